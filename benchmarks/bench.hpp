@@ -0,0 +1,50 @@
+#pragma once
+
+// Helpers shared by the benchmarks. Benchmarks run hosted, with the stubs
+// from tests/stubs.hpp, and report nanoseconds per operation or, for
+// functions over byte ranges, gigabytes per second.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace Bench{
+
+class Timer{
+  public:
+    Timer() noexcept: m_start{std::chrono::steady_clock::now()}{}
+
+    double Seconds() const noexcept{
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+      return elapsed.count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+inline std::uint64_t NextRandom(std::uint64_t& state) noexcept{
+  // splitmix64
+  std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+template<typename T>
+inline void DoNotOptimize(const T& value) noexcept{
+  // forces value to be computed without the compiler seeing it used
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void Report(const char* name, std::size_t count, std::size_t ops, double seconds) noexcept{
+  std::printf("%-32s n=%-9zu %8.2f ns/op\n", name, count, seconds * 1e9 / static_cast<double>(ops));
+}
+
+inline void ReportBandwidth(const char* name, std::size_t bytes, std::size_t total, double seconds) noexcept{
+  // bytes is the size of one input, total the bytes processed over the run
+  std::printf("%-32s n=%-9zu %8.2f GB/s\n", name, bytes, static_cast<double>(total) / seconds * 1e-9);
+}
+
+} // namespace Bench
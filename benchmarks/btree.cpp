@@ -0,0 +1,91 @@
+// BTreeMap against RbTree on random 64 bit keys: insertion, hits and
+// misses, an in-order scan and erasure. Past a few hundred thousand keys the
+// red black tree misses the cache on nearly every level, which is where the
+// B+tree should pull ahead.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "aii/btree.hpp"
+#include "aii/rbtree.hpp"
+
+#include "bench.hpp"
+
+namespace{
+
+template<typename Map>
+void Run(const char* name, const std::vector<std::uint64_t>& keys,
+         const std::vector<std::uint64_t>& misses){
+  char label[64];
+  std::size_t count = keys.size();
+  Map map;
+  {
+    Bench::Timer timer;
+    for(std::uint64_t key : keys){
+      map.Insert(key, key);
+    }
+    std::snprintf(label, sizeof(label), "%s insert", name);
+    Bench::Report(label, count, count, timer.Seconds());
+  }
+  {
+    // look keys up in a different order than they were inserted
+    Bench::Timer timer;
+    std::uint64_t sum = 0;
+    for(std::size_t i = 0; i < count; i++){
+      sum += *map.Find(keys[(i * 7919) % count]);
+    }
+    Bench::DoNotOptimize(sum);
+    std::snprintf(label, sizeof(label), "%s find hit", name);
+    Bench::Report(label, count, count, timer.Seconds());
+  }
+  {
+    Bench::Timer timer;
+    std::size_t found = 0;
+    for(std::uint64_t key : misses){
+      found += map.Contains(key) ? 1 : 0;
+    }
+    Bench::DoNotOptimize(found);
+    std::snprintf(label, sizeof(label), "%s find miss", name);
+    Bench::Report(label, count, misses.size(), timer.Seconds());
+  }
+  {
+    Bench::Timer timer;
+    std::uint64_t sum = 0;
+    for(auto it = map.begin(); it != map.end(); ++it){
+      sum += *it;
+    }
+    Bench::DoNotOptimize(sum);
+    std::snprintf(label, sizeof(label), "%s scan", name);
+    Bench::Report(label, count, count, timer.Seconds());
+  }
+  {
+    Bench::Timer timer;
+    for(std::size_t i = 0; i < count; i++){
+      map.Erase(keys[(i * 7919) % count]);
+    }
+    std::snprintf(label, sizeof(label), "%s erase", name);
+    Bench::Report(label, count, count, timer.Seconds());
+  }
+}
+
+} // namespace
+
+int main(){
+  const std::size_t sizes[] = {1u << 10, 1u << 16, 1u << 20, 1u << 22};
+  for(std::size_t count : sizes){
+    // odd keys hit, even keys miss; the stride used to permute lookups is
+    // prime so it visits every index
+    std::uint64_t state = count;
+    std::vector<std::uint64_t> keys(count);
+    std::vector<std::uint64_t> misses(count);
+    for(std::size_t i = 0; i < count; i++){
+      keys[i] = Bench::NextRandom(state) | 1;
+      misses[i] = Bench::NextRandom(state) & ~std::uint64_t{1};
+    }
+    Run<Aii::RbTree<std::uint64_t, std::uint64_t>>("RbTree", keys, misses);
+    Run<Aii::BTreeMap<std::uint64_t, std::uint64_t>>("BTreeMap", keys, misses);
+    std::printf("\n");
+  }
+  return 0;
+}
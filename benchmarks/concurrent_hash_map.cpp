@@ -0,0 +1,115 @@
+// ConcurrentHashMap against a FlatHashMap behind one SpinLock, with 1 up to
+// hardware_concurrency threads running a lookup heavy mix: 90% finds, 5%
+// replacements and 5% erase or insert pairs over 1M keys. The time reported
+// is wall time over the operations of all threads, so it should fall as
+// threads are added when the map scales.
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "aii/concurrent_hash_map.hpp"
+#include "aii/flat_hash_map.hpp"
+#include "aii/spinlock.hpp"
+
+#include "bench.hpp"
+
+namespace{
+
+constexpr std::uint64_t Keys = 1 << 20;
+constexpr std::size_t OpsPerThread = 2000000;
+
+class LockedMap{
+  public:
+    bool Find(std::uint64_t key){
+      Aii::LockGuard guard{m_lock};
+      return m_map.Find(key) != nullptr;
+    }
+
+    void Assign(std::uint64_t key, std::uint64_t val){
+      Aii::LockGuard guard{m_lock};
+      if(std::uint64_t* found = m_map.Find(key)){
+        *found = val;
+      }
+      else{
+        (void)m_map.Insert(key, val);
+      }
+    }
+
+    void Toggle(std::uint64_t key){
+      Aii::LockGuard guard{m_lock};
+      if(!m_map.Erase(key)){
+        (void)m_map.Insert(key, key);
+      }
+    }
+
+  private:
+    Aii::SpinLock m_lock;
+    Aii::FlatHashMap<std::uint64_t, std::uint64_t> m_map;
+};
+
+class SharedMap{
+  public:
+    bool Find(std::uint64_t key){ return m_map.Find(key).HasVal();}
+    void Assign(std::uint64_t key, std::uint64_t val){ (void)m_map.InsertOrAssign(key, val);}
+    void Toggle(std::uint64_t key){
+      if(!m_map.Erase(key)){
+        (void)m_map.Insert(key, key);
+      }
+    }
+
+  private:
+    Aii::ConcurrentHashMap<std::uint64_t, std::uint64_t> m_map;
+};
+
+template<typename Map>
+void Run(const char* name, unsigned threadCount){
+  Map map;
+  for(std::uint64_t key = 0; key < Keys; key++){
+    map.Assign(key, key);
+  }
+  Bench::Timer timer;
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < threadCount; t++){
+    threads.emplace_back([&map, t]{
+      std::uint64_t state = t + 1;
+      std::uint64_t hits = 0;
+      for(std::size_t i = 0; i < OpsPerThread; i++){
+        std::uint64_t random = Bench::NextRandom(state);
+        std::uint64_t key = random % Keys;
+        unsigned op = (random >> 32) % 100;
+        if(op < 90){
+          hits += map.Find(key);
+        }
+        else if(op < 95){
+          map.Assign(key, i);
+        }
+        else{
+          map.Toggle(key);
+        }
+      }
+      Bench::DoNotOptimize(hits);
+    });
+  }
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  char label[64];
+  std::snprintf(label, sizeof(label), "%s %u threads", name, threadCount);
+  Bench::Report(label, Keys, OpsPerThread * threadCount, timer.Seconds());
+}
+
+} // namespace
+
+int main(){
+  unsigned maxThreads = std::thread::hardware_concurrency();
+  if(maxThreads == 0){
+    maxThreads = 1;
+  }
+  for(unsigned threads = 1; threads <= maxThreads; threads *= 2){
+    Run<LockedMap>("SpinLock+FlatHashMap", threads);
+    Run<SharedMap>("ConcurrentHashMap", threads);
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+// SpinLock, TicketLock, McsLock and QueuedSpinLock with 1 up to
+// hardware_concurrency threads, each taking the lock 1M times around a
+// critical section which updates two cache lines of shared data, with a
+// little private work between acquisitions. The time reported is wall time
+// over the acquisitions of all threads, so the lower bound is one critical
+// section, and how far a lock stays above that as threads are added shows
+// what its handoff costs. The stats build of QueuedSpinLock is run at the
+// largest thread count to show the spins behind it.
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/spinlock.hpp"
+
+#include "bench.hpp"
+
+namespace{
+
+constexpr std::size_t OpsPerThread = 1000000;
+
+struct alignas(Aii::CacheLineSize) Shared{
+  std::uint64_t counters[2 * Aii::CacheLineSize / sizeof(std::uint64_t)];
+};
+
+template<typename L>
+void Acquire(L& lock, Shared& shared, std::uint64_t i){
+  auto update = [&shared, i]{
+    shared.counters[0] += i;
+    shared.counters[Aii::CacheLineSize / sizeof(std::uint64_t)] += 1;
+  };
+  if constexpr(requires{ lock.Lock();}){
+    Aii::LockGuard guard{lock};
+    update();
+  }
+  else{
+    Aii::McsLockGuard guard{lock};
+    update();
+  }
+}
+
+template<typename L>
+void Run(const char* name, unsigned threadCount, L& lock){
+  Shared shared{};
+  Aii::Atomic<bool> start{false};
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < threadCount; t++){
+    threads.emplace_back([&lock, &shared, &start, t]{
+      while(!start.Load(Aii::MemoryOrder::Acquire)){
+        Aii::CpuRelax();
+      }
+      std::uint64_t state = t + 1;
+      for(std::size_t i = 0; i < OpsPerThread; i++){
+        Acquire(lock, shared, i);
+        for(std::uint64_t work = Bench::NextRandom(state) & 15; work; work--){
+          Aii::CpuRelax();
+        }
+      }
+    });
+  }
+  Bench::Timer timer;
+  start.Store(true, Aii::MemoryOrder::Release);
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  double seconds = timer.Seconds();
+  Bench::DoNotOptimize(shared);
+  char label[64];
+  std::snprintf(label, sizeof(label), "%s %u threads", name, threadCount);
+  Bench::Report(label, threadCount, OpsPerThread * threadCount, seconds);
+}
+
+template<typename L>
+void Run(const char* name, unsigned threadCount){
+  L lock;
+  Run(name, threadCount, lock);
+}
+
+} // namespace
+
+int main(){
+  unsigned maxThreads = std::thread::hardware_concurrency();
+  if(maxThreads == 0){
+    maxThreads = 1;
+  }
+  for(unsigned threads = 1; threads <= maxThreads; threads *= 2){
+    Run<Aii::SpinLock>("SpinLock", threads);
+    Run<Aii::TicketLock<>>("TicketLock", threads);
+    Run<Aii::McsLock<>>("McsLock", threads);
+    Run<Aii::QueuedSpinLock<>>("QueuedSpinLock", threads);
+  }
+  Aii::QueuedSpinLock<true> lock;
+  Run("QueuedSpinLock stats", maxThreads, lock);
+  const Aii::LockStats& stats = lock.Stats();
+  std::printf("  %llu of %llu acquisitions contended, %llu spins, longest hold %llu cycles\n",
+              static_cast<unsigned long long>(stats.contended),
+              static_cast<unsigned long long>(stats.acquisitions),
+              static_cast<unsigned long long>(stats.spins),
+              static_cast<unsigned long long>(stats.maxHoldCycles));
+  return 0;
+}
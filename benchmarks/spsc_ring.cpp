@@ -0,0 +1,118 @@
+// SpscRing with a producer and a consumer thread.
+//
+// Throughput streams 10M elements through a 1024 slot ring, one Push and
+// Pop per element and then in batches of 32 with PushN and PopN; the time
+// reported is per element. Latency bounces one element between two rings,
+// so each round trip is two handoffs, and reports half a round trip. Both
+// sides spin without yielding, so on a machine with fewer than two cpus the
+// numbers measure the scheduler rather than the ring.
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "aii/atomic.hpp"
+#include "aii/spsc_ring.hpp"
+
+#include "bench.hpp"
+
+namespace{
+
+constexpr std::uint64_t Count = 10000000;
+constexpr std::uint64_t RoundTrips = 1000000;
+constexpr std::size_t Batch = 32;
+
+using Ring = Aii::SpscRing<std::uint64_t, 1024>;
+
+void Single(Ring& ring){
+  Bench::Timer timer;
+  std::thread producer{[&ring]{
+    for(std::uint64_t i = 0; i < Count; i++){
+      while(!ring.Push(i)){
+        Aii::CpuRelax();
+      }
+    }
+  }};
+  std::uint64_t sum = 0;
+  for(std::uint64_t received = 0; received < Count;){
+    auto val = ring.Pop();
+    if(!val){
+      Aii::CpuRelax();
+      continue;
+    }
+    sum += *val;
+    received++;
+  }
+  producer.join();
+  Bench::DoNotOptimize(sum);
+  Bench::Report("SpscRing Push/Pop", Ring::Capacity(), Count, timer.Seconds());
+}
+
+void Batched(Ring& ring){
+  Bench::Timer timer;
+  std::thread producer{[&ring]{
+    std::uint64_t batch[Batch];
+    for(std::uint64_t next = 0; next < Count;){
+      std::size_t count = Count - next < Batch ? Count - next : Batch;
+      for(std::size_t i = 0; i < count; i++){
+        batch[i] = next + i;
+      }
+      std::size_t pushed = ring.PushN(batch, count);
+      if(!pushed){
+        Aii::CpuRelax();
+      }
+      // the elements which did not fit are rebuilt on the next pass
+      next += pushed;
+    }
+  }};
+  std::uint64_t sum = 0;
+  std::uint64_t batch[Batch];
+  for(std::uint64_t received = 0; received < Count;){
+    std::size_t popped = ring.PopN(batch, Batch);
+    if(!popped){
+      Aii::CpuRelax();
+    }
+    for(std::size_t i = 0; i < popped; i++){
+      sum += batch[i];
+    }
+    received += popped;
+  }
+  producer.join();
+  Bench::DoNotOptimize(sum);
+  Bench::Report("SpscRing PushN/PopN x32", Ring::Capacity(), Count, timer.Seconds());
+}
+
+void Latency(Ring& ping, Ring& pong){
+  Bench::Timer timer;
+  std::thread echo{[&ping, &pong]{
+    for(std::uint64_t i = 0; i < RoundTrips; i++){
+      auto val = ping.Pop();
+      while(!val){
+        Aii::CpuRelax();
+        val = ping.Pop();
+      }
+      (void)pong.Push(*val);
+    }
+  }};
+  for(std::uint64_t i = 0; i < RoundTrips; i++){
+    (void)ping.Push(i);
+    auto val = pong.Pop();
+    while(!val){
+      Aii::CpuRelax();
+      val = pong.Pop();
+    }
+  }
+  echo.join();
+  Bench::Report("SpscRing one way latency", Ring::Capacity(), RoundTrips * 2, timer.Seconds());
+}
+
+} // namespace
+
+int main(){
+  static Ring ring;
+  static Ring pong;
+  Single(ring);
+  Batched(ring);
+  Latency(ring, pong);
+  return 0;
+}
@@ -3,6 +3,8 @@
 #ifdef TEST_HOSTED_ENVIRONMENT
   #include "./../tests/stubs.hpp"
 #else
+#include <cstddef>
+
 namespace Aii::Details{
   // Implement your platform support stubs here
   // see tests/stubs.hpp for an example
@@ -16,7 +18,50 @@ namespace Aii::Details{
   }
 
   template<typename T, typename ...Args>
-  T* Allocate(Args ...args){
+  T* Allocate(Args&& ...args){
+    // ...
+  }
+
+  template<typename T>
+  T* AllocateArray(std::size_t n){
+    // ...
+  }
+
+  template<typename T>
+  void DeleteArray(T* t, std::size_t n){
+    // ...
+  }
+
+  inline std::size_t PageSize(){
+    // granularity of ReserveVirtual, Commit and Decommit
+    // ...
+  }
+
+  inline void* ReserveVirtual(std::size_t bytes){
+    // reserves bytes of address space with no memory behind it, or returns
+    // nullptr. Accessing it before Commit must fault
+    // ...
+  }
+
+  inline bool Commit(void* address, std::size_t bytes){
+    // backs page aligned reserved addresses with readable, writable memory
+    // ...
+  }
+
+  inline void Decommit(void* address, std::size_t bytes){
+    // returns the memory behind page aligned committed addresses, keeping
+    // them reserved
+    // ...
+  }
+
+  inline void ReleaseVirtual(void* address, std::size_t bytes){
+    // frees a whole range returned by ReserveVirtual
+    // ...
+  }
+
+  inline std::size_t CurrentCpu(){
+    // index of the cpu running the caller, counting from 0. Must be cheap,
+    // such as a load from a per cpu segment register
     // ...
   }
 
@@ -10,6 +10,9 @@
 namespace Aii{
   template<typename T>
   class Allocator{
+    public:
+    using ValueType = T;
+
     constexpr Allocator() noexcept = default;
     constexpr ~Allocator() noexcept = default;
 
@@ -18,13 +21,19 @@ namespace Aii{
     }
 
     T* Allocate(std::size_t n) noexcept{
-      return Details::Allocate<T>();
+      // value initialised array of n objects
+      return Details::AllocateArray<T>(n);
     }
 
     void Deallocate(T* obj) noexcept{
       Details::Delete(obj);
     }
 
+    void Deallocate(T* obj, std::size_t n) noexcept{
+      // obj must come from Allocate(n) with the same n
+      Details::DeleteArray(obj, n);
+    }
+
     template<typename U> 
     struct Rebind{
       using other = Allocator<U>;
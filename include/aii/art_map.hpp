@@ -0,0 +1,1081 @@
+#pragma once
+
+// Adaptive radix tree keyed by byte strings, for path component and other
+// string lookups where keys share long prefixes.
+//
+// Each inner node branches on one key byte and comes in four sizes, grown
+// and shrunk as children come and go:
+//
+//  * Node4   - up to 4 children, sorted key bytes searched linearly
+//  * Node16  - up to 16 children, sorted key bytes searched with SSE2
+//  * Node48  - up to 48 children, a 256 entry byte index into the slots
+//  * Node256 - a slot for every byte
+//
+// Chains of single child nodes are collapsed into a prefix stored in the
+// node below them (path compression). The first MaxPrefixLength bytes are
+// kept in the node and lookups skip the rest optimistically, since the full
+// key is compared at the leaf anyway. Memory therefore grows with the number
+// of distinct prefixes rather than the total length of the keys.
+//
+// A key may be a prefix of another: the value for a key which ends at an
+// inner node is held in that node's terminal leaf.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+
+namespace Aii{
+
+template<typename V,
+         typename A = Aii::Allocator<V>>
+class ArtMap{
+  static_assert(Aii::IsAllocator<A>, "ArtMap: A must satisfy Aii::IsAllocator");
+
+  public:
+    using ValueType = V;
+
+    static constexpr std::size_t MaxPrefixLength = 8;
+
+    enum class NodeType: std::uint8_t{
+      Leaf, Node4, Node16, Node48, Node256
+    };
+
+    struct Header{
+      NodeType type;
+    };
+
+    struct Leaf: Header{
+      std::uint8_t* key;
+      std::size_t length;
+      ValueType val;
+    };
+
+    struct Inner: Header{
+      std::uint16_t count;
+      // length of the compressed path above the branch byte, of which the
+      // first MaxPrefixLength bytes are stored
+      std::size_t prefixLength;
+      std::uint8_t prefix[MaxPrefixLength];
+      // value for the key ending at this node
+      Leaf* terminal;
+    };
+
+    struct Node4: Inner{
+      std::uint8_t keys[4];
+      Header* children[4];
+    };
+
+    struct Node16: Inner{
+      std::uint8_t keys[16];
+      Header* children[16];
+    };
+
+    struct Node48: Inner{
+      // slot + 1 of the child for each byte, 0 for none
+      std::uint8_t index[256];
+      Header* children[48];
+    };
+
+    struct Node256: Inner{
+      Header* children[256];
+    };
+
+  private:
+    using LeafAllocType = typename A::template Rebind<Leaf>::other;
+    using ByteAllocType = typename A::template Rebind<std::uint8_t>::other;
+    using Node4AllocType = typename A::template Rebind<Node4>::other;
+    using Node16AllocType = typename A::template Rebind<Node16>::other;
+    using Node48AllocType = typename A::template Rebind<Node48>::other;
+    using Node256AllocType = typename A::template Rebind<Node256>::other;
+
+  public:
+    ArtMap() noexcept;
+    ArtMap(const ArtMap& src) noexcept = delete;
+    ArtMap(ArtMap&& src) noexcept;
+    ArtMap& operator=(const ArtMap& src) noexcept = delete;
+    ArtMap& operator=(ArtMap&& src) noexcept;
+    ~ArtMap() noexcept;
+
+    void Swap(ArtMap& other) noexcept;
+
+    Header* Root() const noexcept{ return m_root;}
+    bool Empty() const noexcept{ return m_root == nullptr;}
+    std::size_t Size() const noexcept{ return m_size;}
+
+    ValueType* Find(const std::uint8_t* key, std::size_t length) const noexcept;
+    ValueType* Find(const char* key) const noexcept;
+    bool Contains(const std::uint8_t* key, std::size_t length) const noexcept{ return Find(key, length) != nullptr;}
+    bool Contains(const char* key) const noexcept{ return Find(key) != nullptr;}
+
+    Aii::Expected<ValueType*, Error> Insert(const std::uint8_t* key, std::size_t length,
+                                           const ValueType& val) noexcept;
+    Aii::Expected<ValueType*, Error> Insert(const char* key, const ValueType& val) noexcept;
+    Aii::Expected<void, Error> Erase(const std::uint8_t* key, std::size_t length) noexcept;
+    Aii::Expected<void, Error> Erase(const char* key) noexcept;
+    void Clear() noexcept;
+
+    template<typename F>
+    std::size_t ForEach(F&& fn) const;
+    template<typename F>
+    std::size_t ForEachPrefix(const std::uint8_t* prefix, std::size_t length, F&& fn) const;
+    template<typename F>
+    std::size_t ForEachPrefix(const char* prefix, F&& fn) const;
+
+  private:
+    static Leaf* AsLeaf(Header* node) noexcept{ return static_cast<Leaf*>(node);}
+    static Inner* AsInner(Header* node) noexcept{ return static_cast<Inner*>(node);}
+    static std::size_t StringLength(const char* str) noexcept;
+    static bool LeafMatches(const Leaf* leaf, const std::uint8_t* key, std::size_t length) noexcept;
+    static Leaf* Minimum(Header* node) noexcept;
+    static std::size_t PrefixMismatch(Inner* inner, const std::uint8_t* key,
+                                      std::size_t length, std::size_t depth) noexcept;
+    static Header** FindChild(Inner* inner, std::uint8_t byte) noexcept;
+    static void AddToNode4(Node4* node, std::uint8_t byte, Header* child) noexcept;
+    static void AttachLeaf(Node4* node, Leaf* leaf, std::size_t depth) noexcept;
+    static void CopyHeader(Inner* dst, const Inner* src) noexcept;
+
+    Leaf* AllocateLeaf(const std::uint8_t* key, std::size_t length, const ValueType& val) noexcept;
+    template<typename Node>
+    Node* AllocateInner(NodeType type) noexcept;
+    void DeallocateNode(Header* node) noexcept;
+    void DeallocateSubtree(Header* node) noexcept;
+
+    Aii::Expected<void, Error> InsertLeaf(Leaf* leaf) noexcept;
+    bool AddChild(Header** ref, Inner* inner, std::uint8_t byte, Header* child) noexcept;
+    void RemoveChild(Header** ref, Inner* inner, std::uint8_t byte, Header** slot) noexcept;
+    void Shrink(Header** ref) noexcept;
+
+    template<typename F>
+    static std::size_t Visit(Header* node, F& fn);
+
+  private:
+    Header* m_root;
+    std::size_t m_size;
+    LeafAllocType m_leafAllocator;
+    ByteAllocType m_byteAllocator;
+    Node4AllocType m_node4Allocator;
+    Node16AllocType m_node16Allocator;
+    Node48AllocType m_node48Allocator;
+    Node256AllocType m_node256Allocator;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename V, typename A>
+Aii::ArtMap<V, A>::ArtMap() noexcept
+  :
+    m_root{nullptr},
+    m_size{0},
+    m_leafAllocator{LeafAllocType()},
+    m_byteAllocator{ByteAllocType()},
+    m_node4Allocator{Node4AllocType()},
+    m_node16Allocator{Node16AllocType()},
+    m_node48Allocator{Node48AllocType()},
+    m_node256Allocator{Node256AllocType()}
+{
+
+}
+
+template<typename V, typename A>
+Aii::ArtMap<V, A>::ArtMap(ArtMap&& src) noexcept
+  :
+    m_root{src.m_root},
+    m_size{src.m_size},
+    m_leafAllocator{std::move(src.m_leafAllocator)},
+    m_byteAllocator{std::move(src.m_byteAllocator)},
+    m_node4Allocator{std::move(src.m_node4Allocator)},
+    m_node16Allocator{std::move(src.m_node16Allocator)},
+    m_node48Allocator{std::move(src.m_node48Allocator)},
+    m_node256Allocator{std::move(src.m_node256Allocator)}
+{
+  src.m_root = nullptr;
+  src.m_size = 0;
+}
+
+template<typename V, typename A>
+auto Aii::ArtMap<V, A>::operator=(ArtMap&& src) noexcept -> ArtMap&{
+  if(this != &src){
+    Clear();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename V, typename A>
+Aii::ArtMap<V, A>::~ArtMap() noexcept{
+  Clear();
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::Swap(ArtMap& other) noexcept{
+  using std::swap;
+  swap(m_root, other.m_root);
+  swap(m_size, other.m_size);
+  swap(m_leafAllocator, other.m_leafAllocator);
+  swap(m_byteAllocator, other.m_byteAllocator);
+  swap(m_node4Allocator, other.m_node4Allocator);
+  swap(m_node16Allocator, other.m_node16Allocator);
+  swap(m_node48Allocator, other.m_node48Allocator);
+  swap(m_node256Allocator, other.m_node256Allocator);
+}
+
+template<typename V, typename A>
+auto Aii::ArtMap<V, A>::AllocateLeaf(const std::uint8_t* key, std::size_t length,
+                                     const ValueType& val) noexcept -> Leaf*{
+  // the leaf owns a copy of the key
+  Leaf* leaf = m_leafAllocator.Allocate();
+  if(!leaf){
+    return nullptr;
+  }
+  leaf->type = NodeType::Leaf;
+  leaf->key = nullptr;
+  leaf->length = length;
+  if(length > 0){
+    leaf->key = m_byteAllocator.Allocate(length);
+    if(!leaf->key){
+      m_leafAllocator.Deallocate(leaf);
+      return nullptr;
+    }
+    for(std::size_t i = 0; i < length; i++){
+      leaf->key[i] = key[i];
+    }
+  }
+  leaf->val = val;
+  return leaf;
+}
+
+template<typename V, typename A> template<typename Node>
+Node* Aii::ArtMap<V, A>::AllocateInner(NodeType type) noexcept{
+  Node* node = nullptr;
+  if constexpr(std::is_same_v<Node, Node4>){
+    node = m_node4Allocator.Allocate();
+  }
+  else if constexpr(std::is_same_v<Node, Node16>){
+    node = m_node16Allocator.Allocate();
+  }
+  else if constexpr(std::is_same_v<Node, Node48>){
+    node = m_node48Allocator.Allocate();
+  }
+  else{
+    node = m_node256Allocator.Allocate();
+  }
+  if(!node){
+    return nullptr;
+  }
+  // the allocator value initialises, so every slot and index starts empty
+  node->type = type;
+  node->count = 0;
+  node->prefixLength = 0;
+  node->terminal = nullptr;
+  return node;
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::DeallocateNode(Header* node) noexcept{
+  switch(node->type){
+    case NodeType::Leaf:
+      if(AsLeaf(node)->key){
+        m_byteAllocator.Deallocate(AsLeaf(node)->key, AsLeaf(node)->length);
+      }
+      m_leafAllocator.Deallocate(AsLeaf(node));
+      break;
+    case NodeType::Node4:
+      m_node4Allocator.Deallocate(static_cast<Node4*>(node));
+      break;
+    case NodeType::Node16:
+      m_node16Allocator.Deallocate(static_cast<Node16*>(node));
+      break;
+    case NodeType::Node48:
+      m_node48Allocator.Deallocate(static_cast<Node48*>(node));
+      break;
+    case NodeType::Node256:
+      m_node256Allocator.Deallocate(static_cast<Node256*>(node));
+      break;
+  }
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::DeallocateSubtree(Header* node) noexcept{
+  // O(n), recursion depth is the number of inner nodes on the longest path
+  if(node->type != NodeType::Leaf){
+    Inner* inner = AsInner(node);
+    if(inner->terminal){
+      DeallocateNode(inner->terminal);
+    }
+    switch(node->type){
+      case NodeType::Node4:
+        for(std::size_t i = 0; i < inner->count; i++){
+          DeallocateSubtree(static_cast<Node4*>(node)->children[i]);
+        }
+        break;
+      case NodeType::Node16:
+        for(std::size_t i = 0; i < inner->count; i++){
+          DeallocateSubtree(static_cast<Node16*>(node)->children[i]);
+        }
+        break;
+      case NodeType::Node48:
+        for(std::size_t i = 0; i < 48; i++){
+          if(static_cast<Node48*>(node)->children[i]){
+            DeallocateSubtree(static_cast<Node48*>(node)->children[i]);
+          }
+        }
+        break;
+      default:
+        for(std::size_t i = 0; i < 256; i++){
+          if(static_cast<Node256*>(node)->children[i]){
+            DeallocateSubtree(static_cast<Node256*>(node)->children[i]);
+          }
+        }
+        break;
+    }
+  }
+  DeallocateNode(node);
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::Clear() noexcept{
+  if(m_root){
+    DeallocateSubtree(m_root);
+  }
+  m_root = nullptr;
+  m_size = 0;
+}
+
+// Helpers
+
+template<typename V, typename A>
+std::size_t Aii::ArtMap<V, A>::StringLength(const char* str) noexcept{
+  std::size_t length = 0;
+  while(str[length]){
+    length++;
+  }
+  return length;
+}
+
+template<typename V, typename A>
+bool Aii::ArtMap<V, A>::LeafMatches(const Leaf* leaf, const std::uint8_t* key, std::size_t length) noexcept{
+  if(leaf->length != length){
+    return false;
+  }
+  for(std::size_t i = 0; i < length; i++){
+    if(leaf->key[i] != key[i]){
+      return false;
+    }
+  }
+  return true;
+}
+
+template<typename V, typename A>
+auto Aii::ArtMap<V, A>::Minimum(Header* node) noexcept -> Leaf*{
+  // leaf with the smallest key below node. Any leaf would do to recover
+  // the unstored part of a prefix, this one is cheapest to reach.
+  while(node->type != NodeType::Leaf){
+    Inner* inner = AsInner(node);
+    if(inner->terminal){
+      return inner->terminal;
+    }
+    switch(node->type){
+      case NodeType::Node4:
+        node = static_cast<Node4*>(node)->children[0];
+        break;
+      case NodeType::Node16:
+        node = static_cast<Node16*>(node)->children[0];
+        break;
+      case NodeType::Node48:{
+        Node48* node48 = static_cast<Node48*>(node);
+        std::size_t byte = 0;
+        while(!node48->index[byte]){
+          byte++;
+        }
+        node = node48->children[node48->index[byte] - 1];
+        break;
+      }
+      default:{
+        Node256* node256 = static_cast<Node256*>(node);
+        std::size_t byte = 0;
+        while(!node256->children[byte]){
+          byte++;
+        }
+        node = node256->children[byte];
+        break;
+      }
+    }
+  }
+  return AsLeaf(node);
+}
+
+template<typename V, typename A>
+std::size_t Aii::ArtMap<V, A>::PrefixMismatch(Inner* inner, const std::uint8_t* key,
+                                              std::size_t length, std::size_t depth) noexcept{
+  // Number of leading bytes of the compressed path of inner matching
+  // key[depth, length). Bytes past the stored ones are read from a leaf.
+  std::size_t limit = inner->prefixLength < length - depth ? inner->prefixLength : length - depth;
+  std::size_t stored = limit < MaxPrefixLength ? limit : MaxPrefixLength;
+  for(std::size_t i = 0; i < stored; i++){
+    if(inner->prefix[i] != key[depth + i]){
+      return i;
+    }
+  }
+  if(limit > MaxPrefixLength){
+    const Leaf* leaf = Minimum(inner);
+    for(std::size_t i = MaxPrefixLength; i < limit; i++){
+      if(leaf->key[depth + i] != key[depth + i]){
+        return i;
+      }
+    }
+  }
+  return limit;
+}
+
+template<typename V, typename A>
+auto Aii::ArtMap<V, A>::FindChild(Inner* inner, std::uint8_t byte) noexcept -> Header**{
+  // slot holding the child for byte, or nullptr
+  switch(inner->type){
+    case NodeType::Node4:{
+      Node4* node = static_cast<Node4*>(inner);
+      for(std::size_t i = 0; i < node->count; i++){
+        if(node->keys[i] == byte){
+          return &node->children[i];
+        }
+      }
+      return nullptr;
+    }
+    case NodeType::Node16:{
+      Node16* node = static_cast<Node16*>(inner);
+#if defined(__SSE2__)
+      // compares all 16 key bytes at once, masking off unused ones
+      __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(node->keys)));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << node->count) - 1);
+      return mask ? &node->children[__builtin_ctz(mask)] : nullptr;
+#else
+      for(std::size_t i = 0; i < node->count; i++){
+        if(node->keys[i] == byte){
+          return &node->children[i];
+        }
+      }
+      return nullptr;
+#endif
+    }
+    case NodeType::Node48:{
+      Node48* node = static_cast<Node48*>(inner);
+      return node->index[byte] ? &node->children[node->index[byte] - 1] : nullptr;
+    }
+    case NodeType::Node256:{
+      Node256* node = static_cast<Node256*>(inner);
+      return node->children[byte] ? &node->children[byte] : nullptr;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::CopyHeader(Inner* dst, const Inner* src) noexcept{
+  dst->count = src->count;
+  dst->prefixLength = src->prefixLength;
+  for(std::size_t i = 0; i < MaxPrefixLength; i++){
+    dst->prefix[i] = src->prefix[i];
+  }
+  dst->terminal = src->terminal;
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::AddToNode4(Node4* node, std::uint8_t byte, Header* child) noexcept{
+  // node must not be full, key bytes stay sorted
+  std::size_t pos = node->count;
+  while(pos > 0 && node->keys[pos - 1] > byte){
+    node->keys[pos] = node->keys[pos - 1];
+    node->children[pos] = node->children[pos - 1];
+    pos--;
+  }
+  node->keys[pos] = byte;
+  node->children[pos] = child;
+  node->count++;
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::AttachLeaf(Node4* node, Leaf* leaf, std::size_t depth) noexcept{
+  // hangs leaf below a node whose path ends at depth
+  if(leaf->length == depth){
+    node->terminal = leaf;
+  }
+  else{
+    AddToNode4(node, leaf->key[depth], leaf);
+  }
+}
+
+// Lookup
+
+template<typename V, typename A>
+auto Aii::ArtMap<V, A>::Find(const std::uint8_t* key, std::size_t length) const noexcept -> ValueType*{
+  // O(length), independent of the number of keys
+  Header* node = m_root;
+  std::size_t depth = 0;
+  while(node){
+    if(node->type == NodeType::Leaf){
+      return LeafMatches(AsLeaf(node), key, length) ? &AsLeaf(node)->val : nullptr;
+    }
+    Inner* inner = AsInner(node);
+    if(inner->prefixLength){
+      // only the stored bytes are checked here, the leaf compare catches
+      // a mismatch in the rest
+      if(inner->prefixLength > length - depth){
+        return nullptr;
+      }
+      std::size_t stored = inner->prefixLength < MaxPrefixLength ? inner->prefixLength : MaxPrefixLength;
+      for(std::size_t i = 0; i < stored; i++){
+        if(inner->prefix[i] != key[depth + i]){
+          return nullptr;
+        }
+      }
+      depth += inner->prefixLength;
+    }
+    if(depth == length){
+      Leaf* leaf = inner->terminal;
+      return leaf && LeafMatches(leaf, key, length) ? &leaf->val : nullptr;
+    }
+    Header** child = FindChild(inner, key[depth]);
+    node = child ? *child : nullptr;
+    depth++;
+  }
+  return nullptr;
+}
+
+template<typename V, typename A>
+auto Aii::ArtMap<V, A>::Find(const char* key) const noexcept -> ValueType*{
+  return Find(reinterpret_cast<const std::uint8_t*>(key), StringLength(key));
+}
+
+// Modification
+
+template<typename V, typename A>
+bool Aii::ArtMap<V, A>::AddChild(Header** ref, Inner* inner, std::uint8_t byte, Header* child) noexcept{
+  // Adds child under byte, replacing a full node with the next larger kind
+  // in *ref. Returns false if that allocation failed, leaving inner as it
+  // was.
+  switch(inner->type){
+    case NodeType::Node4:{
+      Node4* node = static_cast<Node4*>(inner);
+      if(node->count < 4){
+        AddToNode4(node, byte, child);
+        return true;
+      }
+      Node16* grown = AllocateInner<Node16>(NodeType::Node16);
+      if(!grown){
+        return false;
+      }
+      CopyHeader(grown, node);
+      for(std::size_t i = 0; i < 4; i++){
+        grown->keys[i] = node->keys[i];
+        grown->children[i] = node->children[i];
+      }
+      *ref = grown;
+      DeallocateNode(node);
+      return AddChild(ref, grown, byte, child);
+    }
+    case NodeType::Node16:{
+      Node16* node = static_cast<Node16*>(inner);
+      if(node->count < 16){
+        std::size_t pos = node->count;
+        while(pos > 0 && node->keys[pos - 1] > byte){
+          node->keys[pos] = node->keys[pos - 1];
+          node->children[pos] = node->children[pos - 1];
+          pos--;
+        }
+        node->keys[pos] = byte;
+        node->children[pos] = child;
+        node->count++;
+        return true;
+      }
+      Node48* grown = AllocateInner<Node48>(NodeType::Node48);
+      if(!grown){
+        return false;
+      }
+      CopyHeader(grown, node);
+      for(std::size_t i = 0; i < 16; i++){
+        grown->index[node->keys[i]] = static_cast<std::uint8_t>(i + 1);
+        grown->children[i] = node->children[i];
+      }
+      *ref = grown;
+      DeallocateNode(node);
+      return AddChild(ref, grown, byte, child);
+    }
+    case NodeType::Node48:{
+      Node48* node = static_cast<Node48*>(inner);
+      if(node->count < 48){
+        // erased slots are left empty, so take the first free one
+        std::size_t slot = 0;
+        while(node->children[slot]){
+          slot++;
+        }
+        node->children[slot] = child;
+        node->index[byte] = static_cast<std::uint8_t>(slot + 1);
+        node->count++;
+        return true;
+      }
+      Node256* grown = AllocateInner<Node256>(NodeType::Node256);
+      if(!grown){
+        return false;
+      }
+      CopyHeader(grown, node);
+      for(std::size_t i = 0; i < 256; i++){
+        if(node->index[i]){
+          grown->children[i] = node->children[node->index[i] - 1];
+        }
+      }
+      *ref = grown;
+      DeallocateNode(node);
+      return AddChild(ref, grown, byte, child);
+    }
+    default:{
+      Node256* node = static_cast<Node256*>(inner);
+      node->children[byte] = child;
+      node->count++;
+      return true;
+    }
+  }
+}
+
+template<typename V, typename A>
+Aii::Expected<void, Aii::Error> Aii::ArtMap<V, A>::InsertLeaf(Leaf* leaf) noexcept{
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - node allocation failed
+  //
+  // On error, the tree is left in the state before the function call
+  const std::uint8_t* key = leaf->key;
+  std::size_t length = leaf->length;
+  Header** ref = &m_root;
+  std::size_t depth = 0;
+  while(true){
+    Header* node = *ref;
+    if(!node){
+      *ref = leaf;
+      return {};
+    }
+    if(node->type == NodeType::Leaf){
+      // two leaves meet: a Node4 takes their common bytes as its prefix
+      // and branches where they differ
+      Leaf* other = AsLeaf(node);
+      if(LeafMatches(other, key, length)){
+        return {Aii::Error::InvalidArgument};
+      }
+      Node4* split = AllocateInner<Node4>(NodeType::Node4);
+      if(!split){
+        return {Aii::Error::RuntimeError};
+      }
+      std::size_t common = 0;
+      while(depth + common < length && depth + common < other->length &&
+            key[depth + common] == other->key[depth + common]){
+        if(common < MaxPrefixLength){
+          split->prefix[common] = key[depth + common];
+        }
+        common++;
+      }
+      split->prefixLength = common;
+      AttachLeaf(split, other, depth + common);
+      AttachLeaf(split, leaf, depth + common);
+      *ref = split;
+      return {};
+    }
+    Inner* inner = AsInner(node);
+    if(inner->prefixLength){
+      std::size_t mismatch = PrefixMismatch(inner, key, length, depth);
+      if(mismatch < inner->prefixLength){
+        // the key leaves the compressed path part way, so a Node4 takes the
+        // shared part and the old node keeps the rest minus its branch byte
+        Node4* split = AllocateInner<Node4>(NodeType::Node4);
+        if(!split){
+          return {Aii::Error::RuntimeError};
+        }
+        split->prefixLength = mismatch;
+        for(std::size_t i = 0; i < mismatch && i < MaxPrefixLength; i++){
+          split->prefix[i] = key[depth + i];
+        }
+        std::size_t rest = inner->prefixLength - mismatch - 1;
+        if(inner->prefixLength <= MaxPrefixLength){
+          AddToNode4(split, inner->prefix[mismatch], inner);
+          for(std::size_t i = 0; i < rest; i++){
+            inner->prefix[i] = inner->prefix[mismatch + 1 + i];
+          }
+        }
+        else{
+          const Leaf* below = Minimum(inner);
+          AddToNode4(split, below->key[depth + mismatch], inner);
+          for(std::size_t i = 0; i < rest && i < MaxPrefixLength; i++){
+            inner->prefix[i] = below->key[depth + mismatch + 1 + i];
+          }
+        }
+        inner->prefixLength = rest;
+        AttachLeaf(split, leaf, depth + mismatch);
+        *ref = split;
+        return {};
+      }
+      depth += inner->prefixLength;
+    }
+    if(depth == length){
+      if(inner->terminal){
+        return {Aii::Error::InvalidArgument};
+      }
+      inner->terminal = leaf;
+      return {};
+    }
+    Header** child = FindChild(inner, key[depth]);
+    if(!child){
+      if(!AddChild(ref, inner, key[depth], leaf)){
+        return {Aii::Error::RuntimeError};
+      }
+      return {};
+    }
+    ref = child;
+    depth++;
+  }
+}
+
+template<typename V, typename A>
+Aii::Expected<typename Aii::ArtMap<V, A>::ValueType*, Aii::Error>
+Aii::ArtMap<V, A>::Insert(const std::uint8_t* key, std::size_t length, const ValueType& val) noexcept{
+  // O(length)
+  //
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - allocation failed
+  //
+  // On error, the tree is left in the state before the function call
+  Leaf* leaf = AllocateLeaf(key, length, val);
+  if(!leaf){
+    return {Aii::Error::RuntimeError};
+  }
+  auto res = InsertLeaf(leaf);
+  if(!res){
+    DeallocateNode(leaf);
+    return {Aii::Error{res.Error()}};
+  }
+  m_size++;
+  return &leaf->val;
+}
+
+template<typename V, typename A>
+Aii::Expected<typename Aii::ArtMap<V, A>::ValueType*, Aii::Error>
+Aii::ArtMap<V, A>::Insert(const char* key, const ValueType& val) noexcept{
+  return Insert(reinterpret_cast<const std::uint8_t*>(key), StringLength(key), val);
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::RemoveChild(Header** ref, Inner* inner, std::uint8_t byte, Header** slot) noexcept{
+  // unlinks the child in slot, then shrinks the node if it got small
+  switch(inner->type){
+    case NodeType::Node4:{
+      Node4* node = static_cast<Node4*>(inner);
+      for(std::size_t i = slot - node->children + 1; i < node->count; i++){
+        node->keys[i - 1] = node->keys[i];
+        node->children[i - 1] = node->children[i];
+      }
+      break;
+    }
+    case NodeType::Node16:{
+      Node16* node = static_cast<Node16*>(inner);
+      for(std::size_t i = slot - node->children + 1; i < node->count; i++){
+        node->keys[i - 1] = node->keys[i];
+        node->children[i - 1] = node->children[i];
+      }
+      break;
+    }
+    case NodeType::Node48:{
+      Node48* node = static_cast<Node48*>(inner);
+      *slot = nullptr;
+      node->index[byte] = 0;
+      break;
+    }
+    default:
+      *slot = nullptr;
+      break;
+  }
+  inner->count--;
+  Shrink(ref);
+}
+
+template<typename V, typename A>
+void Aii::ArtMap<V, A>::Shrink(Header** ref) noexcept{
+  // Moves the node in *ref to the next smaller kind once it falls well
+  // below its capacity, and removes a Node4 left with a single path. A
+  // failed allocation just keeps the larger node.
+  Inner* inner = AsInner(*ref);
+  switch(inner->type){
+    case NodeType::Node4:{
+      Node4* node = static_cast<Node4*>(inner);
+      if(node->count == 0){
+        // only the terminal leaf is left, and a leaf holds its whole key
+        *ref = node->terminal;
+        DeallocateNode(node);
+      }
+      else if(node->count == 1 && !node->terminal){
+        Header* child = node->children[0];
+        if(child->type != NodeType::Leaf){
+          // the child's path becomes this path, the branch byte and its own
+          Inner* below = AsInner(child);
+          std::uint8_t merged[MaxPrefixLength];
+          std::size_t length = 0;
+          for(std::size_t i = 0; i < node->prefixLength && length < MaxPrefixLength; i++){
+            merged[length++] = node->prefix[i];
+          }
+          if(length < MaxPrefixLength){
+            merged[length++] = node->keys[0];
+          }
+          for(std::size_t i = 0; i < below->prefixLength && length < MaxPrefixLength; i++){
+            merged[length++] = below->prefix[i];
+          }
+          for(std::size_t i = 0; i < length; i++){
+            below->prefix[i] = merged[i];
+          }
+          below->prefixLength += node->prefixLength + 1;
+        }
+        *ref = child;
+        DeallocateNode(node);
+      }
+      break;
+    }
+    case NodeType::Node16:{
+      Node16* node = static_cast<Node16*>(inner);
+      if(node->count > 3){
+        break;
+      }
+      Node4* shrunk = AllocateInner<Node4>(NodeType::Node4);
+      if(!shrunk){
+        break;
+      }
+      CopyHeader(shrunk, node);
+      for(std::size_t i = 0; i < node->count; i++){
+        shrunk->keys[i] = node->keys[i];
+        shrunk->children[i] = node->children[i];
+      }
+      *ref = shrunk;
+      DeallocateNode(node);
+      break;
+    }
+    case NodeType::Node48:{
+      Node48* node = static_cast<Node48*>(inner);
+      if(node->count > 12){
+        break;
+      }
+      Node16* shrunk = AllocateInner<Node16>(NodeType::Node16);
+      if(!shrunk){
+        break;
+      }
+      CopyHeader(shrunk, node);
+      std::size_t pos = 0;
+      for(std::size_t byte = 0; byte < 256; byte++){
+        if(node->index[byte]){
+          shrunk->keys[pos] = static_cast<std::uint8_t>(byte);
+          shrunk->children[pos] = node->children[node->index[byte] - 1];
+          pos++;
+        }
+      }
+      *ref = shrunk;
+      DeallocateNode(node);
+      break;
+    }
+    default:{
+      Node256* node = static_cast<Node256*>(inner);
+      if(node->count > 37){
+        break;
+      }
+      Node48* shrunk = AllocateInner<Node48>(NodeType::Node48);
+      if(!shrunk){
+        break;
+      }
+      CopyHeader(shrunk, node);
+      std::size_t slot = 0;
+      for(std::size_t byte = 0; byte < 256; byte++){
+        if(node->children[byte]){
+          shrunk->children[slot] = node->children[byte];
+          shrunk->index[byte] = static_cast<std::uint8_t>(slot + 1);
+          slot++;
+        }
+      }
+      *ref = shrunk;
+      DeallocateNode(node);
+      break;
+    }
+  }
+}
+
+template<typename V, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::ArtMap<V, A>::Erase(const std::uint8_t* key, std::size_t length) noexcept{
+  // O(length)
+  //
+  // Possible Errors:
+  //  OutOfRange - the key is not present
+  if(!m_root){
+    return {Aii::Error::OutOfRange};
+  }
+  if(m_root->type == NodeType::Leaf){
+    if(!LeafMatches(AsLeaf(m_root), key, length)){
+      return {Aii::Error::OutOfRange};
+    }
+    DeallocateNode(m_root);
+    m_root = nullptr;
+    m_size--;
+    return {};
+  }
+  // leaves are removed by the inner node above them
+  Header** ref = &m_root;
+  std::size_t depth = 0;
+  while(true){
+    Inner* inner = AsInner(*ref);
+    if(inner->prefixLength){
+      if(inner->prefixLength > length - depth){
+        return {Aii::Error::OutOfRange};
+      }
+      std::size_t stored = inner->prefixLength < MaxPrefixLength ? inner->prefixLength : MaxPrefixLength;
+      for(std::size_t i = 0; i < stored; i++){
+        if(inner->prefix[i] != key[depth + i]){
+          return {Aii::Error::OutOfRange};
+        }
+      }
+      depth += inner->prefixLength;
+    }
+    if(depth == length){
+      Leaf* leaf = inner->terminal;
+      if(!leaf || !LeafMatches(leaf, key, length)){
+        return {Aii::Error::OutOfRange};
+      }
+      inner->terminal = nullptr;
+      DeallocateNode(leaf);
+      Shrink(ref);
+      m_size--;
+      return {};
+    }
+    Header** child = FindChild(inner, key[depth]);
+    if(!child){
+      return {Aii::Error::OutOfRange};
+    }
+    if((*child)->type == NodeType::Leaf){
+      Leaf* leaf = AsLeaf(*child);
+      if(!LeafMatches(leaf, key, length)){
+        return {Aii::Error::OutOfRange};
+      }
+      RemoveChild(ref, inner, key[depth], child);
+      DeallocateNode(leaf);
+      m_size--;
+      return {};
+    }
+    ref = child;
+    depth++;
+  }
+}
+
+template<typename V, typename A>
+Aii::Expected<void, Aii::Error> Aii::ArtMap<V, A>::Erase(const char* key) noexcept{
+  return Erase(reinterpret_cast<const std::uint8_t*>(key), StringLength(key));
+}
+
+// Scans
+
+template<typename V, typename A> template<typename F>
+std::size_t Aii::ArtMap<V, A>::Visit(Header* node, F& fn){
+  // calls fn for every leaf below node in key order: a key ending at a node
+  // sorts before every key passing through it
+  if(node->type == NodeType::Leaf){
+    Leaf* leaf = AsLeaf(node);
+    fn(const_cast<const std::uint8_t*>(leaf->key), leaf->length, leaf->val);
+    return 1;
+  }
+  Inner* inner = AsInner(node);
+  std::size_t count = inner->terminal ? Visit(inner->terminal, fn) : 0;
+  switch(node->type){
+    case NodeType::Node4:
+      for(std::size_t i = 0; i < inner->count; i++){
+        count += Visit(static_cast<Node4*>(node)->children[i], fn);
+      }
+      break;
+    case NodeType::Node16:
+      for(std::size_t i = 0; i < inner->count; i++){
+        count += Visit(static_cast<Node16*>(node)->children[i], fn);
+      }
+      break;
+    case NodeType::Node48:{
+      Node48* node48 = static_cast<Node48*>(node);
+      for(std::size_t byte = 0; byte < 256; byte++){
+        if(node48->index[byte]){
+          count += Visit(node48->children[node48->index[byte] - 1], fn);
+        }
+      }
+      break;
+    }
+    default:
+      for(std::size_t byte = 0; byte < 256; byte++){
+        if(static_cast<Node256*>(node)->children[byte]){
+          count += Visit(static_cast<Node256*>(node)->children[byte], fn);
+        }
+      }
+      break;
+  }
+  return count;
+}
+
+template<typename V, typename A> template<typename F>
+std::size_t Aii::ArtMap<V, A>::ForEach(F&& fn) const{
+  // calls fn(key, length, val) for every entry in lexicographic key order,
+  // returns the number of calls
+  return m_root ? Visit(m_root, fn) : 0;
+}
+
+template<typename V, typename A> template<typename F>
+std::size_t Aii::ArtMap<V, A>::ForEachPrefix(const std::uint8_t* prefix, std::size_t length, F&& fn) const{
+  // Calls fn(key, length, val) for every entry whose key starts with
+  // prefix, in key order. Finding the subtree costs O(length), after which
+  // every node visited holds matching keys only.
+  Header* node = m_root;
+  std::size_t depth = 0;
+  while(node){
+    if(node->type == NodeType::Leaf){
+      Leaf* leaf = AsLeaf(node);
+      if(leaf->length < length){
+        return 0;
+      }
+      for(std::size_t i = 0; i < length; i++){
+        if(leaf->key[i] != prefix[i]){
+          return 0;
+        }
+      }
+      return Visit(node, fn);
+    }
+    Inner* inner = AsInner(node);
+    if(inner->prefixLength){
+      std::size_t mismatch = PrefixMismatch(inner, prefix, length, depth);
+      if(mismatch < inner->prefixLength){
+        // either prefix ends inside the compressed path, and every key
+        // below matches, or it leaves the path and none does
+        return depth + mismatch == length ? Visit(node, fn) : 0;
+      }
+      depth += inner->prefixLength;
+    }
+    if(depth == length){
+      return Visit(node, fn);
+    }
+    Header** child = FindChild(inner, prefix[depth]);
+    node = child ? *child : nullptr;
+    depth++;
+  }
+  return 0;
+}
+
+template<typename V, typename A> template<typename F>
+std::size_t Aii::ArtMap<V, A>::ForEachPrefix(const char* prefix, F&& fn) const{
+  return ForEachPrefix(reinterpret_cast<const std::uint8_t*>(prefix), StringLength(prefix), fn);
+}
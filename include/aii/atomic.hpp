@@ -0,0 +1,199 @@
+#pragma once
+
+// Atomic operations for freestanding builds, where neither <atomic> nor
+// libatomic is available.
+//
+// Everything here is a thin, always inlined wrapper over the compiler's
+// __atomic builtins, so it compiles to the same instructions as std::atomic
+// (tests/atomic.cpp checks this on x86-64) and works at -O0. Every
+// operation takes an explicit MemoryOrder, defaulting to SeqCst as
+// std::atomic does.
+//
+// Atomic<T> holds a T only ever accessed atomically. AtomicLoad, AtomicStore
+// and friends act on a plain object instead, like std::atomic_ref, for
+// fields which are also read and written plainly while a lock excludes
+// other cpus, such as the links of a list.
+//
+// Types too large for the cpu's atomic instructions would need libatomic,
+// so Atomic<T> refuses them at compile time.
+
+#include <cstddef>
+#include <type_traits>
+
+namespace Aii{
+
+enum class MemoryOrder: int{
+  Relaxed = __ATOMIC_RELAXED,
+  Acquire = __ATOMIC_ACQUIRE,
+  Release = __ATOMIC_RELEASE,
+  AcqRel = __ATOMIC_ACQ_REL,
+  SeqCst = __ATOMIC_SEQ_CST
+};
+
+namespace Details{
+
+constexpr int ToBuiltin(MemoryOrder order) noexcept{ return static_cast<int>(order);}
+
+constexpr MemoryOrder FailureOrder(MemoryOrder order) noexcept{
+  // strongest order allowed for the load of a failed compare and swap,
+  // which cannot release
+  return order == MemoryOrder::AcqRel ? MemoryOrder::Acquire
+       : order == MemoryOrder::Release ? MemoryOrder::Relaxed : order;
+}
+
+template<typename T>
+concept IsAtomicArithmetic = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+} // namespace Details
+
+// Operations on plain objects
+
+template<typename T>
+[[gnu::always_inline]] inline T AtomicLoad(const T* obj, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+  if constexpr(std::is_integral_v<T> || std::is_pointer_v<T>){
+    return __atomic_load_n(obj, Details::ToBuiltin(order));
+  }
+  else{
+    T val;
+    __atomic_load(obj, &val, Details::ToBuiltin(order));
+    return val;
+  }
+}
+
+template<typename T>
+[[gnu::always_inline]] inline void AtomicStore(T* obj, std::type_identity_t<T> val, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+  if constexpr(std::is_integral_v<T> || std::is_pointer_v<T>){
+    __atomic_store_n(obj, val, Details::ToBuiltin(order));
+  }
+  else{
+    __atomic_store(obj, &val, Details::ToBuiltin(order));
+  }
+}
+
+template<typename T>
+[[gnu::always_inline]] inline T AtomicExchange(T* obj, std::type_identity_t<T> val, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+  if constexpr(std::is_integral_v<T> || std::is_pointer_v<T>){
+    return __atomic_exchange_n(obj, val, Details::ToBuiltin(order));
+  }
+  else{
+    T old;
+    __atomic_exchange(obj, &val, &old, Details::ToBuiltin(order));
+    return old;
+  }
+}
+
+template<typename T>
+[[gnu::always_inline]] inline bool AtomicCompareExchange(T* obj, T& expected, std::type_identity_t<T> desired,
+                                                         MemoryOrder success, MemoryOrder failure, bool weak = false) noexcept{
+  // stores desired if obj holds expected, and otherwise loads obj into
+  // expected. A weak exchange may fail spuriously, which is cheaper in a
+  // retry loop on load linked/store conditional cpus
+  if constexpr(std::is_integral_v<T> || std::is_pointer_v<T>){
+    return __atomic_compare_exchange_n(obj, &expected, desired, weak,
+                                       Details::ToBuiltin(success), Details::ToBuiltin(failure));
+  }
+  else{
+    return __atomic_compare_exchange(obj, &expected, &desired, weak,
+                                     Details::ToBuiltin(success), Details::ToBuiltin(failure));
+  }
+}
+
+[[gnu::always_inline]] inline void ThreadFence(MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+  // orders the calling cpu's accesses against other cpus
+  __atomic_thread_fence(Details::ToBuiltin(order));
+}
+
+[[gnu::always_inline]] inline void SignalFence(MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+  // orders accesses against an interrupt or signal handler on the same cpu;
+  // only restrains the compiler
+  __atomic_signal_fence(Details::ToBuiltin(order));
+}
+
+[[gnu::always_inline]] inline void CpuRelax() noexcept{
+  // tells the cpu it is in a spin loop, saving power and a memory order
+  // flush on exit from the loop
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+template<typename T>
+class Atomic{
+  static_assert(std::is_trivially_copyable_v<T>, "Atomic: T must be trivially copyable");
+  static_assert(__atomic_always_lock_free(sizeof(T), 0), "Atomic: T is too large for the cpu's atomic instructions");
+
+  public:
+    using ValueType = T;
+
+    constexpr Atomic() noexcept: m_val{}{}
+    constexpr Atomic(T val) noexcept: m_val{val}{}
+    Atomic(const Atomic& src) noexcept = delete;
+    Atomic& operator=(const Atomic& src) noexcept = delete;
+
+    [[gnu::always_inline]] T Load(MemoryOrder order = MemoryOrder::SeqCst) const noexcept{
+      return AtomicLoad(&m_val, order);
+    }
+    [[gnu::always_inline]] void Store(T val, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+      AtomicStore(&m_val, val, order);
+    }
+    [[gnu::always_inline]] T Exchange(T val, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+      return AtomicExchange(&m_val, val, order);
+    }
+
+    [[gnu::always_inline]] bool CompareExchangeStrong(T& expected, T desired, MemoryOrder success, MemoryOrder failure) noexcept{
+      return AtomicCompareExchange(&m_val, expected, desired, success, failure);
+    }
+    [[gnu::always_inline]] bool CompareExchangeStrong(T& expected, T desired, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+      return AtomicCompareExchange(&m_val, expected, desired, order, Details::FailureOrder(order));
+    }
+    [[gnu::always_inline]] bool CompareExchangeWeak(T& expected, T desired, MemoryOrder success, MemoryOrder failure) noexcept{
+      return AtomicCompareExchange(&m_val, expected, desired, success, failure, true);
+    }
+    [[gnu::always_inline]] bool CompareExchangeWeak(T& expected, T desired, MemoryOrder order = MemoryOrder::SeqCst) noexcept{
+      return AtomicCompareExchange(&m_val, expected, desired, order, Details::FailureOrder(order), true);
+    }
+
+    // Integers; each returns the value before the operation
+
+    [[gnu::always_inline]] T FetchAdd(T arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires Details::IsAtomicArithmetic<T>{
+      return __atomic_fetch_add(&m_val, arg, Details::ToBuiltin(order));
+    }
+    [[gnu::always_inline]] T FetchSub(T arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires Details::IsAtomicArithmetic<T>{
+      return __atomic_fetch_sub(&m_val, arg, Details::ToBuiltin(order));
+    }
+    [[gnu::always_inline]] T FetchAnd(T arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires Details::IsAtomicArithmetic<T>{
+      return __atomic_fetch_and(&m_val, arg, Details::ToBuiltin(order));
+    }
+    [[gnu::always_inline]] T FetchOr(T arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires Details::IsAtomicArithmetic<T>{
+      return __atomic_fetch_or(&m_val, arg, Details::ToBuiltin(order));
+    }
+    [[gnu::always_inline]] T FetchXor(T arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires Details::IsAtomicArithmetic<T>{
+      return __atomic_fetch_xor(&m_val, arg, Details::ToBuiltin(order));
+    }
+
+    // Pointers move by whole objects, as with built in pointer arithmetic;
+    // the builtins alone would add bytes
+
+    [[gnu::always_inline]] T FetchAdd(std::ptrdiff_t arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires std::is_pointer_v<T>{
+      return __atomic_fetch_add(&m_val, arg * static_cast<std::ptrdiff_t>(sizeof(*m_val)), Details::ToBuiltin(order));
+    }
+    [[gnu::always_inline]] T FetchSub(std::ptrdiff_t arg, MemoryOrder order = MemoryOrder::SeqCst) noexcept
+      requires std::is_pointer_v<T>{
+      return __atomic_fetch_sub(&m_val, arg * static_cast<std::ptrdiff_t>(sizeof(*m_val)), Details::ToBuiltin(order));
+    }
+
+  private:
+    // aligned to its size, so on 32 bit cpus an 8 byte T is not split
+    // across cache lines
+    alignas(sizeof(T) > alignof(T) ? sizeof(T) : alignof(T)) T m_val;
+};
+
+} // namespace Aii
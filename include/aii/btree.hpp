@@ -0,0 +1,825 @@
+#pragma once
+
+// B+tree keyed map, a cache conscious alternative to RbTree for large key
+// sets. Keys can be any type ordered by operator<.
+//
+// Nodes are NodeBytes long and cache line aligned, so a lookup misses once
+// per level of a tree a handful of levels deep instead of once per level of
+// a binary tree. Keys are stored apart from values and child pointers, so
+// the in-node search only touches key lines, and 32 and 64 bit integer keys
+// are compared several at a time when SSE2 (SSE4.2 for 64 bit keys) is
+// available. Every element lives in a leaf and the leaves are linked in key
+// order, so range scans walk consecutive nodes without going back up.
+//
+// The element interface matches RbTree so callers can switch by typedef.
+// Unlike RbTree, elements move between nodes when the tree changes, so value
+// pointers and iterators are invalidated by Insert, Erase and AssignSorted.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__)
+  #include <nmmintrin.h>
+#endif
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+
+namespace Aii{
+
+namespace Details{
+
+template<typename K>
+std::size_t BTreeCountLess(const K* keys, std::size_t count, const K& key) noexcept;
+
+} // namespace Details
+
+template<typename K,
+         typename V,
+         std::size_t NodeBytes = 4 * Aii::CacheLineSize,
+         typename A = Aii::Allocator<K>>
+class BTreeMap{
+  static_assert(Aii::IsAllocator<A>, "BTreeMap: A must satisfy Aii::IsAllocator");
+  static_assert(NodeBytes % Aii::CacheLineSize == 0,
+      "BTreeMap: NodeBytes must be a multiple of the cache line size");
+
+  // count and the leaf link, or count and the extra child of an inner node
+  static constexpr std::size_t HeaderBytes = 2 * sizeof(void*);
+
+  public:
+    using KeyType = K;
+    using ValueType = V;
+
+    static constexpr std::size_t LeafCapacity = (NodeBytes - HeaderBytes) / (sizeof(K) + sizeof(V));
+    static constexpr std::size_t InnerCapacity = (NodeBytes - HeaderBytes) / (sizeof(K) + sizeof(void*));
+
+    // fewest elements (leaf) or keys (inner) a node other than the root holds
+    static constexpr std::size_t LeafMinimum = LeafCapacity / 2;
+    static constexpr std::size_t InnerMinimum = (InnerCapacity - 1) / 2;
+
+    static_assert(LeafCapacity >= 2, "BTreeMap: NodeBytes is too small for K and V");
+    static_assert(InnerCapacity >= 3, "BTreeMap: NodeBytes is too small for K");
+
+    struct NodeBase{
+      std::uint32_t count;
+    };
+
+    struct alignas(Aii::CacheLineSize) Leaf: NodeBase{
+      Leaf* next;
+      KeyType keys[LeafCapacity];
+      ValueType vals[LeafCapacity];
+    };
+
+    // children[i] holds the keys k with keys[i - 1] <= k < keys[i]
+    struct alignas(Aii::CacheLineSize) Inner: NodeBase{
+      KeyType keys[InnerCapacity];
+      NodeBase* children[InnerCapacity + 1];
+    };
+
+    static_assert(sizeof(Leaf) == NodeBytes, "BTreeMap: padding pushes a leaf past NodeBytes");
+    static_assert(sizeof(Inner) == NodeBytes, "BTreeMap: padding pushes an inner node past NodeBytes");
+
+    class Iterator{
+      public:
+        constexpr Iterator() noexcept: m_leaf{nullptr}, m_index{0}{}
+        constexpr Iterator(Leaf* leaf, std::size_t index) noexcept: m_leaf{leaf}, m_index{index}{}
+
+        const KeyType& Key() const noexcept{ return m_leaf->keys[m_index];}
+        ValueType& Val() const noexcept{ return m_leaf->vals[m_index];}
+        Leaf* GetLeaf() const noexcept{ return m_leaf;}
+
+        ValueType& operator*() const noexcept{ return m_leaf->vals[m_index];}
+        ValueType* operator->() const noexcept{ return &m_leaf->vals[m_index];}
+
+        Iterator& operator++() noexcept;
+        Iterator operator++(int) noexcept{ Iterator tmp = *this; ++(*this); return tmp;}
+
+        constexpr bool operator==(const Iterator& rhs) const noexcept{
+          return m_leaf == rhs.m_leaf && m_index == rhs.m_index;
+        }
+        constexpr bool operator!=(const Iterator& rhs) const noexcept{ return !(*this == rhs);}
+
+      private:
+        Leaf* m_leaf;
+        std::size_t m_index;
+    };
+
+  private:
+    using LeafAllocType = typename A::template Rebind<Leaf>::other;
+    using InnerAllocType = typename A::template Rebind<Inner>::other;
+
+  public:
+    BTreeMap() noexcept;
+    BTreeMap(const BTreeMap& src) noexcept = delete;
+    BTreeMap(BTreeMap&& src) noexcept;
+    BTreeMap& operator=(const BTreeMap& src) noexcept = delete;
+    BTreeMap& operator=(BTreeMap&& src) noexcept;
+    ~BTreeMap() noexcept;
+
+    void Swap(BTreeMap& other) noexcept;
+
+    NodeBase* Root() const noexcept{ return m_root;}
+    // number of inner levels above the leaves
+    std::size_t Height() const noexcept{ return m_height;}
+    bool Empty() const noexcept{ return m_root == nullptr;}
+    std::size_t Size() const noexcept{ return m_size;}
+
+    Iterator begin() const noexcept;
+    Iterator end() const noexcept{ return Iterator{};}
+    Iterator LowerBound(const KeyType& key) const noexcept;
+
+    ValueType* Find(const KeyType& key) const noexcept;
+    bool Contains(const KeyType& key) const noexcept{ return Find(key) != nullptr;}
+
+    Aii::Expected<ValueType*, Error> Insert(const KeyType& key, const ValueType& val) noexcept;
+    Aii::Expected<void, Error> Erase(const KeyType& key) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> AssignSorted(const KeyType* keys, const ValueType* vals,
+                                            std::size_t count) noexcept;
+
+  private:
+    static Leaf* AsLeaf(NodeBase* node) noexcept{ return static_cast<Leaf*>(node);}
+    static Inner* AsInner(NodeBase* node) noexcept{ return static_cast<Inner*>(node);}
+    static std::size_t Route(const Inner* inner, const KeyType& key) noexcept;
+    static std::size_t Capacity(std::size_t level) noexcept;
+    static std::size_t Minimum(std::size_t level) noexcept;
+    static std::size_t SubtreeCapacity(std::size_t level) noexcept;
+
+    Leaf* AllocateLeaf() noexcept;
+    Inner* AllocateInner() noexcept;
+    void DeallocateNode(NodeBase* node, std::size_t level) noexcept;
+    void DeallocateSubtree(NodeBase* node, std::size_t level) noexcept;
+    NodeBase* BuildSorted(const KeyType* keys, const ValueType* vals, std::size_t first,
+                          std::size_t count, std::size_t level, Leaf*& tail) noexcept;
+
+    bool SplitChild(Inner* parent, std::size_t index, std::size_t level) noexcept;
+    std::size_t FixChild(Inner* parent, std::size_t index, std::size_t level) noexcept;
+    static void BorrowFromLeft(Inner* parent, std::size_t index, std::size_t level) noexcept;
+    static void BorrowFromRight(Inner* parent, std::size_t index, std::size_t level) noexcept;
+    void MergeChildren(Inner* parent, std::size_t index, std::size_t level) noexcept;
+
+  private:
+    NodeBase* m_root;
+    std::size_t m_height;
+    std::size_t m_size;
+    LeafAllocType m_leafAllocator;
+    InnerAllocType m_innerAllocator;
+};
+
+} // namespace Aii
+
+template<typename K>
+std::size_t Aii::Details::BTreeCountLess(const K* keys, std::size_t count, const K& key) noexcept{
+  // Index of the first key not less than key in the sorted keys[0, count).
+  //
+  // Integer keys are counted with branch free comparisons, which beat a
+  // binary search at node sizes since nothing is mispredicted, and several
+  // at a time where SIMD is available. Other keys use a binary search.
+  if constexpr(std::is_integral_v<K>){
+    std::size_t index = 0;
+    std::size_t less = 0;
+#if defined(__SSE2__)
+    if constexpr(sizeof(K) == 4){
+      // SSE2 only compares signed lanes, flipping the sign bit orders
+      // unsigned keys the same way
+      constexpr std::uint32_t bias = std::is_signed_v<K> ? 0 : 0x80000000u;
+      const __m128i biasLanes = _mm_set1_epi32(static_cast<int>(bias));
+      const __m128i needle = _mm_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(key) ^ bias));
+      for(; index + 4 <= count; index += 4){
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + index));
+        __m128i lt = _mm_cmpgt_epi32(needle, _mm_xor_si128(lanes, biasLanes));
+        less += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+      }
+    }
+#endif
+#if defined(__SSE4_2__)
+    if constexpr(sizeof(K) == 8){
+      constexpr std::uint64_t bias = std::is_signed_v<K> ? 0 : 0x8000000000000000ull;
+      const __m128i biasLanes = _mm_set1_epi64x(static_cast<long long>(bias));
+      const __m128i needle = _mm_set1_epi64x(static_cast<long long>(static_cast<std::uint64_t>(key) ^ bias));
+      for(; index + 2 <= count; index += 2){
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + index));
+        __m128i lt = _mm_cmpgt_epi64(needle, _mm_xor_si128(lanes, biasLanes));
+        less += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(lt)));
+      }
+    }
+#endif
+    for(; index < count; index++){
+      less += keys[index] < key ? 1 : 0;
+    }
+    return less;
+  }
+  else{
+    std::size_t first = 0;
+    while(count > 0){
+      std::size_t half = count / 2;
+      if(keys[first + half] < key){
+        first += half + 1;
+        count -= half + 1;
+      }
+      else{
+        count = half;
+      }
+    }
+    return first;
+  }
+}
+
+// Iterator
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::Iterator::operator++() noexcept -> Iterator&{
+  // leaves are never empty, so stepping off the end of one lands on the
+  // first element of the next
+  if(++m_index == m_leaf->count){
+    m_leaf = m_leaf->next;
+    m_index = 0;
+  }
+  return *this;
+}
+
+// Construction
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+Aii::BTreeMap<K, V, NodeBytes, A>::BTreeMap() noexcept
+  :
+    m_root{nullptr},
+    m_height{0},
+    m_size{0},
+    m_leafAllocator{LeafAllocType()},
+    m_innerAllocator{InnerAllocType()}
+{
+
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+Aii::BTreeMap<K, V, NodeBytes, A>::BTreeMap(BTreeMap&& src) noexcept
+  :
+    m_root{src.m_root},
+    m_height{src.m_height},
+    m_size{src.m_size},
+    m_leafAllocator{std::move(src.m_leafAllocator)},
+    m_innerAllocator{std::move(src.m_innerAllocator)}
+{
+  src.m_root = nullptr;
+  src.m_height = 0;
+  src.m_size = 0;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::operator=(BTreeMap&& src) noexcept -> BTreeMap&{
+  if(this != &src){
+    Clear();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+Aii::BTreeMap<K, V, NodeBytes, A>::~BTreeMap() noexcept{
+  Clear();
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::Swap(BTreeMap& other) noexcept{
+  using std::swap;
+  swap(m_root, other.m_root);
+  swap(m_height, other.m_height);
+  swap(m_size, other.m_size);
+  swap(m_leafAllocator, other.m_leafAllocator);
+  swap(m_innerAllocator, other.m_innerAllocator);
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::AllocateLeaf() noexcept -> Leaf*{
+  Leaf* leaf = m_leafAllocator.Allocate();
+  if(!leaf){
+    return nullptr;
+  }
+  leaf->count = 0;
+  leaf->next = nullptr;
+  return leaf;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::AllocateInner() noexcept -> Inner*{
+  Inner* inner = m_innerAllocator.Allocate();
+  if(!inner){
+    return nullptr;
+  }
+  inner->count = 0;
+  return inner;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::DeallocateNode(NodeBase* node, std::size_t level) noexcept{
+  if(level == 0){
+    m_leafAllocator.Deallocate(AsLeaf(node));
+  }
+  else{
+    m_innerAllocator.Deallocate(AsInner(node));
+  }
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::DeallocateSubtree(NodeBase* node, std::size_t level) noexcept{
+  // O(n), recursion depth is the height of the tree
+  if(level > 0){
+    Inner* inner = AsInner(node);
+    for(std::size_t i = 0; i <= inner->count; i++){
+      DeallocateSubtree(inner->children[i], level - 1);
+    }
+  }
+  DeallocateNode(node, level);
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::Clear() noexcept{
+  if(m_root){
+    DeallocateSubtree(m_root, m_height);
+  }
+  m_root = nullptr;
+  m_height = 0;
+  m_size = 0;
+}
+
+// Node geometry
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+std::size_t Aii::BTreeMap<K, V, NodeBytes, A>::Capacity(std::size_t level) noexcept{
+  return level == 0 ? LeafCapacity : InnerCapacity;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+std::size_t Aii::BTreeMap<K, V, NodeBytes, A>::Minimum(std::size_t level) noexcept{
+  return level == 0 ? LeafMinimum : InnerMinimum;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+std::size_t Aii::BTreeMap<K, V, NodeBytes, A>::SubtreeCapacity(std::size_t level) noexcept{
+  // most elements a subtree rooted at level can hold, saturating
+  std::size_t capacity = LeafCapacity;
+  for(; level > 0; level--){
+    if(capacity > ~std::size_t{0} / (InnerCapacity + 1)){
+      return ~std::size_t{0};
+    }
+    capacity *= InnerCapacity + 1;
+  }
+  return capacity;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+std::size_t Aii::BTreeMap<K, V, NodeBytes, A>::Route(const Inner* inner, const KeyType& key) noexcept{
+  // index of the child whose key range holds key
+  std::size_t index = Details::BTreeCountLess(inner->keys, inner->count, key);
+  if(index < inner->count && !(key < inner->keys[index])){
+    index++;
+  }
+  return index;
+}
+
+// Lookup
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::begin() const noexcept -> Iterator{
+  if(!m_root){
+    return end();
+  }
+  NodeBase* node = m_root;
+  for(std::size_t level = m_height; level > 0; level--){
+    node = AsInner(node)->children[0];
+  }
+  return Iterator{AsLeaf(node), 0};
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::LowerBound(const KeyType& key) const noexcept -> Iterator{
+  // first element whose key is not less than key, O(log n)
+  if(!m_root){
+    return end();
+  }
+  NodeBase* node = m_root;
+  for(std::size_t level = m_height; level > 0; level--){
+    node = AsInner(node)->children[Route(AsInner(node), key)];
+  }
+  Leaf* leaf = AsLeaf(node);
+  std::size_t index = Details::BTreeCountLess(leaf->keys, leaf->count, key);
+  if(index == leaf->count){
+    // every key of the next leaf is at least the separator key was routed by
+    return Iterator{leaf->next, 0};
+  }
+  return Iterator{leaf, index};
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::Find(const KeyType& key) const noexcept -> ValueType*{
+  // O(log n), one node visit per level
+  if(!m_root){
+    return nullptr;
+  }
+  NodeBase* node = m_root;
+  for(std::size_t level = m_height; level > 0; level--){
+    node = AsInner(node)->children[Route(AsInner(node), key)];
+  }
+  Leaf* leaf = AsLeaf(node);
+  std::size_t index = Details::BTreeCountLess(leaf->keys, leaf->count, key);
+  if(index < leaf->count && !(key < leaf->keys[index])){
+    return &leaf->vals[index];
+  }
+  return nullptr;
+}
+
+// Single element modification. Both walk down from the root once, fixing
+// up each child before entering it: Insert splits full children and Erase
+// refills children at their minimum, so the leaf can always absorb the
+// change and nothing has to propagate back up.
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+Aii::Expected<typename Aii::BTreeMap<K, V, NodeBytes, A>::ValueType*, Aii::Error>
+Aii::BTreeMap<K, V, NodeBytes, A>::Insert(const KeyType& key, const ValueType& val) noexcept{
+  // O(log n)
+  //
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - node allocation failed
+  //
+  // Splits made on the way down before an error are kept, the tree stays
+  // valid and holds the same elements
+  if(!m_root){
+    Leaf* leaf = AllocateLeaf();
+    if(!leaf){
+      return {Aii::Error::RuntimeError};
+    }
+    m_root = leaf;
+    m_height = 0;
+  }
+  if(m_root->count == Capacity(m_height)){
+    Inner* root = AllocateInner();
+    if(!root){
+      return {Aii::Error::RuntimeError};
+    }
+    root->children[0] = m_root;
+    if(!SplitChild(root, 0, m_height)){
+      m_innerAllocator.Deallocate(root);
+      return {Aii::Error::RuntimeError};
+    }
+    m_root = root;
+    m_height++;
+  }
+  NodeBase* node = m_root;
+  for(std::size_t level = m_height; level > 0; level--){
+    Inner* inner = AsInner(node);
+    std::size_t index = Route(inner, key);
+    if(inner->children[index]->count == Capacity(level - 1)){
+      if(!SplitChild(inner, index, level - 1)){
+        return {Aii::Error::RuntimeError};
+      }
+      if(!(key < inner->keys[index])){
+        index++;
+      }
+    }
+    node = inner->children[index];
+  }
+  Leaf* leaf = AsLeaf(node);
+  std::size_t index = Details::BTreeCountLess(leaf->keys, leaf->count, key);
+  if(index < leaf->count && !(key < leaf->keys[index])){
+    return {Aii::Error::InvalidArgument};
+  }
+  for(std::size_t i = leaf->count; i > index; i--){
+    leaf->keys[i] = std::move(leaf->keys[i - 1]);
+    leaf->vals[i] = std::move(leaf->vals[i - 1]);
+  }
+  leaf->keys[index] = key;
+  leaf->vals[index] = val;
+  leaf->count++;
+  m_size++;
+  return &leaf->vals[index];
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::BTreeMap<K, V, NodeBytes, A>::Erase(const KeyType& key) noexcept{
+  // O(log n)
+  //
+  // Possible Errors:
+  //  OutOfRange - the key is not present
+  if(!m_root){
+    return {Aii::Error::OutOfRange};
+  }
+  NodeBase* node = m_root;
+  for(std::size_t level = m_height; level > 0; level--){
+    Inner* inner = AsInner(node);
+    std::size_t index = Route(inner, key);
+    if(inner->children[index]->count <= Minimum(level - 1)){
+      index = FixChild(inner, index, level - 1);
+    }
+    node = inner->children[index];
+    if(inner == m_root && inner->count == 0){
+      // the root's last two children were merged
+      m_root = node;
+      m_height--;
+      m_innerAllocator.Deallocate(inner);
+    }
+  }
+  Leaf* leaf = AsLeaf(node);
+  std::size_t index = Details::BTreeCountLess(leaf->keys, leaf->count, key);
+  if(index == leaf->count || key < leaf->keys[index]){
+    return {Aii::Error::OutOfRange};
+  }
+  for(std::size_t i = index + 1; i < leaf->count; i++){
+    leaf->keys[i - 1] = std::move(leaf->keys[i]);
+    leaf->vals[i - 1] = std::move(leaf->vals[i]);
+  }
+  leaf->count--;
+  m_size--;
+  if(leaf->count == 0){
+    // only the root leaf may run empty
+    m_leafAllocator.Deallocate(leaf);
+    m_root = nullptr;
+  }
+  return {};
+}
+
+// Structural helpers. A child at level is a leaf when level is 0.
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+bool Aii::BTreeMap<K, V, NodeBytes, A>::SplitChild(Inner* parent, std::size_t index, std::size_t level) noexcept{
+  // Splits the full parent->children[index] in two and adds the new right
+  // half to parent, which must not be full. Returns false if allocation
+  // failed, leaving the tree untouched.
+  NodeBase* right = nullptr;
+  KeyType separator;
+  if(level == 0){
+    Leaf* leaf = AsLeaf(parent->children[index]);
+    Leaf* sibling = AllocateLeaf();
+    if(!sibling){
+      return false;
+    }
+    std::size_t keep = leaf->count / 2;
+    for(std::size_t i = keep; i < leaf->count; i++){
+      sibling->keys[i - keep] = std::move(leaf->keys[i]);
+      sibling->vals[i - keep] = std::move(leaf->vals[i]);
+    }
+    sibling->count = leaf->count - keep;
+    leaf->count = keep;
+    sibling->next = leaf->next;
+    leaf->next = sibling;
+    separator = sibling->keys[0];
+    right = sibling;
+  }
+  else{
+    // the middle key moves up rather than being copied
+    Inner* inner = AsInner(parent->children[index]);
+    Inner* sibling = AllocateInner();
+    if(!sibling){
+      return false;
+    }
+    std::size_t mid = inner->count / 2;
+    for(std::size_t i = mid + 1; i < inner->count; i++){
+      sibling->keys[i - mid - 1] = std::move(inner->keys[i]);
+    }
+    for(std::size_t i = mid + 1; i <= inner->count; i++){
+      sibling->children[i - mid - 1] = inner->children[i];
+    }
+    sibling->count = inner->count - mid - 1;
+    separator = std::move(inner->keys[mid]);
+    inner->count = mid;
+    right = sibling;
+  }
+  for(std::size_t i = parent->count; i > index; i--){
+    parent->keys[i] = std::move(parent->keys[i - 1]);
+    parent->children[i + 1] = parent->children[i];
+  }
+  parent->keys[index] = std::move(separator);
+  parent->children[index + 1] = right;
+  parent->count++;
+  return true;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+std::size_t Aii::BTreeMap<K, V, NodeBytes, A>::FixChild(Inner* parent, std::size_t index, std::size_t level) noexcept{
+  // Brings parent->children[index], which is at its minimum, above it by
+  // borrowing from a sibling or merging with one. Returns the index of the
+  // child now covering the same key range.
+  if(index > 0 && parent->children[index - 1]->count > Minimum(level)){
+    BorrowFromLeft(parent, index, level);
+    return index;
+  }
+  if(index < parent->count && parent->children[index + 1]->count > Minimum(level)){
+    BorrowFromRight(parent, index, level);
+    return index;
+  }
+  if(index > 0){
+    MergeChildren(parent, index - 1, level);
+    return index - 1;
+  }
+  MergeChildren(parent, index, level);
+  return index;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::BorrowFromLeft(Inner* parent, std::size_t index, std::size_t level) noexcept{
+  // moves the last element of the left sibling to the front of the child
+  if(level == 0){
+    Leaf* left = AsLeaf(parent->children[index - 1]);
+    Leaf* child = AsLeaf(parent->children[index]);
+    for(std::size_t i = child->count; i > 0; i--){
+      child->keys[i] = std::move(child->keys[i - 1]);
+      child->vals[i] = std::move(child->vals[i - 1]);
+    }
+    child->keys[0] = std::move(left->keys[left->count - 1]);
+    child->vals[0] = std::move(left->vals[left->count - 1]);
+    left->count--;
+    child->count++;
+    parent->keys[index - 1] = child->keys[0];
+  }
+  else{
+    // rotates through the separator in the parent
+    Inner* left = AsInner(parent->children[index - 1]);
+    Inner* child = AsInner(parent->children[index]);
+    child->children[child->count + 1] = child->children[child->count];
+    for(std::size_t i = child->count; i > 0; i--){
+      child->keys[i] = std::move(child->keys[i - 1]);
+      child->children[i] = child->children[i - 1];
+    }
+    child->keys[0] = std::move(parent->keys[index - 1]);
+    child->children[0] = left->children[left->count];
+    parent->keys[index - 1] = std::move(left->keys[left->count - 1]);
+    left->count--;
+    child->count++;
+  }
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::BorrowFromRight(Inner* parent, std::size_t index, std::size_t level) noexcept{
+  // moves the first element of the right sibling to the back of the child
+  if(level == 0){
+    Leaf* child = AsLeaf(parent->children[index]);
+    Leaf* right = AsLeaf(parent->children[index + 1]);
+    child->keys[child->count] = std::move(right->keys[0]);
+    child->vals[child->count] = std::move(right->vals[0]);
+    for(std::size_t i = 1; i < right->count; i++){
+      right->keys[i - 1] = std::move(right->keys[i]);
+      right->vals[i - 1] = std::move(right->vals[i]);
+    }
+    right->count--;
+    child->count++;
+    parent->keys[index] = right->keys[0];
+  }
+  else{
+    Inner* child = AsInner(parent->children[index]);
+    Inner* right = AsInner(parent->children[index + 1]);
+    child->keys[child->count] = std::move(parent->keys[index]);
+    child->children[child->count + 1] = right->children[0];
+    parent->keys[index] = std::move(right->keys[0]);
+    for(std::size_t i = 1; i < right->count; i++){
+      right->keys[i - 1] = std::move(right->keys[i]);
+    }
+    for(std::size_t i = 1; i <= right->count; i++){
+      right->children[i - 1] = right->children[i];
+    }
+    right->count--;
+    child->count++;
+  }
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+void Aii::BTreeMap<K, V, NodeBytes, A>::MergeChildren(Inner* parent, std::size_t index, std::size_t level) noexcept{
+  // Appends parent->children[index + 1] to parent->children[index] and frees
+  // it. Only called when both are at their minimum, so the result fits.
+  NodeBase* rightNode = parent->children[index + 1];
+  if(level == 0){
+    Leaf* left = AsLeaf(parent->children[index]);
+    Leaf* right = AsLeaf(rightNode);
+    for(std::size_t i = 0; i < right->count; i++){
+      left->keys[left->count + i] = std::move(right->keys[i]);
+      left->vals[left->count + i] = std::move(right->vals[i]);
+    }
+    left->count += right->count;
+    left->next = right->next;
+  }
+  else{
+    // the separator comes down between the two halves
+    Inner* left = AsInner(parent->children[index]);
+    Inner* right = AsInner(rightNode);
+    left->keys[left->count] = std::move(parent->keys[index]);
+    for(std::size_t i = 0; i < right->count; i++){
+      left->keys[left->count + 1 + i] = std::move(right->keys[i]);
+    }
+    for(std::size_t i = 0; i <= right->count; i++){
+      left->children[left->count + 1 + i] = right->children[i];
+    }
+    left->count += right->count + 1;
+  }
+  for(std::size_t i = index + 1; i < parent->count; i++){
+    parent->keys[i - 1] = std::move(parent->keys[i]);
+    parent->children[i] = parent->children[i + 1];
+  }
+  parent->count--;
+  DeallocateNode(rightNode, level);
+}
+
+// Bulk construction
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+auto Aii::BTreeMap<K, V, NodeBytes, A>::BuildSorted(const KeyType* keys, const ValueType* vals,
+                                                   std::size_t first, std::size_t count,
+                                                   std::size_t level, Leaf*& tail) noexcept -> NodeBase*{
+  // Builds a subtree of the given level over count elements, splitting them
+  // evenly between as few children as can hold them. An even split of more
+  // than one child's capacity gives every child at least half its capacity,
+  // which is above the minimum at every level. Leaves are linked onto tail
+  // in order. Returns nullptr if allocation failed.
+  if(level == 0){
+    Leaf* leaf = AllocateLeaf();
+    if(!leaf){
+      return nullptr;
+    }
+    for(std::size_t i = 0; i < count; i++){
+      leaf->keys[i] = keys[first + i];
+      leaf->vals[i] = vals[first + i];
+    }
+    leaf->count = count;
+    if(tail){
+      tail->next = leaf;
+    }
+    tail = leaf;
+    return leaf;
+  }
+  Inner* inner = AllocateInner();
+  if(!inner){
+    return nullptr;
+  }
+  std::size_t childCapacity = SubtreeCapacity(level - 1);
+  std::size_t children = (count + childCapacity - 1) / childCapacity;
+  std::size_t offset = first;
+  for(std::size_t i = 0; i < children; i++){
+    std::size_t share = count / children + (i < count % children ? 1 : 0);
+    NodeBase* child = BuildSorted(keys, vals, offset, share, level - 1, tail);
+    if(!child){
+      if(i == 0){
+        DeallocateNode(inner, level);
+      }
+      else{
+        DeallocateSubtree(inner, level);
+      }
+      return nullptr;
+    }
+    if(i > 0){
+      inner->keys[i - 1] = keys[offset];
+    }
+    inner->children[i] = child;
+    inner->count = i;
+    offset += share;
+  }
+  return inner;
+}
+
+template<typename K, typename V, std::size_t NodeBytes, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::BTreeMap<K, V, NodeBytes, A>::AssignSorted(const KeyType* keys, const ValueType* vals,
+                                                std::size_t count) noexcept{
+  // Replaces the contents of the map with count key value pairs in O(n),
+  // packing the nodes close to full.
+  //
+  // Possible Errors:
+  //  InvalidArgument - keys are not strictly increasing
+  //  RuntimeError - node allocation failed
+  //
+  // On error, the map is left in the state before the function call
+  if(count > 0 && (!keys || !vals)){
+    return {Aii::Error::InvalidArgument};
+  }
+  for(std::size_t i = 1; i < count; i++){
+    if(!(keys[i - 1] < keys[i])){
+      return {Aii::Error::InvalidArgument};
+    }
+  }
+  if(count == 0){
+    Clear();
+    return {};
+  }
+  std::size_t height = 0;
+  while(SubtreeCapacity(height) < count){
+    height++;
+  }
+  Leaf* tail = nullptr;
+  NodeBase* root = BuildSorted(keys, vals, 0, count, height, tail);
+  if(!root){
+    return {Aii::Error::RuntimeError};
+  }
+  Clear();
+  m_root = root;
+  m_height = height;
+  m_size = count;
+  return {};
+}
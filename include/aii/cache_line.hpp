@@ -0,0 +1,11 @@
+#pragma once
+
+// Size of the unit of transfer between memory and the caches. Containers use
+// it to size and align nodes, concurrent types to keep fields written by
+// different cpus on separate lines.
+
+#include <cstddef>
+
+namespace Aii{
+  inline constexpr std::size_t CacheLineSize = 64;
+}
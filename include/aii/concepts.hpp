@@ -1 +1,23 @@
+#pragma once
 
+// Concepts shared across the library
+
+#include <concepts>
+#include <cstddef>
+
+namespace Aii{
+
+// Requirements on the Allocator parameter of containers. Single objects and
+// arrays are both value initialised, and an array must be returned with the
+// count it was allocated with. Rebind gives the allocator for another type,
+// which containers use for their nodes.
+template<typename A>
+concept IsAllocator = requires(A alloc, typename A::ValueType* pointer, std::size_t n){
+  { alloc.Allocate() } -> std::same_as<typename A::ValueType*>;
+  { alloc.Allocate(n) } -> std::same_as<typename A::ValueType*>;
+  alloc.Deallocate(pointer);
+  alloc.Deallocate(pointer, n);
+  typename A::template Rebind<char>::other;
+};
+
+} // namespace Aii
@@ -0,0 +1,624 @@
+#pragma once
+
+// Hash map shared between cpus, built for lookup heavy use such as file
+// descriptor and page cache tables.
+//
+// Find takes no lock and never waits. Buckets are singly linked chains whose
+// nodes are immutable once published, and writers publish or unlink a node
+// with a single release store, so a reader walking a chain always sees a
+// consistent list. Writers lock one of Stripes cache line sized spin locks
+// picked by the low bits of the hash, so writers to different stripes
+// proceed in parallel.
+//
+// Bucket i belongs to stripe i mod Stripes in a table of any size, so each
+// stripe's chains can move to a new table on their own. Growing publishes a
+// table twice the size and then migrates one stripe at a time: under that
+// stripe's lock it copies the stripe's nodes into the new table and
+// switches the stripe's table pointer with one store. Writers only ever
+// wait for the one stripe being moved, and readers, which find the table
+// through the pointer of their key's stripe, keep using whichever table
+// they loaded. If an allocation fails the stripes not yet moved stay in the
+// old table until a later insert resumes the migration. Unlinked nodes and
+// old tables are freed only after an Srcu grace period, once no reader can
+// still hold a pointer to them.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/concepts.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+#include "aii/hash.hpp"
+#include "aii/optional.hpp"
+#include "aii/spinlock.hpp"
+#include "aii/srcu.hpp"
+
+namespace Aii{
+
+template<typename K,
+         typename V,
+         typename Hash = Aii::Hash<K>,
+         typename Eq = Aii::EqualTo<K>,
+         typename A = Aii::Allocator<K>>
+class ConcurrentHashMap{
+  static_assert(Aii::IsAllocator<A>, "ConcurrentHashMap: A must satisfy Aii::IsAllocator");
+
+  public:
+    using KeyType = K;
+    using ValueType = V;
+
+    static constexpr std::size_t Stripes = 64;
+    static constexpr std::size_t MinBuckets = Stripes;
+    // a stripe holding more than this many nodes per bucket grows the table
+    static constexpr std::size_t MaxLoad = 2;
+    // unlinked nodes collected before a writer waits out a grace period
+    static constexpr std::size_t ReclaimBatch = 64;
+
+    struct Node{
+      Node* next;
+      // chains unlinked nodes awaiting reclamation, as next must stay
+      // intact for readers still walking past them
+      Node* retiredNext;
+      std::uint64_t hash;
+      KeyType key;
+      ValueType val;
+    };
+
+  private:
+    struct Table{
+      std::size_t mask;
+      Node** buckets;
+    };
+
+    struct alignas(CacheLineSize) Stripe{
+      SpinLock lock;
+      std::size_t size;
+    };
+
+    using NodeAllocType = typename A::template Rebind<Node>::other;
+    using TableAllocType = typename A::template Rebind<Table>::other;
+    using BucketAllocType = typename A::template Rebind<Node*>::other;
+
+  public:
+    ConcurrentHashMap() noexcept;
+    ConcurrentHashMap(const ConcurrentHashMap& src) noexcept = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap& src) noexcept = delete;
+    ~ConcurrentHashMap() noexcept;
+
+    // Safe from any number of threads at once
+
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, K, Hash, Eq>
+    Aii::Optional<ValueType> Find(const Q& key) const noexcept;
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, K, Hash, Eq>
+    bool Contains(const Q& key) const noexcept;
+
+    Aii::Expected<void, Error> Insert(const KeyType& key, const ValueType& val) noexcept;
+    Aii::Expected<void, Error> InsertOrAssign(const KeyType& key, const ValueType& val) noexcept;
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, K, Hash, Eq>
+    Aii::Expected<void, Error> Erase(const Q& key) noexcept;
+    void Clear() noexcept;
+
+    std::size_t Size() const noexcept;
+    bool Empty() const noexcept{ return Size() == 0;}
+    std::size_t BucketCount() const noexcept;
+
+    // Frees every node unlinked so far, waiting for readers to leave
+    void Reclaim() noexcept;
+
+  private:
+    template<typename Q>
+    std::uint64_t HashOf(const Q& key) const noexcept{ return static_cast<std::uint64_t>(m_hash(key));}
+    Stripe& StripeFor(std::uint64_t hash) noexcept{ return m_stripes[hash & (Stripes - 1)];}
+
+    template<typename Q>
+    Node* FindIn(const Table* table, const Q& key, std::uint64_t hash) const noexcept;
+    template<typename Q>
+    Node** FindLink(Table* table, const Q& key, std::uint64_t hash) noexcept;
+    Node* AllocateNode(const KeyType& key, const ValueType& val, std::uint64_t hash) noexcept;
+    Table* AllocateTable(std::size_t buckets) noexcept;
+    void DeallocateTable(Table* table) noexcept;
+
+    Table* StripeTable(std::size_t stripe) const noexcept{ return AtomicLoad(&m_stripeTables[stripe], MemoryOrder::Acquire);}
+    Table* StripeTableOrCreate(std::size_t stripe) noexcept;
+    bool MigrateStripe(std::size_t stripe, Table* from, Table* to) noexcept;
+    void FreeStripe(Table* table, std::size_t stripe) noexcept;
+
+    void Retire(Node* node) noexcept;
+    void Grow(std::size_t mask) noexcept;
+
+  private:
+    // the newest table, which stripes first written migrate into
+    Table* m_table;
+    // the table each stripe's chains live in, read by readers and written
+    // only when a stripe migrates
+    Table* m_stripeTables[Stripes];
+    Stripe m_stripes[Stripes];
+    // held by the cpu migrating stripes; guards m_old
+    SpinLock m_growLock;
+    // the table being migrated from, while a migration is unfinished
+    Table* m_old;
+    mutable Aii::Srcu<> m_srcu;
+    SpinLock m_retireLock;
+    Node* m_retired;
+    std::size_t m_retiredCount;
+    [[no_unique_address]] Hash m_hash;
+    [[no_unique_address]] Eq m_eq;
+    NodeAllocType m_nodeAllocator;
+    TableAllocType m_tableAllocator;
+    BucketAllocType m_bucketAllocator;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::ConcurrentHashMap() noexcept
+  :
+    m_table{nullptr},
+    m_stripeTables{},
+    m_stripes{},
+    m_growLock{},
+    m_old{nullptr},
+    m_srcu{},
+    m_retireLock{},
+    m_retired{nullptr},
+    m_retiredCount{0},
+    m_hash{Hash()},
+    m_eq{Eq()},
+    m_nodeAllocator{NodeAllocType()},
+    m_tableAllocator{TableAllocType()},
+    m_bucketAllocator{BucketAllocType()}
+{
+
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::~ConcurrentHashMap() noexcept{
+  // no other thread may be using the map
+  Reclaim();
+  for(std::size_t stripe = 0; stripe < Stripes; stripe++){
+    if(m_stripeTables[stripe]){
+      FreeStripe(m_stripeTables[stripe], stripe);
+    }
+    // the originals of stripes an unfinished migration already copied
+    if(m_old && m_stripeTables[stripe] != m_old){
+      FreeStripe(m_old, stripe);
+    }
+  }
+  if(m_old){
+    DeallocateTable(m_old);
+  }
+  if(m_table){
+    DeallocateTable(m_table);
+  }
+}
+
+// Helpers
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+auto Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::AllocateNode(const KeyType& key, const ValueType& val,
+                                                             std::uint64_t hash) noexcept -> Node*{
+  Node* node = m_nodeAllocator.Allocate();
+  if(!node){
+    return nullptr;
+  }
+  node->next = nullptr;
+  node->retiredNext = nullptr;
+  node->hash = hash;
+  node->key = key;
+  node->val = val;
+  return node;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+auto Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::AllocateTable(std::size_t buckets) noexcept -> Table*{
+  // empty table of buckets chains, a power of two
+  Table* table = m_tableAllocator.Allocate();
+  if(!table){
+    return nullptr;
+  }
+  table->buckets = m_bucketAllocator.Allocate(buckets);
+  if(!table->buckets){
+    m_tableAllocator.Deallocate(table);
+    return nullptr;
+  }
+  table->mask = buckets - 1;
+  return table;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::DeallocateTable(Table* table) noexcept{
+  m_bucketAllocator.Deallocate(table->buckets, table->mask + 1);
+  m_tableAllocator.Deallocate(table);
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+auto Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::StripeTableOrCreate(std::size_t stripe) noexcept -> Table*{
+  // the table of a stripe, giving a stripe with none the newest table and
+  // creating the first table if need be. Caller holds the stripe lock.
+  // nullptr if allocation failed
+  Table* table = m_stripeTables[stripe];
+  if(table){
+    return table;
+  }
+  table = AtomicLoad(&m_table, MemoryOrder::Acquire);
+  if(!table){
+    // writers to other stripes may race to publish the first table
+    table = AllocateTable(MinBuckets);
+    if(!table){
+      return nullptr;
+    }
+    Table* expected = nullptr;
+    if(!AtomicCompareExchange(&m_table, expected, table, MemoryOrder::AcqRel, MemoryOrder::Acquire)){
+      DeallocateTable(table);
+      table = expected;
+    }
+  }
+  AtomicStore(&m_stripeTables[stripe], table, MemoryOrder::Release);
+  return table;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+bool Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::MigrateStripe(std::size_t stripe, Table* from, Table* to) noexcept{
+  // Copies the nodes of stripe from one table into another and switches the
+  // stripe over. Caller holds the stripe lock. Readers still in from see it
+  // unchanged, and its nodes are freed with it. Returns false, leaving the
+  // stripe in from, if allocation failed
+  for(std::size_t i = stripe; i <= from->mask; i += Stripes){
+    for(Node* node = from->buckets[i]; node; node = node->next){
+      Node* copy = AllocateNode(node->key, node->val, node->hash);
+      if(!copy){
+        // no reader can reach the stripe's buckets in to yet
+        for(std::size_t j = stripe; j <= to->mask; j += Stripes){
+          Node* partial = to->buckets[j];
+          while(partial){
+            Node* next = partial->next;
+            m_nodeAllocator.Deallocate(partial);
+            partial = next;
+          }
+          to->buckets[j] = nullptr;
+        }
+        return false;
+      }
+      Node** bucket = &to->buckets[node->hash & to->mask];
+      copy->next = *bucket;
+      *bucket = copy;
+    }
+  }
+  AtomicStore(&m_stripeTables[stripe], to, MemoryOrder::Release);
+  return true;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::FreeStripe(Table* table, std::size_t stripe) noexcept{
+  // frees the nodes of stripe in table, which no reader may still reach
+  for(std::size_t i = stripe; i <= table->mask; i += Stripes){
+    Node* node = table->buckets[i];
+    while(node){
+      Node* next = node->next;
+      m_nodeAllocator.Deallocate(node);
+      node = next;
+    }
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+auto Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::FindIn(const Table* table, const Q& key,
+                                                       std::uint64_t hash) const noexcept -> Node*{
+  // must run inside a read side section or under the stripe lock for hash
+  Node* node = AtomicLoad(&table->buckets[hash & table->mask], MemoryOrder::Acquire);
+  while(node){
+    if(node->hash == hash && m_eq(node->key, key)){
+      return node;
+    }
+    node = AtomicLoad(&node->next, MemoryOrder::Acquire);
+  }
+  return nullptr;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+auto Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::FindLink(Table* table, const Q& key,
+                                                         std::uint64_t hash) noexcept -> Node**{
+  // link pointing at the node for key, or nullptr. Caller holds the stripe
+  // lock for hash, so the chain cannot change underneath.
+  Node** link = &table->buckets[hash & table->mask];
+  while(*link){
+    if((*link)->hash == hash && m_eq((*link)->key, key)){
+      return link;
+    }
+    link = &(*link)->next;
+  }
+  return nullptr;
+}
+
+// Lookup
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, K, Hash, Eq>
+auto Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Find(const Q& key) const noexcept -> Aii::Optional<ValueType>{
+  // O(1) expected, lock free. The value is copied out, as the node may be
+  // freed once the read side section ends.
+  if constexpr(!Details::IsTransparentHash<Hash, Eq> && !std::is_same_v<Q, KeyType>){
+    return Find<KeyType>(key);
+  }
+  else{
+    std::uint64_t hash = HashOf(key);
+    SrcuReadGuard guard{m_srcu};
+    Table* table = StripeTable(hash & (Stripes - 1));
+    if(!table){
+      return Aii::NullOpt;
+    }
+    Node* node = FindIn(table, key, hash);
+    if(!node){
+      return Aii::NullOpt;
+    }
+    return Aii::Optional<ValueType>{node->val};
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, K, Hash, Eq>
+bool Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Contains(const Q& key) const noexcept{
+  if constexpr(!Details::IsTransparentHash<Hash, Eq> && !std::is_same_v<Q, KeyType>){
+    return Contains<KeyType>(key);
+  }
+  else{
+    std::uint64_t hash = HashOf(key);
+    SrcuReadGuard guard{m_srcu};
+    Table* table = StripeTable(hash & (Stripes - 1));
+    return table && FindIn(table, key, hash);
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+std::size_t Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Size() const noexcept{
+  // exact only while no writer runs
+  std::size_t size = 0;
+  for(const Stripe& stripe : m_stripes){
+    size += AtomicLoad(&stripe.size, MemoryOrder::Relaxed);
+  }
+  return size;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+std::size_t Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::BucketCount() const noexcept{
+  Table* table = AtomicLoad(&m_table, MemoryOrder::Acquire);
+  return table ? table->mask + 1 : 0;
+}
+
+// Modification
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Retire(Node* node) noexcept{
+  // node is unlinked and is freed after a grace period
+  bool reclaim;
+  {
+    LockGuard guard{m_retireLock};
+    node->retiredNext = m_retired;
+    m_retired = node;
+    m_retiredCount++;
+    reclaim = m_retiredCount >= ReclaimBatch;
+  }
+  if(reclaim){
+    Reclaim();
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Reclaim() noexcept{
+  // Must not be called while holding a stripe lock or from a read side
+  // section. Nodes retired meanwhile wait for the next batch.
+  Node* retired;
+  {
+    LockGuard guard{m_retireLock};
+    retired = m_retired;
+    m_retired = nullptr;
+    m_retiredCount = 0;
+  }
+  if(!retired){
+    return;
+  }
+  m_srcu.Synchronize();
+  while(retired){
+    Node* next = retired->retiredNext;
+    m_nodeAllocator.Deallocate(retired);
+    retired = next;
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Grow(std::size_t mask) noexcept{
+  // Publishes a table twice the size of one of mask + 1 buckets, unless
+  // another writer already did, and migrates the stripes into it one at a
+  // time. Resumes an unfinished migration instead, and returns at once if
+  // another writer is migrating. Must not be called while holding a stripe
+  // lock or from a read side section.
+  if(!m_growLock.TryLock()){
+    return;
+  }
+  Table* old = m_old;
+  if(!old){
+    Table* current = AtomicLoad(&m_table, MemoryOrder::Acquire);
+    Table* table = current && current->mask == mask ? AllocateTable((mask + 1) * 2) : nullptr;
+    if(!table){
+      m_growLock.Unlock();
+      return;
+    }
+    old = current;
+    m_old = old;
+    // stripes first written from now on start in the new table
+    AtomicStore(&m_table, table, MemoryOrder::Release);
+  }
+  Table* table = AtomicLoad(&m_table, MemoryOrder::Relaxed);
+  bool migrated = true;
+  for(std::size_t stripe = 0; migrated && stripe < Stripes; stripe++){
+    LockGuard guard{m_stripes[stripe].lock};
+    if(m_stripeTables[stripe] == old){
+      migrated = MigrateStripe(stripe, old, table);
+    }
+  }
+  if(migrated){
+    m_old = nullptr;
+  }
+  m_growLock.Unlock();
+  if(!migrated){
+    return;
+  }
+  // no stripe points at the old table, so no new reader can reach it
+  m_srcu.Synchronize();
+  for(std::size_t stripe = 0; stripe < Stripes; stripe++){
+    FreeStripe(old, stripe);
+  }
+  DeallocateTable(old);
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Insert(const KeyType& key, const ValueType& val) noexcept{
+  // O(1) expected
+  //
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - allocation failed
+  //
+  // On error, the map is left in the state before the function call
+  std::uint64_t hash = HashOf(key);
+  Stripe& stripe = StripeFor(hash);
+  std::size_t grow = 0;
+  {
+    LockGuard guard{stripe.lock};
+    Table* table = StripeTableOrCreate(hash & (Stripes - 1));
+    if(!table){
+      return {Aii::Error::RuntimeError};
+    }
+    if(FindLink(table, key, hash)){
+      return {Aii::Error::InvalidArgument};
+    }
+    Node* node = AllocateNode(key, val, hash);
+    if(!node){
+      return {Aii::Error::RuntimeError};
+    }
+    Node** bucket = &table->buckets[hash & table->mask];
+    node->next = *bucket;
+    AtomicStore(bucket, node, MemoryOrder::Release);
+    AtomicStore(&stripe.size, stripe.size + 1, MemoryOrder::Relaxed);
+    // a stripe left behind by an unfinished migration also resumes it
+    if(stripe.size > MaxLoad * (table->mask + 1) / Stripes || table != AtomicLoad(&m_table, MemoryOrder::Relaxed)){
+      grow = table->mask + 1;
+    }
+  }
+  if(grow){
+    Grow(grow - 1);
+  }
+  return {};
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::InsertOrAssign(const KeyType& key, const ValueType& val) noexcept{
+  // Inserts key or replaces its value. A replacement publishes a new node in
+  // place of the old one, so readers see either value whole. O(1) expected
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the map is left in the state before the function call
+  std::uint64_t hash = HashOf(key);
+  Node* replaced = nullptr;
+  {
+    Stripe& stripe = StripeFor(hash);
+    LockGuard guard{stripe.lock};
+    Table* table = m_stripeTables[hash & (Stripes - 1)];
+    Node** link = table ? FindLink(table, key, hash) : nullptr;
+    if(link){
+      Node* node = AllocateNode(key, val, hash);
+      if(!node){
+        return {Aii::Error::RuntimeError};
+      }
+      replaced = *link;
+      node->next = replaced->next;
+      AtomicStore(link, node, MemoryOrder::Release);
+    }
+  }
+  if(!replaced){
+    auto res = Insert(key, val);
+    // lost a race with another insert of key, whose value is replaced
+    if(!res && res.Error() == Aii::Error::InvalidArgument){
+      return InsertOrAssign(key, val);
+    }
+    return res;
+  }
+  Retire(replaced);
+  return {};
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, K, Hash, Eq>
+Aii::Expected<void, Aii::Error> Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Erase(const Q& key) noexcept{
+  // O(1) expected
+  //
+  // Possible Errors:
+  //  OutOfRange - the key is not present
+  if constexpr(!Details::IsTransparentHash<Hash, Eq> && !std::is_same_v<Q, KeyType>){
+    return Erase<KeyType>(key);
+  }
+  else{
+    std::uint64_t hash = HashOf(key);
+    Node* node = nullptr;
+    {
+      Stripe& stripe = StripeFor(hash);
+      LockGuard guard{stripe.lock};
+      Table* table = m_stripeTables[hash & (Stripes - 1)];
+      Node** link = table ? FindLink(table, key, hash) : nullptr;
+      if(!link){
+        return {Aii::Error::OutOfRange};
+      }
+      node = *link;
+      // readers on node still find its successor
+      AtomicStore(link, node->next, MemoryOrder::Release);
+      AtomicStore(&stripe.size, stripe.size - 1, MemoryOrder::Relaxed);
+    }
+    Retire(node);
+    return {};
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::ConcurrentHashMap<K, V, Hash, Eq, A>::Clear() noexcept{
+  // unlinks every node, keeping the table, O(n + buckets)
+  Node* retired = nullptr;
+  for(Stripe& stripe : m_stripes){
+    stripe.lock.Lock();
+  }
+  for(std::size_t stripe = 0; stripe < Stripes; stripe++){
+    Table* table = m_stripeTables[stripe];
+    for(std::size_t i = stripe; table && i <= table->mask; i += Stripes){
+      Node* node = table->buckets[i];
+      AtomicStore(&table->buckets[i], nullptr, MemoryOrder::Release);
+      while(node){
+        node->retiredNext = retired;
+        retired = node;
+        node = node->next;
+      }
+    }
+  }
+  for(Stripe& stripe : m_stripes){
+    AtomicStore(&stripe.size, 0, MemoryOrder::Relaxed);
+    stripe.lock.Unlock();
+  }
+  m_srcu.Synchronize();
+  while(retired){
+    Node* next = retired->retiredNext;
+    m_nodeAllocator.Deallocate(retired);
+    retired = next;
+  }
+}
@@ -0,0 +1,433 @@
+#pragma once
+
+// Double ended queue stored in fixed size chunks.
+//
+// Elements live in chunks of ChunkSize slots, found through a map: an array
+// of chunk pointers in which the elements occupy a contiguous run of
+// positions. Element i sits at position Start + i, so indexing is a shift
+// and a mask away. Pushing at either end fills the chunk at that end and
+// allocates a new chunk only when it is full, and elements never move once
+// constructed, so pointers to them stay valid until they are popped.
+//
+// A chunk is released from the map as soon as it holds no elements. The last
+// one released is kept as a spare for the next chunk needed, so a deque used
+// as a queue, pushing at one end and popping at the other, stops allocating
+// once it reaches its working size. When an end of the map is reached the
+// run of chunk pointers is recentred, or copied into a map twice the size.
+//
+// ChunkSize must be a power of two. The default fits a chunk in about 4 KB.
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+
+namespace Aii{
+
+namespace Details{
+
+template<typename T>
+constexpr std::size_t DequeChunkSize() noexcept{
+  // largest power of two of elements fitting in 4 KB, at least 16
+  std::size_t size = 16;
+  while(size * 2 * sizeof(T) <= 4096){
+    size *= 2;
+  }
+  return size;
+}
+
+} // namespace Details
+
+template<typename T, std::size_t ChunkSize = Details::DequeChunkSize<T>(), typename A = Aii::Allocator<T>>
+class Deque{
+  static_assert(Aii::IsAllocator<A>, "Deque: A must satisfy Aii::IsAllocator");
+  static_assert(ChunkSize > 0 && (ChunkSize & (ChunkSize - 1)) == 0, "Deque: ChunkSize must be a power of two");
+
+  private:
+    // raw storage, elements are constructed in place
+    struct Chunk{
+      alignas(T) unsigned char bytes[ChunkSize * sizeof(T)];
+
+      T* At(std::size_t slot) noexcept{ return std::launder(reinterpret_cast<T*>(bytes) + slot);}
+    };
+
+    using ChunkAllocType = typename A::template Rebind<Chunk>::other;
+    using MapAllocType = typename A::template Rebind<Chunk*>::other;
+
+    static constexpr std::size_t ChunkShift = __builtin_ctzll(ChunkSize);
+    static constexpr std::size_t SlotMask = ChunkSize - 1;
+    static constexpr std::size_t MinMapSize = 8;
+
+  public:
+    using ValueType = T;
+
+    template<typename V>
+    class BasicIterator{
+      public:
+        constexpr BasicIterator() noexcept: m_map{nullptr}, m_pos{0}{}
+        BasicIterator(Chunk* const* map, std::size_t pos) noexcept: m_map{map}, m_pos{pos}{}
+
+        V& operator*() const noexcept{ return *m_map[m_pos >> ChunkShift]->At(m_pos & SlotMask);}
+        V* operator->() const noexcept{ return m_map[m_pos >> ChunkShift]->At(m_pos & SlotMask);}
+
+        BasicIterator& operator++() noexcept{ m_pos++; return *this;}
+        BasicIterator operator++(int) noexcept{ BasicIterator tmp = *this; m_pos++; return tmp;}
+        BasicIterator& operator--() noexcept{ m_pos--; return *this;}
+        BasicIterator operator--(int) noexcept{ BasicIterator tmp = *this; m_pos--; return tmp;}
+
+        constexpr bool operator==(const BasicIterator& rhs) const noexcept{ return m_pos == rhs.m_pos;}
+        constexpr bool operator!=(const BasicIterator& rhs) const noexcept{ return m_pos != rhs.m_pos;}
+
+      private:
+        Chunk* const* m_map;
+        std::size_t m_pos;
+    };
+
+    using Iterator = BasicIterator<T>;
+    using ConstIterator = BasicIterator<const T>;
+
+    Deque() noexcept;
+    Deque(const Deque& src) noexcept = delete;
+    Deque(Deque&& src) noexcept;
+    Deque& operator=(const Deque& src) noexcept = delete;
+    Deque& operator=(Deque&& src) noexcept;
+    ~Deque() noexcept;
+
+    void Swap(Deque& other) noexcept;
+
+    bool Empty() const noexcept{ return m_size == 0;}
+    std::size_t Size() const noexcept{ return m_size;}
+
+    Iterator begin() noexcept{ return Iterator{m_map, m_start};}
+    Iterator end() noexcept{ return Iterator{m_map, m_start + m_size};}
+    ConstIterator begin() const noexcept{ return ConstIterator{m_map, m_start};}
+    ConstIterator end() const noexcept{ return ConstIterator{m_map, m_start + m_size};}
+
+    T& operator[](std::size_t index) noexcept{ return *At(m_start + index);}
+    const T& operator[](std::size_t index) const noexcept{ return *At(m_start + index);}
+    T& Front() noexcept{ return *At(m_start);}
+    const T& Front() const noexcept{ return *At(m_start);}
+    T& Back() noexcept{ return *At(m_start + m_size - 1);}
+    const T& Back() const noexcept{ return *At(m_start + m_size - 1);}
+
+    template<typename ...Args>
+    Aii::Expected<T*, Error> EmplaceBack(Args&& ...args) noexcept;
+    template<typename ...Args>
+    Aii::Expected<T*, Error> EmplaceFront(Args&& ...args) noexcept;
+    Aii::Expected<T*, Error> PushBack(const T& val) noexcept{ return EmplaceBack(val);}
+    Aii::Expected<T*, Error> PushBack(T&& val) noexcept{ return EmplaceBack(std::move(val));}
+    Aii::Expected<T*, Error> PushFront(const T& val) noexcept{ return EmplaceFront(val);}
+    Aii::Expected<T*, Error> PushFront(T&& val) noexcept{ return EmplaceFront(std::move(val));}
+
+    Aii::Expected<void, Error> PopBack() noexcept;
+    Aii::Expected<void, Error> PopFront() noexcept;
+    void Clear() noexcept;
+    void ShrinkToFit() noexcept;
+
+  private:
+    T* At(std::size_t pos) const noexcept{ return m_map[pos >> ChunkShift]->At(pos & SlotMask);}
+    std::size_t FirstChunk() const noexcept{ return m_start >> ChunkShift;}
+    std::size_t UsedChunks() const noexcept;
+
+    bool ReserveMap(bool front) noexcept;
+    T* SlotFor(std::size_t pos) noexcept;
+    void ReleaseChunk(std::size_t pos) noexcept;
+    void Deallocate() noexcept;
+
+  private:
+    Chunk** m_map;
+    std::size_t m_mapSize;
+    // position of the first element, counted in slots from the start of
+    // the map
+    std::size_t m_start;
+    std::size_t m_size;
+    Chunk* m_spare;
+    ChunkAllocType m_chunkAllocator;
+    MapAllocType m_mapAllocator;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, std::size_t ChunkSize, typename A>
+Aii::Deque<T, ChunkSize, A>::Deque() noexcept
+  :
+    m_map{nullptr},
+    m_mapSize{0},
+    m_start{0},
+    m_size{0},
+    m_spare{nullptr},
+    m_chunkAllocator{ChunkAllocType()},
+    m_mapAllocator{MapAllocType()}
+{
+
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+Aii::Deque<T, ChunkSize, A>::Deque(Deque&& src) noexcept
+  :
+    m_map{src.m_map},
+    m_mapSize{src.m_mapSize},
+    m_start{src.m_start},
+    m_size{src.m_size},
+    m_spare{src.m_spare},
+    m_chunkAllocator{std::move(src.m_chunkAllocator)},
+    m_mapAllocator{std::move(src.m_mapAllocator)}
+{
+  src.m_map = nullptr;
+  src.m_mapSize = 0;
+  src.m_start = 0;
+  src.m_size = 0;
+  src.m_spare = nullptr;
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+auto Aii::Deque<T, ChunkSize, A>::operator=(Deque&& src) noexcept -> Deque&{
+  if(this != &src){
+    Clear();
+    Deallocate();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+Aii::Deque<T, ChunkSize, A>::~Deque() noexcept{
+  Clear();
+  Deallocate();
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+void Aii::Deque<T, ChunkSize, A>::Swap(Deque& other) noexcept{
+  std::swap(m_map, other.m_map);
+  std::swap(m_mapSize, other.m_mapSize);
+  std::swap(m_start, other.m_start);
+  std::swap(m_size, other.m_size);
+  std::swap(m_spare, other.m_spare);
+  std::swap(m_chunkAllocator, other.m_chunkAllocator);
+  std::swap(m_mapAllocator, other.m_mapAllocator);
+}
+
+// Storage
+
+template<typename T, std::size_t ChunkSize, typename A>
+std::size_t Aii::Deque<T, ChunkSize, A>::UsedChunks() const noexcept{
+  // chunks in the map holding elements
+  if(m_size == 0){
+    return 0;
+  }
+  return ((m_start + m_size - 1) >> ChunkShift) - FirstChunk() + 1;
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+bool Aii::Deque<T, ChunkSize, A>::ReserveMap(bool front) noexcept{
+  // Makes room in the map for a push at the front or back, by centring the
+  // used chunks in the map, or in a new map if it is less than half free.
+  // O(UsedChunks()). Returns false if allocation failed, leaving the deque
+  // as it was.
+  std::size_t first = FirstChunk();
+  std::size_t used = UsedChunks();
+  if(front ? m_start > 0 : (m_start + m_size) >> ChunkShift < m_mapSize){
+    return true;
+  }
+  if(m_mapSize < 2 * (used + 1)){
+    std::size_t mapSize = m_mapSize ? m_mapSize * 2 : MinMapSize;
+    while(mapSize < 2 * (used + 1)){
+      mapSize *= 2;
+    }
+    Chunk** map = m_mapAllocator.Allocate(mapSize);
+    if(!map){
+      return false;
+    }
+    std::size_t centre = (mapSize - used) / 2;
+    for(std::size_t i = 0; i < used; i++){
+      map[centre + i] = m_map[first + i];
+    }
+    if(m_map){
+      m_mapAllocator.Deallocate(m_map, m_mapSize);
+    }
+    m_map = map;
+    m_mapSize = mapSize;
+    m_start = (centre << ChunkShift) + (m_start & SlotMask);
+    return true;
+  }
+  // every position outside the used chunks is null, so the run can slide
+  // along and clear what it leaves behind
+  std::size_t centre = (m_mapSize - used) / 2;
+  if(centre < first){
+    for(std::size_t i = 0; i < used; i++){
+      m_map[centre + i] = m_map[first + i];
+      m_map[first + i] = nullptr;
+    }
+  }
+  else{
+    for(std::size_t i = used; i > 0; i--){
+      m_map[centre + i - 1] = m_map[first + i - 1];
+      m_map[first + i - 1] = nullptr;
+    }
+  }
+  m_start = (centre << ChunkShift) + (m_start & SlotMask);
+  return true;
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+T* Aii::Deque<T, ChunkSize, A>::SlotFor(std::size_t pos) noexcept{
+  // the slot at pos, giving its chunk storage first if it has none.
+  // nullptr if allocation failed
+  Chunk*& chunk = m_map[pos >> ChunkShift];
+  if(!chunk){
+    if(m_spare){
+      chunk = m_spare;
+      m_spare = nullptr;
+    }
+    else{
+      chunk = m_chunkAllocator.Allocate();
+      if(!chunk){
+        return nullptr;
+      }
+    }
+  }
+  return chunk->At(pos & SlotMask);
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+void Aii::Deque<T, ChunkSize, A>::ReleaseChunk(std::size_t pos) noexcept{
+  // removes the chunk holding pos, which holds no elements, from the map
+  // and keeps it as the spare
+  Chunk*& chunk = m_map[pos >> ChunkShift];
+  if(m_spare){
+    m_chunkAllocator.Deallocate(m_spare);
+  }
+  m_spare = chunk;
+  chunk = nullptr;
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+void Aii::Deque<T, ChunkSize, A>::Deallocate() noexcept{
+  // elements must already be destroyed
+  if(m_spare){
+    m_chunkAllocator.Deallocate(m_spare);
+    m_spare = nullptr;
+  }
+  if(m_map){
+    m_mapAllocator.Deallocate(m_map, m_mapSize);
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_start = 0;
+  }
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+void Aii::Deque<T, ChunkSize, A>::ShrinkToFit() noexcept{
+  // frees the spare chunk, and the map if the deque is empty
+  if(m_size == 0){
+    Deallocate();
+  }
+  else if(m_spare){
+    m_chunkAllocator.Deallocate(m_spare);
+    m_spare = nullptr;
+  }
+}
+
+// Modification
+
+template<typename T, std::size_t ChunkSize, typename A> template<typename ...Args>
+Aii::Expected<T*, Aii::Error> Aii::Deque<T, ChunkSize, A>::EmplaceBack(Args&& ...args) noexcept{
+  // constructs an element from args after the last. O(1) amortised
+  //
+  // Possible Errors:
+  //  RuntimeError - allocating a chunk or the map failed
+  //
+  // On error, the deque is left in the state before the function call
+  if(!ReserveMap(false)){
+    return {Aii::Error::RuntimeError};
+  }
+  T* slot = SlotFor(m_start + m_size);
+  if(!slot){
+    return {Aii::Error::RuntimeError};
+  }
+  T* element = ::new(static_cast<void*>(slot)) T{std::forward<Args>(args)...};
+  m_size++;
+  return element;
+}
+
+template<typename T, std::size_t ChunkSize, typename A> template<typename ...Args>
+Aii::Expected<T*, Aii::Error> Aii::Deque<T, ChunkSize, A>::EmplaceFront(Args&& ...args) noexcept{
+  // constructs an element from args before the first. O(1) amortised
+  //
+  // Possible Errors:
+  //  RuntimeError - allocating a chunk or the map failed
+  //
+  // On error, the deque is left in the state before the function call
+  if(!ReserveMap(true)){
+    return {Aii::Error::RuntimeError};
+  }
+  T* slot = SlotFor(m_start - 1);
+  if(!slot){
+    return {Aii::Error::RuntimeError};
+  }
+  T* element = ::new(static_cast<void*>(slot)) T{std::forward<Args>(args)...};
+  m_start--;
+  m_size++;
+  return element;
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+Aii::Expected<void, Aii::Error> Aii::Deque<T, ChunkSize, A>::PopBack() noexcept{
+  // destroys the last element. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the deque is empty
+  if(m_size == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  std::size_t pos = m_start + m_size - 1;
+  At(pos)->~T();
+  m_size--;
+  if(m_size == 0 || (pos & SlotMask) == 0){
+    ReleaseChunk(pos);
+  }
+  return {};
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+Aii::Expected<void, Aii::Error> Aii::Deque<T, ChunkSize, A>::PopFront() noexcept{
+  // destroys the first element. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the deque is empty
+  if(m_size == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  std::size_t pos = m_start;
+  At(pos)->~T();
+  m_start++;
+  m_size--;
+  if(m_size == 0 || (m_start & SlotMask) == 0){
+    ReleaseChunk(pos);
+  }
+  return {};
+}
+
+template<typename T, std::size_t ChunkSize, typename A>
+void Aii::Deque<T, ChunkSize, A>::Clear() noexcept{
+  // destroys every element and frees their chunks, keeping one spare and
+  // the map. O(Size())
+  if constexpr(!std::is_trivially_destructible_v<T>){
+    for(std::size_t i = 0; i < m_size; i++){
+      At(m_start + i)->~T();
+    }
+  }
+  std::size_t first = FirstChunk();
+  std::size_t used = UsedChunks();
+  for(std::size_t i = 0; i < used; i++){
+    ReleaseChunk((first + i) << ChunkShift);
+  }
+  m_size = 0;
+}
@@ -3,6 +3,7 @@
 // Wrapper for functions which are allowed to fail
 
 #include <concepts>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
@@ -30,7 +31,7 @@ class Expected{
     constexpr Expected(Unexpected<ErrorType>&& src) noexcept;
     constexpr Expected(std::remove_cv_t<ExpectedType>&& src) noexcept;
     constexpr Expected(std::remove_cv_t<ErrorType>&& src) noexcept;
-    ~Expected() noexcept;
+    constexpr ~Expected() noexcept;
 
     constexpr Expected& operator=(std::remove_cv_t<T> val)
     { m_val = val; m_isVal = true; return *this;}
@@ -75,7 +76,7 @@ class Expected<void, E>{
     constexpr Expected(Expected&& src) noexcept;
     constexpr Expected(Unexpected<ErrorType>&& src) noexcept;
     constexpr Expected(std::remove_cv_t<ErrorType>&& src) noexcept;
-    ~Expected() noexcept;
+    constexpr ~Expected() noexcept;
 
     constexpr Expected& operator=(E error)
     { m_error = error; m_isVal = false; return *this;}
@@ -107,12 +108,14 @@ class Expected<void, E>{
 
 template<typename T, typename E>
 constexpr Aii::Expected<T, E>::Expected(const Expected& src) noexcept{
+  // the union members are not constructed yet, so they are constructed in
+  // place rather than assigned to
   m_isVal = src.m_isVal;
   if(m_isVal){
-    m_val = src.m_val;
+    std::construct_at(&m_val, src.m_val);
   }
   else{
-    m_error = src.m_error;
+    std::construct_at(&m_error, src.m_error);
   }
 }
 
@@ -120,10 +123,10 @@ template<typename T, typename E>
 constexpr Aii::Expected<T, E>::Expected(Expected&& src) noexcept{
   m_isVal = src.m_isVal;
   if(m_isVal){
-    m_val = std::move(src.m_val);
+    std::construct_at(&m_val, std::move(src.m_val));
   }
   else{
-    m_error = std::move(src.m_error);
+    std::construct_at(&m_error, std::move(src.m_error));
   }
 }
 
@@ -138,7 +141,7 @@ constexpr Aii::Expected<T, E>::Expected(Unexpected<ErrorType>&& unexp) noexcept
 template<typename T, typename E>
 constexpr Aii::Expected<T, E>::Expected(std::remove_cv_t<ExpectedType>&& src) noexcept
   :
-    m_val{src},
+    m_val{std::move(src)},
     m_isVal{true}
 {
 
@@ -154,7 +157,7 @@ constexpr Aii::Expected<T, E>::Expected(std::remove_cv_t<ErrorType>&& src) noexc
 }
 
 template<typename T, typename E>
-Aii::Expected<T, E>::~Expected() noexcept{
+constexpr Aii::Expected<T, E>::~Expected() noexcept{
   if(HasVal()){
     m_val.~T();
   }
@@ -245,7 +248,7 @@ constexpr Aii::Expected<void, E>::Expected(std::remove_cv_t<ErrorType>&& src) no
 }
 
 template<typename E>
-Aii::Expected<void, E>::~Expected() noexcept{
+constexpr Aii::Expected<void, E>::~Expected() noexcept{
   if(HasVal()){
   }
   else{
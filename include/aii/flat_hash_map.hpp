@@ -0,0 +1,626 @@
+#pragma once
+
+// Open addressing hash map in the style of SwissTable.
+//
+// Entries live in a flat slot array with a parallel array of one byte
+// control words. A control byte is either empty, deleted (a tombstone), or
+// holds the low 7 bits of the hash of its entry (H2). The remaining bits
+// (H1) pick where probing starts. A probe loads a group of control bytes at
+// once and compares all of them against H2, so the slots themselves are
+// only touched for likely matches and a miss usually costs one cache line.
+//
+// Groups are 16 bytes compared with SSE2 where available, otherwise 8 bytes
+// compared with word sized bit tricks (SWAR). The control array repeats its
+// first group past the end, so a group can be loaded from any position.
+//
+// Erasing leaves a tombstone unless no probe can have passed the slot.
+// When the table runs out of room, it grows if it is mostly full of live
+// entries and otherwise rehashes in place, which clears the tombstones
+// without allocating.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+#include "aii/hash.hpp"
+
+namespace Aii{
+
+namespace Details{
+
+inline constexpr std::int8_t CtrlEmpty = -128;
+inline constexpr std::int8_t CtrlDeleted = -2;
+
+inline bool IsFull(std::int8_t ctrl) noexcept{ return ctrl >= 0;}
+
+// Group of 8 control bytes in one word, usable on any target. Each mask has
+// the top bit of a byte set for every selected slot.
+class SwissGroupPortable{
+  public:
+    static constexpr std::size_t Width = 8;
+    static constexpr unsigned SlotShift = 3;
+
+    explicit SwissGroupPortable(const std::int8_t* ctrl) noexcept{
+      __builtin_memcpy(&m_ctrl, ctrl, sizeof(m_ctrl));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      m_ctrl = __builtin_bswap64(m_ctrl);
+#endif
+    }
+
+    std::uint64_t Match(std::uint8_t h2) const noexcept{
+      // Bytes equal to h2 become zero and are found by the borrow trick. A
+      // borrow may also flag the byte above a match, which the key compare
+      // then rejects.
+      std::uint64_t x = m_ctrl ^ (Lsbs * h2);
+      return (x - Lsbs) & ~x & Msbs;
+    }
+
+    std::uint64_t MatchEmpty() const noexcept{
+      // empty is the only value with the high bit set and bit 1 clear
+      return m_ctrl & (~m_ctrl << 6) & Msbs;
+    }
+
+    std::uint64_t MatchEmptyOrDeleted() const noexcept{
+      return m_ctrl & Msbs;
+    }
+
+  private:
+    static constexpr std::uint64_t Lsbs = 0x0101010101010101ull;
+    static constexpr std::uint64_t Msbs = 0x8080808080808080ull;
+
+    std::uint64_t m_ctrl;
+};
+
+#if defined(__SSE2__)
+// Group of 16 control bytes in an SSE2 register. Each mask has bit i set
+// for every selected slot i.
+class SwissGroupSse2{
+  public:
+    static constexpr std::size_t Width = 16;
+    static constexpr unsigned SlotShift = 0;
+
+    explicit SwissGroupSse2(const std::int8_t* ctrl) noexcept
+      : m_ctrl{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))}{}
+
+    std::uint64_t Match(std::uint8_t h2) const noexcept{
+      return static_cast<std::uint16_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(h2)), m_ctrl)));
+    }
+
+    std::uint64_t MatchEmpty() const noexcept{
+      return static_cast<std::uint16_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(CtrlEmpty), m_ctrl)));
+    }
+
+    std::uint64_t MatchEmptyOrDeleted() const noexcept{
+      // both have the sign bit set, full slots do not
+      return static_cast<std::uint16_t>(_mm_movemask_epi8(m_ctrl));
+    }
+
+  private:
+    __m128i m_ctrl;
+};
+
+using SwissGroup = SwissGroupSse2;
+#else
+using SwissGroup = SwissGroupPortable;
+#endif
+
+} // namespace Details
+
+template<typename K,
+         typename V,
+         typename Hash = Aii::Hash<K>,
+         typename Eq = Aii::EqualTo<K>,
+         typename A = Aii::Allocator<K>>
+class FlatHashMap{
+  static_assert(Aii::IsAllocator<A>, "FlatHashMap: A must satisfy Aii::IsAllocator");
+
+  public:
+    using KeyType = K;
+    using ValueType = V;
+    using Group = Details::SwissGroup;
+
+    struct Entry{
+      KeyType key;
+      ValueType val;
+    };
+
+    class Iterator{
+      public:
+        constexpr Iterator() noexcept: m_ctrl{nullptr}, m_end{nullptr}, m_entry{nullptr}{}
+        Iterator(const std::int8_t* ctrl, const std::int8_t* end, Entry* entry) noexcept
+          : m_ctrl{ctrl}, m_end{end}, m_entry{entry}{ SkipFree();}
+
+        const KeyType& Key() const noexcept{ return m_entry->key;}
+        ValueType& Val() const noexcept{ return m_entry->val;}
+
+        ValueType& operator*() const noexcept{ return m_entry->val;}
+        ValueType* operator->() const noexcept{ return &m_entry->val;}
+
+        Iterator& operator++() noexcept{ m_ctrl++; m_entry++; SkipFree(); return *this;}
+        Iterator operator++(int) noexcept{ Iterator tmp = *this; ++(*this); return tmp;}
+
+        constexpr bool operator==(const Iterator& rhs) const noexcept{ return m_ctrl == rhs.m_ctrl;}
+        constexpr bool operator!=(const Iterator& rhs) const noexcept{ return m_ctrl != rhs.m_ctrl;}
+
+      private:
+        void SkipFree() noexcept{
+          while(m_ctrl != m_end && !Details::IsFull(*m_ctrl)){
+            m_ctrl++;
+            m_entry++;
+          }
+        }
+
+        const std::int8_t* m_ctrl;
+        const std::int8_t* m_end;
+        Entry* m_entry;
+    };
+
+  private:
+    // raw storage, entries are constructed in place when a slot fills
+    struct alignas(Entry) Slot{
+      unsigned char bytes[sizeof(Entry)];
+    };
+
+    using CtrlAllocType = typename A::template Rebind<std::int8_t>::other;
+    using SlotAllocType = typename A::template Rebind<Slot>::other;
+
+    static constexpr std::size_t MinCapacity = Group::Width;
+
+  public:
+    FlatHashMap() noexcept;
+    FlatHashMap(const FlatHashMap& src) noexcept = delete;
+    FlatHashMap(FlatHashMap&& src) noexcept;
+    FlatHashMap& operator=(const FlatHashMap& src) noexcept = delete;
+    FlatHashMap& operator=(FlatHashMap&& src) noexcept;
+    ~FlatHashMap() noexcept;
+
+    void Swap(FlatHashMap& other) noexcept;
+
+    bool Empty() const noexcept{ return m_size == 0;}
+    std::size_t Size() const noexcept{ return m_size;}
+    std::size_t Capacity() const noexcept{ return m_capacity;}
+
+    Iterator begin() const noexcept{ return Iterator{m_ctrl, m_ctrl + m_capacity, EntryAt(0)};}
+    Iterator end() const noexcept{ return Iterator{m_ctrl + m_capacity, m_ctrl + m_capacity, EntryAt(m_capacity)};}
+
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, K, Hash, Eq>
+    ValueType* Find(const Q& key) const noexcept;
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, K, Hash, Eq>
+    bool Contains(const Q& key) const noexcept{ return Find(key) != nullptr;}
+
+    Aii::Expected<ValueType*, Error> Insert(const KeyType& key, const ValueType& val) noexcept;
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, K, Hash, Eq>
+    Aii::Expected<void, Error> Erase(const Q& key) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> Reserve(std::size_t count) noexcept;
+
+  private:
+    static constexpr std::size_t H1(std::uint64_t hash) noexcept{ return static_cast<std::size_t>(hash >> 7);}
+    static constexpr std::int8_t H2(std::uint64_t hash) noexcept{ return static_cast<std::int8_t>(hash & 0x7f);}
+    static constexpr std::size_t MaxLoad(std::size_t capacity) noexcept{ return capacity - capacity / 8;}
+
+    template<typename Q>
+    std::uint64_t HashOf(const Q& key) const noexcept{ return static_cast<std::uint64_t>(m_hash(key));}
+    Entry* EntryAt(std::size_t index) const noexcept;
+    void SetCtrl(std::size_t index, std::int8_t ctrl) noexcept;
+
+    template<typename Q>
+    std::size_t FindIndex(const Q& key, std::uint64_t hash) const noexcept;
+    std::size_t FindFirstNonFull(std::uint64_t hash) const noexcept;
+    bool ProbesTogether(std::size_t lhs, std::size_t rhs, std::uint64_t hash) const noexcept;
+
+    bool Resize(std::size_t capacity) noexcept;
+    void DropDeletes() noexcept;
+    bool MakeRoom() noexcept;
+    void DestroyEntries() noexcept;
+    void Deallocate() noexcept;
+
+  private:
+    static constexpr std::size_t NotFound = ~std::size_t{0};
+
+    std::int8_t* m_ctrl;
+    Slot* m_slots;
+    std::size_t m_capacity;
+    std::size_t m_size;
+    // insertions left before the table must grow or drop its tombstones
+    std::size_t m_growthLeft;
+    [[no_unique_address]] Hash m_hash;
+    [[no_unique_address]] Eq m_eq;
+    CtrlAllocType m_ctrlAllocator;
+    SlotAllocType m_slotAllocator;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::FlatHashMap<K, V, Hash, Eq, A>::FlatHashMap() noexcept
+  :
+    m_ctrl{nullptr},
+    m_slots{nullptr},
+    m_capacity{0},
+    m_size{0},
+    m_growthLeft{0},
+    m_hash{Hash()},
+    m_eq{Eq()},
+    m_ctrlAllocator{CtrlAllocType()},
+    m_slotAllocator{SlotAllocType()}
+{
+
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::FlatHashMap<K, V, Hash, Eq, A>::FlatHashMap(FlatHashMap&& src) noexcept
+  :
+    m_ctrl{src.m_ctrl},
+    m_slots{src.m_slots},
+    m_capacity{src.m_capacity},
+    m_size{src.m_size},
+    m_growthLeft{src.m_growthLeft},
+    m_hash{std::move(src.m_hash)},
+    m_eq{std::move(src.m_eq)},
+    m_ctrlAllocator{std::move(src.m_ctrlAllocator)},
+    m_slotAllocator{std::move(src.m_slotAllocator)}
+{
+  src.m_ctrl = nullptr;
+  src.m_slots = nullptr;
+  src.m_capacity = 0;
+  src.m_size = 0;
+  src.m_growthLeft = 0;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+auto Aii::FlatHashMap<K, V, Hash, Eq, A>::operator=(FlatHashMap&& src) noexcept -> FlatHashMap&{
+  if(this != &src){
+    DestroyEntries();
+    Deallocate();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::FlatHashMap<K, V, Hash, Eq, A>::~FlatHashMap() noexcept{
+  DestroyEntries();
+  Deallocate();
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::FlatHashMap<K, V, Hash, Eq, A>::Swap(FlatHashMap& other) noexcept{
+  using std::swap;
+  swap(m_ctrl, other.m_ctrl);
+  swap(m_slots, other.m_slots);
+  swap(m_capacity, other.m_capacity);
+  swap(m_size, other.m_size);
+  swap(m_growthLeft, other.m_growthLeft);
+  swap(m_hash, other.m_hash);
+  swap(m_eq, other.m_eq);
+  swap(m_ctrlAllocator, other.m_ctrlAllocator);
+  swap(m_slotAllocator, other.m_slotAllocator);
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::FlatHashMap<K, V, Hash, Eq, A>::DestroyEntries() noexcept{
+  for(std::size_t i = 0; i < m_capacity; i++){
+    if(Details::IsFull(m_ctrl[i])){
+      EntryAt(i)->~Entry();
+    }
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::FlatHashMap<K, V, Hash, Eq, A>::Deallocate() noexcept{
+  // entries must already be destroyed
+  if(m_capacity){
+    m_ctrlAllocator.Deallocate(m_ctrl, m_capacity + Group::Width);
+    m_slotAllocator.Deallocate(m_slots, m_capacity);
+  }
+  m_ctrl = nullptr;
+  m_slots = nullptr;
+  m_capacity = 0;
+  m_size = 0;
+  m_growthLeft = 0;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::FlatHashMap<K, V, Hash, Eq, A>::Clear() noexcept{
+  // keeps the storage for reuse
+  DestroyEntries();
+  for(std::size_t i = 0; i < m_capacity + (m_capacity ? Group::Width : 0); i++){
+    m_ctrl[i] = Details::CtrlEmpty;
+  }
+  m_size = 0;
+  m_growthLeft = MaxLoad(m_capacity);
+}
+
+// Helpers
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+auto Aii::FlatHashMap<K, V, Hash, Eq, A>::EntryAt(std::size_t index) const noexcept -> Entry*{
+  return std::launder(reinterpret_cast<Entry*>(m_slots + index));
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::FlatHashMap<K, V, Hash, Eq, A>::SetCtrl(std::size_t index, std::int8_t ctrl) noexcept{
+  // the first group is repeated after the last slot
+  m_ctrl[index] = ctrl;
+  if(index < Group::Width){
+    m_ctrl[m_capacity + index] = ctrl;
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+std::size_t Aii::FlatHashMap<K, V, Hash, Eq, A>::FindIndex(const Q& key, std::uint64_t hash) const noexcept{
+  // Probes groups at triangular offsets from H1, which visits every group
+  // once as the capacity is a power of two. An empty slot in a group ends
+  // the search, as an insert would have stopped there.
+  if(m_capacity == 0){
+    return NotFound;
+  }
+  std::size_t mask = m_capacity - 1;
+  std::size_t pos = H1(hash) & mask;
+  std::size_t step = 0;
+  while(true){
+    Group group{m_ctrl + pos};
+    for(std::uint64_t match = group.Match(static_cast<std::uint8_t>(H2(hash))); match; match &= match - 1){
+      std::size_t index = (pos + (__builtin_ctzll(match) >> Group::SlotShift)) & mask;
+      if(m_eq(EntryAt(index)->key, key)){
+        return index;
+      }
+    }
+    if(group.MatchEmpty()){
+      return NotFound;
+    }
+    step += Group::Width;
+    pos = (pos + step) & mask;
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+std::size_t Aii::FlatHashMap<K, V, Hash, Eq, A>::FindFirstNonFull(std::uint64_t hash) const noexcept{
+  // first empty or deleted slot on the probe sequence of hash, one exists
+  // as the load factor stays below one
+  std::size_t mask = m_capacity - 1;
+  std::size_t pos = H1(hash) & mask;
+  std::size_t step = 0;
+  while(true){
+    std::uint64_t free = Group{m_ctrl + pos}.MatchEmptyOrDeleted();
+    if(free){
+      return (pos + (__builtin_ctzll(free) >> Group::SlotShift)) & mask;
+    }
+    step += Group::Width;
+    pos = (pos + step) & mask;
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+bool Aii::FlatHashMap<K, V, Hash, Eq, A>::ProbesTogether(std::size_t lhs, std::size_t rhs,
+                                                         std::uint64_t hash) const noexcept{
+  // whether both slots are in the same probe group for hash
+  std::size_t mask = m_capacity - 1;
+  std::size_t start = H1(hash) & mask;
+  return ((lhs - start) & mask) / Group::Width == ((rhs - start) & mask) / Group::Width;
+}
+
+// Lookup
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, K, Hash, Eq>
+auto Aii::FlatHashMap<K, V, Hash, Eq, A>::Find(const Q& key) const noexcept -> ValueType*{
+  // O(1) expected
+  if constexpr(!Details::IsTransparentHash<Hash, Eq> && !std::is_same_v<Q, KeyType>){
+    return Find<KeyType>(key);
+  }
+  else{
+    std::size_t index = FindIndex(key, HashOf(key));
+    return index == NotFound ? nullptr : &EntryAt(index)->val;
+  }
+}
+
+// Modification
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+bool Aii::FlatHashMap<K, V, Hash, Eq, A>::Resize(std::size_t capacity) noexcept{
+  // Moves every entry to new arrays of capacity slots, a power of two of at
+  // least MinCapacity. Returns false if allocation failed, leaving the table
+  // as it was.
+  std::int8_t* ctrl = m_ctrlAllocator.Allocate(capacity + Group::Width);
+  if(!ctrl){
+    return false;
+  }
+  Slot* slots = m_slotAllocator.Allocate(capacity);
+  if(!slots){
+    m_ctrlAllocator.Deallocate(ctrl, capacity + Group::Width);
+    return false;
+  }
+  for(std::size_t i = 0; i < capacity + Group::Width; i++){
+    ctrl[i] = Details::CtrlEmpty;
+  }
+  std::int8_t* oldCtrl = m_ctrl;
+  Slot* oldSlots = m_slots;
+  std::size_t oldCapacity = m_capacity;
+  std::size_t size = m_size;
+  m_ctrl = ctrl;
+  m_slots = slots;
+  m_capacity = capacity;
+  for(std::size_t i = 0; i < oldCapacity; i++){
+    if(Details::IsFull(oldCtrl[i])){
+      Entry* entry = std::launder(reinterpret_cast<Entry*>(oldSlots + i));
+      std::uint64_t hash = HashOf(entry->key);
+      std::size_t index = FindFirstNonFull(hash);
+      ::new(static_cast<void*>(m_slots + index)) Entry{std::move(*entry)};
+      entry->~Entry();
+      SetCtrl(index, H2(hash));
+    }
+  }
+  if(oldCapacity){
+    m_ctrlAllocator.Deallocate(oldCtrl, oldCapacity + Group::Width);
+    m_slotAllocator.Deallocate(oldSlots, oldCapacity);
+  }
+  m_size = size;
+  m_growthLeft = MaxLoad(m_capacity) - m_size;
+  return true;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+void Aii::FlatHashMap<K, V, Hash, Eq, A>::DropDeletes() noexcept{
+  // Rehashes in place to clear tombstones. Every tombstone becomes empty
+  // and every full slot is marked deleted, meaning not yet placed. Each
+  // marked entry then stays if it is already in the first group it would
+  // probe, moves to an empty slot, or swaps with a marked entry which is
+  // then placed in turn.
+  for(std::size_t i = 0; i < m_capacity; i++){
+    m_ctrl[i] = Details::IsFull(m_ctrl[i]) ? Details::CtrlDeleted : Details::CtrlEmpty;
+  }
+  for(std::size_t i = 0; i < Group::Width; i++){
+    m_ctrl[m_capacity + i] = m_ctrl[i];
+  }
+  for(std::size_t i = 0; i < m_capacity; i++){
+    if(m_ctrl[i] != Details::CtrlDeleted){
+      continue;
+    }
+    Entry* entry = EntryAt(i);
+    std::uint64_t hash = HashOf(entry->key);
+    std::size_t target = FindFirstNonFull(hash);
+    if(ProbesTogether(i, target, hash)){
+      SetCtrl(i, H2(hash));
+      continue;
+    }
+    if(m_ctrl[target] == Details::CtrlEmpty){
+      ::new(static_cast<void*>(m_slots + target)) Entry{std::move(*entry)};
+      entry->~Entry();
+      SetCtrl(target, H2(hash));
+      SetCtrl(i, Details::CtrlEmpty);
+    }
+    else{
+      Entry* other = EntryAt(target);
+      Entry tmp{std::move(*entry)};
+      entry->~Entry();
+      ::new(static_cast<void*>(m_slots + i)) Entry{std::move(*other)};
+      other->~Entry();
+      ::new(static_cast<void*>(m_slots + target)) Entry{std::move(tmp)};
+      SetCtrl(target, H2(hash));
+      // slot i now holds the unplaced entry from target
+      i--;
+    }
+  }
+  m_growthLeft = MaxLoad(m_capacity) - m_size;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+bool Aii::FlatHashMap<K, V, Hash, Eq, A>::MakeRoom() noexcept{
+  // Called when no insertions are left. Unless live entries fill more than
+  // 25/32 of the slots the tombstones are dropped in place, so a table with
+  // steady insert and erase traffic does not grow. Otherwise it doubles.
+  if(m_capacity && m_size * 32 <= m_capacity * 25){
+    DropDeletes();
+    return true;
+  }
+  return Resize(m_capacity ? m_capacity * 2 : MinCapacity);
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::Expected<typename Aii::FlatHashMap<K, V, Hash, Eq, A>::ValueType*, Aii::Error>
+Aii::FlatHashMap<K, V, Hash, Eq, A>::Insert(const KeyType& key, const ValueType& val) noexcept{
+  // O(1) amortised
+  //
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - growing the table failed
+  //
+  // On error, the table is left in the state before the function call
+  std::uint64_t hash = HashOf(key);
+  if(FindIndex(key, hash) != NotFound){
+    return {Aii::Error::InvalidArgument};
+  }
+  std::size_t index = m_capacity ? FindFirstNonFull(hash) : 0;
+  // reusing a tombstone costs no growth
+  if(m_capacity == 0 || (m_growthLeft == 0 && m_ctrl[index] != Details::CtrlDeleted)){
+    if(!MakeRoom()){
+      return {Aii::Error::RuntimeError};
+    }
+    index = FindFirstNonFull(hash);
+  }
+  if(m_ctrl[index] == Details::CtrlEmpty){
+    m_growthLeft--;
+  }
+  Entry* entry = ::new(static_cast<void*>(m_slots + index)) Entry{key, val};
+  SetCtrl(index, H2(hash));
+  m_size++;
+  return &entry->val;
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, K, Hash, Eq>
+Aii::Expected<void, Aii::Error> Aii::FlatHashMap<K, V, Hash, Eq, A>::Erase(const Q& key) noexcept{
+  // O(1) expected
+  //
+  // Possible Errors:
+  //  OutOfRange - the key is not present
+  if constexpr(!Details::IsTransparentHash<Hash, Eq> && !std::is_same_v<Q, KeyType>){
+    return Erase<KeyType>(key);
+  }
+  else{
+    std::size_t index = FindIndex(key, HashOf(key));
+    if(index == NotFound){
+      return {Aii::Error::OutOfRange};
+    }
+    EntryAt(index)->~Entry();
+    m_size--;
+    // If the empty slots either side leave no run of Width full or deleted
+    // slots through index, no probe ever went past it and it can be emptied.
+    std::size_t mask = m_capacity - 1;
+    std::uint64_t emptyBefore = Group{m_ctrl + ((index - Group::Width) & mask)}.MatchEmpty();
+    std::uint64_t emptyAfter = Group{m_ctrl + index}.MatchEmpty();
+    constexpr std::size_t GroupBits = Group::Width << Group::SlotShift;
+    std::size_t leading = emptyBefore ? (__builtin_clzll(emptyBefore) - (64 - GroupBits)) >> Group::SlotShift
+                                      : Group::Width;
+    std::size_t trailing = emptyAfter ? __builtin_ctzll(emptyAfter) >> Group::SlotShift : Group::Width;
+    if(leading + trailing < Group::Width){
+      SetCtrl(index, Details::CtrlEmpty);
+      m_growthLeft++;
+    }
+    else{
+      SetCtrl(index, Details::CtrlDeleted);
+    }
+    return {};
+  }
+}
+
+template<typename K, typename V, typename Hash, typename Eq, typename A>
+Aii::Expected<void, Aii::Error> Aii::FlatHashMap<K, V, Hash, Eq, A>::Reserve(std::size_t count) noexcept{
+  // sizes the table so count entries fit without growing
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the table is left in the state before the function call
+  std::size_t capacity = m_capacity ? m_capacity : MinCapacity;
+  while(MaxLoad(capacity) < count){
+    capacity *= 2;
+  }
+  if(capacity == m_capacity){
+    return {};
+  }
+  if(!Resize(capacity)){
+    return {Aii::Error::RuntimeError};
+  }
+  return {};
+}
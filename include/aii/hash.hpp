@@ -0,0 +1,289 @@
+#pragma once
+
+// Non cryptographic hashing and checksums.
+//
+//  * HashBytes / HashU64 - 64 bit hashes in the style of wyhash: a few 64x64
+//    to 128 bit multiplies per 16 bytes, with every output bit usable
+//  * Crc32c - CRC32C (Castagnoli), using the SSE4.2 crc32 instruction when
+//    the target has it and a slicing-by-8 table otherwise
+//  * Hash / EqualTo - function objects used as the defaults of the hash
+//    containers, which take their bucket from one end of a hash and tag
+//    bits from the other
+//
+// Every function also runs in constant evaluation, through the portable
+// code path, and gives the same result there.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE4_2__)
+  #include <nmmintrin.h>
+#endif
+
+namespace Aii{
+
+namespace Details{
+
+constexpr std::uint64_t HashMix64(std::uint64_t x) noexcept{
+  // finaliser spreading every input bit over the whole word
+  x ^= x >> 32;
+  x *= 0xd6e8feb86659fd93ull;
+  x ^= x >> 32;
+  x *= 0xd6e8feb86659fd93ull;
+  x ^= x >> 32;
+  return x;
+}
+
+inline constexpr std::uint64_t WySecret[4] = {
+  0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+constexpr void WyMum(std::uint64_t& a, std::uint64_t& b) noexcept{
+  // a and b become the low and high halves of their 128 bit product
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  a = static_cast<std::uint64_t>(product);
+  b = static_cast<std::uint64_t>(product >> 64);
+#else
+  std::uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<std::uint32_t>(a), lb = static_cast<std::uint32_t>(b);
+  std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  std::uint64_t t = rl + (rm0 << 32);
+  std::uint64_t carry = t < rl;
+  std::uint64_t lo = t + (rm1 << 32);
+  carry += lo < t;
+  a = lo;
+  b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+constexpr std::uint64_t WyMix(std::uint64_t a, std::uint64_t b) noexcept{
+  WyMum(a, b);
+  return a ^ b;
+}
+
+constexpr std::uint64_t Read64(const std::uint8_t* p) noexcept{
+  // unaligned little endian load
+  if(std::is_constant_evaluated()){
+    std::uint64_t val = 0;
+    for(int i = 7; i >= 0; i--){
+      val = (val << 8) | p[i];
+    }
+    return val;
+  }
+  std::uint64_t val;
+  __builtin_memcpy(&val, p, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  val = __builtin_bswap64(val);
+#endif
+  return val;
+}
+
+constexpr std::uint64_t Read32(const std::uint8_t* p) noexcept{
+  if(std::is_constant_evaluated()){
+    return static_cast<std::uint64_t>(p[0]) | static_cast<std::uint64_t>(p[1]) << 8 |
+           static_cast<std::uint64_t>(p[2]) << 16 | static_cast<std::uint64_t>(p[3]) << 24;
+  }
+  std::uint32_t val;
+  __builtin_memcpy(&val, p, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  val = __builtin_bswap32(val);
+#endif
+  return val;
+}
+
+constexpr std::uint32_t Crc32cByteTable(std::uint32_t byte) noexcept{
+  // reflected polynomial 0x1edc6f41
+  std::uint32_t crc = byte;
+  for(int i = 0; i < 8; i++){
+    crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+  }
+  return crc;
+}
+
+struct Crc32cTables{
+  // entry [k][b] is the crc of byte b followed by k zero bytes
+  std::uint32_t table[8][256];
+
+  constexpr Crc32cTables() noexcept: table{}{
+    for(std::uint32_t b = 0; b < 256; b++){
+      table[0][b] = Crc32cByteTable(b);
+    }
+    for(std::size_t k = 1; k < 8; k++){
+      for(std::size_t b = 0; b < 256; b++){
+        table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+      }
+    }
+  }
+};
+
+inline constexpr Crc32cTables Crc32cTable{};
+
+constexpr std::uint32_t Crc32cSlicing(const std::uint8_t* data, std::size_t length, std::uint32_t crc) noexcept{
+  // crc is the running value, already inverted. Eight table lookups per
+  // eight bytes, independent of each other.
+  const auto& t = Crc32cTable.table;
+  while(length >= 8){
+    std::uint64_t v = Read64(data) ^ crc;
+    crc = t[7][v & 0xff] ^ t[6][(v >> 8) & 0xff] ^ t[5][(v >> 16) & 0xff] ^ t[4][(v >> 24) & 0xff] ^
+          t[3][(v >> 32) & 0xff] ^ t[2][(v >> 40) & 0xff] ^ t[1][(v >> 48) & 0xff] ^ t[0][v >> 56];
+    data += 8;
+    length -= 8;
+  }
+  while(length--){
+    crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(__SSE4_2__)
+inline std::uint32_t Crc32cHardware(const std::uint8_t* data, std::size_t length, std::uint32_t crc) noexcept{
+  #if defined(__x86_64__)
+  std::uint64_t crc64 = crc;
+  while(length >= 8){
+    crc64 = _mm_crc32_u64(crc64, Read64(data));
+    data += 8;
+    length -= 8;
+  }
+  crc = static_cast<std::uint32_t>(crc64);
+  #endif
+  while(length--){
+    crc = _mm_crc32_u8(crc, *data++);
+  }
+  return crc;
+}
+#endif
+
+} // namespace Details
+
+constexpr std::uint64_t HashBytes(const std::uint8_t* data, std::size_t length, std::uint64_t seed = 0) noexcept{
+  // 64 bit hash of length bytes, O(length)
+  using Details::Read32;
+  using Details::Read64;
+  using Details::WyMix;
+  using Details::WySecret;
+  const std::uint8_t* p = data;
+  seed ^= WyMix(seed ^ WySecret[0], WySecret[1]);
+  std::uint64_t a = 0;
+  std::uint64_t b = 0;
+  if(length <= 16){
+    if(length >= 4){
+      // two overlapping pairs of 4 byte reads cover 4 to 16 bytes
+      std::size_t middle = (length >> 3) << 2;
+      a = (Read32(p) << 32) | Read32(p + middle);
+      b = (Read32(p + length - 4) << 32) | Read32(p + length - 4 - middle);
+    }
+    else if(length > 0){
+      a = (static_cast<std::uint64_t>(p[0]) << 16) | (static_cast<std::uint64_t>(p[length >> 1]) << 8) | p[length - 1];
+    }
+  }
+  else{
+    std::size_t rest = length;
+    if(rest >= 48){
+      // three independent lanes keep the multipliers busy
+      std::uint64_t seed1 = seed;
+      std::uint64_t seed2 = seed;
+      do{
+        seed = WyMix(Read64(p) ^ WySecret[1], Read64(p + 8) ^ seed);
+        seed1 = WyMix(Read64(p + 16) ^ WySecret[2], Read64(p + 24) ^ seed1);
+        seed2 = WyMix(Read64(p + 32) ^ WySecret[3], Read64(p + 40) ^ seed2);
+        p += 48;
+        rest -= 48;
+      } while(rest >= 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while(rest > 16){
+      seed = WyMix(Read64(p) ^ WySecret[1], Read64(p + 8) ^ seed);
+      p += 16;
+      rest -= 16;
+    }
+    a = Read64(p + rest - 16);
+    b = Read64(p + rest - 8);
+  }
+  a ^= WySecret[1];
+  b ^= seed;
+  Details::WyMum(a, b);
+  return WyMix(a ^ WySecret[0] ^ length, b ^ WySecret[1]);
+}
+
+inline std::uint64_t HashBytes(const void* data, std::size_t length, std::uint64_t seed = 0) noexcept{
+  return HashBytes(static_cast<const std::uint8_t*>(data), length, seed);
+}
+
+constexpr std::uint64_t HashU64(std::uint64_t val, std::uint64_t seed = 0) noexcept{
+  // hash of a single word. One multiply leaves the high input bits poorly
+  // mixed, so the halves of the product are folded through a second.
+  std::uint64_t a = val ^ Details::WySecret[0];
+  std::uint64_t b = seed ^ Details::WySecret[1];
+  Details::WyMum(a, b);
+  return Details::WyMix(a ^ Details::WySecret[0], b ^ Details::WySecret[1]);
+}
+
+constexpr std::uint32_t Crc32c(const std::uint8_t* data, std::size_t length, std::uint32_t crc = 0) noexcept{
+  // CRC32C of length bytes. Passing the result of a previous call as crc
+  // continues it, so a buffer can be checksummed in pieces. O(length)
+  crc = ~crc;
+#if defined(__SSE4_2__)
+  if(!std::is_constant_evaluated()){
+    return ~Details::Crc32cHardware(data, length, crc);
+  }
+#endif
+  return ~Details::Crc32cSlicing(data, length, crc);
+}
+
+inline std::uint32_t Crc32c(const void* data, std::size_t length, std::uint32_t crc = 0) noexcept{
+  return Crc32c(static_cast<const std::uint8_t*>(data), length, crc);
+}
+
+// Hash and equality which accept types other than the key
+namespace Details{
+
+template<typename Hash, typename Eq>
+concept IsTransparentHash = requires{ typename Hash::is_transparent; typename Eq::is_transparent; };
+
+// Types a hash table with key K can be searched by. Other types are
+// converted to K first, unless the hash and equality are transparent.
+template<typename Q, typename K, typename Hash, typename Eq>
+concept IsHashLookupKey = std::is_convertible_v<const Q&, K> || IsTransparentHash<Hash, Eq>;
+
+} // namespace Details
+
+template<typename T>
+struct Hash;
+
+template<typename T>
+  requires std::is_integral_v<T> || std::is_enum_v<T>
+struct Hash<T>{
+  constexpr std::uint64_t operator()(T val) const noexcept{
+    return HashU64(static_cast<std::uint64_t>(val));
+  }
+};
+
+template<typename T>
+struct Hash<T*>{
+  std::uint64_t operator()(const T* val) const noexcept{
+    return HashU64(reinterpret_cast<std::uintptr_t>(val));
+  }
+};
+
+template<typename T = void>
+struct EqualTo{
+  constexpr bool operator()(const T& lhs, const T& rhs) const noexcept{
+    return lhs == rhs;
+  }
+};
+
+// Compares any two types with an operator==. Tables only allow lookups by
+// a type other than their key when both the hash and the equality are
+// marked transparent like this.
+template<>
+struct EqualTo<void>{
+  using is_transparent = void;
+
+  template<typename L, typename R>
+  constexpr bool operator()(const L& lhs, const R& rhs) const noexcept{
+    return lhs == rhs;
+  }
+};
+
+} // namespace Aii
@@ -0,0 +1,354 @@
+#pragma once
+
+// Map of non overlapping half open intervals [start, end), such as the
+// regions of an address space.
+//
+// Built on an augmented RbTree keyed by interval start, where every node
+// records the free gap between its interval and the previous one and the
+// largest such gap in its subtree. Free range searches prune every subtree
+// whose largest gap is too small, and overlap queries walk only the
+// intervals they report, so neither has to scan the whole map.
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+#include "aii/rbtree.hpp"
+
+namespace Aii{
+
+template<typename K,
+         typename V,
+         typename A = Aii::Allocator<K>>
+class IntervalTree{
+  static_assert(std::is_unsigned_v<K>, "IntervalTree: K must be an unsigned integer");
+
+  struct Entry{
+    K end;
+    V val;
+  };
+
+  struct GapAugment{
+    struct Data{
+      // free space between the end of the previous interval (or the floor)
+      // and the start of this one
+      K gap;
+      // largest gap in the subtree
+      K maxGap;
+      // bitwise or of the starts of the non empty gaps in the subtree, so
+      // its lowest set bit is the alignment every such gap start shares
+      K starts;
+    };
+
+    template<typename TreeNode>
+    static void Update(TreeNode* node) noexcept;
+  };
+
+  using Tree = Aii::RbTree<K, Entry, A, GapAugment>;
+  using Node = typename Tree::Node;
+
+  public:
+    using KeyType = K;
+    using ValueType = V;
+
+    class Iterator{
+      public:
+        constexpr Iterator() noexcept = default;
+        constexpr explicit Iterator(typename Tree::Iterator it) noexcept: m_it{it}{}
+
+        KeyType Start() const noexcept{ return m_it.Key();}
+        KeyType End() const noexcept{ return m_it.Val().end;}
+        ValueType& Val() const noexcept{ return m_it.Val().val;}
+
+        ValueType& operator*() const noexcept{ return m_it.Val().val;}
+        ValueType* operator->() const noexcept{ return &m_it.Val().val;}
+
+        Iterator& operator++() noexcept{ ++m_it; return *this;}
+        Iterator operator++(int) noexcept{ Iterator tmp = *this; ++m_it; return tmp;}
+
+        constexpr bool operator==(const Iterator& rhs) const noexcept{ return m_it == rhs.m_it;}
+        constexpr bool operator!=(const Iterator& rhs) const noexcept{ return m_it != rhs.m_it;}
+
+      private:
+        typename Tree::Iterator m_it;
+    };
+
+  public:
+    IntervalTree() noexcept: IntervalTree(0){}
+    explicit IntervalTree(KeyType floor) noexcept;
+
+    bool Empty() const noexcept{ return m_tree.Empty();}
+    std::size_t Size() const noexcept{ return m_tree.Size();}
+    KeyType Floor() const noexcept{ return m_floor;}
+    void Clear() noexcept{ m_tree.Clear();}
+
+    Iterator begin() const noexcept{ return Iterator{m_tree.begin()};}
+    Iterator end() const noexcept{ return Iterator{m_tree.end()};}
+
+    Aii::Expected<ValueType*, Error> Insert(KeyType start, KeyType end, const ValueType& val) noexcept;
+    Aii::Expected<void, Error> Erase(KeyType start) noexcept;
+
+    Iterator Find(KeyType point) const noexcept;
+    Iterator FirstOverlap(KeyType start, KeyType end) const noexcept;
+    template<typename F>
+    std::size_t ForEachOverlap(KeyType start, KeyType end, F&& fn) const;
+
+    Aii::Expected<KeyType, Error> FindGap(KeyType size, KeyType align,
+                                          KeyType hint, KeyType limit) const noexcept;
+
+  private:
+    Node* Predecessor(KeyType point) const noexcept;
+    KeyType GapStart(const Node* node) const noexcept{ return node->key - node->aug.gap;}
+    void RecomputeGap(Node* node) noexcept;
+
+    static bool FitGap(KeyType gapStart, KeyType gapEnd, KeyType size, KeyType align,
+                       KeyType hint, KeyType limit, KeyType& out) noexcept;
+    bool SearchGap(const Node* node, KeyType size, KeyType length, KeyType align,
+                   KeyType hint, KeyType limit, KeyType& out) const noexcept;
+
+  private:
+    Tree m_tree;
+    KeyType m_floor;
+};
+
+} // namespace Aii
+
+template<typename K, typename V, typename A> template<typename TreeNode>
+void Aii::IntervalTree<K, V, A>::GapAugment::Update(TreeNode* node) noexcept{
+  K maxGap = node->aug.gap;
+  if(node->left && node->left->aug.maxGap > maxGap){
+    maxGap = node->left->aug.maxGap;
+  }
+  if(node->right && node->right->aug.maxGap > maxGap){
+    maxGap = node->right->aug.maxGap;
+  }
+  node->aug.maxGap = maxGap;
+  K starts = node->aug.gap ? node->key - node->aug.gap : K{0};
+  if(node->left){
+    starts |= node->left->aug.starts;
+  }
+  if(node->right){
+    starts |= node->right->aug.starts;
+  }
+  node->aug.starts = starts;
+}
+
+template<typename K, typename V, typename A>
+Aii::IntervalTree<K, V, A>::IntervalTree(KeyType floor) noexcept
+  :
+    m_tree{},
+    m_floor{floor}
+{
+  // floor is the lowest address the first gap may start at
+}
+
+template<typename K, typename V, typename A>
+auto Aii::IntervalTree<K, V, A>::Predecessor(KeyType point) const noexcept -> Node*{
+  // interval with the greatest start not greater than point
+  Node* node = m_tree.Root();
+  Node* candidate = nullptr;
+  while(node){
+    if(point < node->key){
+      node = node->left;
+    }
+    else{
+      candidate = node;
+      node = node->right;
+    }
+  }
+  return candidate;
+}
+
+template<typename K, typename V, typename A>
+void Aii::IntervalTree<K, V, A>::RecomputeGap(Node* node) noexcept{
+  Node* prev = Tree::Prev(node);
+  node->aug.gap = node->key - (prev ? prev->val.end : m_floor);
+  Tree::Propagate(node);
+}
+
+template<typename K, typename V, typename A>
+Aii::Expected<typename Aii::IntervalTree<K, V, A>::ValueType*, Aii::Error>
+Aii::IntervalTree<K, V, A>::Insert(KeyType start, KeyType end, const ValueType& val) noexcept{
+  // O(log n)
+  //
+  // Possible Errors:
+  //  InvalidArgument - the interval is empty, lies below the floor or
+  //                    overlaps an interval already in the map
+  //  RuntimeError - node allocation failed
+  if(!(start < end) || start < m_floor){
+    return {Aii::Error::InvalidArgument};
+  }
+  Node* prev = Predecessor(start);
+  Node* next = prev ? Tree::Next(prev) : Tree::Min(m_tree.Root());
+  if(prev && (prev->key == start || start < prev->val.end)){
+    return {Aii::Error::InvalidArgument};
+  }
+  if(next && next->key < end){
+    return {Aii::Error::InvalidArgument};
+  }
+  if(!m_tree.Insert(start, Entry{end, val})){
+    return {Aii::Error::RuntimeError};
+  }
+  Node* node = prev ? Tree::Next(prev) : Tree::Min(m_tree.Root());
+  RecomputeGap(node);
+  if(next){
+    // the new interval now bounds the gap in front of its successor
+    RecomputeGap(next);
+  }
+  return &node->val.val;
+}
+
+template<typename K, typename V, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::IntervalTree<K, V, A>::Erase(KeyType start) noexcept{
+  // O(log n)
+  //
+  // Possible Errors:
+  //  OutOfRange - no interval starts at start
+  Node* node = Predecessor(start);
+  if(!node || node->key != start){
+    return {Aii::Error::OutOfRange};
+  }
+  // nodes are relinked rather than copied on erase, so next stays valid
+  Node* next = Tree::Next(node);
+  m_tree.Erase(start);
+  if(next){
+    RecomputeGap(next);
+  }
+  return {};
+}
+
+template<typename K, typename V, typename A>
+auto Aii::IntervalTree<K, V, A>::Find(KeyType point) const noexcept -> Iterator{
+  // interval containing point, O(log n)
+  Node* node = Predecessor(point);
+  if(node && point < node->val.end){
+    return Iterator{typename Tree::Iterator{node}};
+  }
+  return end();
+}
+
+template<typename K, typename V, typename A>
+auto Aii::IntervalTree<K, V, A>::FirstOverlap(KeyType start, KeyType end) const noexcept -> Iterator{
+  // lowest interval intersecting [start, end), O(log n)
+  if(!(start < end)){
+    return this->end();
+  }
+  Node* node = Predecessor(start);
+  if(node && start < node->val.end){
+    return Iterator{typename Tree::Iterator{node}};
+  }
+  node = node ? Tree::Next(node) : Tree::Min(m_tree.Root());
+  if(node && node->key < end){
+    return Iterator{typename Tree::Iterator{node}};
+  }
+  return this->end();
+}
+
+template<typename K, typename V, typename A> template<typename F>
+std::size_t Aii::IntervalTree<K, V, A>::ForEachOverlap(KeyType start, KeyType end, F&& fn) const{
+  // calls fn(start, end, val) for every interval intersecting [start, end)
+  // in ascending order. O(log n + k) for k reported intervals.
+  std::size_t count = 0;
+  for(Iterator it = FirstOverlap(start, end); it != this->end() && it.Start() < end; ++it){
+    fn(it.Start(), it.End(), it.Val());
+    count++;
+  }
+  return count;
+}
+
+template<typename K, typename V, typename A>
+bool Aii::IntervalTree<K, V, A>::FitGap(KeyType gapStart, KeyType gapEnd, KeyType size,
+                                        KeyType align, KeyType hint, KeyType limit,
+                                        KeyType& out) noexcept{
+  // lowest align aligned address a >= hint with [a, a + size) inside both
+  // [gapStart, gapEnd) and [0, limit)
+  KeyType start = gapStart < hint ? hint : gapStart;
+  KeyType mask = align - 1;
+  if(start > static_cast<KeyType>(~KeyType{0}) - mask){
+    return false;
+  }
+  start = (start + mask) & ~mask;
+  KeyType end = gapEnd < limit ? gapEnd : limit;
+  if(start > end || end - start < size){
+    return false;
+  }
+  out = start;
+  return true;
+}
+
+template<typename K, typename V, typename A>
+bool Aii::IntervalTree<K, V, A>::SearchGap(const Node* node, KeyType size, KeyType length,
+                                           KeyType align, KeyType hint, KeyType limit,
+                                           KeyType& out) const noexcept{
+  // In order search for the lowest gap at least length long, where length
+  // is chosen by FindGap so that every such gap holds an aligned block.
+  // Subtrees whose largest gap is shorter are skipped, as are the gaps
+  // ending below hint + size, so the walk is a descent to the hint followed
+  // by a descent to the first long enough gap. Only the gap holding the
+  // hint and the one crossing the limit can still be rejected, which keeps
+  // the search O(log n).
+  if(!node || node->aug.maxGap < length){
+    return false;
+  }
+  if(node->key <= hint || node->key - hint < size){
+    // this gap and every gap in the left subtree end too low
+    return SearchGap(node->right, size, length, align, hint, limit, out);
+  }
+  if(SearchGap(node->left, size, length, align, hint, limit, out)){
+    return true;
+  }
+  if(node->aug.gap >= length && FitGap(GapStart(node), node->key, size, align, hint, limit, out)){
+    return true;
+  }
+  if(GapStart(node) >= limit){
+    // every gap further right starts past the limit
+    return false;
+  }
+  return SearchGap(node->right, size, length, align, hint, limit, out);
+}
+
+template<typename K, typename V, typename A>
+Aii::Expected<typename Aii::IntervalTree<K, V, A>::KeyType, Aii::Error>
+Aii::IntervalTree<K, V, A>::FindGap(KeyType size, KeyType align,
+                                    KeyType hint, KeyType limit) const noexcept{
+  // Returns an address a with a >= hint, a aligned to align and
+  // [a, a + size) free and below limit. The space above the last interval
+  // counts as a gap reaching up to limit.
+  //
+  // Like the Linux unmapped_area, the search looks for the lowest gap long
+  // enough to hold an aligned block wherever it starts, which keeps it
+  // O(log n). Gap starts are all aligned to the granularity g, the lowest
+  // bit they share, so that length is size + align - g, and just size
+  // when align is at most g. A one page request at page alignment
+  // therefore takes the first free page, while a gap which holds a block
+  // aligned past g only by its placement is passed over. The space above
+  // the last interval is fitted exactly.
+  //
+  // Possible Errors:
+  //  InvalidArgument - size is zero or align is not a power of two
+  //  OutOfRange - there is no such gap
+  if(size == 0 || align == 0 || (align & (align - 1)) != 0){
+    return {Aii::Error::InvalidArgument};
+  }
+  Node* root = m_tree.Root();
+  KeyType starts = root ? root->aug.starts : KeyType{0};
+  KeyType granularity = starts & (~starts + 1);
+  KeyType slack = starts && align > granularity ? align - granularity : 0;
+  KeyType length = ~KeyType{0};
+  if(size <= length - slack){
+    length = size + slack;
+  }
+  KeyType address = 0;
+  if(SearchGap(root, size, length, align, hint, limit, address)){
+    return KeyType{address};
+  }
+  Node* last = Tree::Max(root);
+  if(FitGap(last ? last->val.end : m_floor, limit, size, align, hint, limit, address)){
+    return KeyType{address};
+  }
+  return {Aii::Error::OutOfRange};
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+// Chained hash table over objects which embed an Aii::ListNode<void>. The
+// table owns only its buckets, each the head of a singly linked list threaded
+// through the objects' nodes, so inserting and removing never allocate and
+// an object can sit in other lists at the same time.
+//
+// Resizing is incremental. Once the load passes one object per bucket a
+// table twice the size is allocated, and every later insert or erase moves a
+// few buckets across until the old table is empty. Lookups search both tables
+// meanwhile. No single operation pays for a full rehash, and a failed bucket
+// allocation only leaves the chains longer.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+#include "aii/hash.hpp"
+#include "aii/list_node.hpp"
+
+namespace Aii{
+
+namespace Details{
+
+template<typename T, typename KeyFn>
+using IntrusiveKeyType = std::remove_cvref_t<decltype(std::declval<KeyFn>()(std::declval<const T&>()))>;
+
+} // namespace Details
+
+template<typename T,
+         Aii::ListNode<void> T::*Node,
+         typename KeyFn,
+         typename Hash = Aii::Hash<Details::IntrusiveKeyType<T, KeyFn>>,
+         typename Eq = Aii::EqualTo<Details::IntrusiveKeyType<T, KeyFn>>,
+         typename A = Aii::Allocator<T>>
+class IntrusiveHashTable{
+  static_assert(Aii::IsAllocator<A>, "IntrusiveHashTable: A must satisfy Aii::IsAllocator");
+
+  public:
+    using ValueType = T;
+    using KeyType = Details::IntrusiveKeyType<T, KeyFn>;
+    using Bucket = Aii::ListNode<void>;
+
+    static constexpr std::size_t MinBuckets = 8;
+    // buckets moved to the new table by each insert or erase during a
+    // resize, enough to finish before the next resize is due
+    static constexpr std::size_t MigrateStep = 2;
+
+  private:
+    using BucketAllocType = typename A::template Rebind<Bucket>::other;
+
+    struct Table{
+      Bucket* buckets;
+      std::size_t count;
+    };
+
+  public:
+    IntrusiveHashTable() noexcept;
+    IntrusiveHashTable(const IntrusiveHashTable& src) noexcept = delete;
+    IntrusiveHashTable(IntrusiveHashTable&& src) noexcept;
+    IntrusiveHashTable& operator=(const IntrusiveHashTable& src) noexcept = delete;
+    IntrusiveHashTable& operator=(IntrusiveHashTable&& src) noexcept;
+    ~IntrusiveHashTable() noexcept;
+
+    void Swap(IntrusiveHashTable& other) noexcept;
+
+    bool Empty() const noexcept{ return m_size == 0;}
+    std::size_t Size() const noexcept{ return m_size;}
+    std::size_t BucketCount() const noexcept{ return Resizing() ? m_tables[1].count : m_tables[0].count;}
+    bool Resizing() const noexcept{ return m_tables[1].buckets != nullptr;}
+
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, KeyType, Hash, Eq>
+    ValueType* Find(const Q& key) const noexcept;
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, KeyType, Hash, Eq>
+    bool Contains(const Q& key) const noexcept{ return Find(key) != nullptr;}
+
+    Aii::Expected<void, Error> Insert(ValueType& obj) noexcept;
+    template<typename Q = KeyType>
+      requires Details::IsHashLookupKey<Q, KeyType, Hash, Eq>
+    Aii::Expected<ValueType*, Error> Erase(const Q& key) noexcept;
+    Aii::Expected<void, Error> Remove(ValueType& obj) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> Reserve(std::size_t count) noexcept;
+    void FinishResize() noexcept;
+
+    template<typename F>
+    std::size_t ForEach(F&& fn) const;
+
+  private:
+    static ValueType* FromNode(Bucket* node) noexcept{ return Aii::ContainerOf(node, Node);}
+    static Bucket* ToNode(ValueType& obj) noexcept{ return &(obj.*Node);}
+    decltype(auto) KeyOf(const ValueType& obj) const noexcept{ return m_key(obj);}
+
+    template<typename Q>
+    std::uint64_t HashOf(const Q& key) const noexcept{ return static_cast<std::uint64_t>(m_hash(key));}
+    Bucket* BucketFor(std::uint64_t hash) const noexcept;
+
+    template<typename Q>
+    ValueType* FindIn(const Bucket* bucket, const Q& key) const noexcept;
+    bool StartResize(std::size_t count) noexcept;
+    void Migrate(std::size_t buckets) noexcept;
+
+  private:
+    // m_tables[0] is the table in use, or the one being emptied while
+    // m_tables[1] is filled. Buckets of m_tables[0] below m_migrated are
+    // already moved.
+    Table m_tables[2];
+    std::size_t m_migrated;
+    std::size_t m_size;
+    [[no_unique_address]] KeyFn m_key;
+    [[no_unique_address]] Hash m_hash;
+    [[no_unique_address]] Eq m_eq;
+    BucketAllocType m_bucketAllocator;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::IntrusiveHashTable() noexcept
+  :
+    m_tables{{nullptr, 0}, {nullptr, 0}},
+    m_migrated{0},
+    m_size{0},
+    m_key{KeyFn()},
+    m_hash{Hash()},
+    m_eq{Eq()},
+    m_bucketAllocator{BucketAllocType()}
+{
+
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::IntrusiveHashTable(IntrusiveHashTable&& src) noexcept
+  :
+    m_tables{src.m_tables[0], src.m_tables[1]},
+    m_migrated{src.m_migrated},
+    m_size{src.m_size},
+    m_key{std::move(src.m_key)},
+    m_hash{std::move(src.m_hash)},
+    m_eq{std::move(src.m_eq)},
+    m_bucketAllocator{std::move(src.m_bucketAllocator)}
+{
+  src.m_tables[0] = {nullptr, 0};
+  src.m_tables[1] = {nullptr, 0};
+  src.m_migrated = 0;
+  src.m_size = 0;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+auto Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::operator=(IntrusiveHashTable&& src) noexcept
+  -> IntrusiveHashTable&{
+  if(this != &src){
+    IntrusiveHashTable tmp{std::move(src)};
+    Swap(tmp);
+  }
+  return *this;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::~IntrusiveHashTable() noexcept{
+  // the objects are not owned, only the buckets are released
+  for(Table& table : m_tables){
+    if(table.buckets){
+      m_bucketAllocator.Deallocate(table.buckets, table.count);
+    }
+  }
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+void Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Swap(IntrusiveHashTable& other) noexcept{
+  using std::swap;
+  swap(m_tables[0], other.m_tables[0]);
+  swap(m_tables[1], other.m_tables[1]);
+  swap(m_migrated, other.m_migrated);
+  swap(m_size, other.m_size);
+  swap(m_key, other.m_key);
+  swap(m_hash, other.m_hash);
+  swap(m_eq, other.m_eq);
+  swap(m_bucketAllocator, other.m_bucketAllocator);
+}
+
+// Helpers
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+auto Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::BucketFor(std::uint64_t hash) const noexcept -> Bucket*{
+  // bucket an object with hash belongs in: the new table while resizing,
+  // since inserts go there
+  const Table& table = Resizing() ? m_tables[1] : m_tables[0];
+  return &table.buckets[hash & (table.count - 1)];
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A> template<typename Q>
+auto Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::FindIn(const Bucket* bucket, const Q& key) const noexcept
+  -> ValueType*{
+  for(Bucket* node = bucket->Next(); node; node = node->Next()){
+    if(m_eq(KeyOf(*FromNode(node)), key)){
+      return FromNode(node);
+    }
+  }
+  return nullptr;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+bool Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::StartResize(std::size_t count) noexcept{
+  // Allocates the table to migrate to, count buckets being a power of two.
+  // Without a table in use it becomes that table directly. Returns false if
+  // the allocation failed.
+  FinishResize();
+  Bucket* buckets = m_bucketAllocator.Allocate(count);
+  if(!buckets){
+    return false;
+  }
+  if(!m_tables[0].buckets){
+    m_tables[0] = {buckets, count};
+  }
+  else{
+    m_tables[1] = {buckets, count};
+    m_migrated = 0;
+  }
+  return true;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+void Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Migrate(std::size_t buckets) noexcept{
+  // Moves up to buckets buckets of the old table into the new one, and
+  // releases the old table once it is empty. O(buckets) expected.
+  if(!Resizing()){
+    return;
+  }
+  Table& from = m_tables[0];
+  Table& to = m_tables[1];
+  for(std::size_t i = 0; i < buckets && m_migrated < from.count; i++, m_migrated++){
+    Bucket& bucket = from.buckets[m_migrated];
+    while(Bucket* node = bucket.Next()){
+      bucket.Next() = node->Next();
+      to.buckets[HashOf(KeyOf(*FromNode(node))) & (to.count - 1)].PushFront(node);
+    }
+  }
+  if(m_migrated == from.count){
+    m_bucketAllocator.Deallocate(from.buckets, from.count);
+    from = to;
+    to = {nullptr, 0};
+    m_migrated = 0;
+  }
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+void Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::FinishResize() noexcept{
+  // completes a resize in progress at once, O(n)
+  if(Resizing()){
+    Migrate(m_tables[0].count);
+  }
+}
+
+// Lookup
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, typename Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::KeyType, Hash, Eq>
+auto Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Find(const Q& key) const noexcept -> ValueType*{
+  // O(1) expected. While resizing, an object is in the new table or in an
+  // old bucket not yet moved.
+  if constexpr(!Details::IsTransparentHash<Hash, Eq> && !std::is_same_v<Q, KeyType>){
+    return Find<KeyType>(key);
+  }
+  else{
+    if(!m_tables[0].buckets){
+      return nullptr;
+    }
+    std::uint64_t hash = HashOf(key);
+    if(Resizing()){
+      std::size_t index = hash & (m_tables[0].count - 1);
+      if(index >= m_migrated){
+        if(ValueType* obj = FindIn(&m_tables[0].buckets[index], key)){
+          return obj;
+        }
+      }
+    }
+    return FindIn(BucketFor(hash), key);
+  }
+}
+
+// Modification
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+Aii::Expected<void, Aii::Error> Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Insert(ValueType& obj) noexcept{
+  // O(1) expected, obj must not be in the table
+  //
+  // Possible Errors:
+  //  InvalidArgument - an object with the same key is present
+  //  RuntimeError - the first bucket array could not be allocated
+  //
+  // On error, the table is left in the state before the function call
+  if(!m_tables[0].buckets && !StartResize(MinBuckets)){
+    return {Aii::Error::RuntimeError};
+  }
+  if(Find(KeyOf(obj))){
+    return {Aii::Error::InvalidArgument};
+  }
+  Migrate(MigrateStep);
+  BucketFor(HashOf(KeyOf(obj)))->PushFront(ToNode(obj));
+  m_size++;
+  if(!Resizing() && m_size > m_tables[0].count){
+    // a failed allocation is retried by the next insert
+    StartResize(m_tables[0].count * 2);
+  }
+  return {};
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A> template<typename Q>
+  requires Aii::Details::IsHashLookupKey<Q, typename Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::KeyType, Hash, Eq>
+Aii::Expected<typename Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::ValueType*, Aii::Error>
+Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Erase(const Q& key) noexcept{
+  // removes and returns the object with key, O(1) expected
+  //
+  // Possible Errors:
+  //  OutOfRange - no object has key
+  ValueType* obj = Find(key);
+  if(!obj){
+    return {Aii::Error::OutOfRange};
+  }
+  Remove(*obj);
+  return obj;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+Aii::Expected<void, Aii::Error> Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Remove(ValueType& obj) noexcept{
+  // O(1) expected
+  //
+  // Possible Errors:
+  //  OutOfRange - obj is not in the table
+  if(!m_tables[0].buckets){
+    return {Aii::Error::OutOfRange};
+  }
+  std::uint64_t hash = HashOf(KeyOf(obj));
+  bool removed = false;
+  if(Resizing()){
+    std::size_t index = hash & (m_tables[0].count - 1);
+    removed = index >= m_migrated && m_tables[0].buckets[index].Remove(ToNode(obj));
+  }
+  if(!removed && !BucketFor(hash)->Remove(ToNode(obj))){
+    return {Aii::Error::OutOfRange};
+  }
+  m_size--;
+  Migrate(MigrateStep);
+  if(!Resizing() && m_tables[0].count > MinBuckets && m_size < m_tables[0].count / 8){
+    StartResize(m_tables[0].count / 2);
+  }
+  return {};
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+void Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Clear() noexcept{
+  // unlinks every object, keeping the buckets, O(n + buckets)
+  FinishResize();
+  for(std::size_t i = 0; i < m_tables[0].count; i++){
+    Bucket& bucket = m_tables[0].buckets[i];
+    while(Bucket* node = bucket.Next()){
+      bucket.Next() = node->Next();
+      node->Next() = nullptr;
+    }
+  }
+  m_size = 0;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A>
+Aii::Expected<void, Aii::Error> Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::Reserve(std::size_t count) noexcept{
+  // Sizes the buckets so count objects fit without resizing, moving every
+  // object now rather than incrementally. O(n + buckets).
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the table is left in the state before the function call
+  std::size_t buckets = MinBuckets;
+  while(buckets < count){
+    buckets *= 2;
+  }
+  FinishResize();
+  if(buckets <= m_tables[0].count){
+    return {};
+  }
+  if(!StartResize(buckets)){
+    return {Aii::Error::RuntimeError};
+  }
+  FinishResize();
+  return {};
+}
+
+// Traversal
+
+template<typename T, Aii::ListNode<void> T::*Node, typename KeyFn, typename Hash, typename Eq, typename A> template<typename F>
+std::size_t Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>::ForEach(F&& fn) const{
+  // calls fn(T&) for every object in no particular order, returns the number
+  // of calls. fn must not insert or remove.
+  std::size_t count = 0;
+  for(std::size_t t = 0; t < 2; t++){
+    const Table& table = m_tables[t];
+    for(std::size_t i = t == 0 ? m_migrated : 0; i < table.count; i++){
+      for(Bucket* node = table.buckets[i].Next(); node; node = node->Next()){
+        fn(*FromNode(node));
+        count++;
+      }
+    }
+  }
+  return count;
+}
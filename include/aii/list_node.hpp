@@ -18,14 +18,69 @@ class ListNode{
     void PushFront(ListNode* node) noexcept;
     void Append(ListNode* node) noexcept;
     void Remove(ListNode* node) noexcept;
-    void Extract(ListNode* node) noexcept;
+    ListNode* Extract(ListNode* node) noexcept;
   private:
     ListNode* m_next;
     T m_val;
 };
 
+// Link without a payload, embedded in an object so intrusive containers can
+// chain it without allocating. The node a list starts from acts as its head.
+template<>
+class ListNode<void>{
+  public:
+    constexpr ListNode() noexcept: m_next{nullptr}{}
+
+    ListNode* Next() const noexcept{ return m_next;}
+    ListNode*& Next() noexcept{ return m_next;}
+
+    bool Empty() const noexcept{ return m_next == nullptr;}
+
+    void PushFront(ListNode* node) noexcept;
+    bool Remove(ListNode* node) noexcept;
+  private:
+    ListNode* m_next;
+};
+
+namespace Details{
+
+// Suitably aligned bytes shaped like a T, which ContainerOf only forms member
+// addresses in; no T is ever constructed there
+template<typename T>
+alignas(T) inline unsigned char ContainerOfStorage[sizeof(T)];
+
+} // namespace Details
+
+template<typename T, typename M>
+T* ContainerOf(M* member, M T::*field) noexcept{
+  // object of type T whose field is at member, as a node embedded in T
+  // maps back to T. The offset of field is measured in static storage, so
+  // with field known at compile time, as in the intrusive containers, it
+  // folds to a constant subtraction
+  const T* base = reinterpret_cast<const T*>(Details::ContainerOfStorage<T>);
+  auto offset = reinterpret_cast<const char*>(&(base->*field)) - reinterpret_cast<const char*>(base);
+  return reinterpret_cast<T*>(reinterpret_cast<char*>(member) - offset);
+}
+
 } // namespace Aii
 
+inline void Aii::ListNode<void>::PushFront(ListNode* node) noexcept{
+  node->m_next = m_next;
+  m_next = node;
+}
+
+inline bool Aii::ListNode<void>::Remove(ListNode* node) noexcept{
+  // O(n), returns whether node was in the list
+  for(ListNode* indexer = this; indexer->m_next; indexer = indexer->m_next){
+    if(indexer->m_next == node){
+      indexer->m_next = node->m_next;
+      node->m_next = nullptr;
+      return true;
+    }
+  }
+  return false;
+}
+
 template<typename T>
 void Aii::ListNode<T>::PushFront(ListNode* node) noexcept{
   ListNode* prevHead = Head();
@@ -67,11 +122,11 @@ void Aii::ListNode<T>::Remove(ListNode* node) noexcept{
 }
 
 template<typename T>
-void Aii::ListNode<T>::Extract(ListNode* node) noexcept{
+auto Aii::ListNode<T>::Extract(ListNode* node) noexcept -> ListNode*{
   // Theta(n)
   ListNode* indexer = Head();
   if(!indexer){
-    return;
+    return nullptr;
   }
   while(indexer){
     if(indexer->Next() == node){
@@ -82,4 +137,5 @@ void Aii::ListNode<T>::Extract(ListNode* node) noexcept{
     }
     indexer = indexer->Next();
   }
+  return nullptr;
 }
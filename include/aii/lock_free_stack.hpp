@@ -0,0 +1,201 @@
+#pragma once
+
+// Treiber stack over objects which embed an Aii::ListNode<void>, for free
+// lists shared between cpus such as those of pool and slab allocators.
+//
+// Push, Pop and PopAll each swing the head with one compare and swap and
+// never allocate. The head carries a version bumped by every swap, so a Pop
+// which read head A with successor B fails if A was popped and pushed back
+// meanwhile, rather than installing the stale B (the ABA problem). Where
+// the cpu has a double width compare and swap the version is a full word
+// beside the pointer; otherwise pointer and version share one word, as 48
+// bits of canonical address and a 16 bit version on 64 bit targets, or 32
+// and 32 on 32 bit ones. 2^16 swaps between a Pop's load and its compare
+// and swap are needed to fool the packed form.
+//
+// Pop reads the successor of an object another cpu may have popped and
+// reused meanwhile; the value read is discarded when the swap fails, but
+// the memory must stay mapped, so objects may be reused freely but must not
+// be returned to the page allocator while the stack may still hold them.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aii/atomic.hpp"
+#include "aii/list_node.hpp"
+
+namespace Aii{
+
+namespace Details{
+
+// Pointer to a node and a version, loaded and compared and swapped as one
+class VersionedNodePtr{
+  public:
+    struct Value{
+      Aii::ListNode<void>* ptr;
+      std::uintptr_t version;
+    };
+
+    constexpr VersionedNodePtr() noexcept: m_word{0}{}
+
+    Value Load() const noexcept;
+    // on failure expected is updated to the current value
+    bool CompareExchange(Value& expected, Value desired) noexcept;
+
+  private:
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) && UINTPTR_MAX == UINT64_MAX
+    using Word = unsigned __int128;
+
+    static Word Pack(Value val) noexcept{
+      return static_cast<Word>(val.version) << 64 | reinterpret_cast<std::uintptr_t>(val.ptr);
+    }
+    static Value Unpack(Word word) noexcept{
+      return {reinterpret_cast<Aii::ListNode<void>*>(static_cast<std::uintptr_t>(word)),
+              static_cast<std::uintptr_t>(word >> 64)};
+    }
+
+    // loaded a half at a time, as a torn value only fails the next swap
+    union alignas(16){
+      Word m_word;
+      std::uint64_t m_halves[2];
+    };
+#elif UINTPTR_MAX == UINT64_MAX
+    using Word = std::uint64_t;
+
+    static Word Pack(Value val) noexcept{
+      return reinterpret_cast<std::uintptr_t>(val.ptr) << 16 | (val.version & 0xFFFF);
+    }
+    static Value Unpack(Word word) noexcept{
+      // the arithmetic shift restores the sign extended upper bits of
+      // canonical addresses
+      return {reinterpret_cast<Aii::ListNode<void>*>(static_cast<std::intptr_t>(word) >> 16),
+              static_cast<std::uintptr_t>(word & 0xFFFF)};
+    }
+
+    Word m_word;
+#else
+    using Word = std::uint64_t;
+
+    static Word Pack(Value val) noexcept{
+      return static_cast<Word>(val.version) << 32 | reinterpret_cast<std::uintptr_t>(val.ptr);
+    }
+    static Value Unpack(Word word) noexcept{
+      return {reinterpret_cast<Aii::ListNode<void>*>(static_cast<std::uintptr_t>(word)),
+              static_cast<std::uintptr_t>(word >> 32)};
+    }
+
+    alignas(8) Word m_word;
+#endif
+};
+
+} // namespace Details
+
+template<typename T, Aii::ListNode<void> T::*Node>
+class LockFreeStack{
+  public:
+    using ValueType = T;
+
+    constexpr LockFreeStack() noexcept: m_head{}{}
+    LockFreeStack(const LockFreeStack& src) noexcept = delete;
+    LockFreeStack& operator=(const LockFreeStack& src) noexcept = delete;
+
+    // Safe from any number of cpus at once
+
+    bool Empty() const noexcept{ return m_head.Load().ptr == nullptr;}
+
+    // obj must not be in the stack already
+    void Push(T& obj) noexcept;
+    // nullptr if the stack is empty
+    T* Pop() noexcept;
+    // Takes every object at once, returning the top one; the rest follow
+    // through Next(), most recently pushed first
+    T* PopAll() noexcept;
+
+    // the object after obj in a chain returned by PopAll()
+    static T* Next(T& obj) noexcept;
+
+  private:
+    static T* FromNode(Aii::ListNode<void>* node) noexcept{ return node ? Aii::ContainerOf(node, Node) : nullptr;}
+    static Aii::ListNode<void>* ToNode(T& obj) noexcept{ return &(obj.*Node);}
+
+  private:
+    Details::VersionedNodePtr m_head;
+};
+
+} // namespace Aii
+
+// Aii::Details::VersionedNodePtr
+
+inline auto Aii::Details::VersionedNodePtr::Load() const noexcept -> Value{
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) && UINTPTR_MAX == UINT64_MAX
+  // version first, so a pointer newer than the version read only makes the
+  // swap fail
+  Word version = AtomicLoad(&m_halves[1], MemoryOrder::Acquire);
+  Word ptr = AtomicLoad(&m_halves[0], MemoryOrder::Acquire);
+  return Unpack(version << 64 | ptr);
+#else
+  return Unpack(AtomicLoad(&m_word, MemoryOrder::Acquire));
+#endif
+}
+
+inline bool Aii::Details::VersionedNodePtr::CompareExchange(Value& expected, Value desired) noexcept{
+  Word old = Pack(expected);
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) && UINTPTR_MAX == UINT64_MAX
+  // the __sync builtin is inlined as cmpxchg16b, where the __atomic ones
+  // behind Aii::Atomic would call into libatomic. It is a full barrier
+  Word seen = __sync_val_compare_and_swap(&m_word, old, Pack(desired));
+  if(seen == old){
+    return true;
+  }
+  expected = Unpack(seen);
+  return false;
+#else
+  if(AtomicCompareExchange(&m_word, old, Pack(desired), MemoryOrder::AcqRel, MemoryOrder::Acquire)){
+    return true;
+  }
+  expected = Unpack(old);
+  return false;
+#endif
+}
+
+// Aii::LockFreeStack
+
+template<typename T, Aii::ListNode<void> T::*Node>
+void Aii::LockFreeStack<T, Node>::Push(T& obj) noexcept{
+  // O(1) unless other cpus keep winning the swap
+  Aii::ListNode<void>* node = ToNode(obj);
+  Details::VersionedNodePtr::Value head = m_head.Load();
+  do{
+    AtomicStore(&node->Next(), head.ptr, MemoryOrder::Relaxed);
+  }while(!m_head.CompareExchange(head, {node, head.version + 1}));
+}
+
+template<typename T, Aii::ListNode<void> T::*Node>
+T* Aii::LockFreeStack<T, Node>::Pop() noexcept{
+  // O(1) unless other cpus keep winning the swap
+  Details::VersionedNodePtr::Value head = m_head.Load();
+  while(head.ptr){
+    Aii::ListNode<void>* next = AtomicLoad(&head.ptr->Next(), MemoryOrder::Relaxed);
+    if(m_head.CompareExchange(head, {next, head.version + 1})){
+      return FromNode(head.ptr);
+    }
+  }
+  return nullptr;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node>
+T* Aii::LockFreeStack<T, Node>::PopAll() noexcept{
+  // O(1) unless other cpus keep winning the swap
+  Details::VersionedNodePtr::Value head = m_head.Load();
+  while(head.ptr){
+    if(m_head.CompareExchange(head, {nullptr, head.version + 1})){
+      return FromNode(head.ptr);
+    }
+  }
+  return nullptr;
+}
+
+template<typename T, Aii::ListNode<void> T::*Node>
+T* Aii::LockFreeStack<T, Node>::Next(T& obj) noexcept{
+  return FromNode(ToNode(obj)->Next());
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+// Bounded multi producer, multi consumer queue, after Dmitry Vyukov's
+// bounded MPMC queue.
+//
+// The N cells live inside the queue, so it never allocates, and no caller
+// ever waits: a push into a full queue or a pop from an empty one fails at
+// once. Any number of cpus may push and pop concurrently.
+//
+// Each cell carries a sequence number saying whose turn it is. Cell i of
+// lap k is free for the push at position p = kN + i when its sequence is p,
+// and holds the element for the pop at position p when its sequence is
+// p + 1. Pushers claim a position by a compare and swap of the enqueue
+// index, construct the element and release the cell by storing p + 1; pops
+// claim from the dequeue index, move the element out and hand the cell to
+// the next lap by storing p + N. Producers and consumers therefore only
+// contend on their own index, each on its own cache line, and meet only on
+// the cells.
+//
+// A pusher preempted between claiming a cell and releasing it does not
+// hold up other pushers, which go on filling the later cells. Pops do wait
+// behind the claimed cell: until the push finishes, Pop finds the front
+// cell unpublished and fails as if the queue were empty.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+
+namespace Aii{
+
+template<typename T, std::size_t N>
+class MpmcQueue{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "MpmcQueue: capacity must be a power of two of at least 2");
+  static_assert(std::is_nothrow_move_constructible_v<T>, "MpmcQueue: elements must be nothrow move constructible");
+
+  private:
+    static constexpr std::size_t Mask = N - 1;
+
+    struct Cell{
+      Atomic<std::size_t> sequence;
+      alignas(T) unsigned char bytes[sizeof(T)];
+
+      T* Element() noexcept{ return std::launder(reinterpret_cast<T*>(bytes));}
+    };
+
+  public:
+    using ValueType = T;
+
+    MpmcQueue() noexcept;
+    MpmcQueue(const MpmcQueue& src) noexcept = delete;
+    MpmcQueue& operator=(const MpmcQueue& src) noexcept = delete;
+    // no other cpu may be using the queue
+    ~MpmcQueue() noexcept;
+
+    static constexpr std::size_t Capacity() noexcept{ return N;}
+
+    // a snapshot, which may be stale by the time it returns
+    std::size_t Size() const noexcept;
+    bool Empty() const noexcept{ return Size() == 0;}
+
+    template<typename ...Args>
+    Aii::Expected<void, Error> Emplace(Args&& ...args) noexcept;
+    Aii::Expected<void, Error> Push(const T& val) noexcept{ return Emplace(val);}
+    Aii::Expected<void, Error> Push(T&& val) noexcept{ return Emplace(std::move(val));}
+
+    Aii::Expected<T, Error> Pop() noexcept;
+
+  private:
+    alignas(CacheLineSize) Atomic<std::size_t> m_enqueue;
+    alignas(CacheLineSize) Atomic<std::size_t> m_dequeue;
+    alignas(CacheLineSize) Cell m_cells[N];
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, std::size_t N>
+Aii::MpmcQueue<T, N>::MpmcQueue() noexcept
+  :
+    m_enqueue{0},
+    m_dequeue{0}
+{
+  for(std::size_t i = 0; i < N; i++){
+    m_cells[i].sequence.Store(i, MemoryOrder::Relaxed);
+  }
+}
+
+template<typename T, std::size_t N>
+Aii::MpmcQueue<T, N>::~MpmcQueue() noexcept{
+  if constexpr(!std::is_trivially_destructible_v<T>){
+    std::size_t enqueue = m_enqueue.Load(MemoryOrder::Relaxed);
+    for(std::size_t pos = m_dequeue.Load(MemoryOrder::Relaxed); pos != enqueue; pos++){
+      m_cells[pos & Mask].Element()->~T();
+    }
+  }
+}
+
+template<typename T, std::size_t N>
+std::size_t Aii::MpmcQueue<T, N>::Size() const noexcept{
+  std::size_t dequeue = m_dequeue.Load(MemoryOrder::Relaxed);
+  std::size_t enqueue = m_enqueue.Load(MemoryOrder::Relaxed);
+  // the two loads are not one snapshot, so pops may appear to pass pushes
+  return enqueue > dequeue ? enqueue - dequeue : 0;
+}
+
+// Modification
+
+template<typename T, std::size_t N> template<typename ...Args>
+Aii::Expected<void, Aii::Error> Aii::MpmcQueue<T, N>::Emplace(Args&& ...args) noexcept{
+  // constructs an element from args at the back. O(1) unless other
+  // pushers keep winning the race for the same position, never waits
+  //
+  // Possible Errors:
+  //  OutOfRange - the queue is full
+  //
+  // On error, the queue is left in the state before the function call
+  std::size_t pos = m_enqueue.Load(MemoryOrder::Relaxed);
+  Cell* cell;
+  for(;;){
+    cell = &m_cells[pos & Mask];
+    std::size_t sequence = cell->sequence.Load(MemoryOrder::Acquire);
+    std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+    if(diff == 0){
+      // a failed compare and swap reloads pos
+      if(m_enqueue.CompareExchangeWeak(pos, pos + 1, MemoryOrder::Relaxed)){
+        break;
+      }
+    }
+    else if(diff < 0){
+      // the cell still holds the element pushed a lap ago
+      return {Aii::Error::OutOfRange};
+    }
+    else{
+      // another pusher took pos
+      pos = m_enqueue.Load(MemoryOrder::Relaxed);
+    }
+  }
+  ::new(static_cast<void*>(cell->bytes)) T{std::forward<Args>(args)...};
+  cell->sequence.Store(pos + 1, MemoryOrder::Release);
+  return {};
+}
+
+template<typename T, std::size_t N>
+Aii::Expected<T, Aii::Error> Aii::MpmcQueue<T, N>::Pop() noexcept{
+  // removes the element at the front. O(1) unless other pops keep winning
+  // the race for the same position, never waits
+  //
+  // Possible Errors:
+  //  OutOfRange - the queue is empty, or the push to the front cell has
+  //               claimed it but not finished
+  //
+  // On error, the queue is left in the state before the function call
+  std::size_t pos = m_dequeue.Load(MemoryOrder::Relaxed);
+  Cell* cell;
+  for(;;){
+    cell = &m_cells[pos & Mask];
+    std::size_t sequence = cell->sequence.Load(MemoryOrder::Acquire);
+    std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+    if(diff == 0){
+      if(m_dequeue.CompareExchangeWeak(pos, pos + 1, MemoryOrder::Relaxed)){
+        break;
+      }
+    }
+    else if(diff < 0){
+      return {Aii::Error::OutOfRange};
+    }
+    else{
+      pos = m_dequeue.Load(MemoryOrder::Relaxed);
+    }
+  }
+  T* element = cell->Element();
+  T val{std::move(*element)};
+  element->~T();
+  cell->sequence.Store(pos + N, MemoryOrder::Release);
+  return {std::move(val)};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// One instance of T for each cpu, each on its own cache lines, so cpus
+// which only touch their own never share a line.
+//
+// Local() picks the instance of the calling cpu through the
+// Details::CurrentCpu() stub. Nothing stops the caller from being moved to
+// another cpu, or interrupted by code on the same cpu, right after, so the
+// instance is only exclusively the caller's while preemption and any
+// interrupt handlers using it are disabled. Otherwise T must be safe to
+// share, with atomic fields, and Local() only keeps the sharing rare.
+//
+// Cpus numbered MaxCpus or above share the instances of lower numbers
+// rather than running off the end.
+
+#include <cstddef>
+
+#include "aii/cache_line.hpp"
+#include "aii/stubs.hpp"
+
+namespace Aii{
+
+inline constexpr std::size_t DefaultMaxCpus = 64;
+
+template<typename T, std::size_t MaxCpus = DefaultMaxCpus>
+class PerCpu{
+  static_assert(MaxCpus > 0, "PerCpu: MaxCpus must be at least 1");
+
+  private:
+    struct alignas(CacheLineSize) Slot{
+      T value;
+    };
+
+  public:
+    using ValueType = T;
+
+    constexpr PerCpu() noexcept: m_slots{}{}
+    PerCpu(const PerCpu& src) noexcept = delete;
+    PerCpu& operator=(const PerCpu& src) noexcept = delete;
+
+    static constexpr std::size_t Size() noexcept{ return MaxCpus;}
+
+    T& Local() noexcept{ return m_slots[Details::CurrentCpu() % MaxCpus].value;}
+    const T& Local() const noexcept{ return m_slots[Details::CurrentCpu() % MaxCpus].value;}
+
+    // the instance of a given cpu, for code which visits them all
+    T& operator[](std::size_t cpu) noexcept{ return m_slots[cpu].value;}
+    const T& operator[](std::size_t cpu) const noexcept{ return m_slots[cpu].value;}
+
+  private:
+    Slot m_slots[MaxCpus];
+};
+
+} // namespace Aii
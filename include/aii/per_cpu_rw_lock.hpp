@@ -0,0 +1,122 @@
+#pragma once
+
+// Reader biased readers-writer lock for read-mostly data such as mount and
+// route tables.
+//
+// Each reader counts itself in the counter of its own cpu, so readers on
+// different cpus never touch a common cache line, and checks that no
+// writer is active. A writer raises the writer flag and waits until the
+// counters of all cpus sum to zero, which makes writing O(MaxCpus) and
+// far dearer than with a plain lock; it only pays off when writes are
+// rare.
+//
+// The reader's increment and the writer's raising of the flag are each
+// followed by a read of what the other wrote, with sequentially consistent
+// ordering between them, so at least one of the two sees the other: either
+// the writer counts the reader, or the reader sees the flag and steps back
+// until the writer is done. A reader may unlock on another cpu than it
+// locked on; only the sum of the counters means anything.
+//
+// Readers wait for writers and writers for readers, so a cpu holding either
+// side must not take either side again: a nested read lock waits for a
+// writer which waits for the outer one.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aii/atomic.hpp"
+#include "aii/per_cpu.hpp"
+#include "aii/spinlock.hpp"
+
+namespace Aii{
+
+template<std::size_t MaxCpus = DefaultMaxCpus>
+class PerCpuRwLock{
+  public:
+    constexpr PerCpuRwLock() noexcept: m_readers{}, m_writer{0}, m_writerLock{}{}
+    PerCpuRwLock(const PerCpuRwLock& src) noexcept = delete;
+    PerCpuRwLock& operator=(const PerCpuRwLock& src) noexcept = delete;
+
+    void ReadLock() noexcept;
+    void ReadUnlock() noexcept;
+
+    // exclusive, for writers
+    void Lock() noexcept;
+    void Unlock() noexcept;
+
+  private:
+    std::size_t Readers() const noexcept;
+
+  private:
+    // counts wrap, as a reader may increment one and decrement another
+    PerCpu<Atomic<std::size_t>, MaxCpus> m_readers;
+    Atomic<std::uint32_t> m_writer;
+    // queues writers behind each other in order
+    TicketLock<> m_writerLock;
+};
+
+// Holds a read side of a lock for the lifetime of the guard; LockGuard
+// holds the write side
+template<typename L>
+class ReadLockGuard{
+  public:
+    explicit ReadLockGuard(L& lock) noexcept: m_lock{lock}{ m_lock.ReadLock();}
+    ReadLockGuard(const ReadLockGuard& src) noexcept = delete;
+    ReadLockGuard& operator=(const ReadLockGuard& src) noexcept = delete;
+    ~ReadLockGuard() noexcept{ m_lock.ReadUnlock();}
+
+  private:
+    L& m_lock;
+};
+
+} // namespace Aii
+
+template<std::size_t MaxCpus>
+void Aii::PerCpuRwLock<MaxCpus>::ReadLock() noexcept{
+  // one increment of the cpu's own counter and a read of the writer flag,
+  // unless a writer is active
+  for(;;){
+    Atomic<std::size_t>& readers = m_readers.Local();
+    readers.FetchAdd(1, MemoryOrder::SeqCst);
+    if(!m_writer.Load(MemoryOrder::SeqCst)){
+      return;
+    }
+    // step back from the same counter, so a writer summing the counters
+    // never sees this decrement without the increment
+    readers.FetchSub(1, MemoryOrder::Release);
+    while(m_writer.Load(MemoryOrder::Relaxed)){
+      CpuRelax();
+    }
+  }
+}
+
+template<std::size_t MaxCpus>
+void Aii::PerCpuRwLock<MaxCpus>::ReadUnlock() noexcept{
+  m_readers.Local().FetchSub(1, MemoryOrder::Release);
+}
+
+template<std::size_t MaxCpus>
+std::size_t Aii::PerCpuRwLock<MaxCpus>::Readers() const noexcept{
+  std::size_t readers = 0;
+  for(std::size_t cpu = 0; cpu < MaxCpus; cpu++){
+    readers += m_readers[cpu].Load(MemoryOrder::SeqCst);
+  }
+  return readers;
+}
+
+template<std::size_t MaxCpus>
+void Aii::PerCpuRwLock<MaxCpus>::Lock() noexcept{
+  // waits for the readers inside when called; readers arriving later wait
+  // for Unlock()
+  m_writerLock.Lock();
+  m_writer.Store(1, MemoryOrder::SeqCst);
+  while(Readers() != 0){
+    CpuRelax();
+  }
+}
+
+template<std::size_t MaxCpus>
+void Aii::PerCpuRwLock<MaxCpus>::Unlock() noexcept{
+  m_writer.Store(0, MemoryOrder::Release);
+  m_writerLock.Unlock();
+}
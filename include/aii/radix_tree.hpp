@@ -0,0 +1,650 @@
+#pragma once
+
+// Radix tree keyed by 64 bit integers, for sparse indices such as file page
+// offsets and physical frame numbers.
+//
+// Every level consumes log2(Fanout) bits of the key, so a lookup is one
+// indexed load per level, and the number of levels only depends on the
+// largest key stored: the tree grows a new root when a key does not fit
+// under the current one, and sheds roots again on erase.
+//
+// Every node keeps a bitmap of its occupied slots and one bitmap per tag.
+// An inner node's tag bit is set when anything below that child carries the
+// tag, so scans for tagged entries (e.g. dirty or under writeback pages)
+// skip whole untagged subtrees, like ordinary scans skip empty ones.
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/expected.hpp"
+#include "aii/error.hpp"
+
+namespace Aii{
+
+template<typename V,
+         std::size_t Fanout = 64,
+         std::size_t Tags = 2,
+         typename A = Aii::Allocator<V>>
+class RadixTree{
+  static_assert(Aii::IsAllocator<A>, "RadixTree: A must satisfy Aii::IsAllocator");
+  static_assert(Fanout >= 2 && Fanout <= 64 && (Fanout & (Fanout - 1)) == 0,
+      "RadixTree: Fanout must be a power of two between 2 and 64");
+
+  public:
+    using KeyType = std::uint64_t;
+    using ValueType = V;
+    using Bitmap = std::uint64_t;
+
+    static constexpr std::size_t Shift = __builtin_ctzll(Fanout);
+    static constexpr KeyType SlotMask = Fanout - 1;
+    static constexpr std::size_t KeyBits = 64;
+
+    struct Inner;
+
+    struct NodeBase{
+      // lowest key covered by the node
+      KeyType base;
+      Inner* parent;
+      // key bits consumed below this node, zero for leaves
+      std::uint8_t shift;
+      Bitmap present;
+      Bitmap tags[Tags];
+    };
+
+    struct Leaf: NodeBase{
+      ValueType values[Fanout];
+    };
+
+    struct Inner: NodeBase{
+      NodeBase* children[Fanout];
+    };
+
+    class Iterator{
+      public:
+        constexpr Iterator() noexcept: m_leaf{nullptr}, m_index{0}{}
+        constexpr Iterator(Leaf* leaf, std::size_t index) noexcept: m_leaf{leaf}, m_index{index}{}
+
+        KeyType Key() const noexcept{ return m_leaf->base + m_index;}
+        ValueType& Val() const noexcept{ return m_leaf->values[m_index];}
+        Leaf* GetLeaf() const noexcept{ return m_leaf;}
+
+        ValueType& operator*() const noexcept{ return m_leaf->values[m_index];}
+        ValueType* operator->() const noexcept{ return &m_leaf->values[m_index];}
+
+        Iterator& operator++() noexcept;
+        Iterator operator++(int) noexcept{ Iterator tmp = *this; ++(*this); return tmp;}
+
+        constexpr bool operator==(const Iterator& rhs) const noexcept{
+          return m_leaf == rhs.m_leaf && m_index == rhs.m_index;
+        }
+        constexpr bool operator!=(const Iterator& rhs) const noexcept{ return !(*this == rhs);}
+
+      private:
+        Leaf* m_leaf;
+        std::size_t m_index;
+    };
+
+  private:
+    using LeafAllocType = typename A::template Rebind<Leaf>::other;
+    using InnerAllocType = typename A::template Rebind<Inner>::other;
+
+    // selects the present bitmap instead of a tag bitmap in a Seek
+    static constexpr std::size_t AnyEntry = ~std::size_t{0};
+
+  public:
+    RadixTree() noexcept;
+    RadixTree(const RadixTree& src) noexcept = delete;
+    RadixTree(RadixTree&& src) noexcept;
+    RadixTree& operator=(const RadixTree& src) noexcept = delete;
+    RadixTree& operator=(RadixTree&& src) noexcept;
+    ~RadixTree() noexcept;
+
+    void Swap(RadixTree& other) noexcept;
+
+    NodeBase* Root() const noexcept{ return m_root;}
+    bool Empty() const noexcept{ return m_root == nullptr;}
+    std::size_t Size() const noexcept{ return m_size;}
+    std::size_t Height() const noexcept;
+
+    Iterator begin() const noexcept{ return LowerBound(0);}
+    Iterator end() const noexcept{ return Iterator{};}
+    Iterator LowerBound(KeyType key) const noexcept;
+
+    ValueType* Find(KeyType key) const noexcept;
+    bool Contains(KeyType key) const noexcept{ return Find(key) != nullptr;}
+
+    Aii::Expected<ValueType*, Error> Insert(KeyType key, const ValueType& val) noexcept;
+    Aii::Expected<void, Error> Erase(KeyType key) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> SetTag(KeyType key, std::size_t tag) noexcept;
+    Aii::Expected<void, Error> ClearTag(KeyType key, std::size_t tag) noexcept;
+    bool GetTag(KeyType key, std::size_t tag) const noexcept;
+    bool AnyTagged(std::size_t tag) const noexcept;
+
+    std::size_t GangLookup(KeyType first, ValueType** results, std::size_t max,
+                           KeyType* keys = nullptr) const noexcept;
+    std::size_t GangLookupTag(KeyType first, std::size_t tag, ValueType** results,
+                              std::size_t max, KeyType* keys = nullptr) const noexcept;
+
+    template<typename F>
+    std::size_t ForEachInRange(KeyType first, KeyType last, F&& fn) const;
+    template<typename F>
+    std::size_t ForEachTagged(KeyType first, KeyType last, std::size_t tag, F&& fn) const;
+
+  private:
+    static Leaf* AsLeaf(NodeBase* node) noexcept{ return static_cast<Leaf*>(node);}
+    static Inner* AsInner(NodeBase* node) noexcept{ return static_cast<Inner*>(node);}
+    static std::size_t SlotOf(const NodeBase* node, KeyType key) noexcept{ return (key >> node->shift) & SlotMask;}
+    static bool Covers(const NodeBase* node, KeyType key) noexcept;
+    static Bitmap Bits(const NodeBase* node, std::size_t tag) noexcept;
+    static Iterator Seek(NodeBase* node, KeyType first, std::size_t tag) noexcept;
+
+    Leaf* FindLeaf(KeyType key) const noexcept;
+    NodeBase* AllocateNode(Inner* parent, KeyType base, std::uint8_t shift) noexcept;
+    void DeallocateNode(NodeBase* node) noexcept;
+    void DeallocateSubtree(NodeBase* node) noexcept;
+    bool Grow(KeyType key) noexcept;
+    void PruneEmpty(NodeBase* node) noexcept;
+    void Shrink() noexcept;
+    static void SetTagBit(NodeBase* node, std::size_t slot, std::size_t tag) noexcept;
+    static void ClearTagBit(NodeBase* node, std::size_t slot, std::size_t tag) noexcept;
+
+  private:
+    NodeBase* m_root;
+    std::size_t m_size;
+    LeafAllocType m_leafAllocator;
+    InnerAllocType m_innerAllocator;
+};
+
+} // namespace Aii
+
+// Iterator
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::Iterator::operator++() noexcept -> Iterator&{
+  KeyType next = Key() + 1;
+  if(next == 0){
+    *this = Iterator{};
+  }
+  else{
+    *this = Seek(m_leaf, next, AnyEntry);
+  }
+  return *this;
+}
+
+// Construction
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::RadixTree<V, Fanout, Tags, A>::RadixTree() noexcept
+  :
+    m_root{nullptr},
+    m_size{0},
+    m_leafAllocator{LeafAllocType()},
+    m_innerAllocator{InnerAllocType()}
+{
+
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::RadixTree<V, Fanout, Tags, A>::RadixTree(RadixTree&& src) noexcept
+  :
+    m_root{src.m_root},
+    m_size{src.m_size},
+    m_leafAllocator{std::move(src.m_leafAllocator)},
+    m_innerAllocator{std::move(src.m_innerAllocator)}
+{
+  src.m_root = nullptr;
+  src.m_size = 0;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::operator=(RadixTree&& src) noexcept -> RadixTree&{
+  if(this != &src){
+    Clear();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::RadixTree<V, Fanout, Tags, A>::~RadixTree() noexcept{
+  Clear();
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::Swap(RadixTree& other) noexcept{
+  using std::swap;
+  swap(m_root, other.m_root);
+  swap(m_size, other.m_size);
+  swap(m_leafAllocator, other.m_leafAllocator);
+  swap(m_innerAllocator, other.m_innerAllocator);
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::AllocateNode(Inner* parent, KeyType base,
+                                                     std::uint8_t shift) noexcept -> NodeBase*{
+  NodeBase* node = nullptr;
+  if(shift == 0){
+    node = m_leafAllocator.Allocate();
+  }
+  else{
+    node = m_innerAllocator.Allocate();
+  }
+  if(!node){
+    return nullptr;
+  }
+  node->base = base;
+  node->parent = parent;
+  node->shift = shift;
+  node->present = 0;
+  for(std::size_t i = 0; i < Tags; i++){
+    node->tags[i] = 0;
+  }
+  return node;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::DeallocateNode(NodeBase* node) noexcept{
+  if(node->shift == 0){
+    m_leafAllocator.Deallocate(AsLeaf(node));
+  }
+  else{
+    m_innerAllocator.Deallocate(AsInner(node));
+  }
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::DeallocateSubtree(NodeBase* node) noexcept{
+  // O(n), recursion depth is the height of the tree
+  if(node->shift > 0){
+    for(Bitmap bits = node->present; bits; bits &= bits - 1){
+      DeallocateSubtree(AsInner(node)->children[__builtin_ctzll(bits)]);
+    }
+  }
+  DeallocateNode(node);
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::Clear() noexcept{
+  if(m_root){
+    DeallocateSubtree(m_root);
+  }
+  m_root = nullptr;
+  m_size = 0;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+std::size_t Aii::RadixTree<V, Fanout, Tags, A>::Height() const noexcept{
+  return m_root ? m_root->shift / Shift + 1 : 0;
+}
+
+// Helpers
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+bool Aii::RadixTree<V, Fanout, Tags, A>::Covers(const NodeBase* node, KeyType key) noexcept{
+  std::size_t span = node->shift + Shift;
+  return span >= KeyBits || (key >> span) == (node->base >> span);
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::Bits(const NodeBase* node, std::size_t tag) noexcept -> Bitmap{
+  return tag == AnyEntry ? node->present : node->tags[tag];
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::Seek(NodeBase* node, KeyType first, std::size_t tag) noexcept -> Iterator{
+  // Finds the lowest entry with a key not less than first (and the tag set,
+  // unless tag is AnyEntry), starting from any node on the path to first.
+  // Each level picks the next set bit of its bitmap, and a node without one
+  // sends the search up to its parent, past the end of its range, so every
+  // node is entered at most twice.
+  while(node){
+    if(!Covers(node, first)){
+      node = node->parent;
+      continue;
+    }
+    std::size_t slot = SlotOf(node, first);
+    Bitmap bits = Bits(node, tag) & (~Bitmap{0} << slot);
+    if(!bits){
+      std::size_t span = node->shift + Shift;
+      if(span >= KeyBits){
+        break;
+      }
+      first = node->base + (KeyType{1} << span);
+      if(first == 0){
+        // the node ends at the top of the key space
+        break;
+      }
+      node = node->parent;
+      continue;
+    }
+    std::size_t next = __builtin_ctzll(bits);
+    if(next != slot){
+      first = node->base + (static_cast<KeyType>(next) << node->shift);
+    }
+    if(node->shift == 0){
+      return Iterator{AsLeaf(node), next};
+    }
+    node = AsInner(node)->children[next];
+  }
+  return Iterator{};
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::FindLeaf(KeyType key) const noexcept -> Leaf*{
+  // leaf whose range holds key, or nullptr
+  NodeBase* node = m_root;
+  if(!node || !Covers(node, key)){
+    return nullptr;
+  }
+  while(node->shift > 0){
+    std::size_t slot = SlotOf(node, key);
+    if(!(node->present & (Bitmap{1} << slot))){
+      return nullptr;
+    }
+    node = AsInner(node)->children[slot];
+  }
+  return AsLeaf(node);
+}
+
+// Lookup
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::Find(KeyType key) const noexcept -> ValueType*{
+  // O(height), one indexed load per level
+  Leaf* leaf = FindLeaf(key);
+  std::size_t slot = key & SlotMask;
+  if(!leaf || !(leaf->present & (Bitmap{1} << slot))){
+    return nullptr;
+  }
+  return &leaf->values[slot];
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+auto Aii::RadixTree<V, Fanout, Tags, A>::LowerBound(KeyType key) const noexcept -> Iterator{
+  // first entry whose key is not less than key
+  return Seek(m_root, key, AnyEntry);
+}
+
+// Modification
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+bool Aii::RadixTree<V, Fanout, Tags, A>::Grow(KeyType key) noexcept{
+  // Adds roots above the current one until key is covered. The old root
+  // becomes child 0 of the new one, since the root range always starts at 0.
+  if(!m_root){
+    std::uint8_t shift = 0;
+    while(shift + Shift < KeyBits && (key >> (shift + Shift)) != 0){
+      shift += Shift;
+    }
+    m_root = AllocateNode(nullptr, 0, shift);
+    return m_root != nullptr;
+  }
+  while(!Covers(m_root, key)){
+    Inner* root = AsInner(AllocateNode(nullptr, 0, m_root->shift + Shift));
+    if(!root){
+      return false;
+    }
+    root->children[0] = m_root;
+    root->present = 1;
+    for(std::size_t i = 0; i < Tags; i++){
+      root->tags[i] = m_root->tags[i] ? 1 : 0;
+    }
+    m_root->parent = root;
+    m_root = root;
+  }
+  return true;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::PruneEmpty(NodeBase* node) noexcept{
+  // frees node and every ancestor left without entries
+  while(node && !node->present){
+    Inner* parent = node->parent;
+    if(parent){
+      parent->present &= ~(Bitmap{1} << SlotOf(parent, node->base));
+    }
+    else{
+      m_root = nullptr;
+    }
+    DeallocateNode(node);
+    node = parent;
+  }
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::Shrink() noexcept{
+  // drops roots whose only child is the first one, keeping lookups as short
+  // as the largest key allows
+  while(m_root && m_root->shift > 0 && m_root->present == 1){
+    NodeBase* child = AsInner(m_root)->children[0];
+    child->parent = nullptr;
+    DeallocateNode(m_root);
+    m_root = child;
+  }
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::Expected<typename Aii::RadixTree<V, Fanout, Tags, A>::ValueType*, Aii::Error>
+Aii::RadixTree<V, Fanout, Tags, A>::Insert(KeyType key, const ValueType& val) noexcept{
+  // O(height)
+  //
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - node allocation failed
+  //
+  // On error, the tree is left in the state before the function call
+  if(Contains(key)){
+    return {Aii::Error::InvalidArgument};
+  }
+  if(!Grow(key)){
+    Shrink();
+    return {Aii::Error::RuntimeError};
+  }
+  NodeBase* node = m_root;
+  while(node->shift > 0){
+    Inner* inner = AsInner(node);
+    std::size_t slot = SlotOf(inner, key);
+    if(!(inner->present & (Bitmap{1} << slot))){
+      NodeBase* child = AllocateNode(inner, inner->base + (static_cast<KeyType>(slot) << inner->shift),
+                                     inner->shift - Shift);
+      if(!child){
+        PruneEmpty(inner);
+        Shrink();
+        return {Aii::Error::RuntimeError};
+      }
+      inner->children[slot] = child;
+      inner->present |= Bitmap{1} << slot;
+    }
+    node = inner->children[slot];
+  }
+  Leaf* leaf = AsLeaf(node);
+  std::size_t slot = key & SlotMask;
+  leaf->values[slot] = val;
+  leaf->present |= Bitmap{1} << slot;
+  m_size++;
+  return &leaf->values[slot];
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::RadixTree<V, Fanout, Tags, A>::Erase(KeyType key) noexcept{
+  // O(height)
+  //
+  // Possible Errors:
+  //  OutOfRange - the key is not present
+  Leaf* leaf = FindLeaf(key);
+  std::size_t slot = key & SlotMask;
+  if(!leaf || !(leaf->present & (Bitmap{1} << slot))){
+    return {Aii::Error::OutOfRange};
+  }
+  for(std::size_t tag = 0; tag < Tags; tag++){
+    ClearTagBit(leaf, slot, tag);
+  }
+  leaf->values[slot] = ValueType{};
+  leaf->present &= ~(Bitmap{1} << slot);
+  m_size--;
+  PruneEmpty(leaf);
+  Shrink();
+  return {};
+}
+
+// Tags
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::SetTagBit(NodeBase* node, std::size_t slot, std::size_t tag) noexcept{
+  // sets the bit and its summary bits up the tree, stopping at the first
+  // ancestor which already had it
+  while(node){
+    Bitmap bit = Bitmap{1} << slot;
+    if(node->tags[tag] & bit){
+      return;
+    }
+    node->tags[tag] |= bit;
+    if(node->parent){
+      slot = SlotOf(node->parent, node->base);
+    }
+    node = node->parent;
+  }
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+void Aii::RadixTree<V, Fanout, Tags, A>::ClearTagBit(NodeBase* node, std::size_t slot, std::size_t tag) noexcept{
+  // clears the bit, and the summary bit above any node left without the tag
+  while(node){
+    node->tags[tag] &= ~(Bitmap{1} << slot);
+    if(node->tags[tag] || !node->parent){
+      return;
+    }
+    slot = SlotOf(node->parent, node->base);
+    node = node->parent;
+  }
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::RadixTree<V, Fanout, Tags, A>::SetTag(KeyType key, std::size_t tag) noexcept{
+  // O(height)
+  //
+  // Possible Errors:
+  //  InvalidArgument - tag is not below Tags
+  //  OutOfRange - the key is not present
+  if(tag >= Tags){
+    return {Aii::Error::InvalidArgument};
+  }
+  Leaf* leaf = FindLeaf(key);
+  std::size_t slot = key & SlotMask;
+  if(!leaf || !(leaf->present & (Bitmap{1} << slot))){
+    return {Aii::Error::OutOfRange};
+  }
+  SetTagBit(leaf, slot, tag);
+  return {};
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+Aii::Expected<void, Aii::Error>
+Aii::RadixTree<V, Fanout, Tags, A>::ClearTag(KeyType key, std::size_t tag) noexcept{
+  // O(height)
+  //
+  // Possible Errors:
+  //  InvalidArgument - tag is not below Tags
+  //  OutOfRange - the key is not present
+  if(tag >= Tags){
+    return {Aii::Error::InvalidArgument};
+  }
+  Leaf* leaf = FindLeaf(key);
+  std::size_t slot = key & SlotMask;
+  if(!leaf || !(leaf->present & (Bitmap{1} << slot))){
+    return {Aii::Error::OutOfRange};
+  }
+  ClearTagBit(leaf, slot, tag);
+  return {};
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+bool Aii::RadixTree<V, Fanout, Tags, A>::GetTag(KeyType key, std::size_t tag) const noexcept{
+  Leaf* leaf = tag < Tags ? FindLeaf(key) : nullptr;
+  return leaf && (leaf->tags[tag] & (Bitmap{1} << (key & SlotMask)));
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+bool Aii::RadixTree<V, Fanout, Tags, A>::AnyTagged(std::size_t tag) const noexcept{
+  // O(1)
+  return tag < Tags && m_root && m_root->tags[tag] != 0;
+}
+
+// Scans
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+std::size_t Aii::RadixTree<V, Fanout, Tags, A>::GangLookup(KeyType first, ValueType** results,
+                                                           std::size_t max, KeyType* keys) const noexcept{
+  // Stores pointers to the values of up to max entries with keys from first
+  // upwards, in key order, and their keys if keys is not null. Returns the
+  // number found. Entries sharing a leaf are collected without leaving it.
+  std::size_t count = 0;
+  for(Iterator it = LowerBound(first); count < max && it != end(); ++it){
+    results[count] = &it.Val();
+    if(keys){
+      keys[count] = it.Key();
+    }
+    count++;
+  }
+  return count;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A>
+std::size_t Aii::RadixTree<V, Fanout, Tags, A>::GangLookupTag(KeyType first, std::size_t tag,
+                                                              ValueType** results, std::size_t max,
+                                                              KeyType* keys) const noexcept{
+  // as GangLookup, for entries carrying tag only
+  std::size_t count = 0;
+  if(tag >= Tags){
+    return 0;
+  }
+  for(Iterator it = Seek(m_root, first, tag); count < max && it != end(); ){
+    results[count] = &it.Val();
+    if(keys){
+      keys[count] = it.Key();
+    }
+    count++;
+    KeyType next = it.Key() + 1;
+    it = next ? Seek(it.GetLeaf(), next, tag) : end();
+  }
+  return count;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A> template<typename F>
+std::size_t Aii::RadixTree<V, Fanout, Tags, A>::ForEachInRange(KeyType first, KeyType last, F&& fn) const{
+  // calls fn(key, val) for every entry with first <= key < last in key
+  // order, returns the number of calls
+  std::size_t count = 0;
+  for(Iterator it = LowerBound(first); it != end() && it.Key() < last; ++it){
+    fn(it.Key(), it.Val());
+    count++;
+  }
+  return count;
+}
+
+template<typename V, std::size_t Fanout, std::size_t Tags, typename A> template<typename F>
+std::size_t Aii::RadixTree<V, Fanout, Tags, A>::ForEachTagged(KeyType first, KeyType last,
+                                                              std::size_t tag, F&& fn) const{
+  // calls fn(key, val) for every entry carrying tag with first <= key < last
+  // in key order, returns the number of calls
+  std::size_t count = 0;
+  if(tag >= Tags){
+    return 0;
+  }
+  for(Iterator it = Seek(m_root, first, tag); it != end() && it.Key() < last; ){
+    fn(it.Key(), it.Val());
+    count++;
+    KeyType next = it.Key() + 1;
+    // the search restarts from the leaf, so neighbouring tagged entries
+    // cost no walk from the root
+    it = next ? Seek(it.GetLeaf(), next, tag) : end();
+  }
+  return count;
+}
@@ -1,76 +1,1197 @@
 #pragma once
 
-// for now it holds int as keys, however
-// later will refactor to allow using any keys which can be compared
+// Red black tree keyed map. Keys can be any type ordered by operator<.
+//
+// Besides the usual single element operations the tree supports bulk
+// operations which work on whole subtrees:
+//
+//  * AssignSorted - O(n) construction from sorted input
+//  * Join         - O(log n) concatenation of two trees with ordered key ranges
+//  * Split        - O(log n) partition of a tree around a key
+//  * Union, Intersection, Difference - set algebra built on Join and Split
+//
+// The Augment parameter lets a node carry data summarising its subtree
+// (e.g. the largest gap or end point below it). Augment::Data is stored in
+// every node and Augment::Update(node) recomputes it from the node and its
+// children; the tree calls it wherever the shape of a subtree changes.
 
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
 #include "aii/expected.hpp"
 #include "aii/error.hpp"
+#include "aii/tagged_ptr.hpp"
 
 namespace Aii{
 
-template<typename T>
+// Augment policy for trees which do not maintain subtree data
+struct RbTreeNoAugment{
+  struct Data{};
+
+  template<typename Node>
+  static constexpr void Update(Node*) noexcept{}
+};
+
+template<typename K,
+         typename V,
+         typename A = Aii::Allocator<K>,
+         typename Augment = Aii::RbTreeNoAugment>
 class RbTree{
+  static_assert(Aii::IsAllocator<A>, "RbTree: A must satisfy Aii::IsAllocator");
+
   public:
-    using KeyType = T;
+    using KeyType = K;
+    using ValueType = V;
 
     enum class Colour{
       Black, Red
     };
 
     struct Node{
-      Node* parent;
+      // the colour lives in the low bit of the parent pointer, saving the
+      // word that a separate enum member costs after padding
+      Aii::TaggedPtr<Node, 1> parent;
       Node* left;
       Node* right;
-      Colour colour;
       KeyType key;
+      ValueType val;
+      [[no_unique_address]] typename Augment::Data aug;
+
+      Node* Parent() const noexcept{ return parent.Ptr();}
+      void SetParent(Node* node) noexcept{ parent.SetPtr(node);}
+
+      Colour GetColour() const noexcept{ return static_cast<Colour>(parent.Tag());}
+      void SetColour(Colour colour) noexcept{ parent.SetTag(static_cast<std::uintptr_t>(colour));}
     };
-  
+
+    class Iterator{
+      public:
+        constexpr Iterator() noexcept: m_node{nullptr}{}
+        constexpr explicit Iterator(Node* node) noexcept: m_node{node}{}
+
+        const KeyType& Key() const noexcept{ return m_node->key;}
+        ValueType& Val() const noexcept{ return m_node->val;}
+        Node* GetNode() const noexcept{ return m_node;}
+
+        ValueType& operator*() const noexcept{ return m_node->val;}
+        ValueType* operator->() const noexcept{ return &m_node->val;}
+
+        Iterator& operator++() noexcept{ m_node = RbTree::Next(m_node); return *this;}
+        Iterator operator++(int) noexcept{ Iterator tmp = *this; ++(*this); return tmp;}
+
+        constexpr bool operator==(const Iterator& rhs) const noexcept{ return m_node == rhs.m_node;}
+        constexpr bool operator!=(const Iterator& rhs) const noexcept{ return m_node != rhs.m_node;}
+
+      private:
+        Node* m_node;
+    };
+
+  private:
+    using NodeAllocType = typename A::template Rebind<Node>::other;
+
+    static constexpr std::size_t UnknownSize = ~std::size_t{0};
+
   public:
     RbTree() noexcept;
-    RbTree(KeyType rootKey) noexcept;
-    
+    RbTree(const RbTree& src) noexcept = delete;
+    RbTree(RbTree&& src) noexcept;
+    RbTree& operator=(const RbTree& src) noexcept = delete;
+    RbTree& operator=(RbTree&& src) noexcept;
+    ~RbTree() noexcept;
+
+    void Swap(RbTree& other) noexcept;
+
+    Node* Root() const noexcept{ return m_root;}
+    bool Empty() const noexcept{ return m_root == nullptr;}
+    std::size_t Size() const noexcept;
+
+    Iterator begin() const noexcept{ return Iterator{Min(m_root)};}
+    Iterator end() const noexcept{ return Iterator{};}
+    Iterator LowerBound(const KeyType& key) const noexcept;
+
+    ValueType* Find(const KeyType& key) const noexcept;
+    bool Contains(const KeyType& key) const noexcept{ return Find(key) != nullptr;}
+
+    Aii::Expected<ValueType*, Error> Insert(const KeyType& key, const ValueType& val) noexcept;
+    Aii::Expected<void, Error> Erase(const KeyType& key) noexcept;
+    void Clear() noexcept;
+
+    // Bulk operations
+
+    Aii::Expected<void, Error> AssignSorted(const KeyType* keys, const ValueType* vals,
+                                            std::size_t count) noexcept;
+    Aii::Expected<void, Error> Join(RbTree& rhs) noexcept;
+    Aii::Expected<void, Error> Split(const KeyType& key, RbTree& greater) noexcept;
+
+    void Union(RbTree& other) noexcept;
+    void Intersection(RbTree& other) noexcept;
+    void Difference(RbTree& other) noexcept;
+
     Aii::Expected<void, Error> LeftRotate(Node* node) noexcept;
-    void RightRotate(Node* node) noexcept;
+    Aii::Expected<void, Error> RightRotate(Node* node) noexcept;
+
+    static Node* Min(Node* node) noexcept;
+    static Node* Max(Node* node) noexcept;
+    static Node* Next(Node* node) noexcept;
+    static Node* Prev(Node* node) noexcept;
+    static void Propagate(Node* node) noexcept;
+
+  private:
+    static constexpr bool Augmented = !std::is_same_v<Augment, RbTreeNoAugment>;
+
+    NodeAllocType& NodeAllocator() noexcept{ return m_allocator;}
+    Node* AllocateNode(const KeyType& key, const ValueType& val) noexcept;
+    std::size_t DeallocateSubtree(Node* node) noexcept;
+    Node* BuildSorted(const KeyType* keys, const ValueType* vals, std::size_t first,
+                      std::size_t last, std::size_t depth, std::size_t redDepth,
+                      bool& failed) noexcept;
+
+    static bool IsRed(const Node* node) noexcept;
+    static bool IsBlack(const Node* node) noexcept{ return !IsRed(node);}
+    static std::size_t BlackHeight(const Node* node) noexcept;
+    static void Detach(Node* node) noexcept;
+
+    static void ReplaceChild(Node*& root, Node* parent, Node* oldChild, Node* newChild) noexcept;
+    static void RotateLeft(Node*& root, Node* node) noexcept;
+    static void RotateRight(Node*& root, Node* node) noexcept;
+    static bool InsertFixup(Node*& root, Node* node) noexcept;
+    static bool EraseNode(Node*& root, Node* node) noexcept;
+    static bool EraseFixup(Node*& root, Node* node, Node* parent) noexcept;
+
+    static Node* JoinNodes(Node* left, std::size_t leftBh, Node* mid,
+                           Node* right, std::size_t rightBh, std::size_t& bhOut) noexcept;
+    static Node* Join2Nodes(Node* left, std::size_t leftBh,
+                            Node* right, std::size_t rightBh, std::size_t& bhOut) noexcept;
+    static void SplitNodes(Node* node, std::size_t bh, const KeyType& key,
+                           Node*& left, std::size_t& leftBh, Node*& found,
+                           Node*& right, std::size_t& rightBh) noexcept;
+
+    Node* UnionNodes(Node* lhs, std::size_t lhsBh, Node* rhs, std::size_t rhsBh,
+                     std::size_t& bhOut, std::size_t& freed) noexcept;
+    Node* IntersectionNodes(Node* lhs, std::size_t lhsBh, Node* rhs, std::size_t rhsBh,
+                            std::size_t& bhOut, std::size_t& freed) noexcept;
+    Node* DifferenceNodes(Node* lhs, std::size_t lhsBh, Node* rhs, std::size_t rhsBh,
+                          std::size_t& bhOut, std::size_t& freed) noexcept;
+
+    void ResetRoot(Node* root, std::size_t size) noexcept;
+    std::size_t CombinedSize(const RbTree& other, std::size_t freed) const noexcept;
 
   private:
-    Node m_root;
+    Node* m_root;
+    // UnknownSize after a split, recounted lazily by Size()
+    mutable std::size_t m_size;
+    NodeAllocType m_allocator;
 };
 
 } // namespace Aii
 
-template<typename T>
-Aii::RbTree<T>::RbTree() noexcept
-  :RbTree(0)
+// Construction
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::RbTree<K, V, A, Augment>::RbTree() noexcept
+  :
+    m_root{nullptr},
+    m_size{0},
+    m_allocator{NodeAllocType()}
 {
 
 }
 
-template<typename T>
-Aii::RbTree<T>::RbTree(KeyType rootKey) noexcept
+template<typename K, typename V, typename A, typename Augment>
+Aii::RbTree<K, V, A, Augment>::RbTree(RbTree&& src) noexcept
   :
-    m_root{
-      .parent = nullptr, 
-      .left = nullptr, 
-      .right = nullptr, 
-      .colour = Colour::Black,
-      .key = rootKey
-    }
+    m_root{src.m_root},
+    m_size{src.m_size},
+    m_allocator{std::move(src.m_allocator)}
 {
+  src.m_root = nullptr;
+  src.m_size = 0;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::operator=(RbTree&& src) noexcept -> RbTree&{
+  if(this != &src){
+    Clear();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::RbTree<K, V, A, Augment>::~RbTree() noexcept{
+  DeallocateSubtree(m_root);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Swap(RbTree& other) noexcept{
+  using std::swap;
+  swap(m_root, other.m_root);
+  swap(m_size, other.m_size);
+  swap(m_allocator, other.m_allocator);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::AllocateNode(const KeyType& key, const ValueType& val) noexcept -> Node*{
+  Node* node = NodeAllocator().Allocate();
+  if(!node){
+    return nullptr;
+  }
+  node->parent = nullptr;
+  node->left = nullptr;
+  node->right = nullptr;
+  node->key = key;
+  node->val = val;
+  node->SetColour(Colour::Red);
+  return node;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+std::size_t Aii::RbTree<K, V, A, Augment>::DeallocateSubtree(Node* node) noexcept{
+  // O(n), recursion depth is bounded by the tree height
+  if(!node){
+    return 0;
+  }
+  std::size_t count = DeallocateSubtree(node->left);
+  count += DeallocateSubtree(node->right);
+  NodeAllocator().Deallocate(node);
+  return count + 1;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Clear() noexcept{
+  DeallocateSubtree(m_root);
+  m_root = nullptr;
+  m_size = 0;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+std::size_t Aii::RbTree<K, V, A, Augment>::Size() const noexcept{
+  // O(1), except for the first call after a Split which recounts in O(n)
+  if(m_size == UnknownSize){
+    std::size_t count = 0;
+    for(Node* node = Min(m_root); node; node = Next(node)){
+      count++;
+    }
+    m_size = count;
+  }
+  return m_size;
+}
+
+// Navigation
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::Min(Node* node) noexcept -> Node*{
+  if(!node){
+    return nullptr;
+  }
+  while(node->left){
+    node = node->left;
+  }
+  return node;
+}
 
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::Max(Node* node) noexcept -> Node*{
+  if(!node){
+    return nullptr;
+  }
+  while(node->right){
+    node = node->right;
+  }
+  return node;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::Next(Node* node) noexcept -> Node*{
+  // in order successor, amortised O(1) over a full traversal
+  if(node->right){
+    return Min(node->right);
+  }
+  Node* parent = node->Parent();
+  while(parent && node == parent->right){
+    node = parent;
+    parent = parent->Parent();
+  }
+  return parent;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::Prev(Node* node) noexcept -> Node*{
+  if(node->left){
+    return Max(node->left);
+  }
+  Node* parent = node->Parent();
+  while(parent && node == parent->left){
+    node = parent;
+    parent = parent->Parent();
+  }
+  return parent;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Propagate(Node* node) noexcept{
+  // Recomputes the augmented data of node and every ancestor. Call after
+  // changing anything Augment::Update reads from node. O(log n)
+  if constexpr(Augmented){
+    while(node){
+      Augment::Update(node);
+      node = node->Parent();
+    }
+  }
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::LowerBound(const KeyType& key) const noexcept -> Iterator{
+  // first element whose key is not less than key
+  Node* node = m_root;
+  Node* candidate = nullptr;
+  while(node){
+    if(node->key < key){
+      node = node->right;
+    }
+    else{
+      candidate = node;
+      node = node->left;
+    }
+  }
+  return Iterator{candidate};
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::Find(const KeyType& key) const noexcept -> ValueType*{
+  // O(log n)
+  Node* node = m_root;
+  while(node){
+    if(key < node->key){
+      node = node->left;
+    }
+    else if(node->key < key){
+      node = node->right;
+    }
+    else{
+      return &node->val;
+    }
+  }
+  return nullptr;
+}
+
+// Single element modification
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<typename Aii::RbTree<K, V, A, Augment>::ValueType*, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::Insert(const KeyType& key, const ValueType& val) noexcept{
+  // O(log n)
+  //
+  // Possible Errors:
+  //  InvalidArgument - the key is already present
+  //  RuntimeError - node allocation failed
+  Node* parent = nullptr;
+  Node* node = m_root;
+  while(node){
+    parent = node;
+    if(key < node->key){
+      node = node->left;
+    }
+    else if(node->key < key){
+      node = node->right;
+    }
+    else{
+      return {Aii::Error::InvalidArgument};
+    }
+  }
+  Node* inserted = AllocateNode(key, val);
+  if(!inserted){
+    return {Aii::Error::RuntimeError};
+  }
+  inserted->SetParent(parent);
+  if(!parent){
+    m_root = inserted;
+  }
+  else if(key < parent->key){
+    parent->left = inserted;
+  }
+  else{
+    parent->right = inserted;
+  }
+  Propagate(inserted);
+  InsertFixup(m_root, inserted);
+  if(m_size != UnknownSize){
+    m_size++;
+  }
+  return &inserted->val;
 }
 
-template<typename T>
-Aii::Expected<void, Aii::Error> 
-Aii::RbTree<T>::LeftRotate(Node* node) noexcept{
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<void, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::Erase(const KeyType& key) noexcept{
+  // O(log n)
+  //
+  // Possible Errors:
+  //  OutOfRange - the key is not present
+  Node* node = m_root;
+  while(node){
+    if(key < node->key){
+      node = node->left;
+    }
+    else if(node->key < key){
+      node = node->right;
+    }
+    else{
+      break;
+    }
+  }
+  if(!node){
+    return {Aii::Error::OutOfRange};
+  }
+  EraseNode(m_root, node);
+  NodeAllocator().Deallocate(node);
+  if(m_size != UnknownSize){
+    m_size--;
+  }
+  return {};
+}
+
+// Structural helpers, these operate on a subtree through its root so the
+// bulk operations can use them on detached subtrees
+
+template<typename K, typename V, typename A, typename Augment>
+bool Aii::RbTree<K, V, A, Augment>::IsRed(const Node* node) noexcept{
+  return node && node->GetColour() == Colour::Red;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+std::size_t Aii::RbTree<K, V, A, Augment>::BlackHeight(const Node* node) noexcept{
+  // number of black nodes from node down to a leaf, including node
+  std::size_t height = 0;
+  while(node){
+    if(IsBlack(node)){
+      height++;
+    }
+    node = node->left;
+  }
+  return height;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Detach(Node* node) noexcept{
+  if(node){
+    node->SetParent(nullptr);
+  }
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::ReplaceChild(Node*& root, Node* parent,
+                                        Node* oldChild, Node* newChild) noexcept{
+  if(!parent){
+    root = newChild;
+  }
+  else if(parent->left == oldChild){
+    parent->left = newChild;
+  }
+  else{
+    parent->right = newChild;
+  }
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::RotateLeft(Node*& root, Node* node) noexcept{
+  // node takes pivot's left subtree as its right child and becomes the
+  // left child of pivot
+  Node* pivot = node->right;
+  node->right = pivot->left;
+  if(pivot->left){
+    pivot->left->SetParent(node);
+  }
+  pivot->SetParent(node->Parent());
+  ReplaceChild(root, node->Parent(), node, pivot);
+  pivot->left = node;
+  node->SetParent(pivot);
+  Augment::Update(node);
+  Augment::Update(pivot);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::RotateRight(Node*& root, Node* node) noexcept{
+  // node takes pivot's right subtree as its left child and becomes the
+  // right child of pivot
+  Node* pivot = node->left;
+  node->left = pivot->right;
+  if(pivot->right){
+    pivot->right->SetParent(node);
+  }
+  pivot->SetParent(node->Parent());
+  ReplaceChild(root, node->Parent(), node, pivot);
+  pivot->right = node;
+  node->SetParent(pivot);
+  Augment::Update(node);
+  Augment::Update(pivot);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+bool Aii::RbTree<K, V, A, Augment>::InsertFixup(Node*& root, Node* node) noexcept{
+  // Restores the red black properties after node was linked in red.
+  // Returns true when the black height of the tree grew by one, which
+  // happens when the red violation is pushed all the way to the root.
+  while(IsRed(node->Parent())){
+    Node* parent = node->Parent();
+    Node* grandparent = parent->Parent();
+    if(parent == grandparent->left){
+      Node* uncle = grandparent->right;
+      if(IsRed(uncle)){
+        parent->SetColour(Colour::Black);
+        uncle->SetColour(Colour::Black);
+        grandparent->SetColour(Colour::Red);
+        node = grandparent;
+        continue;
+      }
+      if(node == parent->right){
+        node = parent;
+        RotateLeft(root, node);
+        parent = node->Parent();
+      }
+      parent->SetColour(Colour::Black);
+      grandparent->SetColour(Colour::Red);
+      RotateRight(root, grandparent);
+    }
+    else{
+      Node* uncle = grandparent->left;
+      if(IsRed(uncle)){
+        parent->SetColour(Colour::Black);
+        uncle->SetColour(Colour::Black);
+        grandparent->SetColour(Colour::Red);
+        node = grandparent;
+        continue;
+      }
+      if(node == parent->left){
+        node = parent;
+        RotateRight(root, node);
+        parent = node->Parent();
+      }
+      parent->SetColour(Colour::Black);
+      grandparent->SetColour(Colour::Red);
+      RotateLeft(root, grandparent);
+    }
+  }
+  bool grew = IsRed(root);
+  root->SetColour(Colour::Black);
+  return grew;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+bool Aii::RbTree<K, V, A, Augment>::EraseNode(Node*& root, Node* node) noexcept{
+  // Unlinks node from the tree rooted at root without deallocating it.
+  // Returns true when the black height of the tree shrank by one.
+  Node* spliced = node;
+  Colour splicedColour = spliced->GetColour();
+  Node* child = nullptr;
+  Node* childParent = nullptr;
+  if(!node->left || !node->right){
+    child = node->left ? node->left : node->right;
+    childParent = node->Parent();
+    ReplaceChild(root, node->Parent(), node, child);
+    if(child){
+      child->SetParent(node->Parent());
+    }
+  }
+  else{
+    // the successor takes node's place and colour
+    spliced = Min(node->right);
+    splicedColour = spliced->GetColour();
+    child = spliced->right;
+    if(spliced->Parent() == node){
+      childParent = spliced;
+    }
+    else{
+      childParent = spliced->Parent();
+      childParent->left = child;
+      if(child){
+        child->SetParent(childParent);
+      }
+      spliced->right = node->right;
+      spliced->right->SetParent(spliced);
+    }
+    ReplaceChild(root, node->Parent(), node, spliced);
+    spliced->SetParent(node->Parent());
+    spliced->left = node->left;
+    spliced->left->SetParent(spliced);
+    spliced->SetColour(node->GetColour());
+  }
+  node->parent = nullptr;
+  node->left = nullptr;
+  node->right = nullptr;
+  // everything from the lowest relinked node up to the root changed shape
+  Propagate(childParent);
+  if(splicedColour == Colour::Red){
+    return false;
+  }
+  return EraseFixup(root, child, childParent);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+bool Aii::RbTree<K, V, A, Augment>::EraseFixup(Node*& root, Node* node, Node* parent) noexcept{
+  // node carries an extra black, node may be null so its parent is tracked
+  // separately. Returns true when the extra black reached the root.
+  while(node != root && IsBlack(node)){
+    if(node == parent->left){
+      Node* sibling = parent->right;
+      if(IsRed(sibling)){
+        sibling->SetColour(Colour::Black);
+        parent->SetColour(Colour::Red);
+        RotateLeft(root, parent);
+        sibling = parent->right;
+      }
+      if(IsBlack(sibling->left) && IsBlack(sibling->right)){
+        sibling->SetColour(Colour::Red);
+        node = parent;
+        parent = node->Parent();
+        continue;
+      }
+      if(IsBlack(sibling->right)){
+        sibling->left->SetColour(Colour::Black);
+        sibling->SetColour(Colour::Red);
+        RotateRight(root, sibling);
+        sibling = parent->right;
+      }
+      sibling->SetColour(parent->GetColour());
+      parent->SetColour(Colour::Black);
+      sibling->right->SetColour(Colour::Black);
+      RotateLeft(root, parent);
+    }
+    else{
+      Node* sibling = parent->left;
+      if(IsRed(sibling)){
+        sibling->SetColour(Colour::Black);
+        parent->SetColour(Colour::Red);
+        RotateRight(root, parent);
+        sibling = parent->left;
+      }
+      if(IsBlack(sibling->left) && IsBlack(sibling->right)){
+        sibling->SetColour(Colour::Red);
+        node = parent;
+        parent = node->Parent();
+        continue;
+      }
+      if(IsBlack(sibling->left)){
+        sibling->right->SetColour(Colour::Black);
+        sibling->SetColour(Colour::Red);
+        RotateLeft(root, sibling);
+        sibling = parent->left;
+      }
+      sibling->SetColour(parent->GetColour());
+      parent->SetColour(Colour::Black);
+      sibling->left->SetColour(Colour::Black);
+      RotateRight(root, parent);
+    }
+    root->SetColour(Colour::Black);
+    return false;
+  }
+  if(IsRed(node)){
+    node->SetColour(Colour::Black);
+    return false;
+  }
+  return true;
+}
+
+// Join and Split
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::JoinNodes(Node* left, std::size_t leftBh, Node* mid,
+                                     Node* right, std::size_t rightBh,
+                                     std::size_t& bhOut) noexcept -> Node*{
+  // Joins two detached subtrees around a detached node, where every key in
+  // left < mid->key < every key in right. O(|leftBh - rightBh| + 1)
+  if(IsRed(left)){
+    left->SetColour(Colour::Black);
+    leftBh++;
+  }
+  if(IsRed(right)){
+    right->SetColour(Colour::Black);
+    rightBh++;
+  }
+  mid->parent = nullptr;
+  if(leftBh == rightBh){
+    mid->left = left;
+    mid->right = right;
+    if(left){
+      left->SetParent(mid);
+    }
+    if(right){
+      right->SetParent(mid);
+    }
+    mid->SetColour(Colour::Black);
+    Augment::Update(mid);
+    bhOut = leftBh + 1;
+    return mid;
+  }
+  Node* root = nullptr;
+  if(leftBh > rightBh){
+    // walk down the right spine of left to the first black node whose
+    // black height matches right, mid replaces it as a red node
+    Node* parent = nullptr;
+    Node* node = left;
+    std::size_t height = leftBh;
+    while(node && !(IsBlack(node) && height == rightBh)){
+      if(IsBlack(node)){
+        height--;
+      }
+      parent = node;
+      node = node->right;
+    }
+    mid->left = node;
+    mid->right = right;
+    if(node){
+      node->SetParent(mid);
+    }
+    if(right){
+      right->SetParent(mid);
+    }
+    parent->right = mid;
+    mid->SetParent(parent);
+    root = left;
+    bhOut = leftBh;
+  }
+  else{
+    Node* parent = nullptr;
+    Node* node = right;
+    std::size_t height = rightBh;
+    while(node && !(IsBlack(node) && height == leftBh)){
+      if(IsBlack(node)){
+        height--;
+      }
+      parent = node;
+      node = node->left;
+    }
+    mid->right = node;
+    mid->left = left;
+    if(node){
+      node->SetParent(mid);
+    }
+    if(left){
+      left->SetParent(mid);
+    }
+    parent->left = mid;
+    mid->SetParent(parent);
+    root = right;
+    bhOut = rightBh;
+  }
+  mid->SetColour(Colour::Red);
+  Propagate(mid);
+  if(InsertFixup(root, mid)){
+    bhOut++;
+  }
+  return root;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::Join2Nodes(Node* left, std::size_t leftBh,
+                                      Node* right, std::size_t rightBh,
+                                      std::size_t& bhOut) noexcept -> Node*{
+  // Joins two detached subtrees without a middle node, the minimum of right
+  // is unlinked and used as the middle node instead
+  if(!right){
+    bhOut = leftBh;
+    return left;
+  }
+  if(!left){
+    bhOut = rightBh;
+    return right;
+  }
+  if(IsRed(right)){
+    right->SetColour(Colour::Black);
+    rightBh++;
+  }
+  Node* mid = Min(right);
+  if(EraseNode(right, mid)){
+    rightBh--;
+  }
+  return JoinNodes(left, leftBh, mid, right, rightBh, bhOut);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::SplitNodes(Node* node, std::size_t bh, const KeyType& key,
+                                      Node*& left, std::size_t& leftBh, Node*& found,
+                                      Node*& right, std::size_t& rightBh) noexcept{
+  // Splits the detached subtree node into the keys less than key, the node
+  // holding key (if any) and the keys greater than key. O(log n) as the
+  // joins on the way back up telescope.
+  if(!node){
+    left = nullptr;
+    right = nullptr;
+    found = nullptr;
+    leftBh = 0;
+    rightBh = 0;
+    return;
+  }
+  Node* lchild = node->left;
+  Node* rchild = node->right;
+  std::size_t childBh = bh - (IsBlack(node) ? 1 : 0);
+  Detach(lchild);
+  Detach(rchild);
+  node->left = nullptr;
+  node->right = nullptr;
+  if(key < node->key){
+    Node* greater = nullptr;
+    std::size_t greaterBh = 0;
+    SplitNodes(lchild, childBh, key, left, leftBh, found, greater, greaterBh);
+    right = JoinNodes(greater, greaterBh, node, rchild, childBh, rightBh);
+  }
+  else if(node->key < key){
+    Node* less = nullptr;
+    std::size_t lessBh = 0;
+    SplitNodes(rchild, childBh, key, less, lessBh, found, right, rightBh);
+    left = JoinNodes(lchild, childBh, node, less, lessBh, leftBh);
+  }
+  else{
+    found = node;
+    left = lchild;
+    leftBh = childBh;
+    right = rchild;
+    rightBh = childBh;
+  }
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::ResetRoot(Node* root, std::size_t size) noexcept{
+  m_root = root;
+  if(m_root){
+    m_root->SetParent(nullptr);
+    m_root->SetColour(Colour::Black);
+  }
+  m_size = m_root ? size : 0;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+std::size_t Aii::RbTree<K, V, A, Augment>::CombinedSize(const RbTree& other, std::size_t freed) const noexcept{
+  if(m_size == UnknownSize || other.m_size == UnknownSize){
+    return UnknownSize;
+  }
+  return m_size + other.m_size - freed;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<void, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::Join(RbTree& rhs) noexcept{
+  // Moves every element of rhs into this tree in O(log n), rhs is left empty
+  //
+  // Possible Errors:
+  //  InvalidArgument - the smallest key of rhs is not greater than the
+  //                    largest key of this tree
+  //
+  // On error, both trees are left in the state before the function call
+  if(this == &rhs){
+    return {Aii::Error::InvalidArgument};
+  }
+  if(rhs.Empty()){
+    return {};
+  }
+  if(Empty()){
+    Swap(rhs);
+    return {};
+  }
+  Node* mid = Min(rhs.m_root);
+  if(!(Max(m_root)->key < mid->key)){
+    return {Aii::Error::InvalidArgument};
+  }
+  std::size_t size = CombinedSize(rhs, 0);
+  std::size_t leftBh = BlackHeight(m_root);
+  std::size_t rightBh = BlackHeight(rhs.m_root);
+  Node* right = rhs.m_root;
+  if(EraseNode(right, mid)){
+    rightBh--;
+  }
+  std::size_t bh = 0;
+  ResetRoot(JoinNodes(m_root, leftBh, mid, right, rightBh, bh), size);
+  rhs.m_root = nullptr;
+  rhs.m_size = 0;
+  return {};
+}
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<void, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::Split(const KeyType& key, RbTree& greater) noexcept{
+  // Moves every element whose key is not less than key into greater in
+  // O(log n). The sizes of both trees are recounted on their next Size().
+  //
+  // Possible Errors:
+  //  InvalidArgument - greater is this tree or is not empty
+  if(this == &greater || !greater.Empty()){
+    return {Aii::Error::InvalidArgument};
+  }
+  Node* left = nullptr;
+  Node* right = nullptr;
+  Node* found = nullptr;
+  std::size_t leftBh = 0;
+  std::size_t rightBh = 0;
+  SplitNodes(m_root, BlackHeight(m_root), key, left, leftBh, found, right, rightBh);
+  if(found){
+    std::size_t bh = 0;
+    right = JoinNodes(nullptr, 0, found, right, rightBh, bh);
+  }
+  ResetRoot(left, UnknownSize);
+  greater.ResetRoot(right, UnknownSize);
+  return {};
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::BuildSorted(const KeyType* keys, const ValueType* vals,
+                                       std::size_t first, std::size_t last,
+                                       std::size_t depth, std::size_t redDepth,
+                                       bool& failed) noexcept -> Node*{
+  // Builds [first, last) around its midpoint. Every leaf ends up at depth
+  // redDepth or redDepth - 1, so colouring only the deepest (incomplete)
+  // level red gives equal black heights on every path.
+  if(first >= last || failed){
+    return nullptr;
+  }
+  std::size_t mid = first + (last - first) / 2;
+  Node* node = AllocateNode(keys[mid], vals[mid]);
+  if(!node){
+    failed = true;
+    return nullptr;
+  }
+  node->SetColour(depth == redDepth ? Colour::Red : Colour::Black);
+  node->left = BuildSorted(keys, vals, first, mid, depth + 1, redDepth, failed);
+  node->right = BuildSorted(keys, vals, mid + 1, last, depth + 1, redDepth, failed);
+  if(node->left){
+    node->left->SetParent(node);
+  }
+  if(node->right){
+    node->right->SetParent(node);
+  }
+  Augment::Update(node);
+  return node;
+}
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<void, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::AssignSorted(const KeyType* keys, const ValueType* vals,
+                                   std::size_t count) noexcept{
+  // Replaces the contents of the tree with count key value pairs in O(n),
+  // instead of the O(n log n) of repeated insertion.
+  //
+  // Possible Errors:
+  //  InvalidArgument - keys are not strictly increasing
+  //  RuntimeError - node allocation failed
+  //
+  // On error, the tree is left in the state before the function call
+  if(count > 0 && (!keys || !vals)){
+    return {Aii::Error::InvalidArgument};
+  }
+  for(std::size_t i = 1; i < count; i++){
+    if(!(keys[i - 1] < keys[i])){
+      return {Aii::Error::InvalidArgument};
+    }
+  }
+  // floor(log2(count + 1)) is the depth of the first incomplete level
+  std::size_t redDepth = 0;
+  for(std::size_t full = count + 1; full > 1; full >>= 1){
+    redDepth++;
+  }
+  bool failed = false;
+  Node* root = BuildSorted(keys, vals, 0, count, 0, redDepth, failed);
+  if(failed){
+    DeallocateSubtree(root);
+    return {Aii::Error::RuntimeError};
+  }
+  Clear();
+  ResetRoot(root, count);
+  return {};
+}
+
+// Set algebra. Every recursive step splits one tree by the root key of the
+// other, then handles the left and right subtrees in turn.
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::UnionNodes(Node* lhs, std::size_t lhsBh,
+                                      Node* rhs, std::size_t rhsBh,
+                                      std::size_t& bhOut, std::size_t& freed) noexcept -> Node*{
+  if(!lhs){
+    bhOut = rhsBh;
+    return rhs;
+  }
+  if(!rhs){
+    bhOut = lhsBh;
+    return lhs;
+  }
+  Node* lchild = lhs->left;
+  Node* rchild = lhs->right;
+  std::size_t childBh = lhsBh - (IsBlack(lhs) ? 1 : 0);
+  Detach(lchild);
+  Detach(rchild);
+  Node* less = nullptr;
+  Node* greater = nullptr;
+  Node* duplicate = nullptr;
+  std::size_t lessBh = 0;
+  std::size_t greaterBh = 0;
+  SplitNodes(rhs, rhsBh, lhs->key, less, lessBh, duplicate, greater, greaterBh);
+  if(duplicate){
+    // the value already in this tree wins
+    NodeAllocator().Deallocate(duplicate);
+    freed++;
+  }
+  std::size_t leftBh = 0;
+  std::size_t rightBh = 0;
+  Node* left = UnionNodes(lchild, childBh, less, lessBh, leftBh, freed);
+  Node* right = UnionNodes(rchild, childBh, greater, greaterBh, rightBh, freed);
+  return JoinNodes(left, leftBh, lhs, right, rightBh, bhOut);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::IntersectionNodes(Node* lhs, std::size_t lhsBh,
+                                             Node* rhs, std::size_t rhsBh,
+                                             std::size_t& bhOut, std::size_t& freed) noexcept -> Node*{
+  if(!lhs || !rhs){
+    freed += DeallocateSubtree(lhs);
+    freed += DeallocateSubtree(rhs);
+    bhOut = 0;
+    return nullptr;
+  }
+  Node* lchild = lhs->left;
+  Node* rchild = lhs->right;
+  std::size_t childBh = lhsBh - (IsBlack(lhs) ? 1 : 0);
+  Detach(lchild);
+  Detach(rchild);
+  Node* less = nullptr;
+  Node* greater = nullptr;
+  Node* duplicate = nullptr;
+  std::size_t lessBh = 0;
+  std::size_t greaterBh = 0;
+  SplitNodes(rhs, rhsBh, lhs->key, less, lessBh, duplicate, greater, greaterBh);
+  std::size_t leftBh = 0;
+  std::size_t rightBh = 0;
+  Node* left = IntersectionNodes(lchild, childBh, less, lessBh, leftBh, freed);
+  Node* right = IntersectionNodes(rchild, childBh, greater, greaterBh, rightBh, freed);
+  if(duplicate){
+    NodeAllocator().Deallocate(duplicate);
+    freed++;
+    return JoinNodes(left, leftBh, lhs, right, rightBh, bhOut);
+  }
+  NodeAllocator().Deallocate(lhs);
+  freed++;
+  return Join2Nodes(left, leftBh, right, rightBh, bhOut);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+auto Aii::RbTree<K, V, A, Augment>::DifferenceNodes(Node* lhs, std::size_t lhsBh,
+                                           Node* rhs, std::size_t rhsBh,
+                                           std::size_t& bhOut, std::size_t& freed) noexcept -> Node*{
+  if(!lhs || !rhs){
+    freed += DeallocateSubtree(rhs);
+    bhOut = lhs ? lhsBh : 0;
+    return lhs;
+  }
+  Node* lchild = rhs->left;
+  Node* rchild = rhs->right;
+  std::size_t childBh = rhsBh - (IsBlack(rhs) ? 1 : 0);
+  Detach(lchild);
+  Detach(rchild);
+  Node* less = nullptr;
+  Node* greater = nullptr;
+  Node* duplicate = nullptr;
+  std::size_t lessBh = 0;
+  std::size_t greaterBh = 0;
+  SplitNodes(lhs, lhsBh, rhs->key, less, lessBh, duplicate, greater, greaterBh);
+  NodeAllocator().Deallocate(rhs);
+  freed++;
+  if(duplicate){
+    NodeAllocator().Deallocate(duplicate);
+    freed++;
+  }
+  std::size_t leftBh = 0;
+  std::size_t rightBh = 0;
+  Node* left = DifferenceNodes(less, lessBh, lchild, childBh, leftBh, freed);
+  Node* right = DifferenceNodes(greater, greaterBh, rchild, childBh, rightBh, freed);
+  return Join2Nodes(left, leftBh, right, rightBh, bhOut);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Union(RbTree& other) noexcept{
+  // this = this | other, other is left empty. On duplicate keys the value
+  // in this tree is kept. O(m log(n / m + 1)) for sizes m <= n.
+  if(this == &other){
+    return;
+  }
+  std::size_t freed = 0;
+  std::size_t bh = 0;
+  Node* root = UnionNodes(m_root, BlackHeight(m_root),
+                          other.m_root, BlackHeight(other.m_root), bh, freed);
+  std::size_t size = CombinedSize(other, freed);
+  other.m_root = nullptr;
+  other.m_size = 0;
+  ResetRoot(root, size);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Intersection(RbTree& other) noexcept{
+  // this = this & other, other is left empty. Values are kept from this tree.
+  if(this == &other){
+    return;
+  }
+  std::size_t freed = 0;
+  std::size_t bh = 0;
+  Node* root = IntersectionNodes(m_root, BlackHeight(m_root),
+                                 other.m_root, BlackHeight(other.m_root), bh, freed);
+  std::size_t size = CombinedSize(other, freed);
+  other.m_root = nullptr;
+  other.m_size = 0;
+  ResetRoot(root, size);
+}
+
+template<typename K, typename V, typename A, typename Augment>
+void Aii::RbTree<K, V, A, Augment>::Difference(RbTree& other) noexcept{
+  // this = this - other, other is left empty
+  if(this == &other){
+    Clear();
+    return;
+  }
+  std::size_t freed = 0;
+  std::size_t bh = 0;
+  Node* root = DifferenceNodes(m_root, BlackHeight(m_root),
+                               other.m_root, BlackHeight(other.m_root), bh, freed);
+  std::size_t size = CombinedSize(other, freed);
+  other.m_root = nullptr;
+  other.m_size = 0;
+  ResetRoot(root, size);
+}
+
+// Rotations
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<void, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::LeftRotate(Node* node) noexcept{
   // Possible Errors:
   //  InvalidArgument
-  //  
+  //  RuntimeError - node has no right child to rotate about
+  //
   // On error, the tree is left in the state before the function call
   if(!node){
     return {Aii::Error::InvalidArgument};
   }
-  Node* pivot = node->right;
-  if(!pivot){
+  if(!node->right){
+    return {Aii::Error::RuntimeError};
+  }
+  RotateLeft(m_root, node);
+  return {};
+}
+
+template<typename K, typename V, typename A, typename Augment>
+Aii::Expected<void, Aii::Error>
+Aii::RbTree<K, V, A, Augment>::RightRotate(Node* node) noexcept{
+  // Possible Errors:
+  //  InvalidArgument
+  //  RuntimeError - node has no left child to rotate about
+  //
+  // On error, the tree is left in the state before the function call
+  if(!node){
+    return {Aii::Error::InvalidArgument};
+  }
+  if(!node->left){
     return {Aii::Error::RuntimeError};
   }
+  RotateRight(m_root, node);
+  return {};
 }
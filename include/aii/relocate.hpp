@@ -0,0 +1,67 @@
+#pragma once
+
+// Relocation: moving an object to new storage and ending its lifetime at
+// the old address, as containers do when they grow or shift elements.
+//
+// For most types relocation is a move construction followed by a destroy,
+// but for many it is equivalent to copying the bytes, even when the type
+// has its own move constructor and destructor (an owning pointer, say). Such
+// types can be relocated in bulk with Memcpy. This holds for every trivially
+// copyable type, and other types opt in by specialising
+// IsTriviallyRelocatable:
+//
+//   template<>
+//   inline constexpr bool Aii::IsTriviallyRelocatable<MyType> = true;
+//
+// A type must not opt in if it stores pointers into itself or registers
+// its address elsewhere.
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/string.h"
+
+namespace Aii{
+
+template<typename T>
+inline constexpr bool IsTriviallyRelocatable = std::is_trivially_copyable_v<T>;
+
+namespace Details{
+
+template<typename T>
+void Relocate(T* dest, T* src, std::size_t count) noexcept{
+  // relocates count objects from src to dest, which must not overlap
+  if constexpr(IsTriviallyRelocatable<T>){
+    Memcpy(static_cast<void*>(dest), static_cast<const void*>(src), count * sizeof(T));
+  }
+  else{
+    for(std::size_t i = 0; i < count; i++){
+      ::new(static_cast<void*>(dest + i)) T{std::move(src[i])};
+      src[i].~T();
+    }
+  }
+}
+
+template<typename T>
+void RelocateOverlapping(T* dest, T* src, std::size_t count) noexcept{
+  // as Relocate, but the ranges may overlap, as when shifting elements
+  // along an array
+  if constexpr(IsTriviallyRelocatable<T>){
+    Memmove(static_cast<void*>(dest), static_cast<const void*>(src), count * sizeof(T));
+  }
+  else if(dest < src){
+    Relocate(dest, src, count);
+  }
+  else{
+    for(std::size_t i = count; i > 0; i--){
+      ::new(static_cast<void*>(dest + i - 1)) T{std::move(src[i - 1])};
+      src[i - 1].~T();
+    }
+  }
+}
+
+} // namespace Details
+
+} // namespace Aii
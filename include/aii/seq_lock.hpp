@@ -0,0 +1,140 @@
+#pragma once
+
+// Sequence lock over a small trivially copyable value which is read often
+// and written rarely, such as the clock source parameters behind the time
+// of day or a statistics snapshot.
+//
+// A writer makes the sequence odd, writes the value and makes the sequence
+// even again. A reader reads the sequence, copies the value and rereads the
+// sequence, and retries if it was odd or changed, as a write ran during the
+// copy. Readers never write shared memory and never wait for one another,
+// so any number of cpus read at once with the line staying shared among
+// them; only a write sends it round again.
+//
+// A reader may copy the value while a writer changes it and throw the copy
+// away. To keep that race defined the value is held as words, copied with
+// relaxed atomic loads and stores, which are plain moves on common cpus;
+// Memcpy only converts between T and the words outside the shared copy.
+//
+// Writers exclude each other with a spin lock. A reader interrupting a
+// writer on the same cpu would retry forever, so a value read from
+// interrupt handlers must be written with interrupts disabled.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "aii/atomic.hpp"
+#include "aii/spinlock.hpp"
+#include "aii/string.h"
+
+namespace Aii{
+
+template<typename T>
+class SeqLock{
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock: T must be trivially copyable");
+  static_assert(std::is_default_constructible_v<T>, "SeqLock: T must be default constructible");
+
+  private:
+    using Word = std::uintptr_t;
+    static constexpr std::size_t Words = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+  public:
+    using ValueType = T;
+
+    SeqLock() noexcept: SeqLock(T{}){}
+    explicit SeqLock(const T& val) noexcept;
+    SeqLock(const SeqLock& src) noexcept = delete;
+    SeqLock& operator=(const SeqLock& src) noexcept = delete;
+
+    // a consistent copy of the value; waits only while a write is running
+    T Load() const noexcept;
+    void Store(const T& val) noexcept;
+    // calls fn on a copy of the value and stores the result, excluding other
+    // writers in between
+    template<typename F>
+    void Update(F&& fn) noexcept;
+
+  private:
+    void CopyOut(Word (&words)[Words]) const noexcept;
+    void StoreLocked(const T& val) noexcept;
+
+  private:
+    // odd while a write is running
+    Atomic<std::uint32_t> m_sequence;
+    Word m_words[Words];
+    SpinLock m_writerLock;
+};
+
+} // namespace Aii
+
+template<typename T>
+Aii::SeqLock<T>::SeqLock(const T& val) noexcept
+  :
+    m_sequence{0},
+    m_words{},
+    m_writerLock{}
+{
+  Memcpy(m_words, &val, sizeof(T));
+}
+
+template<typename T>
+void Aii::SeqLock<T>::CopyOut(Word (&words)[Words]) const noexcept{
+  for(std::size_t i = 0; i < Words; i++){
+    words[i] = AtomicLoad(&m_words[i], MemoryOrder::Relaxed);
+  }
+}
+
+template<typename T>
+T Aii::SeqLock<T>::Load() const noexcept{
+  // O(sizeof(T)) unless writes keep landing during the copy
+  Word words[Words];
+  for(;;){
+    std::uint32_t before = m_sequence.Load(MemoryOrder::Acquire);
+    if(before & 1){
+      CpuRelax();
+      continue;
+    }
+    CopyOut(words);
+    // the copy is complete before the sequence is reread
+    ThreadFence(MemoryOrder::Acquire);
+    if(m_sequence.Load(MemoryOrder::Relaxed) == before){
+      break;
+    }
+  }
+  T val;
+  Memcpy(&val, words, sizeof(T));
+  return val;
+}
+
+template<typename T>
+void Aii::SeqLock<T>::StoreLocked(const T& val) noexcept{
+  Word words[Words] = {};
+  Memcpy(words, &val, sizeof(T));
+  std::uint32_t sequence = m_sequence.Load(MemoryOrder::Relaxed);
+  m_sequence.Store(sequence + 1, MemoryOrder::Relaxed);
+  // the odd sequence is visible before any of the new words
+  ThreadFence(MemoryOrder::Release);
+  for(std::size_t i = 0; i < Words; i++){
+    AtomicStore(&m_words[i], words[i], MemoryOrder::Relaxed);
+  }
+  m_sequence.Store(sequence + 2, MemoryOrder::Release);
+}
+
+template<typename T>
+void Aii::SeqLock<T>::Store(const T& val) noexcept{
+  LockGuard guard{m_writerLock};
+  StoreLocked(val);
+}
+
+template<typename T> template<typename F>
+void Aii::SeqLock<T>::Update(F&& fn) noexcept{
+  LockGuard guard{m_writerLock};
+  // no other writer can change the words, so a plain copy is consistent
+  Word words[Words];
+  CopyOut(words);
+  T val;
+  Memcpy(&val, words, sizeof(T));
+  fn(val);
+  StoreLocked(val);
+}
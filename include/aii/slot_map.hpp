@@ -0,0 +1,281 @@
+#pragma once
+
+// Object table addressed by generation checked handles.
+//
+// Values are packed densely in one Vector, so iterating over them walks
+// contiguous memory. A handle names a slot rather than a value: a 32 bit
+// slot index and the 32 bit generation the slot had when the value was
+// inserted. The slot records where its value sits in the dense array, and
+// each dense entry records its slot, so erasing moves the last value into
+// the hole and patches one slot. Insert, Erase and Find are all O(1) with
+// no hashing.
+//
+// A slot's generation is odd while it holds a value and even while free,
+// and is bumped on every insert and erase, so a handle to an erased value
+// never matches again (until the generation wraps after 2^31 reuses of the
+// same slot). Free slots are chained into a list through their index field.
+//
+// Handles stay valid across insertions and erasures of other values, but
+// pointers to values do not, as erasing relocates the last value.
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+#include "aii/vector.hpp"
+
+namespace Aii{
+
+template<typename T, typename A = Aii::Allocator<T>>
+class SlotMap{
+  static_assert(Aii::IsAllocator<A>, "SlotMap: A must satisfy Aii::IsAllocator");
+
+  private:
+    static constexpr std::uint32_t NoSlot = 0xFFFFFFFF;
+
+    struct Slot{
+      std::uint32_t generation;
+      // dense index of the value while occupied, next free slot while free
+      std::uint32_t index;
+    };
+
+    using SlotAllocType = typename A::template Rebind<Slot>::other;
+    using IndexAllocType = typename A::template Rebind<std::uint32_t>::other;
+
+  public:
+    using ValueType = T;
+
+    // names a value of the map; a default constructed handle names nothing
+    struct Handle{
+      std::uint32_t index = NoSlot;
+      std::uint32_t generation = 0;
+
+      bool operator==(const Handle& other) const noexcept = default;
+    };
+
+    SlotMap() noexcept;
+    SlotMap(const SlotMap& src) noexcept = delete;
+    SlotMap(SlotMap&& src) noexcept;
+    SlotMap& operator=(const SlotMap& src) noexcept = delete;
+    SlotMap& operator=(SlotMap&& src) noexcept;
+    ~SlotMap() noexcept = default;
+
+    void Swap(SlotMap& other) noexcept;
+
+    bool Empty() const noexcept{ return m_values.Empty();}
+    std::size_t Size() const noexcept{ return m_values.Size();}
+
+    // the values in dense order, which changes as values are erased
+    T* begin() noexcept{ return m_values.begin();}
+    T* end() noexcept{ return m_values.end();}
+    const T* begin() const noexcept{ return m_values.begin();}
+    const T* end() const noexcept{ return m_values.end();}
+    T* Data() noexcept{ return m_values.Data();}
+    const T* Data() const noexcept{ return m_values.Data();}
+
+    // handle of the value at position index of the dense order
+    Handle HandleAt(std::size_t index) const noexcept;
+
+    T* Find(Handle handle) noexcept;
+    const T* Find(Handle handle) const noexcept;
+    bool Contains(Handle handle) const noexcept{ return Find(handle) != nullptr;}
+
+    template<typename ...Args>
+    Aii::Expected<Handle, Error> Emplace(Args&& ...args) noexcept;
+    Aii::Expected<Handle, Error> Insert(const T& val) noexcept{ return Emplace(val);}
+    Aii::Expected<Handle, Error> Insert(T&& val) noexcept{ return Emplace(std::move(val));}
+
+    Aii::Expected<void, Error> Erase(Handle handle) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> Reserve(std::size_t count) noexcept;
+
+  private:
+    bool Occupied(Handle handle) const noexcept;
+
+  private:
+    Aii::Vector<T, A> m_values;
+    // slot of each dense value
+    Aii::Vector<std::uint32_t, IndexAllocType> m_slotOf;
+    Aii::Vector<Slot, SlotAllocType> m_slots;
+    std::uint32_t m_freeHead;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, typename A>
+Aii::SlotMap<T, A>::SlotMap() noexcept
+  :
+    m_values{},
+    m_slotOf{},
+    m_slots{},
+    m_freeHead{NoSlot}
+{
+
+}
+
+template<typename T, typename A>
+Aii::SlotMap<T, A>::SlotMap(SlotMap&& src) noexcept
+  :
+    m_values{std::move(src.m_values)},
+    m_slotOf{std::move(src.m_slotOf)},
+    m_slots{std::move(src.m_slots)},
+    m_freeHead{src.m_freeHead}
+{
+  src.m_freeHead = NoSlot;
+}
+
+template<typename T, typename A>
+auto Aii::SlotMap<T, A>::operator=(SlotMap&& src) noexcept -> SlotMap&{
+  if(this != &src){
+    SlotMap{std::move(src)}.Swap(*this);
+  }
+  return *this;
+}
+
+template<typename T, typename A>
+void Aii::SlotMap<T, A>::Swap(SlotMap& other) noexcept{
+  m_values.Swap(other.m_values);
+  m_slotOf.Swap(other.m_slotOf);
+  m_slots.Swap(other.m_slots);
+  std::swap(m_freeHead, other.m_freeHead);
+}
+
+// Lookup
+
+template<typename T, typename A>
+bool Aii::SlotMap<T, A>::Occupied(Handle handle) const noexcept{
+  return handle.index < m_slots.Size()
+      && m_slots[handle.index].generation == handle.generation
+      && (handle.generation & 1);
+}
+
+template<typename T, typename A>
+auto Aii::SlotMap<T, A>::HandleAt(std::size_t index) const noexcept -> Handle{
+  std::uint32_t slot = m_slotOf[index];
+  return Handle{slot, m_slots[slot].generation};
+}
+
+template<typename T, typename A>
+T* Aii::SlotMap<T, A>::Find(Handle handle) noexcept{
+  // the value named by handle, or nullptr if it was erased. O(1)
+  if(!Occupied(handle)){
+    return nullptr;
+  }
+  return &m_values[m_slots[handle.index].index];
+}
+
+template<typename T, typename A>
+const T* Aii::SlotMap<T, A>::Find(Handle handle) const noexcept{
+  if(!Occupied(handle)){
+    return nullptr;
+  }
+  return &m_values[m_slots[handle.index].index];
+}
+
+// Modification
+
+template<typename T, typename A> template<typename ...Args>
+auto Aii::SlotMap<T, A>::Emplace(Args&& ...args) noexcept -> Aii::Expected<Handle, Error>{
+  // constructs a value from args and returns its handle. O(1) amortised
+  //
+  // Possible Errors:
+  //  OutOfRange - the map already uses every 32 bit slot index
+  //  RuntimeError - allocation failed
+  //
+  // On error, the map is left in the state before the function call
+  if(m_freeHead == NoSlot && m_slots.Size() == NoSlot){
+    return {Aii::Error::OutOfRange};
+  }
+  if(!m_values.EmplaceBack(std::forward<Args>(args)...)){
+    return {Aii::Error::RuntimeError};
+  }
+  std::uint32_t slot = m_freeHead;
+  if(slot == NoSlot){
+    slot = static_cast<std::uint32_t>(m_slots.Size());
+    if(!m_slots.PushBack(Slot{0, NoSlot})){
+      m_values.PopBack();
+      return {Aii::Error::RuntimeError};
+    }
+  }
+  if(!m_slotOf.PushBack(slot)){
+    if(slot != m_freeHead){
+      m_slots.PopBack();
+    }
+    m_values.PopBack();
+    return {Aii::Error::RuntimeError};
+  }
+  Slot& entry = m_slots[slot];
+  if(slot == m_freeHead){
+    m_freeHead = entry.index;
+  }
+  entry.generation++;
+  entry.index = static_cast<std::uint32_t>(m_values.Size() - 1);
+  return Handle{slot, entry.generation};
+}
+
+template<typename T, typename A>
+Aii::Expected<void, Aii::Error> Aii::SlotMap<T, A>::Erase(Handle handle) noexcept{
+  // destroys the value named by handle, moving the last dense value into
+  // its place. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - handle does not name a value of the map
+  //
+  // On error, the map is left in the state before the function call
+  if(!Occupied(handle)){
+    return {Aii::Error::OutOfRange};
+  }
+  Slot& entry = m_slots[handle.index];
+  std::uint32_t dense = entry.index;
+  std::uint32_t last = static_cast<std::uint32_t>(m_values.Size() - 1);
+  if(dense != last){
+    m_values[dense] = std::move(m_values[last]);
+    m_slotOf[dense] = m_slotOf[last];
+    m_slots[m_slotOf[dense]].index = dense;
+  }
+  m_values.PopBack();
+  m_slotOf.PopBack();
+  entry.generation++;
+  entry.index = m_freeHead;
+  m_freeHead = handle.index;
+  return {};
+}
+
+template<typename T, typename A>
+void Aii::SlotMap<T, A>::Clear() noexcept{
+  // destroys every value, invalidating every handle. O(Size())
+  for(std::uint32_t slot : m_slotOf){
+    m_slots[slot].generation++;
+    m_slots[slot].index = m_freeHead;
+    m_freeHead = slot;
+  }
+  m_values.Clear();
+  m_slotOf.Clear();
+}
+
+template<typename T, typename A>
+Aii::Expected<void, Aii::Error> Aii::SlotMap<T, A>::Reserve(std::size_t count) noexcept{
+  // allocates room for count values, so inserting up to count values
+  // allocates nothing more. O(Size())
+  //
+  // Possible Errors:
+  //  OutOfRange - count is more than the 32 bit slot indices can name
+  //  RuntimeError - allocation failed
+  //
+  // On error, the map keeps its values but may have reserved part of the
+  // room
+  if(count >= NoSlot){
+    return {Aii::Error::OutOfRange};
+  }
+  if(!m_values.Reserve(count) || !m_slotOf.Reserve(count) || !m_slots.Reserve(count)){
+    return {Aii::Error::RuntimeError};
+  }
+  return {};
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Growable contiguous array which holds up to N elements inside the object
+// itself, like Array<T, N>, and only allocates once it grows past them.
+//
+// The interface is that of Vector<T, A>. While Size() stays within N no
+// allocator function is ever called, so short lived vectors on the stack
+// cost no heap traffic. Past N the elements are relocated to an allocation
+// which grows geometrically, as in Vector, and ShrinkToFit() brings them
+// back inline once they fit again. The element operations are shared with
+// Vector (see aii/vector_base.hpp).
+//
+// Moving a SmallVector whose elements are inline relocates each of them,
+// so unlike Vector it is O(Size()) and invalidates pointers to elements.
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/relocate.hpp"
+#include "aii/vector_base.hpp"
+
+namespace Aii{
+
+template<typename T, std::size_t N, typename A = Aii::Allocator<T>>
+class SmallVector: public Details::VectorBase<T, A, Details::InlineStorage<T, N>>{
+  static_assert(Aii::IsAllocator<A>, "SmallVector: A must satisfy Aii::IsAllocator");
+  static_assert(N > 0, "SmallVector: N must be at least 1, use Vector otherwise");
+  static_assert(std::is_nothrow_move_constructible_v<T>, "SmallVector: elements must be nothrow move constructible");
+
+  private:
+    using Base = Details::VectorBase<T, A, Details::InlineStorage<T, N>>;
+    using typename Base::SlotAllocType;
+
+  public:
+    SmallVector() noexcept;
+    SmallVector(const SmallVector& src) noexcept = delete;
+    SmallVector(SmallVector&& src) noexcept;
+    SmallVector& operator=(const SmallVector& src) noexcept = delete;
+    SmallVector& operator=(SmallVector&& src) noexcept;
+
+    void Swap(SmallVector& other) noexcept;
+
+    // true while the elements are stored in the object itself
+    bool Inline() const noexcept{ return this->m_slots == this->m_inline;}
+
+  private:
+    void TakeElements(SmallVector& src) noexcept;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, std::size_t N, typename A>
+Aii::SmallVector<T, N, A>::SmallVector() noexcept
+  :
+    Base{SlotAllocType()}
+{
+
+}
+
+template<typename T, std::size_t N, typename A>
+Aii::SmallVector<T, N, A>::SmallVector(SmallVector&& src) noexcept
+  :
+    Base{std::move(src.m_allocator)}
+{
+  TakeElements(src);
+}
+
+template<typename T, std::size_t N, typename A>
+auto Aii::SmallVector<T, N, A>::operator=(SmallVector&& src) noexcept -> SmallVector&{
+  if(this != &src){
+    this->Clear();
+    this->Deallocate();
+    std::swap(this->m_allocator, src.m_allocator);
+    TakeElements(src);
+  }
+  return *this;
+}
+
+template<typename T, std::size_t N, typename A>
+void Aii::SmallVector<T, N, A>::TakeElements(SmallVector& src) noexcept{
+  // this must be empty and inline. Steals the allocation of src, or
+  // relocates its inline elements, leaving src empty and inline.
+  if(src.Inline()){
+    Details::Relocate(this->Elements(), src.Elements(), src.m_size);
+  }
+  else{
+    this->m_slots = src.m_slots;
+    this->m_capacity = src.m_capacity;
+    src.m_slots = src.m_inline;
+    src.m_capacity = N;
+  }
+  this->m_size = src.m_size;
+  src.m_size = 0;
+}
+
+template<typename T, std::size_t N, typename A>
+void Aii::SmallVector<T, N, A>::Swap(SmallVector& other) noexcept{
+  // O(Size() + other.Size()) when either is inline, O(1) otherwise
+  SmallVector tmp{std::move(other)};
+  other = std::move(*this);
+  *this = std::move(tmp);
+}
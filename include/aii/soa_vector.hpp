@@ -0,0 +1,455 @@
+#pragma once
+
+// Growable vector of records stored as a struct of arrays: each field of
+// the record type (Fields...) lives in its own contiguous column.
+//
+// A scan over one field then reads only that field's column, instead of
+// pulling whole records through the cache, and the column is a plain array
+// the compiler can vectorise a loop over. Column<I>() gives column I as a
+// Span, and operator[] gives a proxy for a whole record whose fields can be
+// read with Get<I>() or structured bindings:
+//
+//   Aii::SoaVector<TaskState, std::uint64_t> tasks;
+//   for(TaskState& state : tasks.Column<0>()){ ... }
+//   auto [state, runtime] = tasks[i];
+//
+// All columns share one allocation, each starting on its own cache line.
+// Growth doubles the capacity and relocates each column, with Memcpy for
+// trivially relocatable fields, as in Vector.
+//
+// The allocator is the first parameter of BasicSoaVector<A, Fields...>, as
+// Fields... must come last. SoaVector<Fields...> uses the default one.
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/concepts.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+#include "aii/relocate.hpp"
+#include "aii/span.hpp"
+
+namespace Aii{
+
+namespace Details{
+
+template<std::size_t I, typename T, typename ...Ts>
+struct TypeAt{
+  using Type = typename TypeAt<I - 1, Ts...>::Type;
+};
+
+template<typename T, typename ...Ts>
+struct TypeAt<0, T, Ts...>{
+  using Type = T;
+};
+
+// allocation unit of a SoaVector, so every column can start on a line
+struct alignas(CacheLineSize) SoaLine{
+  unsigned char bytes[CacheLineSize];
+};
+
+} // namespace Details
+
+// Proxy for record index of a SoaVector, referring to its fields in place.
+// Const proxies give const fields. A proxy stays valid while its record
+// stays at index, even if the vector reallocates.
+template<bool Const, typename ...Fields>
+class SoaReference{
+  public:
+    template<std::size_t I>
+    using FieldType = std::conditional_t<Const, const typename Details::TypeAt<I, Fields...>::Type,
+                                                typename Details::TypeAt<I, Fields...>::Type>;
+
+    SoaReference(void* const* columns, std::size_t index) noexcept: m_columns{columns}, m_index{index}{}
+
+    // a proxy converts to a const proxy
+    SoaReference(const SoaReference<false, Fields...>& src) noexcept requires Const
+      : m_columns{src.m_columns}, m_index{src.m_index}{}
+
+    std::size_t Index() const noexcept{ return m_index;}
+
+    template<std::size_t I>
+    FieldType<I>& Get() const noexcept{
+      using Field = typename Details::TypeAt<I, Fields...>::Type;
+      return std::launder(static_cast<Field*>(m_columns[I]))[m_index];
+    }
+
+    // lower case for structured bindings
+    template<std::size_t I>
+    FieldType<I>& get() const noexcept{ return Get<I>();}
+
+  private:
+    template<bool, typename ...>
+    friend class SoaReference;
+
+    void* const* m_columns;
+    std::size_t m_index;
+};
+
+template<typename A, typename ...Fields>
+class BasicSoaVector{
+  static_assert(Aii::IsAllocator<A>, "SoaVector: A must satisfy Aii::IsAllocator");
+  static_assert(sizeof...(Fields) > 0, "SoaVector: at least one field is needed");
+  static_assert((std::is_nothrow_move_constructible_v<Fields> && ...), "SoaVector: fields must be nothrow move constructible");
+  static_assert(((alignof(Fields) <= CacheLineSize) && ...), "SoaVector: fields must not be aligned past a cache line");
+
+  private:
+    using LineAllocType = typename A::template Rebind<Details::SoaLine>::other;
+
+    static constexpr std::size_t FieldCount = sizeof...(Fields);
+    static constexpr std::size_t MinCapacity = 16;
+
+  public:
+    template<std::size_t I>
+    using FieldType = typename Details::TypeAt<I, Fields...>::Type;
+
+    using Reference = SoaReference<false, Fields...>;
+    using ConstReference = SoaReference<true, Fields...>;
+
+    template<bool Const>
+    class BasicIterator{
+      public:
+        BasicIterator(void* const* columns, std::size_t index) noexcept: m_columns{columns}, m_index{index}{}
+
+        SoaReference<Const, Fields...> operator*() const noexcept{ return {m_columns, m_index};}
+
+        BasicIterator& operator++() noexcept{ m_index++; return *this;}
+        BasicIterator operator++(int) noexcept{ BasicIterator tmp = *this; m_index++; return tmp;}
+
+        constexpr bool operator==(const BasicIterator& rhs) const noexcept{ return m_index == rhs.m_index;}
+        constexpr bool operator!=(const BasicIterator& rhs) const noexcept{ return m_index != rhs.m_index;}
+
+      private:
+        void* const* m_columns;
+        std::size_t m_index;
+    };
+
+    using Iterator = BasicIterator<false>;
+    using ConstIterator = BasicIterator<true>;
+
+    BasicSoaVector() noexcept;
+    BasicSoaVector(const BasicSoaVector& src) noexcept = delete;
+    BasicSoaVector(BasicSoaVector&& src) noexcept;
+    BasicSoaVector& operator=(const BasicSoaVector& src) noexcept = delete;
+    BasicSoaVector& operator=(BasicSoaVector&& src) noexcept;
+    ~BasicSoaVector() noexcept;
+
+    void Swap(BasicSoaVector& other) noexcept;
+
+    bool Empty() const noexcept{ return m_size == 0;}
+    std::size_t Size() const noexcept{ return m_size;}
+    std::size_t Capacity() const noexcept{ return m_capacity;}
+
+    template<std::size_t I>
+    Span<FieldType<I>> Column() noexcept{ return {ColumnData<I>(), m_size};}
+    template<std::size_t I>
+    Span<const FieldType<I>> Column() const noexcept{ return {ColumnData<I>(), m_size};}
+
+    Reference operator[](std::size_t index) noexcept{ return {m_columns, index};}
+    ConstReference operator[](std::size_t index) const noexcept{ return {m_columns, index};}
+    Reference Back() noexcept{ return {m_columns, m_size - 1};}
+    ConstReference Back() const noexcept{ return {m_columns, m_size - 1};}
+
+    Iterator begin() noexcept{ return {m_columns, 0};}
+    Iterator end() noexcept{ return {m_columns, m_size};}
+    ConstIterator begin() const noexcept{ return {m_columns, 0};}
+    ConstIterator end() const noexcept{ return {m_columns, m_size};}
+
+    template<typename ...Args>
+      requires (sizeof...(Args) == sizeof...(Fields))
+    Aii::Expected<void, Error> EmplaceBack(Args&& ...args) noexcept;
+    Aii::Expected<void, Error> PushBack(const Fields& ...vals) noexcept{ return EmplaceBack(vals...);}
+
+    Aii::Expected<void, Error> PopBack() noexcept;
+    Aii::Expected<void, Error> Erase(std::size_t index) noexcept;
+    Aii::Expected<void, Error> EraseUnordered(std::size_t index) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> Reserve(std::size_t count) noexcept;
+    Aii::Expected<void, Error> ShrinkToFit() noexcept;
+
+  private:
+    template<std::size_t I>
+    FieldType<I>* ColumnData() const noexcept{ return std::launder(static_cast<FieldType<I>*>(m_columns[I]));}
+
+    static std::size_t AlignUp(std::size_t bytes) noexcept{ return (bytes + CacheLineSize - 1) & ~(CacheLineSize - 1);}
+    static std::size_t LinesFor(std::size_t capacity) noexcept;
+
+    std::size_t GrownCapacity(std::size_t count) const noexcept;
+    bool Reallocate(std::size_t capacity) noexcept;
+    void DestroyRow(std::size_t index) noexcept;
+    void Deallocate() noexcept;
+
+  private:
+    Details::SoaLine* m_lines;
+    void* m_columns[FieldCount];
+    std::size_t m_size;
+    std::size_t m_capacity;
+    LineAllocType m_allocator;
+};
+
+template<typename ...Fields>
+using SoaVector = BasicSoaVector<Aii::Allocator<Details::SoaLine>, Fields...>;
+
+} // namespace Aii
+
+// Records are tuple like, for structured bindings
+
+template<bool Const, typename ...Fields>
+struct std::tuple_size<Aii::SoaReference<Const, Fields...>>: std::integral_constant<std::size_t, sizeof...(Fields)>{};
+
+template<std::size_t I, bool Const, typename ...Fields>
+struct std::tuple_element<I, Aii::SoaReference<Const, Fields...>>{
+  using type = typename Aii::SoaReference<Const, Fields...>::template FieldType<I>&;
+};
+
+// Construction
+
+template<typename A, typename ...Fields>
+Aii::BasicSoaVector<A, Fields...>::BasicSoaVector() noexcept
+  :
+    m_lines{nullptr},
+    m_columns{},
+    m_size{0},
+    m_capacity{0},
+    m_allocator{LineAllocType()}
+{
+
+}
+
+template<typename A, typename ...Fields>
+Aii::BasicSoaVector<A, Fields...>::BasicSoaVector(BasicSoaVector&& src) noexcept
+  :
+    BasicSoaVector()
+{
+  Swap(src);
+}
+
+template<typename A, typename ...Fields>
+auto Aii::BasicSoaVector<A, Fields...>::operator=(BasicSoaVector&& src) noexcept -> BasicSoaVector&{
+  if(this != &src){
+    Clear();
+    Deallocate();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename A, typename ...Fields>
+Aii::BasicSoaVector<A, Fields...>::~BasicSoaVector() noexcept{
+  Clear();
+  Deallocate();
+}
+
+template<typename A, typename ...Fields>
+void Aii::BasicSoaVector<A, Fields...>::Swap(BasicSoaVector& other) noexcept{
+  std::swap(m_lines, other.m_lines);
+  for(std::size_t i = 0; i < FieldCount; i++){
+    std::swap(m_columns[i], other.m_columns[i]);
+  }
+  std::swap(m_size, other.m_size);
+  std::swap(m_capacity, other.m_capacity);
+  std::swap(m_allocator, other.m_allocator);
+}
+
+// Storage
+
+template<typename A, typename ...Fields>
+std::size_t Aii::BasicSoaVector<A, Fields...>::LinesFor(std::size_t capacity) noexcept{
+  // cache lines holding every column of capacity records
+  std::size_t bytes = (AlignUp(capacity * sizeof(Fields)) + ...);
+  return bytes / CacheLineSize;
+}
+
+template<typename A, typename ...Fields>
+std::size_t Aii::BasicSoaVector<A, Fields...>::GrownCapacity(std::size_t count) const noexcept{
+  // capacity to grow to when count records no longer fit
+  std::size_t capacity = m_capacity ? m_capacity * 2 : MinCapacity;
+  return capacity < count ? count : capacity;
+}
+
+template<typename A, typename ...Fields>
+bool Aii::BasicSoaVector<A, Fields...>::Reallocate(std::size_t capacity) noexcept{
+  // Relocates every column to new storage for capacity records, which must
+  // be at least Size(). Returns false if allocation failed, leaving the
+  // vector as it was.
+  Details::SoaLine* lines = nullptr;
+  void* columns[FieldCount] = {};
+  if(capacity){
+    lines = m_allocator.Allocate(LinesFor(capacity));
+    if(!lines){
+      return false;
+    }
+    unsigned char* next = lines->bytes;
+    [&]<std::size_t ...I>(std::index_sequence<I...>){
+      ((columns[I] = next, next += AlignUp(capacity * sizeof(FieldType<I>))), ...);
+      (Details::Relocate(static_cast<FieldType<I>*>(columns[I]), ColumnData<I>(), m_size), ...);
+    }(std::index_sequence_for<Fields...>{});
+  }
+  Deallocate();
+  m_lines = lines;
+  for(std::size_t i = 0; i < FieldCount; i++){
+    m_columns[i] = columns[i];
+  }
+  m_capacity = capacity;
+  return true;
+}
+
+template<typename A, typename ...Fields>
+void Aii::BasicSoaVector<A, Fields...>::DestroyRow(std::size_t index) noexcept{
+  [&]<std::size_t ...I>(std::index_sequence<I...>){
+    (std::destroy_at(ColumnData<I>() + index), ...);
+  }(std::index_sequence_for<Fields...>{});
+}
+
+template<typename A, typename ...Fields>
+void Aii::BasicSoaVector<A, Fields...>::Deallocate() noexcept{
+  // records must already be destroyed or relocated
+  if(m_lines){
+    m_allocator.Deallocate(m_lines, LinesFor(m_capacity));
+    m_lines = nullptr;
+    for(std::size_t i = 0; i < FieldCount; i++){
+      m_columns[i] = nullptr;
+    }
+    m_capacity = 0;
+  }
+}
+
+template<typename A, typename ...Fields>
+Aii::Expected<void, Aii::Error> Aii::BasicSoaVector<A, Fields...>::Reserve(std::size_t count) noexcept{
+  // sizes the columns so count records fit without reallocating. Never
+  // shrinks them. O(Size()) if it reallocates
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(count <= m_capacity){
+    return {};
+  }
+  if(!Reallocate(count)){
+    return {Aii::Error::RuntimeError};
+  }
+  return {};
+}
+
+template<typename A, typename ...Fields>
+Aii::Expected<void, Aii::Error> Aii::BasicSoaVector<A, Fields...>::ShrinkToFit() noexcept{
+  // reallocates the columns to exactly Size() records, freeing them when
+  // empty. O(Size())
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size == m_capacity){
+    return {};
+  }
+  if(!Reallocate(m_size)){
+    return {Aii::Error::RuntimeError};
+  }
+  return {};
+}
+
+// Modification
+
+template<typename A, typename ...Fields> template<typename ...Args>
+  requires (sizeof...(Args) == sizeof...(Fields))
+Aii::Expected<void, Aii::Error> Aii::BasicSoaVector<A, Fields...>::EmplaceBack(Args&& ...args) noexcept{
+  // appends a record whose fields are constructed from args, one argument
+  // per field. O(1) amortised
+  //
+  // Possible Errors:
+  //  RuntimeError - growing the columns failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size == m_capacity){
+    // args may refer to fields of a record, so they are read before the
+    // columns move
+    BasicSoaVector grown;
+    if(!grown.Reallocate(GrownCapacity(m_size + 1))){
+      return {Aii::Error::RuntimeError};
+    }
+    [&]<std::size_t ...I>(std::index_sequence<I...>){
+      (::new(static_cast<void*>(grown.template ColumnData<I>() + m_size)) FieldType<I>{std::forward<Args>(args)}, ...);
+      (Details::Relocate(grown.template ColumnData<I>(), ColumnData<I>(), m_size), ...);
+    }(std::index_sequence_for<Fields...>{});
+    grown.m_size = m_size + 1;
+    m_size = 0;
+    Swap(grown);
+    return {};
+  }
+  [&]<std::size_t ...I>(std::index_sequence<I...>){
+    (::new(static_cast<void*>(ColumnData<I>() + m_size)) FieldType<I>{std::forward<Args>(args)}, ...);
+  }(std::index_sequence_for<Fields...>{});
+  m_size++;
+  return {};
+}
+
+template<typename A, typename ...Fields>
+Aii::Expected<void, Aii::Error> Aii::BasicSoaVector<A, Fields...>::PopBack() noexcept{
+  // destroys the last record. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector is empty
+  if(m_size == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  m_size--;
+  DestroyRow(m_size);
+  return {};
+}
+
+template<typename A, typename ...Fields>
+Aii::Expected<void, Aii::Error> Aii::BasicSoaVector<A, Fields...>::Erase(std::size_t index) noexcept{
+  // destroys the record at index, shifting the records after it down by
+  // one. O(Size() - index)
+  //
+  // Possible Errors:
+  //  OutOfRange - index is not less than Size()
+  if(index >= m_size){
+    return {Aii::Error::OutOfRange};
+  }
+  DestroyRow(index);
+  [&]<std::size_t ...I>(std::index_sequence<I...>){
+    (Details::RelocateOverlapping(ColumnData<I>() + index, ColumnData<I>() + index + 1, m_size - index - 1), ...);
+  }(std::index_sequence_for<Fields...>{});
+  m_size--;
+  return {};
+}
+
+template<typename A, typename ...Fields>
+Aii::Expected<void, Aii::Error> Aii::BasicSoaVector<A, Fields...>::EraseUnordered(std::size_t index) noexcept{
+  // destroys the record at index and moves the last record into its place.
+  // O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - index is not less than Size()
+  if(index >= m_size){
+    return {Aii::Error::OutOfRange};
+  }
+  DestroyRow(index);
+  m_size--;
+  if(index != m_size){
+    [&]<std::size_t ...I>(std::index_sequence<I...>){
+      (Details::Relocate(ColumnData<I>() + index, ColumnData<I>() + m_size, 1), ...);
+    }(std::index_sequence_for<Fields...>{});
+  }
+  return {};
+}
+
+template<typename A, typename ...Fields>
+void Aii::BasicSoaVector<A, Fields...>::Clear() noexcept{
+  // destroys every record, keeping the storage. O(Size())
+  if constexpr(!(std::is_trivially_destructible_v<Fields> && ...)){
+    for(std::size_t i = 0; i < m_size; i++){
+      DestroyRow(i);
+    }
+  }
+  m_size = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// Non owning view of a contiguous run of elements
+
+#include <cstddef>
+#include <type_traits>
+
+namespace Aii{
+
+template<typename T>
+class Span{
+  public:
+    using ValueType = T;
+
+    constexpr Span() noexcept: m_data{nullptr}, m_size{0}{}
+    constexpr Span(T* data, std::size_t size) noexcept: m_data{data}, m_size{size}{}
+    template<std::size_t N>
+    constexpr Span(T (&array)[N]) noexcept: m_data{array}, m_size{N}{}
+
+    // a span of U converts to a span of const U
+    template<typename U>
+      requires (!std::is_const_v<U> && std::is_same_v<const U, T>)
+    constexpr Span(const Span<U>& src) noexcept: m_data{src.Data()}, m_size{src.Size()}{}
+
+    constexpr T* Data() const noexcept{ return m_data;}
+    constexpr std::size_t Size() const noexcept{ return m_size;}
+    constexpr bool Empty() const noexcept{ return m_size == 0;}
+
+    constexpr T* begin() const noexcept{ return m_data;}
+    constexpr T* end() const noexcept{ return m_data + m_size;}
+
+    constexpr T& operator[](std::size_t index) const noexcept{ return m_data[index];}
+    constexpr T& Front() const noexcept{ return m_data[0];}
+    constexpr T& Back() const noexcept{ return m_data[m_size - 1];}
+
+    // count must not exceed Size(), and offset + count must not either
+    constexpr Span First(std::size_t count) const noexcept{ return Span{m_data, count};}
+    constexpr Span Last(std::size_t count) const noexcept{ return Span{m_data + m_size - count, count};}
+    constexpr Span Subspan(std::size_t offset, std::size_t count) const noexcept{ return Span{m_data + offset, count};}
+
+  private:
+    T* m_data;
+    std::size_t m_size;
+};
+
+} // namespace Aii
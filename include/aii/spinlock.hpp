@@ -0,0 +1,445 @@
+#pragma once
+
+// Busy waiting mutual exclusion for short critical sections, where sleeping
+// costs more than spinning or is not possible at all.
+//
+// SpinLock is the smallest and fastest uncontended, but every waiter spins
+// on the one line, each release sends it to all of them, and which waiter
+// wins is arbitrary. The others trade a little of the uncontended path for
+// behaviour under contention:
+//
+//  * TicketLock grants the lock in arrival order. Waiters still share the
+//    line, but back off in proportion to their place in the queue.
+//
+//  * McsLock queues waiters on nodes they supply, each spinning on its own
+//    node, so a release touches only the next waiter's line.
+//
+//  * QueuedSpinLock is one word, like SpinLock, and takes the lock with a
+//    single compare and swap when it is free. The first waiter spins on the
+//    word, and any further ones queue MCS style on nodes on their own
+//    stacks, as in the Linux qspinlock.
+//
+// Passing true as the template argument makes a lock keep LockStats, read
+// with Stats(), at the price of a cycle counter read on each acquire and
+// release.
+
+#include <cstdint>
+
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+
+namespace Aii{
+
+struct LockStats{
+  std::uint64_t acquisitions;
+  // acquisitions which found the lock held
+  std::uint64_t contended;
+  // CpuRelax() calls while waiting, over all acquisitions
+  std::uint64_t spins;
+  // longest time the lock was held, in cpu cycle counter ticks, or 0 where
+  // the cpu has no cycle counter
+  std::uint64_t maxHoldCycles;
+};
+
+namespace Details{
+
+[[gnu::always_inline]] inline std::uint64_t ReadCycleCounter() noexcept{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+  std::uint64_t ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return 0;
+#endif
+}
+
+// Counts for LockStats, kept by the holder of the lock so plain fields do.
+// The disabled form is empty and its calls compile to nothing.
+template<bool Enabled>
+class LockStatsCounter{
+  public:
+    void Acquired(std::uint64_t) noexcept{}
+    void Released() noexcept{}
+};
+
+template<>
+class LockStatsCounter<true>{
+  public:
+    constexpr LockStatsCounter() noexcept: m_stats{}, m_acquiredAt{0}{}
+
+    void Acquired(std::uint64_t spins) noexcept{
+      m_stats.acquisitions++;
+      m_stats.contended += spins != 0;
+      m_stats.spins += spins;
+      m_acquiredAt = ReadCycleCounter();
+    }
+
+    void Released() noexcept{
+      std::uint64_t held = ReadCycleCounter() - m_acquiredAt;
+      if(held > m_stats.maxHoldCycles){
+        m_stats.maxHoldCycles = held;
+      }
+    }
+
+    const LockStats& Stats() const noexcept{ return m_stats;}
+    void Reset() noexcept{ m_stats = {};}
+
+  private:
+    LockStats m_stats;
+    std::uint64_t m_acquiredAt;
+};
+
+} // namespace Details
+
+// Test and test-and-set lock. Waiters spin on a plain load, so the line stays
+// shared until the holder releases it.
+class SpinLock{
+  public:
+    constexpr SpinLock() noexcept: m_locked{0}{}
+    SpinLock(const SpinLock& src) noexcept = delete;
+    SpinLock& operator=(const SpinLock& src) noexcept = delete;
+
+    void Lock() noexcept{
+      while(m_locked.Exchange(1, MemoryOrder::Acquire)){
+        while(m_locked.Load(MemoryOrder::Relaxed)){
+          CpuRelax();
+        }
+      }
+    }
+
+    bool TryLock() noexcept{
+      return !m_locked.Load(MemoryOrder::Relaxed) &&
+             !m_locked.Exchange(1, MemoryOrder::Acquire);
+    }
+
+    void Unlock() noexcept{
+      m_locked.Store(0, MemoryOrder::Release);
+    }
+
+    bool IsLocked() const noexcept{ return m_locked.Load(MemoryOrder::Relaxed) != 0;}
+
+  private:
+    Atomic<std::uint32_t> m_locked;
+};
+
+// First come, first served lock. Lock() draws a ticket and waits for the
+// owner count to reach it; Unlock() advances the owner count.
+template<bool CollectStats = false>
+class TicketLock{
+  public:
+    constexpr TicketLock() noexcept: m_next{0}, m_owner{0}, m_stats{}{}
+    TicketLock(const TicketLock& src) noexcept = delete;
+    TicketLock& operator=(const TicketLock& src) noexcept = delete;
+
+    void Lock() noexcept;
+    bool TryLock() noexcept;
+    void Unlock() noexcept;
+
+    bool IsLocked() const noexcept{
+      return m_next.Load(MemoryOrder::Relaxed) != m_owner.Load(MemoryOrder::Relaxed);
+    }
+
+    // only while holding the lock, or while no other cpu uses it
+    const LockStats& Stats() const noexcept requires CollectStats{ return m_stats.Stats();}
+    void ResetStats() noexcept requires CollectStats{ m_stats.Reset();}
+
+  private:
+    Atomic<std::uint32_t> m_next;
+    Atomic<std::uint32_t> m_owner;
+    [[no_unique_address]] Details::LockStatsCounter<CollectStats> m_stats;
+};
+
+// Mellor-Crummey and Scott queue lock. Each cpu passes a node of its own to
+// Lock() and the same node to the matching Unlock(), and the node must stay
+// put in between; McsLockGuard keeps one on the stack. Waiters spin on
+// their own node until the previous holder hands the lock over.
+template<bool CollectStats = false>
+class McsLock{
+  public:
+    struct alignas(CacheLineSize) Node{
+      Atomic<Node*> next;
+      Atomic<std::uint32_t> waiting;
+    };
+
+    constexpr McsLock() noexcept: m_tail{nullptr}, m_stats{}{}
+    McsLock(const McsLock& src) noexcept = delete;
+    McsLock& operator=(const McsLock& src) noexcept = delete;
+
+    void Lock(Node& node) noexcept;
+    bool TryLock(Node& node) noexcept;
+    void Unlock(Node& node) noexcept;
+
+    bool IsLocked() const noexcept{ return m_tail.Load(MemoryOrder::Relaxed) != nullptr;}
+
+    // only while holding the lock, or while no other cpu uses it
+    const LockStats& Stats() const noexcept requires CollectStats{ return m_stats.Stats();}
+    void ResetStats() noexcept requires CollectStats{ m_stats.Reset();}
+
+  private:
+    Atomic<Node*> m_tail;
+    [[no_unique_address]] Details::LockStatsCounter<CollectStats> m_stats;
+};
+
+// One word lock after the Linux qspinlock. The word holds a locked byte, a
+// pending bit and the tail of a queue of waiters:
+//
+//  * Lock() on a free lock swaps in the locked byte, and Unlock() clears it.
+//
+//  * The first waiter sets pending and spins on the word until the holder
+//    leaves, then swaps pending for locked. No queue node is touched.
+//
+//  * Later waiters queue MCS style on a node on their own stack. The waiter
+//    at the head of the queue spins on the word until locked and pending
+//    are clear; the others spin on their own node, so at most two cpus
+//    ever spin on the word.
+//
+// A node is only needed until its waiter takes the lock, so unlike McsLock
+// the holder keeps nothing and Lock() and Unlock() take no arguments.
+template<bool CollectStats = false>
+class QueuedSpinLock{
+  private:
+    struct Node{
+      Atomic<Node*> next;
+      Atomic<std::uint32_t> head;
+    };
+
+    static constexpr std::uint64_t Locked = 1;
+    static constexpr std::uint64_t Pending = 1 << 8;
+    static constexpr std::uint64_t LockedPendingMask = 0xFFFF;
+    static constexpr unsigned TailShift = 16;
+
+  public:
+    constexpr QueuedSpinLock() noexcept: m_word{0}, m_stats{}{}
+    QueuedSpinLock(const QueuedSpinLock& src) noexcept = delete;
+    QueuedSpinLock& operator=(const QueuedSpinLock& src) noexcept = delete;
+
+    void Lock() noexcept{
+      std::uint64_t val = 0;
+      if(m_word.CompareExchangeStrong(val, Locked, MemoryOrder::Acquire, MemoryOrder::Relaxed)){
+        m_stats.Acquired(0);
+        return;
+      }
+      LockSlow(val);
+    }
+
+    bool TryLock() noexcept{
+      std::uint64_t val = 0;
+      if(m_word.CompareExchangeStrong(val, Locked, MemoryOrder::Acquire, MemoryOrder::Relaxed)){
+        m_stats.Acquired(0);
+        return true;
+      }
+      return false;
+    }
+
+    void Unlock() noexcept{
+      m_stats.Released();
+      // the Linux lock stores 0 to the locked byte, but C++ has no atomic
+      // access to part of an atomic word, so it is subtracted instead
+      m_word.FetchSub(Locked, MemoryOrder::Release);
+    }
+
+    bool IsLocked() const noexcept{ return (m_word.Load(MemoryOrder::Relaxed) & Locked) != 0;}
+
+    // only while holding the lock, or while no other cpu uses it
+    const LockStats& Stats() const noexcept requires CollectStats{ return m_stats.Stats();}
+    void ResetStats() noexcept requires CollectStats{ m_stats.Reset();}
+
+  private:
+    void LockSlow(std::uint64_t val) noexcept;
+
+    static std::uint64_t PackTail(Node* node) noexcept{
+      return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(node)) << TailShift;
+    }
+    static Node* UnpackTail(std::uint64_t word) noexcept{
+      // the arithmetic shift restores the sign extended upper bits of
+      // canonical addresses
+      return reinterpret_cast<Node*>(static_cast<std::intptr_t>(static_cast<std::int64_t>(word) >> TailShift));
+    }
+
+  private:
+    Atomic<std::uint64_t> m_word;
+    [[no_unique_address]] Details::LockStatsCounter<CollectStats> m_stats;
+};
+
+// Holds a lock for the lifetime of the guard
+template<typename L>
+class LockGuard{
+  public:
+    explicit LockGuard(L& lock) noexcept: m_lock{lock}{ m_lock.Lock();}
+    LockGuard(const LockGuard& src) noexcept = delete;
+    LockGuard& operator=(const LockGuard& src) noexcept = delete;
+    ~LockGuard() noexcept{ m_lock.Unlock();}
+
+  private:
+    L& m_lock;
+};
+
+// Holds an McsLock for the lifetime of the guard, queueing on a node inside
+// the guard
+template<typename L>
+class McsLockGuard{
+  public:
+    explicit McsLockGuard(L& lock) noexcept: m_lock{lock}, m_node{}{ m_lock.Lock(m_node);}
+    McsLockGuard(const McsLockGuard& src) noexcept = delete;
+    McsLockGuard& operator=(const McsLockGuard& src) noexcept = delete;
+    ~McsLockGuard() noexcept{ m_lock.Unlock(m_node);}
+
+  private:
+    L& m_lock;
+    typename L::Node m_node;
+};
+
+} // namespace Aii
+
+// Aii::TicketLock
+
+template<bool CollectStats>
+void Aii::TicketLock<CollectStats>::Lock() noexcept{
+  std::uint32_t ticket = m_next.FetchAdd(1, MemoryOrder::Relaxed);
+  std::uint64_t spins = 0;
+  for(;;){
+    std::uint32_t owner = m_owner.Load(MemoryOrder::Acquire);
+    if(owner == ticket){
+      break;
+    }
+    // each holder ahead takes a while, so poll the shared line less the
+    // further back in the queue
+    for(std::uint32_t ahead = ticket - owner; ahead; ahead--){
+      CpuRelax();
+      spins++;
+    }
+  }
+  m_stats.Acquired(spins);
+}
+
+template<bool CollectStats>
+bool Aii::TicketLock<CollectStats>::TryLock() noexcept{
+  // the lock is free when no ticket beyond the owner's has been drawn; the
+  // owner count cannot move while it is
+  std::uint32_t owner = m_owner.Load(MemoryOrder::Acquire);
+  if(!m_next.CompareExchangeStrong(owner, owner + 1, MemoryOrder::Acquire, MemoryOrder::Relaxed)){
+    return false;
+  }
+  m_stats.Acquired(0);
+  return true;
+}
+
+template<bool CollectStats>
+void Aii::TicketLock<CollectStats>::Unlock() noexcept{
+  m_stats.Released();
+  // only the holder writes the owner count
+  m_owner.Store(m_owner.Load(MemoryOrder::Relaxed) + 1, MemoryOrder::Release);
+}
+
+// Aii::McsLock
+
+template<bool CollectStats>
+void Aii::McsLock<CollectStats>::Lock(Node& node) noexcept{
+  node.next.Store(nullptr, MemoryOrder::Relaxed);
+  node.waiting.Store(1, MemoryOrder::Relaxed);
+  // the exchange releases the node's fields to the cpu which links it in
+  Node* prev = m_tail.Exchange(&node, MemoryOrder::AcqRel);
+  std::uint64_t spins = 0;
+  if(prev){
+    prev->next.Store(&node, MemoryOrder::Release);
+    while(node.waiting.Load(MemoryOrder::Acquire)){
+      CpuRelax();
+      spins++;
+    }
+  }
+  m_stats.Acquired(spins);
+}
+
+template<bool CollectStats>
+bool Aii::McsLock<CollectStats>::TryLock(Node& node) noexcept{
+  node.next.Store(nullptr, MemoryOrder::Relaxed);
+  node.waiting.Store(0, MemoryOrder::Relaxed);
+  Node* expected = nullptr;
+  if(!m_tail.CompareExchangeStrong(expected, &node, MemoryOrder::AcqRel, MemoryOrder::Relaxed)){
+    return false;
+  }
+  m_stats.Acquired(0);
+  return true;
+}
+
+template<bool CollectStats>
+void Aii::McsLock<CollectStats>::Unlock(Node& node) noexcept{
+  m_stats.Released();
+  Node* next = node.next.Load(MemoryOrder::Acquire);
+  if(!next){
+    // no successor yet: leave the queue empty, unless one is between its
+    // exchange of the tail and linking itself behind node
+    Node* expected = &node;
+    if(m_tail.CompareExchangeStrong(expected, nullptr, MemoryOrder::Release, MemoryOrder::Relaxed)){
+      return;
+    }
+    while(!(next = node.next.Load(MemoryOrder::Acquire))){
+      CpuRelax();
+    }
+  }
+  next->waiting.Store(0, MemoryOrder::Release);
+}
+
+// Aii::QueuedSpinLock
+
+template<bool CollectStats>
+void Aii::QueuedSpinLock<CollectStats>::LockSlow(std::uint64_t val) noexcept{
+  std::uint64_t spins = 0;
+  if(!(val & ~Locked)){
+    // held, with no one waiting: become the pending waiter
+    val = m_word.FetchOr(Pending, MemoryOrder::Acquire);
+    if(!(val & ~Locked)){
+      while(m_word.Load(MemoryOrder::Acquire) & Locked){
+        CpuRelax();
+        spins++;
+      }
+      // nobody else may take the lock while pending is set, but the tail
+      // may change, so pending is swapped for locked in one addition
+      m_word.FetchAdd(Locked - Pending, MemoryOrder::Relaxed);
+      m_stats.Acquired(spins);
+      return;
+    }
+    // lost to another pending waiter or a queue; undo our own bit only
+    if(!(val & Pending)){
+      m_word.FetchAnd(~Pending, MemoryOrder::Relaxed);
+    }
+  }
+
+  Node node;
+  node.next.Store(nullptr, MemoryOrder::Relaxed);
+  node.head.Store(0, MemoryOrder::Relaxed);
+  val = m_word.Load(MemoryOrder::Relaxed);
+  while(!m_word.CompareExchangeWeak(val, (val & LockedPendingMask) | PackTail(&node),
+                                    MemoryOrder::AcqRel, MemoryOrder::Relaxed)){
+    CpuRelax();
+  }
+  if(Node* prev = UnpackTail(val)){
+    prev->next.Store(&node, MemoryOrder::Release);
+    while(!node.head.Load(MemoryOrder::Acquire)){
+      CpuRelax();
+      spins++;
+    }
+  }
+
+  // at the head of the queue; wait out the holder and the pending waiter
+  while((val = m_word.Load(MemoryOrder::Acquire)) & LockedPendingMask){
+    CpuRelax();
+    spins++;
+  }
+  // last in the queue: take the lock and empty the queue at once
+  if(UnpackTail(val) == &node &&
+     m_word.CompareExchangeStrong(val, Locked, MemoryOrder::Acquire, MemoryOrder::Relaxed)){
+    m_stats.Acquired(spins);
+    return;
+  }
+  // others queued behind; with the tail set no one else may take the lock
+  m_word.FetchOr(Locked, MemoryOrder::Relaxed);
+  Node* next;
+  while(!(next = node.next.Load(MemoryOrder::Acquire))){
+    CpuRelax();
+  }
+  next->head.Store(1, MemoryOrder::Release);
+  m_stats.Acquired(spins);
+}
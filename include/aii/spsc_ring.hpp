@@ -0,0 +1,219 @@
+#pragma once
+
+// Bounded single producer, single consumer queue.
+//
+// The N slots live inside the ring, so it never allocates, and neither end
+// ever waits on the other: a push into a full ring or a pop from an empty
+// one fails at once. That makes it usable from interrupt context, to hand
+// work from a handler to a thread, provided at most one context pushes and
+// at most one pops at any time.
+//
+// The producer owns the tail index and the consumer the head index. Each
+// sits on its own cache line next to the owner's cached copy of the other
+// index, so the line of the other side is only read when the cached copy
+// shows too little room (or too few elements) for the call. Indices run
+// freely and are reduced modulo N, a power of two, when a slot is
+// addressed. A release store of an index publishes the slots written
+// before it, and the acquire load on the other side makes them visible.
+//
+// PushN and PopN move a batch of elements with a single index update,
+// which amortises the cache line transfer over the batch.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+
+namespace Aii{
+
+template<typename T, std::size_t N>
+class SpscRing{
+  static_assert(N != 0 && (N & (N - 1)) == 0, "SpscRing: capacity must be a power of two");
+  static_assert(std::is_nothrow_move_constructible_v<T>, "SpscRing: elements must be nothrow move constructible");
+
+  private:
+    static constexpr std::size_t Mask = N - 1;
+
+    struct alignas(T) Slot{
+      unsigned char bytes[sizeof(T)];
+    };
+
+  public:
+    using ValueType = T;
+
+    SpscRing() noexcept;
+    SpscRing(const SpscRing& src) noexcept = delete;
+    SpscRing& operator=(const SpscRing& src) noexcept = delete;
+    ~SpscRing() noexcept;
+
+    static constexpr std::size_t Capacity() noexcept{ return N;}
+
+    // exact only when called from one of the two ends with the other idle
+    std::size_t Size() const noexcept;
+    bool Empty() const noexcept{ return Size() == 0;}
+
+    // producer side
+    template<typename ...Args>
+    Aii::Expected<void, Error> Emplace(Args&& ...args) noexcept;
+    Aii::Expected<void, Error> Push(const T& val) noexcept{ return Emplace(val);}
+    Aii::Expected<void, Error> Push(T&& val) noexcept{ return Emplace(std::move(val));}
+    std::size_t PushN(const T* src, std::size_t count) noexcept;
+
+    // consumer side
+    Aii::Expected<T, Error> Pop() noexcept;
+    std::size_t PopN(T* dest, std::size_t count) noexcept;
+
+  private:
+    T* At(std::size_t index) noexcept{ return std::launder(reinterpret_cast<T*>(&m_slots[index & Mask]));}
+    std::size_t Free(std::size_t tail, std::size_t wanted) noexcept;
+    std::size_t Available(std::size_t head, std::size_t wanted) noexcept;
+
+  private:
+    // written by the consumer
+    alignas(CacheLineSize) Atomic<std::size_t> m_head;
+    std::size_t m_cachedTail;
+    // written by the producer
+    alignas(CacheLineSize) Atomic<std::size_t> m_tail;
+    std::size_t m_cachedHead;
+    alignas(CacheLineSize) Slot m_slots[N];
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, std::size_t N>
+Aii::SpscRing<T, N>::SpscRing() noexcept
+  :
+    m_head{0},
+    m_cachedTail{0},
+    m_tail{0},
+    m_cachedHead{0}
+{
+
+}
+
+template<typename T, std::size_t N>
+Aii::SpscRing<T, N>::~SpscRing() noexcept{
+  if constexpr(!std::is_trivially_destructible_v<T>){
+    std::size_t tail = m_tail.Load(MemoryOrder::Relaxed);
+    for(std::size_t index = m_head.Load(MemoryOrder::Relaxed); index != tail; index++){
+      At(index)->~T();
+    }
+  }
+}
+
+template<typename T, std::size_t N>
+std::size_t Aii::SpscRing<T, N>::Size() const noexcept{
+  std::size_t head = m_head.Load(MemoryOrder::Acquire);
+  std::size_t tail = m_tail.Load(MemoryOrder::Acquire);
+  return tail - head;
+}
+
+// Producer
+
+template<typename T, std::size_t N>
+std::size_t Aii::SpscRing<T, N>::Free(std::size_t tail, std::size_t wanted) noexcept{
+  // slots the producer may fill, rereading the head only when the cached
+  // copy shows fewer than wanted
+  std::size_t free = N - (tail - m_cachedHead);
+  if(free < wanted){
+    m_cachedHead = m_head.Load(MemoryOrder::Acquire);
+    free = N - (tail - m_cachedHead);
+  }
+  return free;
+}
+
+template<typename T, std::size_t N> template<typename ...Args>
+Aii::Expected<void, Aii::Error> Aii::SpscRing<T, N>::Emplace(Args&& ...args) noexcept{
+  // constructs an element from args at the tail. O(1), never waits
+  //
+  // Possible Errors:
+  //  OutOfRange - the ring is full
+  //
+  // On error, the ring is left in the state before the function call
+  std::size_t tail = m_tail.Load(MemoryOrder::Relaxed);
+  if(Free(tail, 1) == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  ::new(static_cast<void*>(&m_slots[tail & Mask])) T{std::forward<Args>(args)...};
+  m_tail.Store(tail + 1, MemoryOrder::Release);
+  return {};
+}
+
+template<typename T, std::size_t N>
+std::size_t Aii::SpscRing<T, N>::PushN(const T* src, std::size_t count) noexcept{
+  // copies up to count elements from src to the tail, publishing them
+  // together. Returns how many fit. O(count), never waits
+  std::size_t tail = m_tail.Load(MemoryOrder::Relaxed);
+  std::size_t free = Free(tail, count);
+  if(count > free){
+    count = free;
+  }
+  for(std::size_t i = 0; i < count; i++){
+    ::new(static_cast<void*>(&m_slots[(tail + i) & Mask])) T{src[i]};
+  }
+  if(count){
+    m_tail.Store(tail + count, MemoryOrder::Release);
+  }
+  return count;
+}
+
+// Consumer
+
+template<typename T, std::size_t N>
+std::size_t Aii::SpscRing<T, N>::Available(std::size_t head, std::size_t wanted) noexcept{
+  // elements the consumer may take, rereading the tail only when the cached
+  // copy shows fewer than wanted
+  std::size_t available = m_cachedTail - head;
+  if(available < wanted){
+    m_cachedTail = m_tail.Load(MemoryOrder::Acquire);
+    available = m_cachedTail - head;
+  }
+  return available;
+}
+
+template<typename T, std::size_t N>
+Aii::Expected<T, Aii::Error> Aii::SpscRing<T, N>::Pop() noexcept{
+  // removes the element at the head. O(1), never waits
+  //
+  // Possible Errors:
+  //  OutOfRange - the ring is empty
+  //
+  // On error, the ring is left in the state before the function call
+  std::size_t head = m_head.Load(MemoryOrder::Relaxed);
+  if(Available(head, 1) == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  T* element = At(head);
+  Aii::Expected<T, Error> result{std::move(*element)};
+  element->~T();
+  m_head.Store(head + 1, MemoryOrder::Release);
+  return result;
+}
+
+template<typename T, std::size_t N>
+std::size_t Aii::SpscRing<T, N>::PopN(T* dest, std::size_t count) noexcept{
+  // moves up to count elements from the head into dest, releasing their
+  // slots together. Returns how many were taken. O(count), never waits
+  std::size_t head = m_head.Load(MemoryOrder::Relaxed);
+  std::size_t available = Available(head, count);
+  if(count > available){
+    count = available;
+  }
+  for(std::size_t i = 0; i < count; i++){
+    T* element = At(head + i);
+    dest[i] = std::move(*element);
+    element->~T();
+  }
+  if(count){
+    m_head.Store(head + count, MemoryOrder::Release);
+  }
+  return count;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+// Sleepable read-copy-update domain: readers mark the span in which they
+// hold pointers into a shared structure, and a writer which has unlinked
+// something waits in Synchronize() until every reader that could still see
+// it has left.
+//
+// Readers never wait. Each increments and decrements a counter for the
+// current epoch, spread over Slots cache lines picked from the reader's
+// stack address so threads rarely share one. Synchronize() flips the epoch
+// and waits for the old epoch's counters to drain, twice, as a reader may
+// have read the epoch just before a flip and counted itself just after.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/hash.hpp"
+#include "aii/spinlock.hpp"
+
+namespace Aii{
+
+template<std::size_t Slots = 16>
+class Srcu{
+  static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "Srcu: Slots must be a power of two");
+
+  public:
+    // returned by ReadLock and passed back to the matching ReadUnlock
+    struct ReadToken{
+      std::uint32_t slot;
+      std::uint32_t epoch;
+    };
+
+    constexpr Srcu() noexcept: m_counters{}, m_epoch{0}, m_syncLock{}{}
+    Srcu(const Srcu& src) noexcept = delete;
+    Srcu& operator=(const Srcu& src) noexcept = delete;
+
+    ReadToken ReadLock() noexcept;
+    void ReadUnlock(ReadToken token) noexcept;
+    void Synchronize() noexcept;
+
+  private:
+    struct alignas(CacheLineSize) Counter{
+      Atomic<std::uint64_t> readers[2];
+    };
+
+    std::uint64_t Readers(std::uint32_t epoch) const noexcept;
+
+  private:
+    Counter m_counters[Slots];
+    Atomic<std::uint32_t> m_epoch;
+    SpinLock m_syncLock;
+};
+
+// Read side section for the lifetime of the guard
+template<typename Domain>
+class SrcuReadGuard{
+  public:
+    explicit SrcuReadGuard(Domain& domain) noexcept: m_domain{domain}, m_token{domain.ReadLock()}{}
+    SrcuReadGuard(const SrcuReadGuard& src) noexcept = delete;
+    SrcuReadGuard& operator=(const SrcuReadGuard& src) noexcept = delete;
+    ~SrcuReadGuard() noexcept{ m_domain.ReadUnlock(m_token);}
+
+  private:
+    Domain& m_domain;
+    typename Domain::ReadToken m_token;
+};
+
+} // namespace Aii
+
+template<std::size_t Slots>
+auto Aii::Srcu<Slots>::ReadLock() noexcept -> ReadToken{
+  // The increment is a full barrier, so loads in the section cannot move
+  // above it and a Synchronize() which missed it ran entirely before them.
+  char marker;
+  std::uint64_t stack = reinterpret_cast<std::uintptr_t>(&marker) >> 12;
+  ReadToken token;
+  token.slot = static_cast<std::uint32_t>(Details::HashMix64(stack) & (Slots - 1));
+  token.epoch = m_epoch.Load(MemoryOrder::Relaxed) & 1;
+  m_counters[token.slot].readers[token.epoch].FetchAdd(1, MemoryOrder::SeqCst);
+  return token;
+}
+
+template<std::size_t Slots>
+void Aii::Srcu<Slots>::ReadUnlock(ReadToken token) noexcept{
+  m_counters[token.slot].readers[token.epoch].FetchSub(1, MemoryOrder::Release);
+}
+
+template<std::size_t Slots>
+std::uint64_t Aii::Srcu<Slots>::Readers(std::uint32_t epoch) const noexcept{
+  std::uint64_t readers = 0;
+  for(const Counter& counter : m_counters){
+    readers += counter.readers[epoch].Load(MemoryOrder::Acquire);
+  }
+  return readers;
+}
+
+template<std::size_t Slots>
+void Aii::Srcu<Slots>::Synchronize() noexcept{
+  // Waits until every read side section which began before the call has
+  // ended. Must not be called from inside one.
+  LockGuard guard{m_syncLock};
+  ThreadFence(MemoryOrder::SeqCst);
+  for(int flip = 0; flip < 2; flip++){
+    std::uint32_t epoch = m_epoch.Load(MemoryOrder::Relaxed);
+    m_epoch.Store(epoch + 1, MemoryOrder::SeqCst);
+    while(Readers(epoch & 1) != 0){
+      CpuRelax();
+    }
+  }
+  ThreadFence(MemoryOrder::SeqCst);
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+// Growable contiguous array whose elements never move.
+//
+// On first use the vector reserves address space for MaxSize() elements,
+// with no memory behind it, and grows by committing pages at the end of the
+// elements in use. Growing therefore never copies, and a pointer to an
+// element stays valid for as long as the element exists, while indexing is
+// still a single offset from one base address.
+//
+// Commits start at 64 KB and double up to 2 MB, so a vector of several GB
+// makes a few thousand commit calls over its life. ShrinkToFit() decommits
+// the whole pages past the last element, keeping the address space.
+//
+// Requires the virtual memory stubs in stubs.hpp (ReserveVirtual, Commit,
+// Decommit, ReleaseVirtual and PageSize).
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+#include "aii/stubs.hpp"
+
+namespace Aii{
+
+template<typename T>
+class StableVector{
+  static_assert(alignof(T) <= 4096, "StableVector: elements must not be aligned past a page");
+
+  private:
+    static constexpr std::size_t DefaultReserveBytes = sizeof(void*) >= 8 ? std::size_t{1} << 36 : std::size_t{1} << 28;
+    static constexpr std::size_t MinCommitBytes = std::size_t{1} << 16;
+    static constexpr std::size_t MaxCommitBytes = std::size_t{1} << 21;
+
+  public:
+    using ValueType = T;
+
+    // maxSize elements are reserved on first use, by default 64 GB worth on
+    // 64 bit targets
+    explicit StableVector(std::size_t maxSize = DefaultReserveBytes / sizeof(T)) noexcept;
+    StableVector(const StableVector& src) noexcept = delete;
+    StableVector(StableVector&& src) noexcept;
+    StableVector& operator=(const StableVector& src) noexcept = delete;
+    StableVector& operator=(StableVector&& src) noexcept;
+    ~StableVector() noexcept;
+
+    void Swap(StableVector& other) noexcept;
+
+    bool Empty() const noexcept{ return m_size == 0;}
+    std::size_t Size() const noexcept{ return m_size;}
+    // elements which fit in the committed memory
+    std::size_t Capacity() const noexcept{ return m_committed / sizeof(T);}
+    std::size_t MaxSize() const noexcept{ return m_maxSize;}
+
+    T* Data() noexcept{ return m_data;}
+    const T* Data() const noexcept{ return m_data;}
+
+    T* begin() noexcept{ return m_data;}
+    T* end() noexcept{ return m_data + m_size;}
+    const T* begin() const noexcept{ return m_data;}
+    const T* end() const noexcept{ return m_data + m_size;}
+
+    T& operator[](std::size_t index) noexcept{ return m_data[index];}
+    const T& operator[](std::size_t index) const noexcept{ return m_data[index];}
+    T& Front() noexcept{ return m_data[0];}
+    const T& Front() const noexcept{ return m_data[0];}
+    T& Back() noexcept{ return m_data[m_size - 1];}
+    const T& Back() const noexcept{ return m_data[m_size - 1];}
+
+    template<typename ...Args>
+    Aii::Expected<T*, Error> EmplaceBack(Args&& ...args) noexcept;
+    Aii::Expected<T*, Error> PushBack(const T& val) noexcept{ return EmplaceBack(val);}
+    Aii::Expected<T*, Error> PushBack(T&& val) noexcept{ return EmplaceBack(std::move(val));}
+
+    Aii::Expected<void, Error> PopBack() noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> Resize(std::size_t count) noexcept;
+    Aii::Expected<void, Error> Reserve(std::size_t count) noexcept;
+    void ShrinkToFit() noexcept;
+
+  private:
+    static std::size_t PageAlign(std::size_t bytes) noexcept;
+    std::size_t ReservedBytes() const noexcept{ return PageAlign(m_maxSize * sizeof(T));}
+    Aii::Expected<void, Error> CommitFor(std::size_t count) noexcept;
+    void DestroyFrom(std::size_t first) noexcept;
+    void Release() noexcept;
+
+  private:
+    T* m_data;
+    std::size_t m_size;
+    std::size_t m_maxSize;
+    // bytes committed from m_data
+    std::size_t m_committed;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T>
+Aii::StableVector<T>::StableVector(std::size_t maxSize) noexcept
+  :
+    m_data{nullptr},
+    m_size{0},
+    m_maxSize{maxSize},
+    m_committed{0}
+{
+
+}
+
+template<typename T>
+Aii::StableVector<T>::StableVector(StableVector&& src) noexcept
+  :
+    m_data{src.m_data},
+    m_size{src.m_size},
+    m_maxSize{src.m_maxSize},
+    m_committed{src.m_committed}
+{
+  src.m_data = nullptr;
+  src.m_size = 0;
+  src.m_committed = 0;
+}
+
+template<typename T>
+auto Aii::StableVector<T>::operator=(StableVector&& src) noexcept -> StableVector&{
+  if(this != &src){
+    Clear();
+    Release();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename T>
+Aii::StableVector<T>::~StableVector() noexcept{
+  Clear();
+  Release();
+}
+
+template<typename T>
+void Aii::StableVector<T>::Swap(StableVector& other) noexcept{
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+  std::swap(m_maxSize, other.m_maxSize);
+  std::swap(m_committed, other.m_committed);
+}
+
+// Storage
+
+template<typename T>
+std::size_t Aii::StableVector<T>::PageAlign(std::size_t bytes) noexcept{
+  std::size_t page = Details::PageSize();
+  return (bytes + page - 1) / page * page;
+}
+
+template<typename T>
+Aii::Expected<void, Aii::Error> Aii::StableVector<T>::CommitFor(std::size_t count) noexcept{
+  // Commits memory for at least count elements, reserving the address
+  // space first if this is the first use. count must not exceed MaxSize().
+  //
+  // Possible Errors:
+  //  InvalidArgument - MaxSize() elements do not fit in the address space
+  //  RuntimeError - reserving or committing memory failed
+  //
+  // On error, the vector is left in the state before the function call
+  std::size_t needed = count * sizeof(T);
+  if(needed <= m_committed){
+    return {};
+  }
+  if(!m_data){
+    // ReservedBytes() rounds up to a page, which must not overflow either
+    if(m_maxSize > (~std::size_t{0} - Details::PageSize()) / sizeof(T)){
+      return {Aii::Error::InvalidArgument};
+    }
+    void* base = Details::ReserveVirtual(ReservedBytes());
+    if(!base){
+      return {Aii::Error::RuntimeError};
+    }
+    m_data = static_cast<T*>(base);
+  }
+  std::size_t step = m_committed < MinCommitBytes ? MinCommitBytes
+                   : m_committed > MaxCommitBytes ? MaxCommitBytes : m_committed;
+  std::size_t target = m_committed + step < needed ? needed : m_committed + step;
+  target = PageAlign(target);
+  if(target > ReservedBytes()){
+    target = ReservedBytes();
+  }
+  unsigned char* base = reinterpret_cast<unsigned char*>(m_data);
+  if(!Details::Commit(base + m_committed, target - m_committed)){
+    if(m_committed == 0){
+      Release();
+    }
+    return {Aii::Error::RuntimeError};
+  }
+  m_committed = target;
+  return {};
+}
+
+template<typename T>
+void Aii::StableVector<T>::DestroyFrom(std::size_t first) noexcept{
+  if constexpr(!std::is_trivially_destructible_v<T>){
+    for(std::size_t i = first; i < m_size; i++){
+      m_data[i].~T();
+    }
+  }
+  m_size = first;
+}
+
+template<typename T>
+void Aii::StableVector<T>::Release() noexcept{
+  // elements must already be destroyed
+  if(m_data){
+    Details::ReleaseVirtual(m_data, ReservedBytes());
+    m_data = nullptr;
+    m_committed = 0;
+  }
+}
+
+template<typename T>
+Aii::Expected<void, Aii::Error> Aii::StableVector<T>::Reserve(std::size_t count) noexcept{
+  // commits memory so count elements fit without committing more. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - count is greater than MaxSize()
+  //  InvalidArgument - MaxSize() elements do not fit in the address space
+  //  RuntimeError - reserving or committing memory failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(count > m_maxSize){
+    return {Aii::Error::OutOfRange};
+  }
+  auto res = CommitFor(count);
+  if(!res){
+    return {Aii::Error{res.Error()}};
+  }
+  return {};
+}
+
+template<typename T>
+void Aii::StableVector<T>::ShrinkToFit() noexcept{
+  // decommits the whole pages after the last element, releasing the
+  // address space as well when empty
+  if(m_size == 0){
+    Release();
+    return;
+  }
+  std::size_t keep = PageAlign(m_size * sizeof(T));
+  if(keep < m_committed){
+    unsigned char* base = reinterpret_cast<unsigned char*>(m_data);
+    Details::Decommit(base + keep, m_committed - keep);
+    m_committed = keep;
+  }
+}
+
+// Modification
+
+template<typename T> template<typename ...Args>
+Aii::Expected<T*, Aii::Error> Aii::StableVector<T>::EmplaceBack(Args&& ...args) noexcept{
+  // constructs an element from args after the last. O(1) amortised, and
+  // no element is moved
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector holds MaxSize() elements
+  //  InvalidArgument - MaxSize() elements do not fit in the address space
+  //  RuntimeError - reserving or committing memory failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size == m_maxSize){
+    return {Aii::Error::OutOfRange};
+  }
+  auto res = CommitFor(m_size + 1);
+  if(!res){
+    return {Aii::Error{res.Error()}};
+  }
+  T* element = ::new(static_cast<void*>(m_data + m_size)) T{std::forward<Args>(args)...};
+  m_size++;
+  return element;
+}
+
+template<typename T>
+Aii::Expected<void, Aii::Error> Aii::StableVector<T>::PopBack() noexcept{
+  // destroys the last element. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector is empty
+  if(m_size == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  DestroyFrom(m_size - 1);
+  return {};
+}
+
+template<typename T>
+void Aii::StableVector<T>::Clear() noexcept{
+  // destroys every element, keeping the committed memory. O(Size())
+  DestroyFrom(0);
+}
+
+template<typename T>
+Aii::Expected<void, Aii::Error> Aii::StableVector<T>::Resize(std::size_t count) noexcept{
+  // destroys the elements from count onwards, or value initialises new ones
+  // up to count. O(|count - Size()|)
+  //
+  // Possible Errors:
+  //  OutOfRange - count is greater than MaxSize()
+  //  InvalidArgument - MaxSize() elements do not fit in the address space
+  //  RuntimeError - reserving or committing memory failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(count <= m_size){
+    DestroyFrom(count);
+    return {};
+  }
+  if(count > m_maxSize){
+    return {Aii::Error::OutOfRange};
+  }
+  auto res = CommitFor(count);
+  if(!res){
+    return {Aii::Error{res.Error()}};
+  }
+  for(; m_size < count; m_size++){
+    ::new(static_cast<void*>(m_data + m_size)) T{};
+  }
+  return {};
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+// Fixed capacity vector: room for N elements inside the object, of which
+// the first Size() are constructed.
+//
+// Unlike Array<T, N>, unused slots hold no object, so T needs no default
+// constructor and nothing is constructed until it is added. StaticVector
+// never allocates, which makes it usable where the heap is not, such as
+// interrupt handlers, and every operation is constexpr, so tables can be
+// built with it at compile time. A StaticVector which is itself a constant
+// needs trivially default constructible elements.
+//
+// For trivially copyable T the StaticVector itself is trivially copyable.
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+#include "aii/relocate.hpp"
+
+namespace Aii{
+
+template<typename T, std::size_t N>
+class StaticVector{
+  static_assert(std::is_nothrow_move_constructible_v<T>, "StaticVector: elements must be nothrow move constructible");
+  static_assert(N > 0, "StaticVector: N must be at least 1");
+
+  private:
+    // the first Size() elements are alive, the rest are raw storage
+    union Storage{
+      constexpr Storage() noexcept{}
+      constexpr ~Storage() noexcept requires std::is_trivially_destructible_v<T> = default;
+      constexpr ~Storage() noexcept{}
+
+      T elements[N];
+    };
+
+  public:
+    using ValueType = T;
+
+    constexpr StaticVector() noexcept;
+    constexpr StaticVector(const StaticVector& src) noexcept requires std::is_trivially_copy_constructible_v<T> = default;
+    constexpr StaticVector(const StaticVector& src) noexcept;
+    constexpr StaticVector(StaticVector&& src) noexcept requires std::is_trivially_move_constructible_v<T> = default;
+    constexpr StaticVector(StaticVector&& src) noexcept;
+    constexpr StaticVector& operator=(const StaticVector& src) noexcept
+      requires std::is_trivially_copyable_v<T> = default;
+    constexpr StaticVector& operator=(const StaticVector& src) noexcept;
+    constexpr StaticVector& operator=(StaticVector&& src) noexcept
+      requires std::is_trivially_copyable_v<T> = default;
+    constexpr StaticVector& operator=(StaticVector&& src) noexcept;
+    constexpr ~StaticVector() noexcept requires std::is_trivially_destructible_v<T> = default;
+    constexpr ~StaticVector() noexcept{ Clear();}
+
+    constexpr bool Empty() const noexcept{ return m_size == 0;}
+    constexpr bool Full() const noexcept{ return m_size == N;}
+    constexpr std::size_t Size() const noexcept{ return m_size;}
+    static constexpr std::size_t Capacity() noexcept{ return N;}
+
+    constexpr T* Data() noexcept{ return m_storage.elements;}
+    constexpr const T* Data() const noexcept{ return m_storage.elements;}
+
+    constexpr T* begin() noexcept{ return Data();}
+    constexpr T* end() noexcept{ return Data() + m_size;}
+    constexpr const T* begin() const noexcept{ return Data();}
+    constexpr const T* end() const noexcept{ return Data() + m_size;}
+
+    constexpr T& operator[](std::size_t index) noexcept{ return m_storage.elements[index];}
+    constexpr const T& operator[](std::size_t index) const noexcept{ return m_storage.elements[index];}
+    constexpr T& Front() noexcept{ return m_storage.elements[0];}
+    constexpr const T& Front() const noexcept{ return m_storage.elements[0];}
+    constexpr T& Back() noexcept{ return m_storage.elements[m_size - 1];}
+    constexpr const T& Back() const noexcept{ return m_storage.elements[m_size - 1];}
+
+    constexpr bool operator==(const StaticVector& rhs) const noexcept;
+
+    template<typename ...Args>
+    constexpr Aii::Expected<T*, Error> EmplaceBack(Args&& ...args) noexcept;
+    constexpr Aii::Expected<T*, Error> PushBack(const T& val) noexcept{ return EmplaceBack(val);}
+    constexpr Aii::Expected<T*, Error> PushBack(T&& val) noexcept{ return EmplaceBack(std::move(val));}
+    template<typename ...Args>
+    constexpr Aii::Expected<T*, Error> Emplace(std::size_t index, Args&& ...args) noexcept;
+    constexpr Aii::Expected<T*, Error> Insert(std::size_t index, const T& val) noexcept{ return Emplace(index, val);}
+    constexpr Aii::Expected<T*, Error> Insert(std::size_t index, T&& val) noexcept{ return Emplace(index, std::move(val));}
+
+    constexpr Aii::Expected<void, Error> PopBack() noexcept;
+    constexpr Aii::Expected<void, Error> Erase(std::size_t index) noexcept;
+    constexpr void Clear() noexcept;
+
+    constexpr Aii::Expected<void, Error> Resize(std::size_t count) noexcept;
+
+  private:
+    constexpr void Shift(std::size_t dest, std::size_t src, std::size_t count) noexcept;
+
+  private:
+    Storage m_storage;
+    std::size_t m_size;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, std::size_t N>
+constexpr Aii::StaticVector<T, N>::StaticVector() noexcept
+  :
+    m_storage{},
+    m_size{0}
+{
+  // A constant must have every subobject initialised, so tables built at
+  // compile time value initialise the unused slots. Elements of other
+  // types cannot be left in the storage of a constant.
+  if constexpr(std::is_trivially_default_constructible_v<T>){
+    if(std::is_constant_evaluated()){
+      for(std::size_t i = 0; i < N; i++){
+        std::construct_at(&m_storage.elements[i]);
+      }
+    }
+  }
+}
+
+template<typename T, std::size_t N>
+constexpr Aii::StaticVector<T, N>::StaticVector(const StaticVector& src) noexcept
+  :
+    m_storage{},
+    m_size{src.m_size}
+{
+  for(std::size_t i = 0; i < m_size; i++){
+    std::construct_at(&m_storage.elements[i], src.m_storage.elements[i]);
+  }
+}
+
+template<typename T, std::size_t N>
+constexpr Aii::StaticVector<T, N>::StaticVector(StaticVector&& src) noexcept
+  :
+    m_storage{},
+    m_size{src.m_size}
+{
+  // the elements of src are moved from, not destroyed
+  for(std::size_t i = 0; i < m_size; i++){
+    std::construct_at(&m_storage.elements[i], std::move(src.m_storage.elements[i]));
+  }
+}
+
+template<typename T, std::size_t N>
+constexpr auto Aii::StaticVector<T, N>::operator=(const StaticVector& src) noexcept -> StaticVector&{
+  if(this != &src){
+    Clear();
+    for(std::size_t i = 0; i < src.m_size; i++){
+      std::construct_at(&m_storage.elements[i], src.m_storage.elements[i]);
+    }
+    m_size = src.m_size;
+  }
+  return *this;
+}
+
+template<typename T, std::size_t N>
+constexpr auto Aii::StaticVector<T, N>::operator=(StaticVector&& src) noexcept -> StaticVector&{
+  if(this != &src){
+    Clear();
+    for(std::size_t i = 0; i < src.m_size; i++){
+      std::construct_at(&m_storage.elements[i], std::move(src.m_storage.elements[i]));
+    }
+    m_size = src.m_size;
+  }
+  return *this;
+}
+
+template<typename T, std::size_t N>
+constexpr bool Aii::StaticVector<T, N>::operator==(const StaticVector& rhs) const noexcept{
+  if(m_size != rhs.m_size){
+    return false;
+  }
+  for(std::size_t i = 0; i < m_size; i++){
+    if(!(m_storage.elements[i] == rhs.m_storage.elements[i])){
+      return false;
+    }
+  }
+  return true;
+}
+
+// Modification
+
+template<typename T, std::size_t N>
+constexpr void Aii::StaticVector<T, N>::Shift(std::size_t dest, std::size_t src, std::size_t count) noexcept{
+  // relocates the count elements from slot src onwards to slot dest
+  if(!std::is_constant_evaluated()){
+    Details::RelocateOverlapping(&m_storage.elements[dest], &m_storage.elements[src], count);
+    return;
+  }
+  // one slot at a time, in the order which never overwrites a live element
+  if(dest < src){
+    for(std::size_t i = 0; i < count; i++){
+      std::construct_at(&m_storage.elements[dest + i], std::move(m_storage.elements[src + i]));
+      std::destroy_at(&m_storage.elements[src + i]);
+    }
+  }
+  else{
+    for(std::size_t i = count; i > 0; i--){
+      std::construct_at(&m_storage.elements[dest + i - 1], std::move(m_storage.elements[src + i - 1]));
+      std::destroy_at(&m_storage.elements[src + i - 1]);
+    }
+  }
+}
+
+template<typename T, std::size_t N> template<typename ...Args>
+constexpr Aii::Expected<T*, Aii::Error> Aii::StaticVector<T, N>::EmplaceBack(Args&& ...args) noexcept{
+  // constructs an element from args after the last. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector is full
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size == N){
+    return {Aii::Error::OutOfRange};
+  }
+  T* element = std::construct_at(&m_storage.elements[m_size], std::forward<Args>(args)...);
+  m_size++;
+  return element;
+}
+
+template<typename T, std::size_t N> template<typename ...Args>
+constexpr Aii::Expected<T*, Aii::Error> Aii::StaticVector<T, N>::Emplace(std::size_t index, Args&& ...args) noexcept{
+  // constructs an element from args at index, shifting the elements from
+  // index onwards up by one. O(Size() - index)
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector is full, or index is greater than Size()
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size == N || index > m_size){
+    return {Aii::Error::OutOfRange};
+  }
+  if(index == m_size){
+    return EmplaceBack(std::forward<Args>(args)...);
+  }
+  // built aside first, as args may refer to an element which is shifted
+  T val{std::forward<Args>(args)...};
+  Shift(index + 1, index, m_size - index);
+  T* element = std::construct_at(&m_storage.elements[index], std::move(val));
+  m_size++;
+  return element;
+}
+
+template<typename T, std::size_t N>
+constexpr Aii::Expected<void, Aii::Error> Aii::StaticVector<T, N>::PopBack() noexcept{
+  // destroys the last element. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector is empty
+  if(m_size == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  m_size--;
+  std::destroy_at(&m_storage.elements[m_size]);
+  return {};
+}
+
+template<typename T, std::size_t N>
+constexpr Aii::Expected<void, Aii::Error> Aii::StaticVector<T, N>::Erase(std::size_t index) noexcept{
+  // destroys the element at index, shifting the elements after it down by
+  // one. O(Size() - index)
+  //
+  // Possible Errors:
+  //  OutOfRange - index is not less than Size()
+  if(index >= m_size){
+    return {Aii::Error::OutOfRange};
+  }
+  std::destroy_at(&m_storage.elements[index]);
+  Shift(index, index + 1, m_size - index - 1);
+  m_size--;
+  return {};
+}
+
+template<typename T, std::size_t N>
+constexpr void Aii::StaticVector<T, N>::Clear() noexcept{
+  // destroys every element. O(Size())
+  for(std::size_t i = 0; i < m_size; i++){
+    std::destroy_at(&m_storage.elements[i]);
+  }
+  m_size = 0;
+}
+
+template<typename T, std::size_t N>
+constexpr Aii::Expected<void, Aii::Error> Aii::StaticVector<T, N>::Resize(std::size_t count) noexcept{
+  // destroys the elements from count onwards, or value initialises new ones
+  // up to count. O(|count - Size()|)
+  //
+  // Possible Errors:
+  //  OutOfRange - count is greater than N
+  //
+  // On error, the vector is left in the state before the function call
+  if(count > N){
+    return {Aii::Error::OutOfRange};
+  }
+  while(m_size > count){
+    m_size--;
+    std::destroy_at(&m_storage.elements[m_size]);
+  }
+  for(; m_size < count; m_size++){
+    std::construct_at(&m_storage.elements[m_size]);
+  }
+  return {};
+}
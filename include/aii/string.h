@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Aii{
@@ -52,8 +53,9 @@ constexpr int Aii::Memcmp(const void* s1, const void* s2, std::size_t n){
   return 0;
 }
 
-// required for GCC 
+// required for GCC. Hosted builds link against the C library's versions.
 
+#ifndef TEST_HOSTED_ENVIRONMENT
 extern "C" {
 
 inline void* memcpy(void* dest, const void* src, std::size_t n){
@@ -73,3 +75,4 @@ inline int memcmp(const void* s1, const void* s2, std::size_t n){
 }
 
 }
+#endif
@@ -8,6 +8,26 @@
 //
 //    * T* Allocate<T, ...Args>(Args ...args)
 //
+//    * T* AllocateArray<T>(std::size_t n)
+//
+//    * void DeleteArray<T>(T* t, std::size_t n)
+//
+//  Containers which reserve address space up front (Aii::StableVector) additionally need:
+//
+//    * std::size_t PageSize()
+//
+//    * void* ReserveVirtual(std::size_t bytes)
+//
+//    * bool Commit(void* address, std::size_t bytes)
+//
+//    * void Decommit(void* address, std::size_t bytes)
+//
+//    * void ReleaseVirtual(void* address, std::size_t bytes)
+//
+//  Per cpu data (Aii::PerCpu) additionally needs:
+//
+//    * std::size_t CurrentCpu()
+//
 //  The implementations of these support functions should be reachable from /impl/stubs.hpp
 
 #include "../../impl/stubs.hpp"
@@ -0,0 +1,106 @@
+#pragma once
+
+// Pointer which packs Bits flag bits into the low bits guaranteed to be zero
+// by the alignment of T. Used for node colours, list flags and ABA tags.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Aii{
+
+template<typename T, std::size_t Bits = 1>
+class TaggedPtr{
+  static_assert(Bits < sizeof(std::uintptr_t) * 8, "TaggedPtr: too many tag bits");
+
+  public:
+    using PointerType = T*;
+    using TagType = std::uintptr_t;
+
+    static constexpr std::uintptr_t TagMask = (std::uintptr_t{1} << Bits) - 1;
+    static constexpr std::uintptr_t PtrMask = ~TagMask;
+
+    constexpr TaggedPtr() noexcept: m_bits{0}{}
+    constexpr TaggedPtr(std::nullptr_t) noexcept: m_bits{0}{}
+    TaggedPtr(PointerType pointer, TagType tag = 0) noexcept;
+
+    PointerType Ptr() const noexcept;
+    void SetPtr(PointerType pointer) noexcept;
+
+    constexpr TagType Tag() const noexcept{ return m_bits & TagMask;}
+    constexpr void SetTag(TagType tag) noexcept;
+
+    constexpr bool Bit(std::size_t index) const noexcept;
+    constexpr void SetBit(std::size_t index, bool value) noexcept;
+
+    constexpr std::uintptr_t Raw() const noexcept{ return m_bits;}
+    static constexpr TaggedPtr FromRaw(std::uintptr_t bits) noexcept;
+
+    T& operator*() const noexcept{ return *Ptr();}
+    PointerType operator->() const noexcept{ return Ptr();}
+
+    constexpr explicit operator bool() const noexcept{ return (m_bits & PtrMask) != 0;}
+
+    constexpr bool operator==(const TaggedPtr& rhs) const noexcept{ return m_bits == rhs.m_bits;}
+    constexpr bool operator!=(const TaggedPtr& rhs) const noexcept{ return m_bits != rhs.m_bits;}
+
+  private:
+    static constexpr void CheckAlignment() noexcept;
+
+  private:
+    std::uintptr_t m_bits;
+};
+
+} // namespace Aii
+
+template<typename T, std::size_t Bits>
+constexpr void Aii::TaggedPtr<T, Bits>::CheckAlignment() noexcept{
+  // T may be incomplete where the TaggedPtr is declared (e.g. a node pointing
+  // to its parent), so the check is deferred until a pointer is stored or read
+  static_assert(alignof(T) > TagMask,
+      "TaggedPtr: alignment of T does not leave enough free low bits");
+}
+
+template<typename T, std::size_t Bits>
+Aii::TaggedPtr<T, Bits>::TaggedPtr(PointerType pointer, TagType tag) noexcept
+  :
+    m_bits{reinterpret_cast<std::uintptr_t>(pointer) | (tag & TagMask)}
+{
+  CheckAlignment();
+}
+
+template<typename T, std::size_t Bits>
+auto Aii::TaggedPtr<T, Bits>::Ptr() const noexcept -> PointerType{
+  CheckAlignment();
+  return reinterpret_cast<PointerType>(m_bits & PtrMask);
+}
+
+template<typename T, std::size_t Bits>
+void Aii::TaggedPtr<T, Bits>::SetPtr(PointerType pointer) noexcept{
+  // preserves the tag bits
+  CheckAlignment();
+  m_bits = reinterpret_cast<std::uintptr_t>(pointer) | (m_bits & TagMask);
+}
+
+template<typename T, std::size_t Bits>
+constexpr void Aii::TaggedPtr<T, Bits>::SetTag(TagType tag) noexcept{
+  // preserves the pointer bits
+  m_bits = (m_bits & PtrMask) | (tag & TagMask);
+}
+
+template<typename T, std::size_t Bits>
+constexpr bool Aii::TaggedPtr<T, Bits>::Bit(std::size_t index) const noexcept{
+  return ((m_bits & TagMask) >> index) & 1;
+}
+
+template<typename T, std::size_t Bits>
+constexpr void Aii::TaggedPtr<T, Bits>::SetBit(std::size_t index, bool value) noexcept{
+  const std::uintptr_t mask = (std::uintptr_t{1} << index) & TagMask;
+  m_bits = value ? (m_bits | mask) : (m_bits & ~mask);
+}
+
+template<typename T, std::size_t Bits>
+constexpr auto Aii::TaggedPtr<T, Bits>::FromRaw(std::uintptr_t bits) noexcept -> TaggedPtr{
+  TaggedPtr tagged;
+  tagged.m_bits = bits;
+  return tagged;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Growable contiguous array.
+//
+// Elements live in one allocation of Capacity() slots, of which the first
+// Size() are constructed. Appending to a full vector doubles its capacity,
+// so a run of appends costs O(1) amortised each and at most half of the
+// storage is ever unused while growing. Growing relocates the elements to
+// the new storage, with a single Memcpy for trivially relocatable types
+// (see aii/relocate.hpp) rather than a move and destroy per element. The
+// element operations are shared with SmallVector (see aii/vector_base.hpp).
+//
+// Pointers to elements are invalidated when the vector reallocates, and by
+// insertions and erasures before them.
+
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/vector_base.hpp"
+
+namespace Aii{
+
+template<typename T, typename A = Aii::Allocator<T>>
+class Vector: public Details::VectorBase<T, A, Details::HeapStorage<T>>{
+  static_assert(Aii::IsAllocator<A>, "Vector: A must satisfy Aii::IsAllocator");
+  static_assert(std::is_nothrow_move_constructible_v<T>, "Vector: elements must be nothrow move constructible");
+
+  private:
+    using Base = Details::VectorBase<T, A, Details::HeapStorage<T>>;
+    using typename Base::SlotAllocType;
+
+  public:
+    Vector() noexcept;
+    Vector(const Vector& src) noexcept = delete;
+    Vector(Vector&& src) noexcept;
+    Vector& operator=(const Vector& src) noexcept = delete;
+    Vector& operator=(Vector&& src) noexcept;
+
+    void Swap(Vector& other) noexcept;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, typename A>
+Aii::Vector<T, A>::Vector() noexcept
+  :
+    Base{SlotAllocType()}
+{
+
+}
+
+template<typename T, typename A>
+Aii::Vector<T, A>::Vector(Vector&& src) noexcept
+  :
+    Base{std::move(src.m_allocator)}
+{
+  this->m_slots = src.m_slots;
+  this->m_size = src.m_size;
+  this->m_capacity = src.m_capacity;
+  src.m_slots = nullptr;
+  src.m_size = 0;
+  src.m_capacity = 0;
+}
+
+template<typename T, typename A>
+auto Aii::Vector<T, A>::operator=(Vector&& src) noexcept -> Vector&{
+  if(this != &src){
+    this->Clear();
+    this->Deallocate();
+    Swap(src);
+  }
+  return *this;
+}
+
+template<typename T, typename A>
+void Aii::Vector<T, A>::Swap(Vector& other) noexcept{
+  std::swap(this->m_slots, other.m_slots);
+  std::swap(this->m_size, other.m_size);
+  std::swap(this->m_capacity, other.m_capacity);
+  std::swap(this->m_allocator, other.m_allocator);
+}
@@ -0,0 +1,368 @@
+#pragma once
+
+// Shared implementation of Vector<T, A> and SmallVector<T, N, A>.
+//
+// Both keep their first Size() slots constructed in one contiguous block
+// and grow it geometrically, relocating the elements with Details::Relocate.
+// They differ only in where the block lives while it is small, which the
+// Storage parameter decides:
+//
+//   HeapStorage<T>        - no inline slots, an empty vector has no block
+//   InlineStorage<T, N>   - N slots inside the object, used until Size()
+//                           grows past N and again after ShrinkToFit()
+//
+// VectorBase holds the element operations, and the vectors themselves add
+// construction, moves and Swap(), which depend on the storage.
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/concepts.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+#include "aii/relocate.hpp"
+
+namespace Aii::Details{
+
+// raw storage, elements are constructed in place
+template<typename T>
+struct alignas(T) VectorSlot{
+  unsigned char bytes[sizeof(T)];
+};
+
+template<typename T>
+struct HeapStorage{
+  static constexpr std::size_t InlineCapacity = 0;
+
+  VectorSlot<T>* InlineSlots() noexcept{ return nullptr;}
+};
+
+template<typename T, std::size_t N>
+struct InlineStorage{
+  static constexpr std::size_t InlineCapacity = N;
+
+  VectorSlot<T>* InlineSlots() noexcept{ return m_inline;}
+
+  VectorSlot<T> m_inline[N];
+};
+
+template<typename T, typename A, typename Storage>
+class VectorBase: protected Storage{
+  static_assert(Aii::IsAllocator<A>, "VectorBase: A must satisfy Aii::IsAllocator");
+
+  protected:
+    using Slot = VectorSlot<T>;
+    using SlotAllocType = typename A::template Rebind<Slot>::other;
+
+    static constexpr std::size_t MinCapacity = sizeof(T) >= 64 ? 1 : 64 / sizeof(T);
+
+  public:
+    using ValueType = T;
+
+    VectorBase(const VectorBase& src) noexcept = delete;
+    VectorBase& operator=(const VectorBase& src) noexcept = delete;
+
+    bool Empty() const noexcept{ return m_size == 0;}
+    std::size_t Size() const noexcept{ return m_size;}
+    std::size_t Capacity() const noexcept{ return m_capacity;}
+
+    T* Data() noexcept{ return Elements();}
+    const T* Data() const noexcept{ return Elements();}
+
+    T* begin() noexcept{ return Elements();}
+    T* end() noexcept{ return Elements() + m_size;}
+    const T* begin() const noexcept{ return Elements();}
+    const T* end() const noexcept{ return Elements() + m_size;}
+
+    T& operator[](std::size_t index) noexcept{ return Elements()[index];}
+    const T& operator[](std::size_t index) const noexcept{ return Elements()[index];}
+    T& Front() noexcept{ return Elements()[0];}
+    const T& Front() const noexcept{ return Elements()[0];}
+    T& Back() noexcept{ return Elements()[m_size - 1];}
+    const T& Back() const noexcept{ return Elements()[m_size - 1];}
+
+    template<typename ...Args>
+    Aii::Expected<T*, Error> EmplaceBack(Args&& ...args) noexcept;
+    Aii::Expected<T*, Error> PushBack(const T& val) noexcept{ return EmplaceBack(val);}
+    Aii::Expected<T*, Error> PushBack(T&& val) noexcept{ return EmplaceBack(std::move(val));}
+    template<typename ...Args>
+    Aii::Expected<T*, Error> Emplace(std::size_t index, Args&& ...args) noexcept;
+    Aii::Expected<T*, Error> Insert(std::size_t index, const T& val) noexcept{ return Emplace(index, val);}
+    Aii::Expected<T*, Error> Insert(std::size_t index, T&& val) noexcept{ return Emplace(index, std::move(val));}
+
+    Aii::Expected<void, Error> PopBack() noexcept;
+    Aii::Expected<void, Error> Erase(std::size_t index) noexcept;
+    void Clear() noexcept;
+
+    Aii::Expected<void, Error> Resize(std::size_t count) noexcept;
+    Aii::Expected<void, Error> Reserve(std::size_t count) noexcept;
+    Aii::Expected<void, Error> ShrinkToFit() noexcept;
+
+  protected:
+    explicit VectorBase(SlotAllocType&& allocator) noexcept;
+    ~VectorBase() noexcept;
+
+    T* Elements() const noexcept{ return std::launder(reinterpret_cast<T*>(m_slots));}
+    std::size_t GrownCapacity(std::size_t count) const noexcept;
+    bool Reallocate(std::size_t capacity) noexcept;
+    void DestroyRange(std::size_t first, std::size_t last) noexcept;
+    void Deallocate() noexcept;
+
+  protected:
+    Slot* m_slots;
+    std::size_t m_size;
+    std::size_t m_capacity;
+    [[no_unique_address]] SlotAllocType m_allocator;
+};
+
+} // namespace Aii::Details
+
+// Construction
+
+template<typename T, typename A, typename Storage>
+Aii::Details::VectorBase<T, A, Storage>::VectorBase(SlotAllocType&& allocator) noexcept
+  :
+    m_slots{this->InlineSlots()},
+    m_size{0},
+    m_capacity{Storage::InlineCapacity},
+    m_allocator{std::move(allocator)}
+{
+
+}
+
+template<typename T, typename A, typename Storage>
+Aii::Details::VectorBase<T, A, Storage>::~VectorBase() noexcept{
+  Clear();
+  Deallocate();
+}
+
+// Storage
+
+template<typename T, typename A, typename Storage>
+std::size_t Aii::Details::VectorBase<T, A, Storage>::GrownCapacity(std::size_t count) const noexcept{
+  // capacity to grow to when count elements no longer fit
+  std::size_t capacity = m_capacity ? m_capacity * 2 : MinCapacity;
+  return capacity < count ? count : capacity;
+}
+
+template<typename T, typename A, typename Storage>
+bool Aii::Details::VectorBase<T, A, Storage>::Reallocate(std::size_t capacity) noexcept{
+  // Relocates the elements to an allocation of capacity slots, or to the
+  // inline slots if capacity is at most InlineCapacity. capacity must be at
+  // least Size(). Returns false if allocation failed, leaving the vector as
+  // it was.
+  Slot* slots = this->InlineSlots();
+  if(capacity > Storage::InlineCapacity){
+    slots = m_allocator.Allocate(capacity);
+    if(!slots){
+      return false;
+    }
+  }
+  else{
+    capacity = Storage::InlineCapacity;
+  }
+  if(slots == m_slots){
+    return true;
+  }
+  if(m_size){
+    Details::Relocate(std::launder(reinterpret_cast<T*>(slots)), Elements(), m_size);
+  }
+  Deallocate();
+  m_slots = slots;
+  m_capacity = capacity;
+  return true;
+}
+
+template<typename T, typename A, typename Storage>
+void Aii::Details::VectorBase<T, A, Storage>::DestroyRange(std::size_t first, std::size_t last) noexcept{
+  if constexpr(!std::is_trivially_destructible_v<T>){
+    T* elements = Elements();
+    for(std::size_t i = first; i < last; i++){
+      elements[i].~T();
+    }
+  }
+}
+
+template<typename T, typename A, typename Storage>
+void Aii::Details::VectorBase<T, A, Storage>::Deallocate() noexcept{
+  // elements must already be destroyed or relocated. Returns to the inline
+  // slots, if any
+  if(m_slots != this->InlineSlots()){
+    m_allocator.Deallocate(m_slots, m_capacity);
+    m_slots = this->InlineSlots();
+    m_capacity = Storage::InlineCapacity;
+  }
+}
+
+template<typename T, typename A, typename Storage>
+Aii::Expected<void, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::Reserve(std::size_t count) noexcept{
+  // sizes the storage so count elements fit without reallocating. Never
+  // shrinks it. O(Size()) if it reallocates
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(count <= m_capacity){
+    return {};
+  }
+  if(!Reallocate(count)){
+    return {Aii::Error::RuntimeError};
+  }
+  return {};
+}
+
+template<typename T, typename A, typename Storage>
+Aii::Expected<void, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::ShrinkToFit() noexcept{
+  // moves the elements back to the inline slots if they fit, otherwise
+  // reallocates the storage to exactly Size() slots. A vector without
+  // inline slots frees its storage when empty. O(Size())
+  //
+  // Possible Errors:
+  //  RuntimeError - allocation failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size == m_capacity){
+    return {};
+  }
+  if(!Reallocate(m_size)){
+    return {Aii::Error::RuntimeError};
+  }
+  return {};
+}
+
+// Modification
+
+template<typename T, typename A, typename Storage> template<typename ...Args>
+Aii::Expected<T*, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::EmplaceBack(Args&& ...args) noexcept{
+  // constructs an element from args after the last. O(1) amortised
+  //
+  // Possible Errors:
+  //  RuntimeError - growing the storage failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(m_size < m_capacity){
+    T* element = ::new(static_cast<void*>(m_slots + m_size)) T{std::forward<Args>(args)...};
+    m_size++;
+    return element;
+  }
+  // args may refer to an element, so the new one is constructed before
+  // the old storage is released
+  std::size_t capacity = GrownCapacity(m_size + 1);
+  Slot* slots = m_allocator.Allocate(capacity);
+  if(!slots){
+    return {Aii::Error::RuntimeError};
+  }
+  T* element = ::new(static_cast<void*>(slots + m_size)) T{std::forward<Args>(args)...};
+  Details::Relocate(std::launder(reinterpret_cast<T*>(slots)), Elements(), m_size);
+  Deallocate();
+  m_slots = slots;
+  m_capacity = capacity;
+  m_size++;
+  return element;
+}
+
+template<typename T, typename A, typename Storage> template<typename ...Args>
+Aii::Expected<T*, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::Emplace(std::size_t index, Args&& ...args) noexcept{
+  // constructs an element from args at index, shifting the elements from
+  // index onwards up by one. O(Size() - index) amortised
+  //
+  // Possible Errors:
+  //  OutOfRange - index is greater than Size()
+  //  RuntimeError - growing the storage failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(index > m_size){
+    return {Aii::Error::OutOfRange};
+  }
+  if(index == m_size){
+    return EmplaceBack(std::forward<Args>(args)...);
+  }
+  if(m_size == m_capacity){
+    std::size_t capacity = GrownCapacity(m_size + 1);
+    Slot* slots = m_allocator.Allocate(capacity);
+    if(!slots){
+      return {Aii::Error::RuntimeError};
+    }
+    T* elements = std::launder(reinterpret_cast<T*>(slots));
+    T* element = ::new(static_cast<void*>(elements + index)) T{std::forward<Args>(args)...};
+    Details::Relocate(elements, Elements(), index);
+    Details::Relocate(elements + index + 1, Elements() + index, m_size - index);
+    Deallocate();
+    m_slots = slots;
+    m_capacity = capacity;
+    m_size++;
+    return element;
+  }
+  // built aside first, as args may refer to an element which is shifted
+  T val{std::forward<Args>(args)...};
+  T* elements = Elements();
+  Details::RelocateOverlapping(elements + index + 1, elements + index, m_size - index);
+  T* element = ::new(static_cast<void*>(elements + index)) T{std::move(val)};
+  m_size++;
+  return element;
+}
+
+template<typename T, typename A, typename Storage>
+Aii::Expected<void, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::PopBack() noexcept{
+  // destroys the last element. O(1)
+  //
+  // Possible Errors:
+  //  OutOfRange - the vector is empty
+  if(m_size == 0){
+    return {Aii::Error::OutOfRange};
+  }
+  DestroyRange(m_size - 1, m_size);
+  m_size--;
+  return {};
+}
+
+template<typename T, typename A, typename Storage>
+Aii::Expected<void, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::Erase(std::size_t index) noexcept{
+  // destroys the element at index, shifting the elements after it down by
+  // one. O(Size() - index)
+  //
+  // Possible Errors:
+  //  OutOfRange - index is not less than Size()
+  if(index >= m_size){
+    return {Aii::Error::OutOfRange};
+  }
+  T* elements = Elements();
+  DestroyRange(index, index + 1);
+  Details::RelocateOverlapping(elements + index, elements + index + 1, m_size - index - 1);
+  m_size--;
+  return {};
+}
+
+template<typename T, typename A, typename Storage>
+void Aii::Details::VectorBase<T, A, Storage>::Clear() noexcept{
+  // destroys every element, keeping the storage. O(Size())
+  DestroyRange(0, m_size);
+  m_size = 0;
+}
+
+template<typename T, typename A, typename Storage>
+Aii::Expected<void, Aii::Error> Aii::Details::VectorBase<T, A, Storage>::Resize(std::size_t count) noexcept{
+  // destroys the elements from count onwards, or value initialises new ones
+  // up to count. O(|count - Size()|) amortised
+  //
+  // Possible Errors:
+  //  RuntimeError - growing the storage failed
+  //
+  // On error, the vector is left in the state before the function call
+  if(count <= m_size){
+    DestroyRange(count, m_size);
+    m_size = count;
+    return {};
+  }
+  if(count > m_capacity && !Reallocate(GrownCapacity(count))){
+    return {Aii::Error::RuntimeError};
+  }
+  for(; m_size < count; m_size++){
+    ::new(static_cast<void*>(m_slots + m_size)) T{};
+  }
+  return {};
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+// Chase-Lev work stealing deque, for per cpu run queues.
+//
+// One owner cpu pushes and pops at the bottom, LIFO, touching only its own
+// index in the common case; any other cpu may steal from the top, FIFO,
+// with a compare and swap of the top index. Owner and thieves only race
+// for the last element, which the owner settles by the same compare and
+// swap. The memory ordering follows Le, Pop, Cohen and Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013),
+// so it holds on weakly ordered cpus as well as x86.
+//
+// Elements sit in a circular buffer which the owner replaces with one twice
+// the size when full. A thief may still be reading the old buffer, so it
+// is kept until Reclaim() has waited out an Srcu grace period; thieves
+// read inside an Srcu read side section. A thief may read a slot which the
+// owner is overwriting, and then loses the compare and swap and discards
+// what it read, so elements must be trivially copyable and small enough to
+// load and store atomically: typically a pointer to a task.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "aii/allocator.hpp"
+#include "aii/atomic.hpp"
+#include "aii/cache_line.hpp"
+#include "aii/concepts.hpp"
+#include "aii/error.hpp"
+#include "aii/expected.hpp"
+#include "aii/srcu.hpp"
+
+namespace Aii{
+
+template<typename T, typename A = Aii::Allocator<T>>
+class WorkStealingDeque{
+  static_assert(Aii::IsAllocator<A>, "WorkStealingDeque: A must satisfy Aii::IsAllocator");
+  static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque: elements must be trivially copyable");
+  static_assert(__atomic_always_lock_free(sizeof(T), 0), "WorkStealingDeque: elements must be lock free atomic sized");
+
+  private:
+    static constexpr std::size_t MinCapacity = 64;
+
+    struct Buffer{
+      std::size_t mask;
+      T* slots;
+      // chains replaced buffers awaiting reclamation
+      Buffer* retiredNext;
+
+      T Load(std::int64_t index) const noexcept;
+      void Store(std::int64_t index, T val) noexcept;
+    };
+
+    using BufferAllocType = typename A::template Rebind<Buffer>::other;
+    using SlotAllocType = typename A::template Rebind<T>::other;
+
+  public:
+    using ValueType = T;
+
+    WorkStealingDeque() noexcept;
+    WorkStealingDeque(const WorkStealingDeque& src) noexcept = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque& src) noexcept = delete;
+    // no other cpu may be using the deque
+    ~WorkStealingDeque() noexcept;
+
+    // a snapshot, which may be stale by the time it returns
+    std::size_t Size() const noexcept;
+    bool Empty() const noexcept{ return Size() == 0;}
+    std::size_t Capacity() const noexcept;
+
+    // Owner only
+
+    Aii::Expected<void, Error> Push(T val) noexcept;
+    Aii::Expected<T, Error> Pop() noexcept;
+    // Frees the buffers replaced by growing, waiting for thieves to leave
+    void Reclaim() noexcept;
+
+    // Safe from any number of cpus at once
+
+    Aii::Expected<T, Error> Steal() noexcept;
+
+  private:
+    Buffer* AllocateBuffer(std::size_t capacity) noexcept;
+    void DeallocateBuffer(Buffer* buffer) noexcept;
+    Buffer* Grow(Buffer* buffer, std::int64_t top, std::int64_t bottom) noexcept;
+
+  private:
+    // written by thieves and, for the last element, the owner
+    alignas(CacheLineSize) Atomic<std::int64_t> m_top;
+    // written by the owner
+    alignas(CacheLineSize) Atomic<std::int64_t> m_bottom;
+    Atomic<Buffer*> m_buffer;
+    Buffer* m_retired;
+    Aii::Srcu<> m_srcu;
+    BufferAllocType m_bufferAllocator;
+    SlotAllocType m_slotAllocator;
+};
+
+} // namespace Aii
+
+// Construction
+
+template<typename T, typename A>
+Aii::WorkStealingDeque<T, A>::WorkStealingDeque() noexcept
+  :
+    m_top{0},
+    m_bottom{0},
+    m_buffer{nullptr},
+    m_retired{nullptr},
+    m_srcu{},
+    m_bufferAllocator{BufferAllocType()},
+    m_slotAllocator{SlotAllocType()}
+{
+
+}
+
+template<typename T, typename A>
+Aii::WorkStealingDeque<T, A>::~WorkStealingDeque() noexcept{
+  while(m_retired){
+    Buffer* next = m_retired->retiredNext;
+    DeallocateBuffer(m_retired);
+    m_retired = next;
+  }
+  if(Buffer* buffer = m_buffer.Load(MemoryOrder::Relaxed)){
+    DeallocateBuffer(buffer);
+  }
+}
+
+template<typename T, typename A>
+std::size_t Aii::WorkStealingDeque<T, A>::Size() const noexcept{
+  std::int64_t bottom = m_bottom.Load(MemoryOrder::Relaxed);
+  std::int64_t top = m_top.Load(MemoryOrder::Relaxed);
+  return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+}
+
+template<typename T, typename A>
+std::size_t Aii::WorkStealingDeque<T, A>::Capacity() const noexcept{
+  Buffer* buffer = m_buffer.Load(MemoryOrder::Acquire);
+  return buffer ? buffer->mask + 1 : 0;
+}
+
+// Storage
+
+template<typename T, typename A>
+T Aii::WorkStealingDeque<T, A>::Buffer::Load(std::int64_t index) const noexcept{
+  return AtomicLoad(&slots[static_cast<std::size_t>(index) & mask], MemoryOrder::Relaxed);
+}
+
+template<typename T, typename A>
+void Aii::WorkStealingDeque<T, A>::Buffer::Store(std::int64_t index, T val) noexcept{
+  AtomicStore(&slots[static_cast<std::size_t>(index) & mask], val, MemoryOrder::Relaxed);
+}
+
+template<typename T, typename A>
+auto Aii::WorkStealingDeque<T, A>::AllocateBuffer(std::size_t capacity) noexcept -> Buffer*{
+  // capacity must be a power of two. Returns nullptr if allocation failed
+  Buffer* buffer = m_bufferAllocator.Allocate();
+  if(!buffer){
+    return nullptr;
+  }
+  buffer->slots = m_slotAllocator.Allocate(capacity);
+  if(!buffer->slots){
+    m_bufferAllocator.Deallocate(buffer);
+    return nullptr;
+  }
+  buffer->mask = capacity - 1;
+  buffer->retiredNext = nullptr;
+  return buffer;
+}
+
+template<typename T, typename A>
+void Aii::WorkStealingDeque<T, A>::DeallocateBuffer(Buffer* buffer) noexcept{
+  m_slotAllocator.Deallocate(buffer->slots, buffer->mask + 1);
+  m_bufferAllocator.Deallocate(buffer);
+}
+
+template<typename T, typename A>
+auto Aii::WorkStealingDeque<T, A>::Grow(Buffer* buffer, std::int64_t top, std::int64_t bottom) noexcept -> Buffer*{
+  // Copies the elements from top to bottom into a buffer twice the size and
+  // publishes it. Thieves carry on in the old buffer, whose slots from top
+  // on are left untouched, and it is freed by Reclaim(). Returns nullptr if
+  // allocation failed, leaving the deque as it was.
+  Buffer* grown = AllocateBuffer(buffer ? (buffer->mask + 1) * 2 : MinCapacity);
+  if(!grown){
+    return nullptr;
+  }
+  for(std::int64_t i = top; i < bottom; i++){
+    grown->Store(i, buffer->Load(i));
+  }
+  m_buffer.Store(grown, MemoryOrder::Release);
+  if(buffer){
+    buffer->retiredNext = m_retired;
+    m_retired = buffer;
+  }
+  return grown;
+}
+
+template<typename T, typename A>
+void Aii::WorkStealingDeque<T, A>::Reclaim() noexcept{
+  // waits for the thieves inside Steal() when called, then frees every
+  // buffer replaced so far
+  Buffer* retired = m_retired;
+  if(!retired){
+    return;
+  }
+  m_retired = nullptr;
+  m_srcu.Synchronize();
+  while(retired){
+    Buffer* next = retired->retiredNext;
+    DeallocateBuffer(retired);
+    retired = next;
+  }
+}
+
+// Owner
+
+template<typename T, typename A>
+Aii::Expected<void, Aii::Error> Aii::WorkStealingDeque<T, A>::Push(T val) noexcept{
+  // adds val at the bottom. O(1) amortised, never waits
+  //
+  // Possible Errors:
+  //  RuntimeError - growing the buffer failed
+  //
+  // On error, the deque is left in the state before the function call
+  std::int64_t bottom = m_bottom.Load(MemoryOrder::Relaxed);
+  std::int64_t top = m_top.Load(MemoryOrder::Acquire);
+  Buffer* buffer = m_buffer.Load(MemoryOrder::Relaxed);
+  if(!buffer || bottom - top > static_cast<std::int64_t>(buffer->mask)){
+    buffer = Grow(buffer, top, bottom);
+    if(!buffer){
+      return {Aii::Error::RuntimeError};
+    }
+  }
+  buffer->Store(bottom, val);
+  // the element is visible before the bottom which covers it
+  ThreadFence(MemoryOrder::Release);
+  m_bottom.Store(bottom + 1, MemoryOrder::Relaxed);
+  return {};
+}
+
+template<typename T, typename A>
+Aii::Expected<T, Aii::Error> Aii::WorkStealingDeque<T, A>::Pop() noexcept{
+  // removes the element at the bottom, the one pushed last. O(1), never
+  // waits
+  //
+  // Possible Errors:
+  //  OutOfRange - the deque is empty, or a thief took the last element
+  //
+  // On error, the deque is left in the state before the function call
+  std::int64_t bottom = m_bottom.Load(MemoryOrder::Relaxed) - 1;
+  Buffer* buffer = m_buffer.Load(MemoryOrder::Relaxed);
+  m_bottom.Store(bottom, MemoryOrder::Relaxed);
+  // the claim on the bottom element is ordered before reading top, against
+  // the thieves' read of top before bottom
+  ThreadFence(MemoryOrder::SeqCst);
+  std::int64_t top = m_top.Load(MemoryOrder::Relaxed);
+  if(top > bottom){
+    m_bottom.Store(bottom + 1, MemoryOrder::Relaxed);
+    return {Aii::Error::OutOfRange};
+  }
+  T val = buffer->Load(bottom);
+  if(top == bottom){
+    // the last element, which a thief may be taking as well
+    bool won = m_top.CompareExchangeStrong(top, top + 1, MemoryOrder::SeqCst, MemoryOrder::Relaxed);
+    m_bottom.Store(bottom + 1, MemoryOrder::Relaxed);
+    if(!won){
+      return {Aii::Error::OutOfRange};
+    }
+  }
+  return {std::move(val)};
+}
+
+// Thieves
+
+template<typename T, typename A>
+Aii::Expected<T, Aii::Error> Aii::WorkStealingDeque<T, A>::Steal() noexcept{
+  // removes the element at the top, the oldest. Retries while other
+  // thieves or the owner win the race for it, so lock free rather than
+  // wait free
+  //
+  // Possible Errors:
+  //  OutOfRange - the deque is empty
+  //
+  // On error, the deque is left in the state before the function call
+  SrcuReadGuard guard{m_srcu};
+  for(;;){
+    std::int64_t top = m_top.Load(MemoryOrder::Acquire);
+    ThreadFence(MemoryOrder::SeqCst);
+    std::int64_t bottom = m_bottom.Load(MemoryOrder::Acquire);
+    if(top >= bottom){
+      return {Aii::Error::OutOfRange};
+    }
+    Buffer* buffer = m_buffer.Load(MemoryOrder::Acquire);
+    T val = buffer->Load(top);
+    if(m_top.CompareExchangeStrong(top, top + 1, MemoryOrder::SeqCst, MemoryOrder::Relaxed)){
+      return {std::move(val)};
+    }
+    CpuRelax();
+  }
+}
@@ -0,0 +1,287 @@
+#include "doctest.h"
+
+// Tests for Aii::ArtMap<V, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/art_map.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+using Map = Aii::ArtMap<int>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+bool KeyLess(const std::uint8_t* lhs, std::size_t lhsLength, const std::uint8_t* rhs, std::size_t rhsLength){
+  for(std::size_t i = 0; i < lhsLength && i < rhsLength; i++){
+    if(lhs[i] != rhs[i]){
+      return lhs[i] < rhs[i];
+    }
+  }
+  return lhsLength < rhsLength;
+}
+
+bool IsSorted(const Map& map){
+  // ForEach visits every entry once in strictly increasing key order
+  const std::uint8_t* prev = nullptr;
+  std::size_t prevLength = 0;
+  bool sorted = true;
+  std::size_t count = map.ForEach([&](const std::uint8_t* key, std::size_t length, int&){
+    if(prev && !KeyLess(prev, prevLength, key, length)){
+      sorted = false;
+    }
+    prev = key;
+    prevLength = length;
+  });
+  return sorted && count == map.Size();
+}
+
+Map::NodeType RootType(const Map& map){
+  return map.Root()->type;
+}
+
+void MakeKey(std::uint64_t id, std::uint8_t* key, std::size_t& length){
+  // the base 4 digits of id / 2 over "abcd", behind a long common prefix
+  // for odd ids, so keys share prefixes and many are prefixes of others
+  const char common[] = "/a/long/common/";
+  length = 0;
+  if(id & 1){
+    while(common[length]){
+      key[length] = static_cast<std::uint8_t>(common[length]);
+      length++;
+    }
+  }
+  std::uint8_t digits[32];
+  std::size_t count = 0;
+  for(std::uint64_t rest = id >> 1; rest; rest >>= 2){
+    digits[count++] = static_cast<std::uint8_t>('a' + (rest & 3));
+  }
+  while(count > 0){
+    key[length++] = digits[--count];
+  }
+}
+
+} // namespace
+
+TEST_CASE("ArtMap<V, A> insert, find and erase"){
+  Map map;
+  REQUIRE(map.Empty());
+
+  SUBCASE("Path components"){
+    const char* paths[] = {"/", "/usr", "/usr/bin", "/usr/lib", "/usr/lib64", "/home/user", "/etc"};
+    for(int i = 0; i < 7; i++){
+      auto res = map.Insert(paths[i], i);
+      REQUIRE(res);
+      CHECK(**res == i);
+    }
+    CHECK(map.Size() == 7);
+    for(int i = 0; i < 7; i++){
+      REQUIRE(map.Find(paths[i]));
+      CHECK(*map.Find(paths[i]) == i);
+    }
+    CHECK(!map.Find("/us"));
+    CHECK(!map.Find("/usr/lib6"));
+    CHECK(!map.Find("/usr/lib644"));
+    CHECK(!map.Find(""));
+    CHECK(IsSorted(map));
+  }
+  SUBCASE("The empty key and keys which are prefixes of others"){
+    REQUIRE(map.Insert("abc", 3));
+    REQUIRE(map.Insert("ab", 2));
+    REQUIRE(map.Insert("", 0));
+    REQUIRE(map.Insert("abcd", 4));
+    REQUIRE(map.Insert("a", 1));
+    for(const char* key : {"", "a", "ab", "abc", "abcd"}){
+      REQUIRE(map.Find(key));
+    }
+    CHECK(*map.Find("abc") == 3);
+    CHECK(*map.Find("") == 0);
+    REQUIRE(map.Erase("ab"));
+    CHECK(!map.Find("ab"));
+    CHECK(*map.Find("abcd") == 4);
+    REQUIRE(map.Erase(""));
+    REQUIRE(map.Erase("abcd"));
+    CHECK(*map.Find("a") == 1);
+    CHECK(*map.Find("abc") == 3);
+    CHECK(map.Size() == 2);
+    CHECK(IsSorted(map));
+  }
+  SUBCASE("Prefixes longer than the stored part are split and merged"){
+    const char* keys[] = {"/very/long/shared/directory/one", "/very/long/shared/directory/two",
+                          "/very/long/shared/dir", "/very/long/other", "/very/long/shared/directory/"};
+    for(int i = 0; i < 5; i++){
+      REQUIRE(map.Insert(keys[i], i));
+    }
+    CHECK(!map.Find("/very/long/shared/directory/thr"));
+    CHECK(!map.Find("/very/long/sharXd/directory/one"));
+    CHECK(map.Insert("/very/long/sharXd/directory/one", 9));
+    for(int i = 0; i < 5; i++){
+      REQUIRE(map.Find(keys[i]));
+      CHECK(*map.Find(keys[i]) == i);
+    }
+    // erasing collapses the single child nodes back into long prefixes
+    REQUIRE(map.Erase("/very/long/other"));
+    REQUIRE(map.Erase("/very/long/sharXd/directory/one"));
+    REQUIRE(map.Erase("/very/long/shared/dir"));
+    REQUIRE(map.Erase("/very/long/shared/directory/"));
+    CHECK(*map.Find(keys[0]) == 0);
+    CHECK(*map.Find(keys[1]) == 1);
+    CHECK(!map.Find("/very/long/shared/directorX/one"));
+    CHECK(map.Insert("/very/long/shared/directorX/one", 5));
+    CHECK(IsSorted(map));
+  }
+  SUBCASE("Inserting a duplicate key is an invalid argument"){
+    REQUIRE(map.Insert("key", 1));
+    REQUIRE(map.Insert("keys", 2));
+    auto res = map.Insert("key", 5);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(*map.Find("key") == 1);
+    CHECK(map.Size() == 2);
+    CHECK(map.Erase("ke").Error() == Aii::Error::OutOfRange);
+    CHECK(map.Erase("kez").Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("Binary keys with embedded zero bytes"){
+    std::uint8_t lhs[] = {0, 1, 0, 2};
+    std::uint8_t rhs[] = {0, 1, 0, 3};
+    REQUIRE(map.Insert(lhs, 4, 1));
+    REQUIRE(map.Insert(rhs, 4, 2));
+    CHECK(*map.Find(lhs, 4) == 1);
+    CHECK(!map.Contains(rhs, 3));
+    CHECK(*map.Find(rhs, 4) == 2);
+  }
+}
+
+TEST_CASE("ArtMap<V, A> nodes grow and shrink with their children"){
+  Map map;
+  std::uint8_t key[2] = {'x', 0};
+  REQUIRE(map.Insert(key, 1, -1));
+  for(int byte = 0; byte < 256; byte++){
+    key[1] = static_cast<std::uint8_t>(byte);
+    REQUIRE(map.Insert(key, 2, byte));
+    if(byte == 0){
+      // a leaf and its extension share one Node4
+      CHECK(RootType(map) == Map::NodeType::Node4);
+    }
+    if(byte == 4){
+      CHECK(RootType(map) == Map::NodeType::Node16);
+    }
+    if(byte == 16){
+      CHECK(RootType(map) == Map::NodeType::Node48);
+    }
+    if(byte == 48){
+      CHECK(RootType(map) == Map::NodeType::Node256);
+    }
+  }
+  CHECK(map.Size() == 257);
+  CHECK(IsSorted(map));
+  for(int byte = 255; byte >= 0; byte--){
+    key[1] = static_cast<std::uint8_t>(byte);
+    REQUIRE(map.Find(key, 2));
+    REQUIRE(*map.Find(key, 2) == byte);
+    REQUIRE(map.Erase(key, 2));
+    if(byte == 37){
+      CHECK(RootType(map) == Map::NodeType::Node48);
+    }
+    if(byte == 12){
+      CHECK(RootType(map) == Map::NodeType::Node16);
+    }
+    if(byte == 3){
+      CHECK(RootType(map) == Map::NodeType::Node4);
+    }
+  }
+  // only the one byte key is left, as a plain leaf
+  CHECK(RootType(map) == Map::NodeType::Leaf);
+  CHECK(*map.Find(key, 1) == -1);
+  REQUIRE(map.Erase(key, 1));
+  CHECK(map.Empty());
+}
+
+TEST_CASE("ArtMap<V, A> random keys agree with a table"){
+  Map map;
+  constexpr std::size_t Count = 4096;
+  bool present[Count] = {};
+  std::uint8_t key[32];
+  std::size_t length;
+  std::uint64_t state = 11;
+  for(int i = 0; i < 30000; i++){
+    std::uint64_t id = NextRandom(state) % Count;
+    MakeKey(id, key, length);
+    if(present[id]){
+      REQUIRE(map.Erase(key, length));
+    }
+    else{
+      REQUIRE(map.Insert(key, length, static_cast<int>(id)));
+    }
+    present[id] = !present[id];
+  }
+  std::size_t count = 0;
+  for(std::uint64_t id = 0; id < Count; id++){
+    MakeKey(id, key, length);
+    REQUIRE(map.Contains(key, length) == present[id]);
+    if(present[id]){
+      CHECK(*map.Find(key, length) == static_cast<int>(id));
+      count++;
+    }
+  }
+  CHECK(map.Size() == count);
+  CHECK(IsSorted(map));
+  map.Clear();
+  CHECK(map.Empty());
+}
+
+TEST_CASE("ArtMap<V, A> prefix scans"){
+  Map map;
+  const char* keys[] = {"/etc/fstab", "/etc/hosts", "/usr/bin/cc", "/usr/bin/ld", "/usr/bin",
+                        "/usr/lib/libc.so", "/usr/libexec/helper", "/usr/share/doc/some/long/path"};
+  for(int i = 0; i < 8; i++){
+    REQUIRE(map.Insert(keys[i], i));
+  }
+  auto count = [&](const char* prefix){
+    return map.ForEachPrefix(prefix, [](const std::uint8_t*, std::size_t, int&){});
+  };
+  CHECK(count("") == 8);
+  CHECK(count("/") == 8);
+  CHECK(count("/etc/") == 2);
+  CHECK(count("/usr/bin") == 3);
+  CHECK(count("/usr/bin/") == 2);
+  CHECK(count("/usr/lib") == 2);
+  // the prefix ends inside a compressed path
+  CHECK(count("/usr/share/doc/so") == 1);
+  CHECK(count("/usr/share/doc/some/long/path") == 1);
+  CHECK(count("/usr/share/doc/some/long/path/") == 0);
+  CHECK(count("/usr/shared") == 0);
+  CHECK(count("/var") == 0);
+
+  int expected[] = {2, 3};
+  std::size_t index = 0;
+  map.ForEachPrefix("/usr/bin/", [&](const std::uint8_t*, std::size_t, int& val){
+    CHECK(val == expected[index]);
+    index++;
+  });
+  CHECK(index == 2);
+}
+
+TEST_CASE("ArtMap<V, A> move and swap"){
+  Map lhs;
+  Map rhs;
+  REQUIRE(lhs.Insert("left", 1));
+  REQUIRE(rhs.Insert("right", 2));
+  REQUIRE(rhs.Insert("righter", 3));
+  lhs.Swap(rhs);
+  CHECK(lhs.Size() == 2);
+  CHECK(lhs.Contains("righter"));
+  CHECK(rhs.Contains("left"));
+  Map moved{std::move(lhs)};
+  CHECK(lhs.Empty());
+  CHECK(*moved.Find("right") == 2);
+  rhs = std::move(moved);
+  CHECK(moved.Empty());
+  CHECK(rhs.Size() == 2);
+  CHECK(IsSorted(rhs));
+}
@@ -0,0 +1,102 @@
+#include "doctest.h"
+
+// Tests for Aii::Atomic<T> and the atomic operations on plain objects
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/atomic.hpp"
+
+#include "atomic_codegen.hpp"
+
+TEST_CASE("Atomic<T> operations"){
+  Aii::Atomic<std::uint64_t> val{5};
+  CHECK(val.Load() == 5);
+  val.Store(7, Aii::MemoryOrder::Release);
+  CHECK(val.Load(Aii::MemoryOrder::Acquire) == 7);
+  CHECK(val.Exchange(9) == 7);
+  CHECK(val.FetchAdd(1) == 9);
+  CHECK(val.FetchSub(2) == 10);
+  CHECK(val.FetchOr(0x10) == 8);
+  CHECK(val.FetchAnd(0x18) == 0x18);
+  CHECK(val.FetchXor(0x08) == 0x18);
+  CHECK(val.Load() == 0x10);
+
+  std::uint64_t expected = 3;
+  CHECK(!val.CompareExchangeStrong(expected, 4));
+  CHECK(expected == 0x10);
+  CHECK(val.CompareExchangeStrong(expected, 4, Aii::MemoryOrder::AcqRel));
+  CHECK(val.Load() == 4);
+  while(!val.CompareExchangeWeak(expected, 6)){}
+  CHECK(expected == 4);
+  CHECK(val.Load() == 6);
+
+  std::uint64_t array[8] = {};
+  Aii::Atomic<std::uint64_t*> pointer{array};
+  CHECK(pointer.FetchAdd(3) == array);
+  CHECK(pointer.FetchSub(1) == array + 3);
+  CHECK(pointer.Load() == array + 2);
+
+  struct Pair{
+    std::uint32_t a;
+    std::uint32_t b;
+  };
+  Aii::Atomic<Pair> pair{Pair{1, 2}};
+  Pair old = pair.Exchange(Pair{3, 4});
+  CHECK(old.b == 2);
+  Pair seen{0, 0};
+  CHECK(!pair.CompareExchangeStrong(seen, Pair{5, 6}));
+  CHECK(seen.a == 3);
+  CHECK(pair.CompareExchangeStrong(seen, Pair{5, 6}));
+  CHECK(pair.Load().b == 6);
+
+  int plain = 1;
+  Aii::AtomicStore(&plain, 2, Aii::MemoryOrder::Release);
+  CHECK(Aii::AtomicLoad(&plain, Aii::MemoryOrder::Acquire) == 2);
+  CHECK(Aii::AtomicExchange(&plain, 3) == 2);
+  int want = 3;
+  CHECK(Aii::AtomicCompareExchange(&plain, want, 4, Aii::MemoryOrder::SeqCst, Aii::MemoryOrder::Relaxed));
+  CHECK(plain == 4);
+}
+
+TEST_CASE("Atomic<T> between threads"){
+  constexpr unsigned Threads = 4;
+  constexpr std::uint64_t Adds = 100000;
+  Aii::Atomic<std::uint64_t> counter;
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < Threads; t++){
+    threads.emplace_back([&counter]{
+      for(std::uint64_t i = 0; i < Adds; i++){
+        counter.FetchAdd(1, Aii::MemoryOrder::Relaxed);
+        Aii::CpuRelax();
+      }
+    });
+  }
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  CHECK(counter.Load() == Threads * Adds);
+}
+
+#if defined(__x86_64__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+TEST_CASE("Atomic<T> compiles to the same code as std::atomic"){
+  // compares the whole machine code of each pair
+  const char* mismatch = nullptr;
+  for(std::size_t i = 0; i < AtomicCodegen::PairCount && !mismatch; i++){
+    const AtomicCodegen::Pair& pair = AtomicCodegen::Pairs[i];
+    std::size_t size = pair.aiiEnd - pair.aiiBegin;
+    if(size == 0 || size != static_cast<std::size_t>(pair.stdEnd - pair.stdBegin)){
+      mismatch = pair.name;
+      break;
+    }
+    for(std::size_t byte = 0; byte < size; byte++){
+      if(pair.aiiBegin[byte] != pair.stdBegin[byte]){
+        mismatch = pair.name;
+        break;
+      }
+    }
+  }
+  CHECK(mismatch == nullptr);
+}
+#endif
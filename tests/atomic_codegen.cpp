@@ -0,0 +1,137 @@
+// Pairs of functions doing the same operation through Aii::Atomic and
+// std::atomic, compiled with optimisation (see CMakeLists.txt) so the
+// machine code can be compared by tests/atomic.cpp. noipa keeps each
+// function separate and uninlined, and each one is placed alone in its own
+// section, so the __start_ and __stop_ symbols the linker defines for it
+// bound exactly the function's code.
+
+#include <atomic>
+#include <cstdint>
+
+#include "aii/atomic.hpp"
+
+#include "atomic_codegen.hpp"
+
+#define CODEGEN(fn) [[gnu::noipa, gnu::used, gnu::section("codegen_" #fn)]]
+#define CODEGEN_BOUNDS(fn) \
+  extern "C" const unsigned char __start_codegen_##fn[]; \
+  extern "C" const unsigned char __stop_codegen_##fn[];
+#define CODEGEN_PAIR(name, aii, std) \
+  {name, __start_codegen_##aii, __stop_codegen_##aii, __start_codegen_##std, __stop_codegen_##std}
+
+namespace{
+
+using Aii::MemoryOrder;
+
+CODEGEN(AiiLoadRelaxed) std::uint64_t AiiLoadRelaxed(Aii::Atomic<std::uint64_t>& a){ return a.Load(MemoryOrder::Relaxed);}
+CODEGEN(StdLoadRelaxed) std::uint64_t StdLoadRelaxed(std::atomic<std::uint64_t>& a){ return a.load(std::memory_order_relaxed);}
+
+CODEGEN(AiiLoadAcquire) std::uint64_t AiiLoadAcquire(Aii::Atomic<std::uint64_t>& a){ return a.Load(MemoryOrder::Acquire);}
+CODEGEN(StdLoadAcquire) std::uint64_t StdLoadAcquire(std::atomic<std::uint64_t>& a){ return a.load(std::memory_order_acquire);}
+
+CODEGEN(AiiLoadSeqCst) std::uint64_t AiiLoadSeqCst(Aii::Atomic<std::uint64_t>& a){ return a.Load();}
+CODEGEN(StdLoadSeqCst) std::uint64_t StdLoadSeqCst(std::atomic<std::uint64_t>& a){ return a.load();}
+
+CODEGEN(AiiStoreRelease) void AiiStoreRelease(Aii::Atomic<std::uint64_t>& a, std::uint64_t v){ a.Store(v, MemoryOrder::Release);}
+CODEGEN(StdStoreRelease) void StdStoreRelease(std::atomic<std::uint64_t>& a, std::uint64_t v){ a.store(v, std::memory_order_release);}
+
+CODEGEN(AiiStoreSeqCst) void AiiStoreSeqCst(Aii::Atomic<std::uint64_t>& a, std::uint64_t v){ a.Store(v);}
+CODEGEN(StdStoreSeqCst) void StdStoreSeqCst(std::atomic<std::uint64_t>& a, std::uint64_t v){ a.store(v);}
+
+CODEGEN(AiiExchange) std::uint64_t AiiExchange(Aii::Atomic<std::uint64_t>& a, std::uint64_t v){ return a.Exchange(v, MemoryOrder::AcqRel);}
+CODEGEN(StdExchange) std::uint64_t StdExchange(std::atomic<std::uint64_t>& a, std::uint64_t v){ return a.exchange(v, std::memory_order_acq_rel);}
+
+CODEGEN(AiiCasStrong) bool AiiCasStrong(Aii::Atomic<std::uint64_t>& a, std::uint64_t& e, std::uint64_t d){
+  return a.CompareExchangeStrong(e, d, MemoryOrder::AcqRel, MemoryOrder::Acquire);
+}
+CODEGEN(StdCasStrong) bool StdCasStrong(std::atomic<std::uint64_t>& a, std::uint64_t& e, std::uint64_t d){
+  return a.compare_exchange_strong(e, d, std::memory_order_acq_rel, std::memory_order_acquire);
+}
+
+CODEGEN(AiiCasWeak) bool AiiCasWeak(Aii::Atomic<std::uint32_t>& a, std::uint32_t& e, std::uint32_t d){ return a.CompareExchangeWeak(e, d);}
+CODEGEN(StdCasWeak) bool StdCasWeak(std::atomic<std::uint32_t>& a, std::uint32_t& e, std::uint32_t d){ return a.compare_exchange_weak(e, d);}
+
+CODEGEN(AiiFetchAdd) std::uint64_t AiiFetchAdd(Aii::Atomic<std::uint64_t>& a){ return a.FetchAdd(1, MemoryOrder::Relaxed);}
+CODEGEN(StdFetchAdd) std::uint64_t StdFetchAdd(std::atomic<std::uint64_t>& a){ return a.fetch_add(1, std::memory_order_relaxed);}
+
+CODEGEN(AiiFetchSub) std::uint32_t AiiFetchSub(Aii::Atomic<std::uint32_t>& a){ return a.FetchSub(1, MemoryOrder::Release);}
+CODEGEN(StdFetchSub) std::uint32_t StdFetchSub(std::atomic<std::uint32_t>& a){ return a.fetch_sub(1, std::memory_order_release);}
+
+CODEGEN(AiiFetchOr) std::uint64_t AiiFetchOr(Aii::Atomic<std::uint64_t>& a, std::uint64_t v){ return a.FetchOr(v);}
+CODEGEN(StdFetchOr) std::uint64_t StdFetchOr(std::atomic<std::uint64_t>& a, std::uint64_t v){ return a.fetch_or(v);}
+
+CODEGEN(AiiFetchAnd) std::uint8_t AiiFetchAnd(Aii::Atomic<std::uint8_t>& a, std::uint8_t v){ return a.FetchAnd(v, MemoryOrder::AcqRel);}
+CODEGEN(StdFetchAnd) std::uint8_t StdFetchAnd(std::atomic<std::uint8_t>& a, std::uint8_t v){ return a.fetch_and(v, std::memory_order_acq_rel);}
+
+CODEGEN(AiiPointerAdd) std::uint64_t* AiiPointerAdd(Aii::Atomic<std::uint64_t*>& a){ return a.FetchAdd(3);}
+CODEGEN(StdPointerAdd) std::uint64_t* StdPointerAdd(std::atomic<std::uint64_t*>& a){ return a.fetch_add(3);}
+
+CODEGEN(AiiBoolExchange) bool AiiBoolExchange(Aii::Atomic<bool>& a){ return a.Exchange(true, MemoryOrder::Acquire);}
+CODEGEN(StdBoolExchange) bool StdBoolExchange(std::atomic<bool>& a){ return a.exchange(true, std::memory_order_acquire);}
+
+CODEGEN(AiiFenceAcquire) void AiiFenceAcquire(){ Aii::ThreadFence(MemoryOrder::Acquire);}
+CODEGEN(StdFenceAcquire) void StdFenceAcquire(){ std::atomic_thread_fence(std::memory_order_acquire);}
+
+CODEGEN(AiiFenceSeqCst) void AiiFenceSeqCst(){ Aii::ThreadFence();}
+CODEGEN(StdFenceSeqCst) void StdFenceSeqCst(){ std::atomic_thread_fence(std::memory_order_seq_cst);}
+
+} // namespace
+
+CODEGEN_BOUNDS(fn)
+CODEGEN_BOUNDS(AiiLoadRelaxed)
+CODEGEN_BOUNDS(StdLoadRelaxed)
+CODEGEN_BOUNDS(AiiLoadAcquire)
+CODEGEN_BOUNDS(StdLoadAcquire)
+CODEGEN_BOUNDS(AiiLoadSeqCst)
+CODEGEN_BOUNDS(StdLoadSeqCst)
+CODEGEN_BOUNDS(AiiStoreRelease)
+CODEGEN_BOUNDS(StdStoreRelease)
+CODEGEN_BOUNDS(AiiStoreSeqCst)
+CODEGEN_BOUNDS(StdStoreSeqCst)
+CODEGEN_BOUNDS(AiiExchange)
+CODEGEN_BOUNDS(StdExchange)
+CODEGEN_BOUNDS(AiiCasStrong)
+CODEGEN_BOUNDS(StdCasStrong)
+CODEGEN_BOUNDS(AiiCasWeak)
+CODEGEN_BOUNDS(StdCasWeak)
+CODEGEN_BOUNDS(AiiFetchAdd)
+CODEGEN_BOUNDS(StdFetchAdd)
+CODEGEN_BOUNDS(AiiFetchSub)
+CODEGEN_BOUNDS(StdFetchSub)
+CODEGEN_BOUNDS(AiiFetchOr)
+CODEGEN_BOUNDS(StdFetchOr)
+CODEGEN_BOUNDS(AiiFetchAnd)
+CODEGEN_BOUNDS(StdFetchAnd)
+CODEGEN_BOUNDS(AiiPointerAdd)
+CODEGEN_BOUNDS(StdPointerAdd)
+CODEGEN_BOUNDS(AiiBoolExchange)
+CODEGEN_BOUNDS(StdBoolExchange)
+CODEGEN_BOUNDS(AiiFenceAcquire)
+CODEGEN_BOUNDS(StdFenceAcquire)
+CODEGEN_BOUNDS(AiiFenceSeqCst)
+CODEGEN_BOUNDS(StdFenceSeqCst)
+
+namespace AtomicCodegen{
+
+const Pair Pairs[] = {
+  CODEGEN_PAIR("load relaxed", AiiLoadRelaxed, StdLoadRelaxed),
+  CODEGEN_PAIR("load acquire", AiiLoadAcquire, StdLoadAcquire),
+  CODEGEN_PAIR("load seq_cst", AiiLoadSeqCst, StdLoadSeqCst),
+  CODEGEN_PAIR("store release", AiiStoreRelease, StdStoreRelease),
+  CODEGEN_PAIR("store seq_cst", AiiStoreSeqCst, StdStoreSeqCst),
+  CODEGEN_PAIR("exchange acq_rel", AiiExchange, StdExchange),
+  CODEGEN_PAIR("compare exchange strong", AiiCasStrong, StdCasStrong),
+  CODEGEN_PAIR("compare exchange weak", AiiCasWeak, StdCasWeak),
+  CODEGEN_PAIR("fetch add relaxed", AiiFetchAdd, StdFetchAdd),
+  CODEGEN_PAIR("fetch sub release", AiiFetchSub, StdFetchSub),
+  CODEGEN_PAIR("fetch or seq_cst", AiiFetchOr, StdFetchOr),
+  CODEGEN_PAIR("fetch and acq_rel", AiiFetchAnd, StdFetchAnd),
+  CODEGEN_PAIR("pointer fetch add", AiiPointerAdd, StdPointerAdd),
+  CODEGEN_PAIR("bool exchange", AiiBoolExchange, StdBoolExchange),
+  CODEGEN_PAIR("fence acquire", AiiFenceAcquire, StdFenceAcquire),
+  CODEGEN_PAIR("fence seq_cst", AiiFenceSeqCst, StdFenceSeqCst),
+};
+
+const std::size_t PairCount = sizeof(Pairs) / sizeof(Pairs[0]);
+
+} // namespace AtomicCodegen
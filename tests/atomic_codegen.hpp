@@ -0,0 +1,22 @@
+#pragma once
+
+// Functions from atomic_codegen.cpp, each operation once through
+// Aii::Atomic and once through std::atomic
+
+#include <cstddef>
+
+namespace AtomicCodegen{
+
+// each function's machine code is [begin, end)
+struct Pair{
+  const char* name;
+  const unsigned char* aiiBegin;
+  const unsigned char* aiiEnd;
+  const unsigned char* stdBegin;
+  const unsigned char* stdEnd;
+};
+
+extern const Pair Pairs[];
+extern const std::size_t PairCount;
+
+} // namespace AtomicCodegen
@@ -0,0 +1,295 @@
+#include "doctest.h"
+
+// Tests for Aii::BTreeMap<K, V, NodeBytes, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/btree.hpp"
+#include "aii/rbtree.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+// two cache lines hold 6 elements per leaf and 4 keys per inner node, so
+// small key counts already build trees several levels deep
+using Tree = Aii::BTreeMap<int, int, 64>;
+
+std::size_t CheckSubtree(const Tree::NodeBase* node, std::size_t level, bool root,
+                         const int* low, const int* high, bool& valid){
+  // returns the number of elements below node, clearing valid if a node is
+  // under or over full, unsorted, or holds a key outside [low, high)
+  std::size_t capacity = level == 0 ? Tree::LeafCapacity : Tree::InnerCapacity;
+  std::size_t minimum = level == 0 ? Tree::LeafMinimum : Tree::InnerMinimum;
+  if(node->count > capacity || (!root && node->count < minimum) || (root && node->count == 0)){
+    valid = false;
+    return 0;
+  }
+  const int* keys = level == 0 ? static_cast<const Tree::Leaf*>(node)->keys
+                               : static_cast<const Tree::Inner*>(node)->keys;
+  for(std::size_t i = 0; i < node->count; i++){
+    if((i > 0 && !(keys[i - 1] < keys[i])) || (low && keys[i] < *low) || (high && !(keys[i] < *high))){
+      valid = false;
+    }
+  }
+  if(level == 0){
+    return node->count;
+  }
+  const Tree::Inner* inner = static_cast<const Tree::Inner*>(node);
+  std::size_t count = 0;
+  for(std::size_t i = 0; i <= inner->count; i++){
+    const int* childLow = i == 0 ? low : &inner->keys[i - 1];
+    const int* childHigh = i == inner->count ? high : &inner->keys[i];
+    count += CheckSubtree(inner->children[i], level - 1, false, childLow, childHigh, valid);
+  }
+  return count;
+}
+
+bool IsValid(const Tree& tree){
+  if(!tree.Root()){
+    return tree.Size() == 0 && tree.begin() == tree.end();
+  }
+  bool valid = true;
+  std::size_t count = CheckSubtree(tree.Root(), tree.Height(), true, nullptr, nullptr, valid);
+  // the leaf chain visits every element once, in order
+  std::size_t linked = 0;
+  for(auto it = tree.begin(); it != tree.end(); ++it){
+    linked++;
+  }
+  return valid && count == tree.Size() && linked == tree.Size();
+}
+
+bool HasKeys(const Tree& tree, int first, int last, int step){
+  // tree holds exactly first, first + step, ... < last in order
+  int expected = first;
+  for(auto it = tree.begin(); it != tree.end(); ++it){
+    if(expected >= last || it.Key() != expected || it.Val() != expected * 10){
+      return false;
+    }
+    expected += step;
+  }
+  return expected >= last;
+}
+
+void FillSorted(Tree& tree, int first, int last, int step){
+  int keys[1024];
+  int vals[1024];
+  int count = 0;
+  for(int key = first; key < last; key += step){
+    keys[count] = key;
+    vals[count] = key * 10;
+    count++;
+  }
+  REQUIRE(tree.AssignSorted(keys, vals, count));
+}
+
+template<typename T>
+std::size_t ScalarCountLess(const T* keys, std::size_t count, T key){
+  std::size_t less = 0;
+  while(less < count && keys[less] < key){
+    less++;
+  }
+  return less;
+}
+
+template<typename T>
+bool CountLessAgrees(const T* keys, std::size_t size){
+  // every prefix of keys against every key and the values either side
+  for(std::size_t count = 0; count <= size; count++){
+    for(std::size_t i = 0; i < size; i++){
+      T probes[] = {keys[i], static_cast<T>(keys[i] - 1), static_cast<T>(keys[i] + 1)};
+      for(T probe : probes){
+        if(Aii::Details::BTreeCountLess(keys, count, probe) != ScalarCountLess(keys, count, probe)){
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template<typename Map>
+bool UseThroughCommonInterface(){
+  // code written against the RbTree interface compiles and behaves the same
+  // with a BTreeMap
+  Map map;
+  for(int i = 0; i < 100; i++){
+    if(!map.Insert((i * 7) % 100, i)){
+      return false;
+    }
+  }
+  if(map.Insert(5, 0).Error() != Aii::Error::InvalidArgument){
+    return false;
+  }
+  for(int i = 0; i < 100; i += 2){
+    if(!map.Erase(i)){
+      return false;
+    }
+  }
+  int expected = 1;
+  for(auto it = map.LowerBound(0); it != map.end(); ++it){
+    if(it.Key() != expected || *map.Find(it.Key()) != *it){
+      return false;
+    }
+    expected += 2;
+  }
+  return expected == 101 && map.Size() == 50 && !map.Contains(50);
+}
+
+} // namespace
+
+TEST_CASE("BTreeMap<K, V, NodeBytes, A> node layout"){
+  // nodes fill whole cache lines and start on a line boundary
+  CHECK(sizeof(Tree::Leaf) == 64);
+  CHECK(sizeof(Tree::Inner) == 64);
+  CHECK(alignof(Tree::Leaf) == Aii::CacheLineSize);
+  using U64Map = Aii::BTreeMap<std::uint64_t, std::uint64_t>;
+  CHECK(sizeof(U64Map::Leaf) == 256);
+  CHECK(U64Map::LeafCapacity == 15);
+  CHECK(U64Map::InnerCapacity == 15);
+}
+
+TEST_CASE("BTreeMap<K, V, NodeBytes, A> in-node search"){
+  SUBCASE("Signed 32 bit keys"){
+    int keys[] = {-2000000000, -70000, -5, 0, 3, 9, 100, 4096, 70000, 123456, 2000000000};
+    CHECK(CountLessAgrees(keys, sizeof(keys) / sizeof(keys[0])));
+  }
+  SUBCASE("Unsigned 32 bit keys above the signed range"){
+    std::uint32_t keys[] = {1, 2, 100, 0x7fffffff, 0x80000000, 0x80000001, 0xfffffff0, 0xfffffffe};
+    CHECK(CountLessAgrees(keys, sizeof(keys) / sizeof(keys[0])));
+  }
+  SUBCASE("64 bit keys"){
+    std::int64_t signedKeys[] = {-(1ll << 62), -3, 0, 8, 1ll << 40, 1ll << 62};
+    std::uint64_t unsignedKeys[] = {1, 0x7fffffffffffffff, 0x8000000000000000, 0xfffffffffffffff0};
+    CHECK(CountLessAgrees(signedKeys, sizeof(signedKeys) / sizeof(signedKeys[0])));
+    CHECK(CountLessAgrees(unsignedKeys, sizeof(unsignedKeys) / sizeof(unsignedKeys[0])));
+  }
+}
+
+TEST_CASE("BTreeMap<K, V, NodeBytes, A> insert, find and erase"){
+  Tree tree;
+  REQUIRE(tree.Empty());
+
+  SUBCASE("Inserted keys can be found and iterate in order"){
+    for(int i = 0; i < 500; i++){
+      int key = (i * 37) % 500;
+      auto res = tree.Insert(key, key * 10);
+      REQUIRE(res);
+      CHECK(**res == key * 10);
+      REQUIRE(IsValid(tree));
+    }
+    CHECK(tree.Size() == 500);
+    CHECK(tree.Height() >= 3);
+    CHECK(HasKeys(tree, 0, 500, 1));
+    REQUIRE(tree.Find(42));
+    CHECK(*tree.Find(42) == 420);
+    CHECK(!tree.Find(500));
+    CHECK(!tree.Find(-1));
+  }
+  SUBCASE("Inserting a duplicate key is an invalid argument"){
+    for(int i = 0; i < 50; i++){
+      REQUIRE(tree.Insert(i, i));
+    }
+    auto res = tree.Insert(17, 2);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(*tree.Find(17) == 17);
+    CHECK(tree.Size() == 50);
+    CHECK(IsValid(tree));
+  }
+  SUBCASE("Erase keeps every node at or above its minimum"){
+    for(int i = 0; i < 600; i++){
+      REQUIRE(tree.Insert(i, i));
+    }
+    for(int i = 0; i < 600; i += 2){
+      REQUIRE(tree.Erase((i * 7) % 600));
+      REQUIRE(IsValid(tree));
+    }
+    CHECK(tree.Size() == 300);
+    auto res = tree.Erase(1000);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::OutOfRange);
+    CHECK(IsValid(tree));
+  }
+  SUBCASE("Erasing every key empties the tree"){
+    for(int i = 0; i < 300; i++){
+      REQUIRE(tree.Insert(i, i));
+    }
+    for(int i = 0; i < 300; i++){
+      REQUIRE(tree.Erase((i * 113) % 300));
+      REQUIRE(IsValid(tree));
+    }
+    CHECK(tree.Empty());
+    CHECK(tree.Height() == 0);
+    CHECK(tree.Erase(0).Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("LowerBound crosses leaf boundaries"){
+    FillSorted(tree, 0, 1000, 10);
+    for(int key = -5; key < 1000; key++){
+      auto it = tree.LowerBound(key);
+      int expected = key < 0 ? 0 : (key + 9) / 10 * 10;
+      if(expected >= 1000){
+        REQUIRE(it == tree.end());
+      }
+      else{
+        REQUIRE(it != tree.end());
+        REQUIRE(it.Key() == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE("BTreeMap<K, V, NodeBytes, A> AssignSorted builds a valid tree"){
+  Tree tree;
+  SUBCASE("Every size up to 1000 is valid"){
+    for(int count = 0; count < 1000; count++){
+      FillSorted(tree, 0, count, 1);
+      REQUIRE(IsValid(tree));
+      REQUIRE(tree.Size() == static_cast<std::size_t>(count));
+      REQUIRE(HasKeys(tree, 0, count, 1));
+    }
+  }
+  SUBCASE("A bulk built tree accepts further changes"){
+    FillSorted(tree, 0, 1000, 2);
+    for(int i = 1; i < 1000; i += 2){
+      REQUIRE(tree.Insert(i, i * 10));
+    }
+    REQUIRE(IsValid(tree));
+    CHECK(HasKeys(tree, 0, 1000, 1));
+    for(int i = 0; i < 1000; i += 3){
+      REQUIRE(tree.Erase(i));
+    }
+    CHECK(IsValid(tree));
+  }
+  SUBCASE("Unsorted input is rejected and leaves the tree untouched"){
+    FillSorted(tree, 0, 10, 1);
+    int keys[] = {1, 3, 2};
+    int vals[] = {1, 1, 1};
+    auto res = tree.AssignSorted(keys, vals, 3);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Size() == 10);
+  }
+}
+
+TEST_CASE("BTreeMap<K, V, NodeBytes, A> matches the RbTree interface"){
+  CHECK(UseThroughCommonInterface<Aii::RbTree<int, int>>());
+  CHECK(UseThroughCommonInterface<Aii::BTreeMap<int, int>>());
+  CHECK(UseThroughCommonInterface<Tree>());
+}
+
+TEST_CASE("BTreeMap<K, V, NodeBytes, A> move and swap"){
+  Tree lhs;
+  Tree rhs;
+  FillSorted(lhs, 0, 100, 1);
+  FillSorted(rhs, 0, 10, 1);
+  lhs.Swap(rhs);
+  CHECK(lhs.Size() == 10);
+  CHECK(rhs.Size() == 100);
+  Tree moved{std::move(rhs)};
+  CHECK(rhs.Empty());
+  CHECK(HasKeys(moved, 0, 100, 1));
+  lhs = std::move(moved);
+  CHECK(HasKeys(lhs, 0, 100, 1));
+  CHECK(IsValid(lhs));
+}
@@ -0,0 +1,154 @@
+#include "doctest.h"
+
+// Tests for Aii::ConcurrentHashMap<K, V, Hash, Eq, A>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/atomic.hpp"
+#include "aii/concurrent_hash_map.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+using Map = Aii::ConcurrentHashMap<std::uint64_t, std::uint64_t>;
+
+// values readers can check for tearing: both halves derive from the key
+struct Record{
+  std::uint64_t key;
+  std::uint64_t check;
+};
+
+using RecordMap = Aii::ConcurrentHashMap<std::uint64_t, Record>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+} // namespace
+
+TEST_CASE("ConcurrentHashMap<K, V, Hash, Eq, A> insert, find and erase"){
+  Map map;
+  REQUIRE(map.Empty());
+  CHECK(!map.Find(1));
+  CHECK(map.Erase(1).Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("Inserted keys can be found and the table grows"){
+    for(std::uint64_t key = 0; key < 10000; key++){
+      REQUIRE(map.Insert(key, key * 3));
+    }
+    CHECK(map.Size() == 10000);
+    CHECK(map.BucketCount() >= 4096);
+    for(std::uint64_t key = 0; key < 10000; key++){
+      auto val = map.Find(key);
+      REQUIRE(val);
+      REQUIRE(*val == key * 3);
+    }
+    CHECK(!map.Contains(10000));
+  }
+  SUBCASE("A duplicate key is an invalid argument unless assigned"){
+    REQUIRE(map.Insert(7, 21));
+    auto res = map.Insert(7, 0);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(*map.Find(7) == 21);
+    REQUIRE(map.InsertOrAssign(7, 22));
+    REQUIRE(map.InsertOrAssign(8, 24));
+    CHECK(*map.Find(7) == 22);
+    CHECK(*map.Find(8) == 24);
+    CHECK(map.Size() == 2);
+  }
+  SUBCASE("Erase and clear"){
+    for(std::uint64_t key = 0; key < 1000; key++){
+      REQUIRE(map.Insert(key, key * 3));
+    }
+    for(std::uint64_t key = 0; key < 1000; key += 2){
+      REQUIRE(map.Erase(key));
+    }
+    CHECK(map.Size() == 500);
+    for(std::uint64_t key = 0; key < 1000; key++){
+      REQUIRE(map.Contains(key) == (key % 2 == 1));
+    }
+    map.Reclaim();
+    map.Clear();
+    CHECK(map.Empty());
+    CHECK(!map.Contains(1));
+    REQUIRE(map.Insert(1, 3));
+    CHECK(*map.Find(1) == 3);
+  }
+}
+
+TEST_CASE("ConcurrentHashMap<K, V, Hash, Eq, A> readers run alongside writers"){
+  // Writers insert, replace and erase keys while readers look them up. A
+  // reader must only ever see a whole record for the key it asked for, and
+  // freed nodes would show up under the address sanitizer.
+  RecordMap map;
+  constexpr std::uint64_t Keys = 4096;
+  constexpr int Writers = 2;
+  constexpr int Readers = 4;
+  for(std::uint64_t key = 0; key < Keys; key += 2){
+    REQUIRE(map.Insert(key, Record{key, ~key}));
+  }
+  // odd keys are never erased, so readers can also check nothing is lost
+  // across a resize
+  Aii::Atomic<bool> done{false};
+  Aii::Atomic<std::uint64_t> badReads{0};
+  Aii::Atomic<std::uint64_t> lostKeys{0};
+  std::vector<std::thread> threads;
+  for(int r = 0; r < Readers; r++){
+    threads.emplace_back([&, r]{
+      std::uint64_t state = 100 + r;
+      std::uint64_t bad = 0;
+      std::uint64_t lost = 0;
+      while(!done.Load(Aii::MemoryOrder::Acquire)){
+        std::uint64_t key = NextRandom(state) % Keys;
+        auto record = map.Find(key);
+        if(record && (record->key != key || record->check != ~key)){
+          bad++;
+        }
+        if(key % 2 == 0 && !record){
+          lost++;
+        }
+      }
+      badReads.FetchAdd(bad, Aii::MemoryOrder::Relaxed);
+      lostKeys.FetchAdd(lost, Aii::MemoryOrder::Relaxed);
+    });
+  }
+  std::vector<std::thread> writers;
+  for(int w = 0; w < Writers; w++){
+    writers.emplace_back([&, w]{
+      std::uint64_t state = 7 + w;
+      for(int i = 0; i < 40000; i++){
+        // odd keys owned by this writer come and go, even keys are replaced
+        std::uint64_t key = NextRandom(state) % Keys;
+        if(key % 2 == 0){
+          (void)map.InsertOrAssign(key, Record{key, ~key});
+        }
+        else if(key % (2 * Writers) == static_cast<std::uint64_t>(2 * w + 1)){
+          if(!map.Erase(key)){
+            (void)map.Insert(key, Record{key, ~key});
+          }
+        }
+        else{
+          // unrelated keys force the table to grow under the readers
+          std::uint64_t far = Keys + i * Writers + w;
+          (void)map.Insert(far, Record{far, ~far});
+        }
+      }
+    });
+  }
+  for(std::thread& writer : writers){
+    writer.join();
+  }
+  done.Store(true, Aii::MemoryOrder::Release);
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  CHECK(badReads.Load() == 0);
+  CHECK(lostKeys.Load() == 0);
+  for(std::uint64_t key = 0; key < Keys; key += 2){
+    REQUIRE(map.Contains(key));
+  }
+}
@@ -0,0 +1,163 @@
+#include "doctest.h"
+
+// Tests for Aii::Deque<T, ChunkSize, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/deque.hpp"
+#include "aii/allocator.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+namespace{
+
+using Fixtures::CountingAllocator;
+using Fixtures::allocations;
+using Fixtures::Tracked;
+
+// small chunks so a few hundred elements cross many chunk and map edges
+using Queue = Aii::Deque<std::uint64_t, 8, CountingAllocator<std::uint64_t>>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+} // namespace
+
+static_assert(Aii::Details::DequeChunkSize<std::uint64_t>() == 512);
+static_assert(Aii::Details::DequeChunkSize<char[1000]>() == 16);
+
+TEST_CASE("Deque<T, ChunkSize, A> push and pop at both ends"){
+  allocations = 0;
+  Queue deque;
+  REQUIRE(deque.Empty());
+  CHECK(deque.begin() == deque.end());
+  CHECK(deque.PopBack().Error() == Aii::Error::OutOfRange);
+  CHECK(deque.PopFront().Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("Elements are indexed from the front and never move"){
+    std::uint64_t* addresses[400];
+    for(std::uint64_t i = 0; i < 200; i++){
+      addresses[200 + i] = *deque.PushBack(200 + i);
+      addresses[199 - i] = *deque.PushFront(199 - i);
+    }
+    REQUIRE(deque.Size() == 400);
+    CHECK(deque.Front() == 0);
+    CHECK(deque.Back() == 399);
+    std::uint64_t expected = 0;
+    for(std::uint64_t& val : deque){
+      REQUIRE(val == expected);
+      REQUIRE(&val == addresses[expected]);
+      expected++;
+    }
+    for(std::size_t i = 0; i < 400; i++){
+      REQUIRE(&deque[i] == addresses[i]);
+    }
+    // one allocation per chunk of 8, plus a few for the map
+    CHECK(allocations < 400 / 8 + 10);
+  }
+  SUBCASE("Matches a reference under random operations"){
+    // the reference is a ring large enough to never wrap into itself
+    constexpr std::size_t Ring = 1 << 12;
+    std::uint64_t ring[Ring];
+    std::size_t head = Ring / 2;
+    std::size_t size = 0;
+    std::uint64_t state = 3;
+    for(int op = 0; op < 20000; op++){
+      std::uint64_t random = NextRandom(state);
+      std::uint64_t val = random >> 8;
+      switch(random % 4){
+        case 0:
+          if(size < Ring){
+            REQUIRE(deque.PushBack(val));
+            ring[(head + size) % Ring] = val;
+            size++;
+          }
+          break;
+        case 1:
+          if(size < Ring){
+            REQUIRE(deque.PushFront(val));
+            head = (head + Ring - 1) % Ring;
+            ring[head] = val;
+            size++;
+          }
+          break;
+        case 2:
+          REQUIRE(deque.PopBack().HasVal() == (size > 0));
+          size -= size > 0;
+          break;
+        default:
+          REQUIRE(deque.PopFront().HasVal() == (size > 0));
+          if(size){
+            head = (head + 1) % Ring;
+            size--;
+          }
+          break;
+      }
+      REQUIRE(deque.Size() == size);
+      if(size){
+        REQUIRE(deque.Front() == ring[head]);
+        REQUIRE(deque.Back() == ring[(head + size - 1) % Ring]);
+        std::size_t index = val % size;
+        REQUIRE(deque[index] == ring[(head + index) % Ring]);
+      }
+    }
+  }
+  SUBCASE("A queue at its working size stops allocating"){
+    for(std::uint64_t i = 0; i < 100; i++){
+      REQUIRE(deque.PushBack(i));
+    }
+    int settled = allocations;
+    for(std::uint64_t i = 100; i < 100000; i++){
+      REQUIRE(deque.PushBack(i));
+      REQUIRE(deque.Front() == i - 100);
+      REQUIRE(deque.PopFront());
+    }
+    // the chunk freed at the front is reused at the back, and the map only
+    // recentres
+    CHECK(allocations - settled <= 2);
+  }
+  SUBCASE("Clear, move and swap"){
+    for(std::uint64_t i = 0; i < 50; i++){
+      REQUIRE(deque.PushBack(i));
+    }
+    Queue other{std::move(deque)};
+    CHECK(deque.Empty());
+    CHECK(other.Size() == 50);
+    CHECK(other[49] == 49);
+    deque.Swap(other);
+    CHECK(deque[10] == 10);
+    CHECK(other.Empty());
+    deque.Clear();
+    CHECK(deque.Empty());
+    REQUIRE(deque.PushFront(7));
+    CHECK(deque.Back() == 7);
+    other = std::move(deque);
+    CHECK(other.Front() == 7);
+    other.ShrinkToFit();
+    CHECK(other.Front() == 7);
+  }
+}
+
+TEST_CASE("Deque<T, ChunkSize, A> element lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::Deque<Tracked, 4> deque;
+    for(int i = 0; i < 30; i++){
+      REQUIRE(deque.EmplaceBack(i));
+      REQUIRE(deque.EmplaceFront(-i));
+    }
+    CHECK(Tracked::live == 60);
+    for(int i = 0; i < 10; i++){
+      REQUIRE(deque.PopBack());
+      REQUIRE(deque.PopFront());
+    }
+    CHECK(Tracked::live == 40);
+    CHECK(deque.Front().val == -19);
+    CHECK(deque.Back().val == 19);
+  }
+  CHECK(Tracked::live == 0);
+}
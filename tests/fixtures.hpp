@@ -0,0 +1,47 @@
+#pragma once
+
+// Types shared by the container tests
+
+#include <cstddef>
+
+#include "aii/allocator.hpp"
+
+namespace Fixtures{
+
+// counts live objects, and checks that each one is still at the address it
+// was constructed or moved to
+struct Tracked{
+  static inline int live = 0;
+
+  int val;
+  Tracked* self;
+
+  Tracked(int v = 0) noexcept: val{v}, self{this}{ live++;}
+  Tracked(const Tracked& src) noexcept: val{src.val}, self{this}{ live++;}
+  Tracked(Tracked&& src) noexcept: val{src.val}, self{this}{ live++;}
+  Tracked& operator=(const Tracked& src) noexcept{ val = src.val; return *this;}
+  Tracked& operator=(Tracked&& src) noexcept{ val = src.val; return *this;}
+  ~Tracked() noexcept{ live--;}
+
+  bool Intact() const noexcept{ return self == this;}
+};
+
+// Aii::Allocator which counts the allocations made through it
+inline int allocations = 0;
+
+template<typename T>
+struct CountingAllocator{
+  using ValueType = T;
+
+  T* Allocate() noexcept{ allocations++; return Aii::Allocator<T>{}.Allocate();}
+  T* Allocate(std::size_t n) noexcept{ allocations++; return Aii::Allocator<T>{}.Allocate(n);}
+  void Deallocate(T* obj) noexcept{ Aii::Allocator<T>{}.Deallocate(obj);}
+  void Deallocate(T* obj, std::size_t n) noexcept{ Aii::Allocator<T>{}.Deallocate(obj, n);}
+
+  template<typename U>
+  struct Rebind{
+    using other = CountingAllocator<U>;
+  };
+};
+
+} // namespace Fixtures
@@ -0,0 +1,263 @@
+#include "doctest.h"
+
+// Tests for Aii::FlatHashMap<K, V, Hash, Eq, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/flat_hash_map.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+using Map = Aii::FlatHashMap<std::uint64_t, std::uint64_t>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+// every key lands in the same probe sequence, so lookups depend on the
+// control bytes and the key compare alone
+struct CollidingHash{
+  std::uint64_t operator()(std::uint64_t key) const noexcept{ return key & 0x7f;}
+};
+
+// a name held inline, which can be looked up by a C string without
+// building one
+struct Name{
+  char str[16];
+
+  explicit Name(const char* src){
+    std::size_t i = 0;
+    for(; src[i] && i < 15; i++){
+      str[i] = src[i];
+    }
+    str[i] = '\0';
+  }
+};
+
+bool SameString(const char* lhs, const char* rhs){
+  while(*lhs && *lhs == *rhs){
+    lhs++;
+    rhs++;
+  }
+  return *lhs == *rhs;
+}
+
+struct NameHash{
+  using is_transparent = void;
+
+  std::uint64_t operator()(const char* str) const noexcept{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    while(*str){
+      hash = (hash ^ static_cast<unsigned char>(*str++)) * 0x100000001b3ull;
+    }
+    return Aii::Details::HashMix64(hash);
+  }
+  std::uint64_t operator()(const Name& name) const noexcept{ return (*this)(name.str);}
+};
+
+struct NameEq{
+  using is_transparent = void;
+
+  bool operator()(const Name& lhs, const Name& rhs) const noexcept{ return SameString(lhs.str, rhs.str);}
+  bool operator()(const Name& lhs, const char* rhs) const noexcept{ return SameString(lhs.str, rhs);}
+};
+
+template<typename T>
+bool HasEveryEntry(const T& map){
+  // iteration visits each entry once and values match their keys
+  std::size_t count = 0;
+  for(auto it = map.begin(); it != map.end(); ++it){
+    if(*it != it.Key() * 3 || map.Find(it.Key()) != &*it){
+      return false;
+    }
+    count++;
+  }
+  return count == map.Size();
+}
+
+template<typename Group>
+bool GroupAgrees(const std::int8_t* ctrl, std::uint8_t h2){
+  // masks of Group against a byte by byte scan. Match may report a byte
+  // just after a real match as well, never fewer.
+  Group group{ctrl};
+  std::uint64_t match = group.Match(h2);
+  std::uint64_t empty = group.MatchEmpty();
+  std::uint64_t free = group.MatchEmptyOrDeleted();
+  for(std::size_t i = 0; i < Group::Width; i++){
+    std::uint64_t bit = std::uint64_t{1} << ((i << Group::SlotShift) + (Group::SlotShift ? 7 : 0));
+    if(ctrl[i] == static_cast<std::int8_t>(h2) && !(match & bit)){
+      return false;
+    }
+    if(((empty & bit) != 0) != (ctrl[i] == Aii::Details::CtrlEmpty)){
+      return false;
+    }
+    if(((free & bit) != 0) != !Aii::Details::IsFull(ctrl[i])){
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+TEST_CASE("FlatHashMap<K, V, Hash, Eq, A> control byte groups"){
+  std::int8_t ctrl[16] = {5, Aii::Details::CtrlEmpty, 5, Aii::Details::CtrlDeleted,
+                          6, 4, Aii::Details::CtrlEmpty, 0x7f,
+                          0, 5, Aii::Details::CtrlDeleted, 5,
+                          1, Aii::Details::CtrlEmpty, 127, 5};
+  for(std::uint8_t h2 : {0, 1, 4, 5, 6, 0x7f}){
+    CHECK(GroupAgrees<Aii::Details::SwissGroupPortable>(ctrl, h2));
+    CHECK(GroupAgrees<Aii::Details::SwissGroupPortable>(ctrl + 8, h2));
+    CHECK(GroupAgrees<Aii::Details::SwissGroup>(ctrl, h2));
+  }
+}
+
+TEST_CASE("FlatHashMap<K, V, Hash, Eq, A> insert, find and erase"){
+  Map map;
+  REQUIRE(map.Empty());
+  CHECK(!map.Find(1));
+  CHECK(map.Erase(1).Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("Inserted keys can be found"){
+    for(std::uint64_t key = 0; key < 1000; key++){
+      auto res = map.Insert(key * 7919, key * 7919 * 3);
+      REQUIRE(res);
+      CHECK(**res == key * 7919 * 3);
+    }
+    CHECK(map.Size() == 1000);
+    // the load factor stays at or below 7/8
+    CHECK(map.Capacity() * 7 / 8 >= 1000);
+    for(std::uint64_t key = 0; key < 1000; key++){
+      REQUIRE(map.Find(key * 7919));
+      CHECK(*map.Find(key * 7919) == key * 7919 * 3);
+      CHECK(!map.Find(key * 7919 + 1));
+    }
+    // lookups by a convertible type go through the key type
+    CHECK(map.Contains(7919));
+    CHECK(HasEveryEntry(map));
+  }
+  SUBCASE("Inserting a duplicate key is an invalid argument"){
+    REQUIRE(map.Insert(42, 126));
+    auto res = map.Insert(42, 0);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(*map.Find(42) == 126);
+    CHECK(map.Size() == 1);
+  }
+  SUBCASE("Random operations agree with a bitmap"){
+    bool present[8192] = {};
+    std::uint64_t state = 3;
+    for(int i = 0; i < 100000; i++){
+      std::uint64_t key = NextRandom(state) % 8192;
+      if(present[key]){
+        REQUIRE(map.Erase(key));
+      }
+      else{
+        REQUIRE(map.Insert(key, key * 3));
+      }
+      present[key] = !present[key];
+    }
+    std::size_t count = 0;
+    for(std::uint64_t key = 0; key < 8192; key++){
+      REQUIRE(map.Contains(key) == present[key]);
+      count += present[key] ? 1 : 0;
+    }
+    CHECK(map.Size() == count);
+    CHECK(HasEveryEntry(map));
+  }
+  SUBCASE("Clear keeps the storage"){
+    for(std::uint64_t key = 0; key < 100; key++){
+      REQUIRE(map.Insert(key, key * 3));
+    }
+    std::size_t capacity = map.Capacity();
+    map.Clear();
+    CHECK(map.Empty());
+    CHECK(map.Capacity() == capacity);
+    CHECK(!map.Contains(5));
+    REQUIRE(map.Insert(5, 15));
+    CHECK(HasEveryEntry(map));
+  }
+}
+
+TEST_CASE("FlatHashMap<K, V, Hash, Eq, A> tombstones"){
+  SUBCASE("Steady insert and erase traffic rehashes in place"){
+    Map map;
+    REQUIRE(map.Reserve(100));
+    std::size_t capacity = map.Capacity();
+    for(std::uint64_t key = 0; key < 100; key++){
+      REQUIRE(map.Insert(key, key * 3));
+    }
+    // a sliding window of 100 keys over 100000 inserts leaves a tombstone
+    // behind most erases
+    for(std::uint64_t key = 100; key < 100000; key++){
+      REQUIRE(map.Erase(key - 100));
+      REQUIRE(map.Insert(key, key * 3));
+    }
+    CHECK(map.Capacity() == capacity);
+    CHECK(map.Size() == 100);
+    for(std::uint64_t key = 99900; key < 100000; key++){
+      REQUIRE(map.Contains(key));
+    }
+    CHECK(!map.Contains(99899));
+    CHECK(HasEveryEntry(map));
+  }
+  SUBCASE("Long probe sequences survive erase and rehash"){
+    Aii::FlatHashMap<std::uint64_t, std::uint64_t, CollidingHash> map;
+    for(std::uint64_t key = 0; key < 200; key++){
+      REQUIRE(map.Insert(key, key * 3));
+    }
+    for(std::uint64_t key = 0; key < 200; key += 2){
+      REQUIRE(map.Erase(key));
+    }
+    for(std::uint64_t round = 0; round < 20; round++){
+      for(std::uint64_t key = 1000; key < 1050; key++){
+        REQUIRE(map.Insert(key, key * 3));
+      }
+      for(std::uint64_t key = 1000; key < 1050; key++){
+        REQUIRE(map.Erase(key));
+      }
+    }
+    for(std::uint64_t key = 0; key < 200; key++){
+      REQUIRE(map.Contains(key) == (key % 2 == 1));
+    }
+    CHECK(map.Size() == 100);
+    CHECK(HasEveryEntry(map));
+  }
+}
+
+TEST_CASE("FlatHashMap<K, V, Hash, Eq, A> heterogeneous lookup"){
+  Aii::FlatHashMap<Name, int, NameHash, NameEq> map;
+  REQUIRE(map.Insert(Name{"init"}, 1));
+  REQUIRE(map.Insert(Name{"kthreadd"}, 2));
+  REQUIRE(map.Insert(Name{"sshd"}, 300));
+  REQUIRE(map.Find("kthreadd"));
+  CHECK(*map.Find("kthreadd") == 2);
+  CHECK(*map.Find(Name{"sshd"}) == 300);
+  CHECK(!map.Contains("bash"));
+  REQUIRE(map.Erase("init"));
+  CHECK(!map.Contains("init"));
+  CHECK(map.Size() == 2);
+}
+
+TEST_CASE("FlatHashMap<K, V, Hash, Eq, A> move and swap"){
+  Map lhs;
+  Map rhs;
+  for(std::uint64_t key = 0; key < 50; key++){
+    REQUIRE(lhs.Insert(key, key * 3));
+  }
+  REQUIRE(rhs.Insert(1000, 3000));
+  lhs.Swap(rhs);
+  CHECK(lhs.Size() == 1);
+  CHECK(rhs.Size() == 50);
+  Map moved{std::move(rhs)};
+  CHECK(rhs.Empty());
+  CHECK(rhs.Capacity() == 0);
+  CHECK(HasEveryEntry(moved));
+  lhs = std::move(moved);
+  CHECK(lhs.Size() == 50);
+  CHECK(!lhs.Contains(1000));
+  CHECK(HasEveryEntry(lhs));
+}
@@ -0,0 +1,127 @@
+#include "doctest.h"
+
+// Tests for aii/hash.hpp
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aii/hash.hpp"
+
+namespace{
+
+constexpr std::uint8_t Check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+// published CRC32C check value
+static_assert(Aii::Crc32c(Check, sizeof(Check)) == 0xe3069283u);
+static_assert(Aii::Crc32c(Check, 0) == 0);
+
+constexpr std::uint64_t ConstantHash = Aii::HashBytes(Check, sizeof(Check));
+constexpr std::uint64_t ConstantWord = Aii::HashU64(0x0123456789abcdefull, 5);
+
+void Fill(std::uint8_t* data, std::size_t length, std::uint64_t seed){
+  for(std::size_t i = 0; i < length; i++){
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    data[i] = static_cast<std::uint8_t>(seed >> 56);
+  }
+}
+
+// every length up to a few blocks, at every alignment within a word, so each
+// branch of the hashes and each tail length is covered
+constexpr std::size_t MaxLength = 200;
+
+} // namespace
+
+TEST_CASE("HashBytes and HashU64"){
+  std::uint8_t buffer[MaxLength + 8];
+  Fill(buffer, sizeof(buffer), 1);
+
+  SUBCASE("Constant evaluation gives the runtime result"){
+    const std::uint8_t* runtime = Check;
+    CHECK(Aii::HashBytes(runtime, sizeof(Check)) == ConstantHash);
+    CHECK(Aii::HashBytes(static_cast<const void*>(Check), sizeof(Check)) == ConstantHash);
+    volatile std::uint64_t word = 0x0123456789abcdefull;
+    CHECK(Aii::HashU64(word, 5) == ConstantWord);
+  }
+  SUBCASE("The hash depends on the bytes and not their address"){
+    for(std::size_t length = 0; length <= MaxLength; length++){
+      std::uint8_t copy[MaxLength + 8];
+      std::uint64_t expected = Aii::HashBytes(buffer, length);
+      for(std::size_t offset = 0; offset < 8; offset++){
+        for(std::size_t i = 0; i < length; i++){
+          copy[offset + i] = buffer[i];
+        }
+        REQUIRE(Aii::HashBytes(copy + offset, length) == expected);
+      }
+    }
+  }
+  SUBCASE("Length, seed and every byte change the hash"){
+    for(std::size_t length = 1; length <= MaxLength; length++){
+      std::uint64_t hash = Aii::HashBytes(buffer, length);
+      REQUIRE(hash != Aii::HashBytes(buffer, length - 1));
+      REQUIRE(hash != Aii::HashBytes(buffer, length, 1));
+      for(std::size_t i = 0; i < length; i++){
+        buffer[i] ^= 0x01;
+        REQUIRE(hash != Aii::HashBytes(buffer, length));
+        buffer[i] ^= 0x01;
+      }
+    }
+  }
+  SUBCASE("One flipped input bit flips about half of the output bits"){
+    // averaged over many inputs, including small integers, which a weak
+    // mix would leave clustered in the low bits
+    std::uint64_t flipped = 0;
+    std::uint64_t trials = 0;
+    for(std::uint64_t val = 0; val < 256; val++){
+      std::uint64_t hash = Aii::HashU64(val);
+      for(int bit = 0; bit < 64; bit++){
+        flipped += __builtin_popcountll(hash ^ Aii::HashU64(val ^ (1ull << bit)));
+        trials++;
+      }
+    }
+    double average = static_cast<double>(flipped) / static_cast<double>(trials);
+    CHECK(average > 31.0);
+    CHECK(average < 33.0);
+  }
+  SUBCASE("Hash<T> spreads consecutive integers over the top bits"){
+    Aii::Hash<std::uint32_t> hash;
+    bool seen[128] = {};
+    for(std::uint32_t val = 0; val < 1024; val++){
+      seen[hash(val) >> 57] = true;
+    }
+    std::size_t used = 0;
+    for(bool bucket : seen){
+      used += bucket;
+    }
+    CHECK(used == 128);
+  }
+}
+
+TEST_CASE("Crc32c"){
+  std::uint8_t buffer[MaxLength + 8];
+  Fill(buffer, sizeof(buffer), 2);
+
+  SUBCASE("The check value at runtime"){
+    const std::uint8_t* runtime = Check;
+    CHECK(Aii::Crc32c(runtime, sizeof(Check)) == 0xe3069283u);
+    CHECK(Aii::Crc32c(static_cast<const void*>(Check), sizeof(Check)) == 0xe3069283u);
+  }
+  SUBCASE("The instruction and the tables agree with a bitwise crc"){
+    for(std::size_t length = 0; length <= MaxLength; length++){
+      std::uint32_t crc = ~0u;
+      for(std::size_t i = 0; i < length; i++){
+        crc = (crc >> 8) ^ Aii::Details::Crc32cByteTable((crc ^ buffer[i]) & 0xff);
+      }
+      crc = ~crc;
+      REQUIRE(Aii::Crc32c(buffer, length) == crc);
+      REQUIRE(~Aii::Details::Crc32cSlicing(buffer, length, ~0u) == crc);
+      REQUIRE(~Aii::Details::Crc32cSlicing(buffer + 3, length, ~0u) == Aii::Crc32c(buffer + 3, length));
+    }
+  }
+  SUBCASE("Checksums continue across pieces"){
+    std::uint32_t whole = Aii::Crc32c(buffer, MaxLength);
+    for(std::size_t split = 0; split <= MaxLength; split += 7){
+      std::uint32_t crc = Aii::Crc32c(buffer, split);
+      REQUIRE(Aii::Crc32c(buffer + split, MaxLength - split, crc) == whole);
+    }
+  }
+}
@@ -0,0 +1,171 @@
+#include "doctest.h"
+
+// Tests for Aii::IntervalTree<K, V, A>
+
+#include <cstdint>
+
+#include "aii/interval_tree.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+using Tree = Aii::IntervalTree<std::uint64_t, int>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+std::uint64_t ReferenceGap(const Tree& tree, std::uint64_t size, std::uint64_t align,
+                           std::uint64_t hint, std::uint64_t limit){
+  // linear scan over every gap at least size + align - g long, where g is
+  // the alignment all non empty gap starts share, then the space above the
+  // last interval. Returns ~0 when nothing fits
+  std::uint64_t starts = 0;
+  std::uint64_t gapStart = tree.Floor();
+  for(auto it = tree.begin(); it != tree.end(); ++it){
+    starts |= it.Start() != gapStart ? gapStart : 0;
+    gapStart = it.End();
+  }
+  std::uint64_t granularity = starts & (~starts + 1);
+  std::uint64_t slack = starts && align > granularity ? align - granularity : 0;
+  gapStart = tree.Floor();
+  auto fit = [&](std::uint64_t first, std::uint64_t last) -> std::uint64_t{
+    std::uint64_t start = first < hint ? hint : first;
+    start = (start + align - 1) & ~(align - 1);
+    std::uint64_t end = last < limit ? last : limit;
+    if(start > end || end - start < size){
+      return ~0ull;
+    }
+    return start;
+  };
+  for(auto it = tree.begin(); it != tree.end(); ++it){
+    std::uint64_t found = it.Start() - gapStart >= size + slack ? fit(gapStart, it.Start()) : ~0ull;
+    if(found != ~0ull){
+      return found;
+    }
+    gapStart = it.End();
+  }
+  return fit(gapStart, limit);
+}
+
+} // namespace
+
+TEST_CASE("IntervalTree<K, V, A> insert and erase"){
+  Tree tree;
+  REQUIRE(tree.Insert(0x1000, 0x2000, 1));
+  REQUIRE(tree.Insert(0x4000, 0x5000, 2));
+
+  SUBCASE("Overlapping or empty intervals are rejected"){
+    CHECK(tree.Insert(0x1800, 0x1900, 3).Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Insert(0x0800, 0x1001, 3).Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Insert(0x3000, 0x4001, 3).Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Insert(0x1000, 0x1000, 3).Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Insert(0x0000, 0x8000, 3).Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Size() == 2);
+  }
+  SUBCASE("Adjacent intervals are accepted"){
+    CHECK(tree.Insert(0x2000, 0x4000, 3));
+    CHECK(tree.Size() == 3);
+  }
+  SUBCASE("Find returns the interval containing a point"){
+    CHECK(tree.Find(0x1000).Val() == 1);
+    CHECK(tree.Find(0x1fff).Val() == 1);
+    CHECK(tree.Find(0x2000) == tree.end());
+    CHECK(tree.Find(0x4800).Val() == 2);
+  }
+  SUBCASE("Erase of a missing interval is out of range"){
+    CHECK(tree.Erase(0x1800).Error() == Aii::Error::OutOfRange);
+    CHECK(tree.Erase(0x1000));
+    CHECK(tree.Find(0x1800) == tree.end());
+    CHECK(tree.Size() == 1);
+  }
+}
+
+TEST_CASE("IntervalTree<K, V, A> overlap queries"){
+  Tree tree;
+  for(std::uint64_t i = 0; i < 100; i++){
+    REQUIRE(tree.Insert(i * 0x100, i * 0x100 + 0x80, static_cast<int>(i)));
+  }
+  SUBCASE("FirstOverlap finds an interval starting before the query"){
+    auto it = tree.FirstOverlap(0x150, 0x160);
+    REQUIRE(it != tree.end());
+    CHECK(it.Val() == 1);
+  }
+  SUBCASE("A query inside a gap overlaps nothing"){
+    CHECK(tree.FirstOverlap(0x180, 0x200) == tree.end());
+  }
+  SUBCASE("ForEachOverlap reports every intersecting interval in order"){
+    int first = -1;
+    int last = -1;
+    std::size_t count = tree.ForEachOverlap(0x250, 0x701,
+      [&](std::uint64_t, std::uint64_t, int& val){
+        if(first < 0){
+          first = val;
+        }
+        last = val;
+      });
+    CHECK(count == 6);
+    CHECK(first == 2);
+    CHECK(last == 7);
+  }
+}
+
+TEST_CASE("IntervalTree<K, V, A> gap search"){
+  Tree tree{0x1000};
+  SUBCASE("An empty map has one gap from the floor to the limit"){
+    CHECK(*tree.FindGap(0x1000, 0x1000, 0, 0x10000) == 0x1000);
+    CHECK(*tree.FindGap(0x1000, 0x4000, 0, 0x10000) == 0x4000);
+    CHECK(tree.FindGap(0x10000, 1, 0, 0x10000).Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("Invalid sizes and alignments are rejected"){
+    CHECK(tree.FindGap(0, 1, 0, 0x10000).Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.FindGap(1, 3, 0, 0x10000).Error() == Aii::Error::InvalidArgument);
+  }
+  SUBCASE("Gaps respect the hint and alignment"){
+    REQUIRE(tree.Insert(0x1000, 0x3000, 0));
+    REQUIRE(tree.Insert(0x4000, 0x5000, 0));
+    REQUIRE(tree.Insert(0x9000, 0xa000, 0));
+    CHECK(*tree.FindGap(0x1000, 0x1000, 0, 0x100000) == 0x3000);
+    CHECK(*tree.FindGap(0x2000, 0x1000, 0, 0x100000) == 0x5000);
+    CHECK(*tree.FindGap(0x1000, 0x1000, 0x6800, 0x100000) == 0x7000);
+    CHECK(*tree.FindGap(0x1000, 0x2000, 0, 0x100000) == 0x6000);
+    CHECK(*tree.FindGap(0x2000, 0x8000, 0, 0x100000) == 0x10000);
+    CHECK(tree.FindGap(0x2000, 0x8000, 0, 0xc000).Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("Random maps agree with a linear scan"){
+    std::uint64_t state = 12345;
+    for(int round = 0; round < 20; round++){
+      tree.Clear();
+      std::uint64_t address = 0x1000;
+      for(int i = 0; i < 200; i++){
+        address += (NextRandom(state) % 8) * 0x1000;
+        std::uint64_t length = (NextRandom(state) % 4 + 1) * 0x1000;
+        REQUIRE(tree.Insert(address, address + length, i));
+        address += length;
+      }
+      for(int i = 0; i < 60; i++){
+        std::uint64_t victim = tree.Floor() + (NextRandom(state) % 200) * 0x4000;
+        auto it = tree.Find(victim);
+        if(it != tree.end()){
+          REQUIRE(tree.Erase(it.Start()));
+        }
+      }
+      for(int query = 0; query < 100; query++){
+        std::uint64_t size = (NextRandom(state) % 12 + 1) * 0x1000;
+        std::uint64_t align = 0x1000ull << (NextRandom(state) % 4);
+        std::uint64_t hint = NextRandom(state) % (address + 0x10000);
+        std::uint64_t limit = address + 0x10000 - NextRandom(state) % 0x40000;
+        std::uint64_t expected = ReferenceGap(tree, size, align, hint, limit);
+        auto res = tree.FindGap(size, align, hint, limit);
+        if(expected == ~0ull){
+          REQUIRE(!res);
+        }
+        else{
+          REQUIRE(res);
+          REQUIRE(*res == expected);
+        }
+      }
+    }
+  }
+}
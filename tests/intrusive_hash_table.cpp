@@ -0,0 +1,211 @@
+#include "doctest.h"
+
+// Tests for Aii::IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/intrusive_hash_table.hpp"
+#include "aii/list_node.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+// an object on two lists at once: a table by pid and a plain run queue
+struct Task{
+  std::uint64_t pid;
+  int priority;
+  Aii::ListNode<void> runNode;
+  Aii::ListNode<void> hashNode;
+};
+
+struct TaskPid{
+  std::uint64_t operator()(const Task& task) const noexcept{ return task.pid;}
+};
+
+using Table = Aii::IntrusiveHashTable<Task, &Task::hashNode, TaskPid>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+void MakeTasks(Task* tasks, std::size_t count){
+  for(std::size_t i = 0; i < count; i++){
+    tasks[i].pid = i * 1000003;
+    tasks[i].priority = static_cast<int>(i);
+  }
+}
+
+} // namespace
+
+TEST_CASE("ListNode<void> links embedded nodes"){
+  Task tasks[3];
+  MakeTasks(tasks, 3);
+  Aii::ListNode<void> head;
+  CHECK(head.Empty());
+  for(Task& task : tasks){
+    head.PushFront(&task.runNode);
+  }
+  CHECK(Aii::ContainerOf(head.Next(), &Task::runNode) == &tasks[2]);
+  CHECK(head.Remove(&tasks[1].runNode));
+  CHECK(!head.Remove(&tasks[1].runNode));
+  CHECK(Aii::ContainerOf(head.Next()->Next(), &Task::runNode) == &tasks[0]);
+}
+
+TEST_CASE("IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A> insert, find and erase"){
+  static Task tasks[5000];
+  MakeTasks(tasks, 5000);
+  Table table;
+  REQUIRE(table.Empty());
+  CHECK(!table.Find(0));
+  CHECK(table.Erase(0).Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("Inserted objects can be found by key"){
+    for(Task& task : tasks){
+      REQUIRE(table.Insert(task));
+    }
+    CHECK(table.Size() == 5000);
+    CHECK(table.BucketCount() >= 4096);
+    for(Task& task : tasks){
+      REQUIRE(table.Find(task.pid) == &task);
+    }
+    CHECK(!table.Find(1));
+    CHECK(table.ForEach([](Task&){}) == 5000);
+  }
+  SUBCASE("A duplicate key is an invalid argument"){
+    REQUIRE(table.Insert(tasks[0]));
+    Task twin{tasks[0].pid, 7, {}, {}};
+    auto res = table.Insert(twin);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(table.Find(tasks[0].pid) == &tasks[0]);
+    CHECK(table.Size() == 1);
+  }
+  SUBCASE("Erase returns the object and Remove unlinks by identity"){
+    for(std::size_t i = 0; i < 100; i++){
+      REQUIRE(table.Insert(tasks[i]));
+    }
+    auto res = table.Erase(tasks[10].pid);
+    REQUIRE(res);
+    CHECK(*res == &tasks[10]);
+    REQUIRE(table.Remove(tasks[20]));
+    CHECK(table.Remove(tasks[20]).Error() == Aii::Error::OutOfRange);
+    CHECK(!table.Contains(tasks[10].pid));
+    CHECK(!table.Contains(tasks[20].pid));
+    CHECK(table.Size() == 98);
+    // the object can go back in once unlinked
+    REQUIRE(table.Insert(tasks[10]));
+    CHECK(table.Find(tasks[10].pid) == &tasks[10]);
+  }
+  SUBCASE("Objects stay on their other lists"){
+    Aii::ListNode<void> runQueue;
+    for(std::size_t i = 0; i < 50; i++){
+      runQueue.PushFront(&tasks[i].runNode);
+      REQUIRE(table.Insert(tasks[i]));
+    }
+    for(std::size_t i = 0; i < 50; i += 2){
+      REQUIRE(table.Erase(tasks[i].pid));
+    }
+    std::size_t queued = 0;
+    for(Aii::ListNode<void>* node = runQueue.Next(); node; node = node->Next()){
+      queued++;
+    }
+    CHECK(queued == 50);
+    CHECK(table.Size() == 25);
+  }
+}
+
+TEST_CASE("IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A> incremental resize"){
+  static Task tasks[4096];
+  MakeTasks(tasks, 4096);
+  Table table;
+
+  SUBCASE("Lookups see both tables while a resize is in progress"){
+    std::size_t resizing = 0;
+    for(Task& task : tasks){
+      REQUIRE(table.Insert(task));
+      if(table.Resizing()){
+        resizing++;
+        // objects both moved and not yet moved are found
+        REQUIRE(table.Find(tasks[0].pid) == &tasks[0]);
+        REQUIRE(table.Find(task.pid) == &task);
+      }
+    }
+    // the work is spread over many inserts rather than done at once
+    CHECK(resizing > 1000);
+    std::size_t found = 0;
+    for(Task& task : tasks){
+      found += table.Find(task.pid) == &task ? 1 : 0;
+    }
+    CHECK(found == 4096);
+    CHECK(table.ForEach([](Task&){}) == 4096);
+  }
+  SUBCASE("Random operations agree with a bitmap"){
+    bool present[4096] = {};
+    std::uint64_t state = 5;
+    for(int i = 0; i < 50000; i++){
+      std::size_t index = NextRandom(state) % 4096;
+      if(present[index]){
+        REQUIRE(table.Remove(tasks[index]));
+      }
+      else{
+        REQUIRE(table.Insert(tasks[index]));
+      }
+      present[index] = !present[index];
+    }
+    std::size_t count = 0;
+    for(std::size_t i = 0; i < 4096; i++){
+      REQUIRE((table.Find(tasks[i].pid) == &tasks[i]) == present[i]);
+      count += present[i] ? 1 : 0;
+    }
+    CHECK(table.Size() == count);
+    CHECK(table.ForEach([](Task&){}) == count);
+  }
+  SUBCASE("Erasing most objects shrinks the buckets"){
+    for(Task& task : tasks){
+      REQUIRE(table.Insert(task));
+    }
+    std::size_t buckets = table.BucketCount();
+    for(std::size_t i = 0; i < 4000; i++){
+      REQUIRE(table.Remove(tasks[i]));
+    }
+    table.FinishResize();
+    CHECK(table.BucketCount() < buckets);
+    CHECK(table.Size() == 96);
+    for(std::size_t i = 4000; i < 4096; i++){
+      REQUIRE(table.Find(tasks[i].pid) == &tasks[i]);
+    }
+  }
+  SUBCASE("Reserve sizes the buckets up front"){
+    REQUIRE(table.Reserve(4096));
+    std::size_t buckets = table.BucketCount();
+    for(Task& task : tasks){
+      REQUIRE(table.Insert(task));
+    }
+    CHECK(!table.Resizing());
+    CHECK(table.BucketCount() == buckets);
+  }
+}
+
+TEST_CASE("IntrusiveHashTable<T, Node, KeyFn, Hash, Eq, A> clear, move and swap"){
+  Task tasks[20];
+  MakeTasks(tasks, 20);
+  Table lhs;
+  Table rhs;
+  for(std::size_t i = 0; i < 10; i++){
+    REQUIRE(lhs.Insert(tasks[i]));
+    REQUIRE(rhs.Insert(tasks[i + 10]));
+  }
+  lhs.Swap(rhs);
+  CHECK(lhs.Find(tasks[15].pid) == &tasks[15]);
+  CHECK(rhs.Find(tasks[5].pid) == &tasks[5]);
+  Table moved{std::move(lhs)};
+  CHECK(lhs.Empty());
+  CHECK(moved.Size() == 10);
+  moved.Clear();
+  CHECK(moved.Empty());
+  CHECK(!moved.Contains(tasks[15].pid));
+  REQUIRE(moved.Insert(tasks[15]));
+  CHECK(moved.Size() == 1);
+}
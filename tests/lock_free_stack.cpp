@@ -0,0 +1,115 @@
+#include "doctest.h"
+
+// Tests for Aii::LockFreeStack<T, Node>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/lock_free_stack.hpp"
+#include "aii/atomic.hpp"
+#include "aii/list_node.hpp"
+
+namespace{
+
+struct Block{
+  int id;
+  // set while a thread holds the block popped
+  Aii::Atomic<int> owned;
+  Aii::ListNode<void> node;
+};
+
+using Stack = Aii::LockFreeStack<Block, &Block::node>;
+
+} // namespace
+
+TEST_CASE("LockFreeStack<T, Node> from one thread"){
+  Stack stack;
+  Block blocks[5];
+  REQUIRE(stack.Empty());
+  CHECK(stack.Pop() == nullptr);
+  CHECK(stack.PopAll() == nullptr);
+  for(int i = 0; i < 5; i++){
+    blocks[i].id = i;
+    stack.Push(blocks[i]);
+  }
+  CHECK(!stack.Empty());
+  CHECK(stack.Pop() == &blocks[4]);
+  CHECK(stack.Pop() == &blocks[3]);
+  stack.Push(blocks[4]);
+  Block* chain = stack.PopAll();
+  CHECK(stack.Empty());
+  int ids[4];
+  int count = 0;
+  for(Block* block = chain; block; block = Stack::Next(*block)){
+    REQUIRE(count < 4);
+    ids[count++] = block->id;
+  }
+  REQUIRE(count == 4);
+  CHECK(ids[0] == 4);
+  CHECK(ids[1] == 2);
+  CHECK(ids[2] == 1);
+  CHECK(ids[3] == 0);
+}
+
+TEST_CASE("LockFreeStack<T, Node> as a shared free list"){
+  // threads pop and push the same few blocks back and forth, which is the
+  // pattern that would expose ABA without the version
+  constexpr int Blocks = 8;
+  constexpr unsigned Threads = 4;
+  constexpr int Rounds = 100000;
+  Stack stack;
+  Block blocks[Blocks];
+  for(int i = 0; i < Blocks; i++){
+    blocks[i].id = i;
+    stack.Push(blocks[i]);
+  }
+  bool exclusive[Threads];
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < Threads; t++){
+    exclusive[t] = true;
+    threads.emplace_back([&, t]{
+      Block* held[2];
+      for(int round = 0; round < Rounds; round++){
+        int count = 0;
+        for(; count < 2; count++){
+          held[count] = stack.Pop();
+          if(!held[count]){
+            break;
+          }
+          exclusive[t] &= held[count]->owned.Exchange(1, Aii::MemoryOrder::AcqRel) == 0;
+        }
+        if(round % 64 == 0){
+          // hand a batch back through PopAll and Push
+          for(Block* block = stack.PopAll(); block;){
+            Block* next = Stack::Next(*block);
+            stack.Push(*block);
+            block = next;
+          }
+        }
+        while(count--){
+          held[count]->owned.Store(0, Aii::MemoryOrder::Release);
+          stack.Push(*held[count]);
+        }
+      }
+    });
+  }
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  for(unsigned t = 0; t < Threads; t++){
+    CHECK(exclusive[t]);
+  }
+  // every block is back exactly once
+  int seen[Blocks] = {};
+  int count = 0;
+  while(Block* block = stack.Pop()){
+    REQUIRE(count < Blocks);
+    seen[block->id]++;
+    count++;
+  }
+  CHECK(count == Blocks);
+  for(int i = 0; i < Blocks; i++){
+    CHECK(seen[i] == 1);
+  }
+}
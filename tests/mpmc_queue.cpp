@@ -0,0 +1,121 @@
+#include "doctest.h"
+
+// Tests for Aii::MpmcQueue<T, N>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/mpmc_queue.hpp"
+#include "aii/atomic.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+using Fixtures::Tracked;
+
+TEST_CASE("MpmcQueue<T, N> from one thread"){
+  Aii::MpmcQueue<std::uint64_t, 8> queue;
+  REQUIRE(queue.Empty());
+  CHECK(queue.Capacity() == 8);
+  CHECK(queue.Pop().Error() == Aii::Error::OutOfRange);
+
+  std::uint64_t next = 0;
+  std::uint64_t expected = 0;
+  for(int round = 0; round < 100; round++){
+    while(queue.Push(next)){
+      next++;
+    }
+    REQUIRE(queue.Size() == 8);
+    for(int i = 0; i < 3; i++){
+      auto val = queue.Pop();
+      REQUIRE(val);
+      REQUIRE(*val == expected);
+      expected++;
+    }
+  }
+  while(auto val = queue.Pop()){
+    REQUIRE(*val == expected);
+    expected++;
+  }
+  CHECK(expected == next);
+  CHECK(queue.Empty());
+}
+
+TEST_CASE("MpmcQueue<T, N> element lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::MpmcQueue<Tracked, 4> queue;
+    for(int i = 0; i < 4; i++){
+      REQUIRE(queue.Emplace(i));
+    }
+    CHECK(queue.Emplace(4).Error() == Aii::Error::OutOfRange);
+    CHECK(Tracked::live == 4);
+    {
+      auto val = queue.Pop();
+      REQUIRE(val);
+      CHECK(val->val == 0);
+    }
+    CHECK(Tracked::live == 3);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+TEST_CASE("MpmcQueue<T, N> between many threads"){
+  constexpr unsigned Producers = 4;
+  constexpr unsigned Consumers = 4;
+  constexpr std::uint64_t PerProducer = 50000;
+  // elements are the producer in the top bits and a sequence number below
+  constexpr unsigned Shift = 32;
+  Aii::MpmcQueue<std::uint64_t, 64> queue;
+  Aii::Atomic<std::uint64_t> received{0};
+  std::uint64_t sums[Consumers] = {};
+  bool ordered[Consumers];
+  std::vector<std::thread> threads;
+  for(unsigned p = 0; p < Producers; p++){
+    threads.emplace_back([&queue, p]{
+      for(std::uint64_t i = 0; i < PerProducer;){
+        if(queue.Push((std::uint64_t{p} << Shift) | i)){
+          i++;
+        }
+        else{
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(unsigned c = 0; c < Consumers; c++){
+    ordered[c] = true;
+    threads.emplace_back([&, c]{
+      // each producer's elements are seen in the order pushed
+      std::uint64_t last[Producers];
+      for(std::uint64_t& seq : last){
+        seq = ~std::uint64_t{0};
+      }
+      while(received.Load(Aii::MemoryOrder::Relaxed) < Producers * PerProducer){
+        auto val = queue.Pop();
+        if(!val){
+          std::this_thread::yield();
+          continue;
+        }
+        std::uint64_t producer = *val >> Shift;
+        std::uint64_t seq = *val & 0xFFFFFFFF;
+        ordered[c] &= last[producer] == ~std::uint64_t{0} || seq > last[producer];
+        last[producer] = seq;
+        sums[c] += seq;
+        received.FetchAdd(1, Aii::MemoryOrder::Relaxed);
+      }
+    });
+  }
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  std::uint64_t sum = 0;
+  for(unsigned c = 0; c < Consumers; c++){
+    CHECK(ordered[c]);
+    sum += sums[c];
+  }
+  CHECK(received.Load() == Producers * PerProducer);
+  CHECK(sum == Producers * (PerProducer * (PerProducer - 1) / 2));
+  CHECK(queue.Empty());
+}
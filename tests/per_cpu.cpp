@@ -0,0 +1,41 @@
+#include "doctest.h"
+
+// Tests for Aii::PerCpu<T, MaxCpus>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aii/cache_line.hpp"
+#include "aii/per_cpu.hpp"
+
+TEST_CASE("PerCpu<T, MaxCpus> instances"){
+  Aii::PerCpu<int, 8> counters;
+  REQUIRE(counters.Size() == 8);
+  for(std::size_t cpu = 0; cpu < counters.Size(); cpu++){
+    CHECK(counters[cpu] == 0);
+    counters[cpu] = static_cast<int>(cpu);
+  }
+  // each instance on its own line
+  for(std::size_t cpu = 1; cpu < counters.Size(); cpu++){
+    auto prev = reinterpret_cast<std::uintptr_t>(&counters[cpu - 1]);
+    auto next = reinterpret_cast<std::uintptr_t>(&counters[cpu]);
+    CHECK(next - prev == Aii::CacheLineSize);
+    CHECK(next % Aii::CacheLineSize == 0);
+  }
+  // the calling thread may move to another cpu at any time, so only check
+  // that Local() is one of the instances
+  counters.Local() = -1;
+  int found = 0;
+  for(std::size_t cpu = 0; cpu < counters.Size(); cpu++){
+    found += counters[cpu] == -1;
+  }
+  CHECK(found == 1);
+}
+
+TEST_CASE("PerCpu<T, MaxCpus> with fewer slots than cpus"){
+  // cpus past MaxCpus share slots rather than run off the end
+  Aii::PerCpu<std::uint64_t, 1> counter;
+  counter.Local()++;
+  counter.Local()++;
+  CHECK(counter[0] == 2);
+}
@@ -0,0 +1,70 @@
+#include "doctest.h"
+
+// Tests for Aii::PerCpuRwLock<MaxCpus>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/atomic.hpp"
+#include "aii/per_cpu_rw_lock.hpp"
+#include "aii/spinlock.hpp"
+
+TEST_CASE("PerCpuRwLock<MaxCpus> from one thread"){
+  Aii::PerCpuRwLock<> lock;
+  lock.ReadLock();
+  lock.ReadUnlock();
+  {
+    Aii::ReadLockGuard guard{lock};
+  }
+  {
+    Aii::LockGuard guard{lock};
+  }
+  // readers may share a counter when cpus outnumber MaxCpus
+  Aii::PerCpuRwLock<1> small;
+  small.ReadLock();
+  small.ReadLock();
+  small.ReadUnlock();
+  small.ReadUnlock();
+  small.Lock();
+  small.Unlock();
+}
+
+TEST_CASE("PerCpuRwLock<MaxCpus> readers and writers"){
+  // writers keep first == second, and readers must never see them differ
+  constexpr unsigned Readers = 3;
+  constexpr unsigned Writers = 2;
+  constexpr int ReadRounds = 20000;
+  constexpr int WriteRounds = 200;
+  Aii::PerCpuRwLock<> lock;
+  std::uint64_t first = 0;
+  std::uint64_t second = 0;
+  Aii::Atomic<std::uint64_t> torn{0};
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < Readers; t++){
+    threads.emplace_back([&]{
+      for(int round = 0; round < ReadRounds; round++){
+        Aii::ReadLockGuard guard{lock};
+        if(first != second){
+          torn.FetchAdd(1, Aii::MemoryOrder::Relaxed);
+        }
+      }
+    });
+  }
+  for(unsigned t = 0; t < Writers; t++){
+    threads.emplace_back([&]{
+      for(int round = 0; round < WriteRounds; round++){
+        Aii::LockGuard guard{lock};
+        first++;
+        std::this_thread::yield();
+        second++;
+      }
+    });
+  }
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  CHECK(torn.Load() == 0);
+  CHECK(first == Writers * WriteRounds);
+  CHECK(second == Writers * WriteRounds);
+}
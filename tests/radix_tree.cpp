@@ -0,0 +1,197 @@
+#include "doctest.h"
+
+// Tests for Aii::RadixTree<V, Fanout, Tags, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/radix_tree.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+using Tree = Aii::RadixTree<std::uint64_t>;
+// 4 way nodes give tall trees from small keys
+using NarrowTree = Aii::RadixTree<std::uint64_t, 4>;
+
+constexpr std::size_t Dirty = 0;
+constexpr std::size_t Writeback = 1;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+template<typename T>
+bool IsSorted(const T& tree){
+  std::size_t count = 0;
+  std::uint64_t prev = 0;
+  for(auto it = tree.begin(); it != tree.end(); ++it){
+    if((count > 0 && !(prev < it.Key())) || *it != it.Key() * 3){
+      return false;
+    }
+    prev = it.Key();
+    count++;
+  }
+  return count == tree.Size();
+}
+
+} // namespace
+
+TEST_CASE("RadixTree<V, Fanout, Tags, A> insert, find and erase"){
+  Tree tree;
+  REQUIRE(tree.Empty());
+
+  SUBCASE("Sparse keys across the whole key space"){
+    std::uint64_t keys[] = {0, 1, 63, 64, 4095, 1ull << 32, (1ull << 63) + 5, ~0ull};
+    for(std::uint64_t key : keys){
+      auto res = tree.Insert(key, key * 3);
+      REQUIRE(res);
+      CHECK(**res == key * 3);
+    }
+    CHECK(tree.Size() == 8);
+    // 64 bits in 6 bit steps
+    CHECK(tree.Height() == 11);
+    for(std::uint64_t key : keys){
+      REQUIRE(tree.Find(key));
+      CHECK(*tree.Find(key) == key * 3);
+    }
+    CHECK(!tree.Find(2));
+    CHECK(!tree.Find(1ull << 33));
+    CHECK(IsSorted(tree));
+  }
+  SUBCASE("Inserting a duplicate key is an invalid argument"){
+    REQUIRE(tree.Insert(100, 1));
+    auto res = tree.Insert(100, 2);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(*tree.Find(100) == 1);
+  }
+  SUBCASE("The height follows the largest key"){
+    REQUIRE(tree.Insert(5, 15));
+    CHECK(tree.Height() == 1);
+    REQUIRE(tree.Insert(1ull << 20, 3ull << 20));
+    CHECK(tree.Height() == 4);
+    REQUIRE(tree.Erase(1ull << 20));
+    CHECK(tree.Height() == 1);
+    CHECK(*tree.Find(5) == 15);
+    REQUIRE(tree.Erase(5));
+    CHECK(tree.Empty());
+    CHECK(tree.Erase(5).Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("Random keys agree with a bitmap"){
+    NarrowTree narrow;
+    bool present[4096] = {};
+    std::uint64_t state = 7;
+    for(int i = 0; i < 20000; i++){
+      std::uint64_t key = NextRandom(state) % 4096;
+      if(present[key]){
+        REQUIRE(narrow.Erase(key));
+      }
+      else{
+        REQUIRE(narrow.Insert(key, key * 3));
+      }
+      present[key] = !present[key];
+    }
+    std::size_t count = 0;
+    for(std::uint64_t key = 0; key < 4096; key++){
+      REQUIRE(narrow.Contains(key) == present[key]);
+      count += present[key] ? 1 : 0;
+    }
+    CHECK(narrow.Size() == count);
+    CHECK(IsSorted(narrow));
+  }
+}
+
+TEST_CASE("RadixTree<V, Fanout, Tags, A> range iteration and gang lookup"){
+  Tree tree;
+  for(std::uint64_t key = 0; key < 100000; key += 7){
+    REQUIRE(tree.Insert(key, key * 3));
+  }
+  SUBCASE("LowerBound skips empty slots and subtrees"){
+    CHECK(tree.LowerBound(0).Key() == 0);
+    CHECK(tree.LowerBound(8).Key() == 14);
+    CHECK(tree.LowerBound(99995).Key() == 99995);
+    CHECK(tree.LowerBound(99996) == tree.end());
+  }
+  SUBCASE("ForEachInRange visits the half open range in order"){
+    std::uint64_t expected = 63;
+    std::size_t count = tree.ForEachInRange(60, 4100, [&](std::uint64_t key, std::uint64_t& val){
+      CHECK(key == expected);
+      CHECK(val == key * 3);
+      expected += 7;
+    });
+    CHECK(count == (4100 - 63 + 6) / 7);
+  }
+  SUBCASE("GangLookup returns the next present entries"){
+    std::uint64_t* results[16];
+    std::uint64_t keys[16];
+    std::size_t found = tree.GangLookup(1000, results, 16, keys);
+    REQUIRE(found == 16);
+    for(std::size_t i = 0; i < found; i++){
+      CHECK(keys[i] == 1001 + 7 * i);
+      CHECK(*results[i] == keys[i] * 3);
+    }
+    CHECK(tree.GangLookup(99990, results, 16) == 1);
+  }
+}
+
+TEST_CASE("RadixTree<V, Fanout, Tags, A> tags"){
+  Tree tree;
+  for(std::uint64_t key = 0; key < 1000000; key += 3){
+    REQUIRE(tree.Insert(key, key * 3));
+  }
+  CHECK(!tree.AnyTagged(Dirty));
+
+  SUBCASE("Tagging a missing entry or an unknown tag fails"){
+    CHECK(tree.SetTag(1, Dirty).Error() == Aii::Error::OutOfRange);
+    CHECK(tree.SetTag(0, 2).Error() == Aii::Error::InvalidArgument);
+    CHECK(!tree.GetTag(1, Dirty));
+  }
+  SUBCASE("Tagged scans report only tagged entries"){
+    std::uint64_t tagged[] = {3, 300000, 300003, 999999};
+    for(std::uint64_t key : tagged){
+      REQUIRE(tree.SetTag(key, Dirty));
+    }
+    REQUIRE(tree.SetTag(6, Writeback));
+    CHECK(tree.AnyTagged(Dirty));
+    CHECK(tree.GetTag(300000, Dirty));
+    CHECK(!tree.GetTag(300000, Writeback));
+
+    std::size_t index = 0;
+    std::size_t count = tree.ForEachTagged(0, ~0ull, Dirty, [&](std::uint64_t key, std::uint64_t&){
+      CHECK(key == tagged[index]);
+      index++;
+    });
+    CHECK(count == 4);
+    CHECK(tree.ForEachTagged(4, 999999, Dirty, [](std::uint64_t, std::uint64_t&){}) == 2);
+
+    std::uint64_t* results[8];
+    std::uint64_t keys[8];
+    REQUIRE(tree.GangLookupTag(0, Writeback, results, 8, keys) == 1);
+    CHECK(keys[0] == 6);
+  }
+  SUBCASE("Clearing the last tag clears the summary bits"){
+    REQUIRE(tree.SetTag(300000, Dirty));
+    REQUIRE(tree.SetTag(300003, Dirty));
+    REQUIRE(tree.ClearTag(300000, Dirty));
+    CHECK(tree.AnyTagged(Dirty));
+    REQUIRE(tree.Erase(300003));
+    CHECK(!tree.AnyTagged(Dirty));
+    CHECK(tree.ForEachTagged(0, ~0ull, Dirty, [](std::uint64_t, std::uint64_t&){}) == 0);
+  }
+}
+
+TEST_CASE("RadixTree<V, Fanout, Tags, A> move and swap"){
+  Tree lhs;
+  Tree rhs;
+  REQUIRE(lhs.Insert(1, 3));
+  REQUIRE(rhs.Insert(1ull << 40, 3ull << 40));
+  lhs.Swap(rhs);
+  CHECK(lhs.Contains(1ull << 40));
+  CHECK(rhs.Contains(1));
+  Tree moved{std::move(lhs)};
+  CHECK(lhs.Empty());
+  CHECK(moved.Size() == 1);
+  CHECK(IsSorted(moved));
+}
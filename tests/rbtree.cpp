@@ -0,0 +1,270 @@
+#include "doctest.h"
+
+// Tests for Aii::RbTree<K, V, A>
+
+#include <cstdint>
+
+#include "aii/rbtree.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+using Tree = Aii::RbTree<int, int>;
+
+int CheckSubtree(const Tree::Node* node, const Tree::Node* parent){
+  // returns the black height of node, or -1 if a red black property or a
+  // parent link is broken
+  if(!node){
+    return 0;
+  }
+  if(node->Parent() != parent){
+    return -1;
+  }
+  if(node->left && !(node->left->key < node->key)){
+    return -1;
+  }
+  if(node->right && !(node->key < node->right->key)){
+    return -1;
+  }
+  bool red = node->GetColour() == Tree::Colour::Red;
+  if(red){
+    if((node->left && node->left->GetColour() == Tree::Colour::Red) ||
+       (node->right && node->right->GetColour() == Tree::Colour::Red)){
+      return -1;
+    }
+  }
+  int left = CheckSubtree(node->left, node);
+  int right = CheckSubtree(node->right, node);
+  if(left < 0 || right < 0 || left != right){
+    return -1;
+  }
+  return left + (red ? 0 : 1);
+}
+
+bool IsValid(const Tree& tree){
+  if(tree.Root() && tree.Root()->GetColour() != Tree::Colour::Black){
+    return false;
+  }
+  return CheckSubtree(tree.Root(), nullptr) >= 0;
+}
+
+bool HasKeys(const Tree& tree, int first, int last, int step){
+  // tree holds exactly first, first + step, ... < last in order
+  int expected = first;
+  for(auto it = tree.begin(); it != tree.end(); ++it){
+    if(expected >= last || it.Key() != expected){
+      return false;
+    }
+    expected += step;
+  }
+  return expected >= last;
+}
+
+void FillSorted(Tree& tree, int first, int last, int step){
+  int keys[1024];
+  int vals[1024];
+  int count = 0;
+  for(int key = first; key < last; key += step){
+    keys[count] = key;
+    vals[count] = key * 10;
+    count++;
+  }
+  REQUIRE(tree.AssignSorted(keys, vals, count));
+}
+
+} // namespace
+
+TEST_CASE("RbTree<K, V, A> node layout"){
+  using U64Tree = Aii::RbTree<std::uint64_t, std::uint64_t>;
+  // the colour is packed into the parent pointer
+  CHECK(sizeof(U64Tree::Node) == 3 * sizeof(void*) + 2 * sizeof(std::uint64_t));
+}
+
+TEST_CASE("RbTree<K, V, A> insert, find and erase"){
+  Tree tree;
+  REQUIRE(tree.Empty());
+
+  SUBCASE("Inserted keys can be found and iterate in order"){
+    for(int i = 0; i < 200; i++){
+      int key = (i * 37) % 200;
+      auto res = tree.Insert(key, key + 1);
+      REQUIRE(res);
+      CHECK(**res == key + 1);
+    }
+    CHECK(IsValid(tree));
+    CHECK(tree.Size() == 200);
+    CHECK(HasKeys(tree, 0, 200, 1));
+    REQUIRE(tree.Find(42));
+    CHECK(*tree.Find(42) == 43);
+    CHECK(!tree.Find(200));
+  }
+  SUBCASE("Inserting a duplicate key is an invalid argument"){
+    REQUIRE(tree.Insert(1, 1));
+    auto res = tree.Insert(1, 2);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(*tree.Find(1) == 1);
+  }
+  SUBCASE("Erase keeps the tree balanced"){
+    for(int i = 0; i < 300; i++){
+      REQUIRE(tree.Insert(i, i));
+    }
+    for(int i = 0; i < 300; i += 2){
+      REQUIRE(tree.Erase((i * 7) % 300));
+      REQUIRE(IsValid(tree));
+    }
+    CHECK(tree.Size() == 150);
+    auto res = tree.Erase(1000);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("LowerBound finds the first key not less than the argument"){
+    FillSorted(tree, 0, 100, 10);
+    CHECK(tree.LowerBound(15).Key() == 20);
+    CHECK(tree.LowerBound(20).Key() == 20);
+    CHECK(tree.LowerBound(95) == tree.end());
+  }
+}
+
+TEST_CASE("RbTree<K, V, A> rotation errors"){
+  Tree tree;
+  REQUIRE(tree.Insert(10, 10));
+  SUBCASE("Rotating a null node is an invalid argument"){
+    auto res = tree.LeftRotate(nullptr);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+  }
+  SUBCASE("Rotating without a pivot child leaves the tree untouched"){
+    auto res = tree.RightRotate(tree.Root());
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::RuntimeError);
+    CHECK(tree.Root()->key == 10);
+  }
+}
+
+TEST_CASE("RbTree<K, V, A> AssignSorted builds a valid tree"){
+  Tree tree;
+  SUBCASE("Every size up to 200 is valid"){
+    for(int count = 0; count < 200; count++){
+      FillSorted(tree, 0, count, 1);
+      REQUIRE(IsValid(tree));
+      REQUIRE(tree.Size() == static_cast<std::size_t>(count));
+      REQUIRE(HasKeys(tree, 0, count, 1));
+    }
+  }
+  SUBCASE("Unsorted input is rejected and leaves the tree untouched"){
+    FillSorted(tree, 0, 10, 1);
+    int keys[] = {1, 3, 2};
+    int vals[] = {1, 1, 1};
+    auto res = tree.AssignSorted(keys, vals, 3);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(tree.Size() == 10);
+  }
+}
+
+TEST_CASE("RbTree<K, V, A> Join and Split"){
+  Tree lhs;
+  Tree rhs;
+  SUBCASE("Join of trees with different black heights"){
+    for(int small = 0; small < 40; small++){
+      FillSorted(lhs, 0, 500, 1);
+      FillSorted(rhs, 500, 500 + small, 1);
+      REQUIRE(lhs.Join(rhs));
+      REQUIRE(IsValid(lhs));
+      REQUIRE(rhs.Empty());
+      REQUIRE(lhs.Size() == static_cast<std::size_t>(500 + small));
+      REQUIRE(HasKeys(lhs, 0, 500 + small, 1));
+
+      FillSorted(lhs, 0, small, 1);
+      FillSorted(rhs, small, 500, 1);
+      REQUIRE(lhs.Join(rhs));
+      REQUIRE(IsValid(lhs));
+      REQUIRE(HasKeys(lhs, 0, 500, 1));
+    }
+  }
+  SUBCASE("Join of overlapping ranges is rejected"){
+    FillSorted(lhs, 0, 10, 1);
+    FillSorted(rhs, 5, 20, 1);
+    auto res = lhs.Join(rhs);
+    CHECK(!res);
+    CHECK(res.Error() == Aii::Error::InvalidArgument);
+    CHECK(lhs.Size() == 10);
+    CHECK(rhs.Size() == 15);
+  }
+  SUBCASE("Split at every key position"){
+    for(int key = -1; key <= 301; key++){
+      FillSorted(lhs, 0, 300, 2);
+      Tree greater;
+      REQUIRE(lhs.Split(key, greater));
+      REQUIRE(IsValid(lhs));
+      REQUIRE(IsValid(greater));
+      int boundary = key < 0 ? 0 : (key > 300 ? 300 : key + (key & 1));
+      REQUIRE(HasKeys(lhs, 0, boundary, 2));
+      REQUIRE(HasKeys(greater, boundary, 300, 2));
+      REQUIRE(lhs.Size() + greater.Size() == 150);
+      REQUIRE(lhs.Join(greater));
+      REQUIRE(HasKeys(lhs, 0, 300, 2));
+    }
+  }
+  SUBCASE("Split into a non empty tree is rejected"){
+    FillSorted(lhs, 0, 10, 1);
+    FillSorted(rhs, 20, 30, 1);
+    auto res = lhs.Split(5, rhs);
+    CHECK(!res);
+    CHECK(lhs.Size() == 10);
+  }
+}
+
+TEST_CASE("RbTree<K, V, A> set algebra"){
+  Tree lhs;
+  Tree rhs;
+  // lhs holds multiples of 2 below 600, rhs holds multiples of 3 below 600
+  FillSorted(lhs, 0, 600, 2);
+  FillSorted(rhs, 0, 600, 3);
+
+  SUBCASE("Union"){
+    REQUIRE(rhs.Insert(1000, 7));
+    lhs.Union(rhs);
+    CHECK(IsValid(lhs));
+    CHECK(rhs.Empty());
+    std::size_t count = 0;
+    for(int key = 0; key < 600; key++){
+      bool expected = key % 2 == 0 || key % 3 == 0;
+      CHECK(lhs.Contains(key) == expected);
+      count += expected ? 1 : 0;
+    }
+    CHECK(*lhs.Find(1000) == 7);
+    CHECK(lhs.Size() == count + 1);
+  }
+  SUBCASE("Intersection"){
+    lhs.Intersection(rhs);
+    CHECK(IsValid(lhs));
+    CHECK(rhs.Empty());
+    CHECK(HasKeys(lhs, 0, 600, 6));
+    CHECK(lhs.Size() == 100);
+    CHECK(*lhs.Find(6) == 60);
+  }
+  SUBCASE("Difference"){
+    lhs.Difference(rhs);
+    CHECK(IsValid(lhs));
+    CHECK(rhs.Empty());
+    std::size_t count = 0;
+    for(int key = 0; key < 600; key++){
+      bool expected = key % 2 == 0 && key % 3 != 0;
+      CHECK(lhs.Contains(key) == expected);
+      count += expected ? 1 : 0;
+    }
+    CHECK(lhs.Size() == count);
+  }
+  SUBCASE("Operations with an empty tree"){
+    Tree empty;
+    lhs.Intersection(empty);
+    CHECK(lhs.Empty());
+    CHECK(lhs.Size() == 0);
+    rhs.Union(lhs);
+    CHECK(rhs.Size() == 200);
+    rhs.Difference(lhs);
+    CHECK(rhs.Size() == 200);
+  }
+}
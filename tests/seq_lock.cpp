@@ -0,0 +1,99 @@
+#include "doctest.h"
+
+// Tests for Aii::SeqLock<T>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/atomic.hpp"
+#include "aii/seq_lock.hpp"
+
+namespace{
+
+// the kind of value timekeeping publishes: fields which only make sense
+// together
+struct Clock{
+  std::uint64_t cycles;
+  std::uint64_t nanoseconds;
+  std::uint32_t multiplier;
+  std::uint16_t shift;
+};
+
+// not a whole number of words
+struct Triple{
+  std::uint16_t a;
+  std::uint16_t b;
+  std::uint16_t c;
+};
+
+} // namespace
+
+TEST_CASE("SeqLock<T> from one thread"){
+  Aii::SeqLock<Clock> clock;
+  Clock val = clock.Load();
+  CHECK(val.cycles == 0);
+  CHECK(val.nanoseconds == 0);
+  clock.Store({10, 20, 3, 4});
+  val = clock.Load();
+  CHECK(val.cycles == 10);
+  CHECK(val.nanoseconds == 20);
+  CHECK(val.multiplier == 3);
+  CHECK(val.shift == 4);
+  clock.Update([](Clock& current){ current.cycles += 5;});
+  CHECK(clock.Load().cycles == 15);
+  CHECK(clock.Load().nanoseconds == 20);
+
+  Aii::SeqLock<Triple> triple{Triple{1, 2, 3}};
+  Triple copy = triple.Load();
+  CHECK(copy.a == 1);
+  CHECK(copy.b == 2);
+  CHECK(copy.c == 3);
+}
+
+TEST_CASE("SeqLock<T> readers never see a torn value"){
+  // writers keep nanoseconds == 3 * cycles and multiplier == ~cycles
+  constexpr unsigned Readers = 3;
+  constexpr std::uint64_t Writes = 100000;
+  Aii::SeqLock<Clock> clock;
+  clock.Store({0, 0, ~0u, 0});
+  Aii::Atomic<bool> done{false};
+  Aii::Atomic<std::uint64_t> torn{0};
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < Readers; t++){
+    threads.emplace_back([&]{
+      std::uint64_t last = 0;
+      while(!done.Load(Aii::MemoryOrder::Acquire)){
+        Clock val = clock.Load();
+        bool consistent = val.nanoseconds == 3 * val.cycles &&
+                          val.multiplier == static_cast<std::uint32_t>(~val.cycles) &&
+                          val.cycles >= last;
+        if(!consistent){
+          torn.FetchAdd(1, Aii::MemoryOrder::Relaxed);
+        }
+        last = val.cycles;
+      }
+    });
+  }
+  std::thread writer{[&]{
+    for(std::uint64_t i = 1; i <= Writes; i++){
+      if(i % 2){
+        clock.Store({i, 3 * i, static_cast<std::uint32_t>(~i), 0});
+      }
+      else{
+        clock.Update([](Clock& current){
+          current.cycles++;
+          current.nanoseconds += 3;
+          current.multiplier--;
+        });
+      }
+    }
+    done.Store(true, Aii::MemoryOrder::Release);
+  }};
+  writer.join();
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  CHECK(torn.Load() == 0);
+  CHECK(clock.Load().cycles == Writes);
+}
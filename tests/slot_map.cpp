@@ -0,0 +1,157 @@
+#include "doctest.h"
+
+// Tests for Aii::SlotMap<T, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/slot_map.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+namespace{
+
+using Fixtures::Tracked;
+
+using Map = Aii::SlotMap<std::uint64_t>;
+
+std::uint64_t NextRandom(std::uint64_t& state){
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return state >> 33;
+}
+
+} // namespace
+
+TEST_CASE("SlotMap<T, A>"){
+  Map map;
+  REQUIRE(map.Empty());
+  CHECK(map.Find(Map::Handle{}) == nullptr);
+  CHECK(map.Erase(Map::Handle{}).Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("Handles find their values until erased"){
+    Map::Handle handles[100];
+    for(std::uint64_t i = 0; i < 100; i++){
+      auto handle = map.Insert(i * 10);
+      REQUIRE(handle);
+      handles[i] = *handle;
+    }
+    CHECK(map.Size() == 100);
+    for(std::uint64_t i = 0; i < 100; i++){
+      REQUIRE(map.Find(handles[i]));
+      REQUIRE(*map.Find(handles[i]) == i * 10);
+    }
+    for(std::uint64_t i = 0; i < 100; i += 2){
+      REQUIRE(map.Erase(handles[i]));
+    }
+    CHECK(map.Size() == 50);
+    for(std::uint64_t i = 0; i < 100; i++){
+      REQUIRE(map.Contains(handles[i]) == (i % 2 == 1));
+    }
+    CHECK(map.Erase(handles[0]).Error() == Aii::Error::OutOfRange);
+    // freed slots are reused under a new generation
+    auto reused = map.Insert(7);
+    REQUIRE(reused);
+    CHECK(reused->index == handles[98].index);
+    CHECK(reused->generation != handles[98].generation);
+    CHECK(map.Find(handles[98]) == nullptr);
+    CHECK(*map.Find(*reused) == 7);
+  }
+  SUBCASE("Values stay densely packed and know their handles"){
+    Map::Handle a = *map.Insert(1);
+    Map::Handle b = *map.Insert(2);
+    Map::Handle c = *map.Insert(3);
+    REQUIRE(map.Erase(a));
+    REQUIRE(map.Size() == 2);
+    CHECK(map.end() - map.begin() == 2);
+    CHECK(map.Data()[0] == 3);
+    CHECK(map.HandleAt(0) == c);
+    CHECK(map.HandleAt(1) == b);
+    std::uint64_t sum = 0;
+    for(std::uint64_t val : map){
+      sum += val;
+    }
+    CHECK(sum == 5);
+  }
+  SUBCASE("Matches a reference under random operations"){
+    constexpr std::size_t Max = 256;
+    Map::Handle handles[Max];
+    std::uint64_t values[Max];
+    std::size_t count = 0;
+    Map::Handle erased[Max];
+    std::size_t erasedCount = 0;
+    std::uint64_t state = 5;
+    for(int op = 0; op < 20000; op++){
+      std::uint64_t random = NextRandom(state);
+      if(random % 3 != 0 && count < Max){
+        auto handle = map.Insert(random);
+        REQUIRE(handle);
+        handles[count] = *handle;
+        values[count] = random;
+        count++;
+      }
+      else if(count){
+        std::size_t victim = (random >> 4) % count;
+        REQUIRE(map.Erase(handles[victim]));
+        if(erasedCount < Max){
+          erased[erasedCount++] = handles[victim];
+        }
+        count--;
+        handles[victim] = handles[count];
+        values[victim] = values[count];
+      }
+      REQUIRE(map.Size() == count);
+      if(count){
+        std::size_t probe = (random >> 12) % count;
+        REQUIRE(map.Find(handles[probe]));
+        REQUIRE(*map.Find(handles[probe]) == values[probe]);
+      }
+    }
+    for(std::size_t i = 0; i < erasedCount; i++){
+      REQUIRE(map.Find(erased[i]) == nullptr);
+    }
+    for(std::size_t i = 0; i < map.Size(); i++){
+      REQUIRE(map.Find(map.HandleAt(i)) == &map.Data()[i]);
+    }
+  }
+  SUBCASE("Clear, reserve and move"){
+    Map::Handle a = *map.Insert(1);
+    REQUIRE(map.Reserve(1000));
+    const std::uint64_t* data = map.Data();
+    for(std::uint64_t i = 1; i < 1000; i++){
+      REQUIRE(map.Insert(i));
+    }
+    CHECK(map.Data() == data);
+    Map other{std::move(map)};
+    CHECK(map.Empty());
+    CHECK(*other.Find(a) == 1);
+    other.Clear();
+    CHECK(other.Empty());
+    CHECK(other.Find(a) == nullptr);
+    Map::Handle b = *other.Insert(2);
+    map = std::move(other);
+    CHECK(*map.Find(b) == 2);
+    CHECK(map.Reserve(0xFFFFFFFF).Error() == Aii::Error::OutOfRange);
+  }
+}
+
+TEST_CASE("SlotMap<T, A> value lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::SlotMap<Tracked> map;
+    Aii::SlotMap<Tracked>::Handle handles[20];
+    for(int i = 0; i < 20; i++){
+      handles[i] = *map.Emplace(i);
+    }
+    CHECK(Tracked::live == 20);
+    for(int i = 0; i < 20; i += 4){
+      REQUIRE(map.Erase(handles[i]));
+    }
+    CHECK(Tracked::live == 15);
+    CHECK(map.Find(handles[5])->val == 5);
+    map.Clear();
+    CHECK(Tracked::live == 0);
+    REQUIRE(map.Emplace(3));
+  }
+  CHECK(Tracked::live == 0);
+}
@@ -0,0 +1,135 @@
+#include "doctest.h"
+
+// Tests for Aii::SmallVector<T, N, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/small_vector.hpp"
+#include "aii/allocator.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+namespace{
+
+using Fixtures::CountingAllocator;
+using Fixtures::allocations;
+using Fixtures::Tracked;
+
+using Small = Aii::SmallVector<std::uint64_t, 8, CountingAllocator<std::uint64_t>>;
+
+} // namespace
+
+TEST_CASE("SmallVector<T, N, A> inline storage"){
+  allocations = 0;
+  Small vec;
+  REQUIRE(vec.Empty());
+  CHECK(vec.Inline());
+  CHECK(vec.Capacity() == 8);
+
+  SUBCASE("Up to N elements never allocate"){
+    for(std::uint64_t i = 0; i < 8; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    REQUIRE(vec.Erase(0));
+    REQUIRE(vec.Insert(0, 0));
+    REQUIRE(vec.Reserve(8));
+    REQUIRE(vec.Resize(8));
+    CHECK(vec.Inline());
+    CHECK(allocations == 0);
+    for(std::uint64_t i = 0; i < 8; i++){
+      REQUIRE(vec[i] == i);
+    }
+  }
+  SUBCASE("Growing past N spills to the allocator and shrinking returns"){
+    for(std::uint64_t i = 0; i < 100; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    CHECK(!vec.Inline());
+    CHECK(allocations > 0);
+    CHECK(allocations < 8);
+    for(std::uint64_t i = 0; i < 100; i++){
+      REQUIRE(vec[i] == i);
+    }
+    REQUIRE(vec.Resize(5));
+    REQUIRE(vec.ShrinkToFit());
+    CHECK(vec.Inline());
+    CHECK(vec.Capacity() == 8);
+    CHECK(vec.Back() == 4);
+  }
+  SUBCASE("Insert and erase across the inline boundary"){
+    for(std::uint64_t i = 0; i < 8; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    // full and inline, so this insert spills
+    REQUIRE(**vec.Insert(3, 103) == 103);
+    CHECK(!vec.Inline());
+    CHECK(vec.Insert(10, 0).Error() == Aii::Error::OutOfRange);
+    std::uint64_t expected[] = {0, 1, 2, 103, 3, 4, 5, 6, 7};
+    REQUIRE(vec.Size() == 9);
+    for(std::size_t i = 0; i < 9; i++){
+      REQUIRE(vec[i] == expected[i]);
+    }
+    REQUIRE(vec.Erase(3));
+    CHECK(vec.Erase(8).Error() == Aii::Error::OutOfRange);
+    REQUIRE(vec.PopBack());
+    CHECK(vec.Back() == 6);
+  }
+  SUBCASE("Move and swap between inline and allocated vectors"){
+    for(std::uint64_t i = 0; i < 4; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    Small big;
+    for(std::uint64_t i = 0; i < 20; i++){
+      REQUIRE(big.PushBack(i + 100));
+    }
+    const std::uint64_t* bigData = big.Data();
+    vec.Swap(big);
+    CHECK(!vec.Inline());
+    CHECK(vec.Data() == bigData);
+    CHECK(vec.Size() == 20);
+    CHECK(big.Inline());
+    CHECK(big.Size() == 4);
+    CHECK(big[3] == 3);
+    Small moved{std::move(big)};
+    CHECK(big.Empty());
+    CHECK(moved.Inline());
+    CHECK(moved[3] == 3);
+    moved = std::move(vec);
+    CHECK(vec.Empty());
+    CHECK(vec.Inline());
+    CHECK(moved[19] == 119);
+  }
+}
+
+TEST_CASE("SmallVector<T, N, A> element lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::SmallVector<Tracked, 4> vec;
+    for(int i = 0; i < 4; i++){
+      REQUIRE(vec.EmplaceBack(i));
+    }
+    Aii::SmallVector<Tracked, 4> other{std::move(vec)};
+    CHECK(Tracked::live == 4);
+    for(int i = 4; i < 20; i++){
+      REQUIRE(other.EmplaceBack(i));
+    }
+    REQUIRE(other.Insert(0, Tracked{-1}));
+    REQUIRE(other.Erase(5));
+    CHECK(Tracked::live == 20);
+    for(const Tracked& t : other){
+      REQUIRE(t.Intact());
+    }
+    REQUIRE(other.Resize(3));
+    REQUIRE(other.ShrinkToFit());
+    CHECK(other.Inline());
+    CHECK(Tracked::live == 3);
+    for(const Tracked& t : other){
+      REQUIRE(t.Intact());
+    }
+    CHECK(other[0].val == -1);
+    CHECK(other[2].val == 1);
+  }
+  CHECK(Tracked::live == 0);
+}
@@ -0,0 +1,170 @@
+#include "doctest.h"
+
+// Tests for Aii::BasicSoaVector<A, Fields...> and Aii::Span<T>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/soa_vector.hpp"
+#include "aii/span.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+namespace{
+
+using Fixtures::CountingAllocator;
+using Fixtures::allocations;
+using Fixtures::Tracked;
+
+enum class State : std::uint8_t{
+  Ready,
+  Running,
+  Blocked
+};
+
+using Tasks = Aii::SoaVector<State, std::uint64_t, std::uint32_t>;
+
+} // namespace
+
+TEST_CASE("Span<T>"){
+  int array[] = {1, 2, 3, 4, 5};
+  Aii::Span<int> span{array};
+  REQUIRE(span.Size() == 5);
+  CHECK(span.Front() == 1);
+  CHECK(span.Back() == 5);
+  CHECK(span.First(2).Back() == 2);
+  CHECK(span.Last(2).Front() == 4);
+  CHECK(span.Subspan(1, 3).Size() == 3);
+  CHECK(span.Subspan(1, 3)[2] == 4);
+  span[0] = 10;
+  Aii::Span<const int> view = span;
+  int sum = 0;
+  for(int val : view){
+    sum += val;
+  }
+  CHECK(sum == 24);
+  CHECK(Aii::Span<int>{}.Empty());
+}
+
+TEST_CASE("SoaVector<Fields...> columns and records"){
+  Tasks tasks;
+  REQUIRE(tasks.Empty());
+  CHECK(tasks.Column<1>().Empty());
+
+  for(std::uint32_t i = 0; i < 1000; i++){
+    REQUIRE(tasks.EmplaceBack(i % 3 == 0 ? State::Running : State::Ready, std::uint64_t{i} * 10, i));
+  }
+  REQUIRE(tasks.Size() == 1000);
+
+  SUBCASE("Each column is contiguous and starts on a cache line"){
+    Aii::Span<State> states = tasks.Column<0>();
+    Aii::Span<std::uint64_t> runtimes = tasks.Column<1>();
+    Aii::Span<std::uint32_t> ids = tasks.Column<2>();
+    REQUIRE(states.Size() == 1000);
+    CHECK(reinterpret_cast<std::uintptr_t>(states.Data()) % Aii::CacheLineSize == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(runtimes.Data()) % Aii::CacheLineSize == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(ids.Data()) % Aii::CacheLineSize == 0);
+    std::size_t running = 0;
+    for(State state : states){
+      running += state == State::Running;
+    }
+    CHECK(running == 334);
+    std::uint64_t total = 0;
+    for(std::uint64_t runtime : runtimes){
+      total += runtime;
+    }
+    CHECK(total == 4995000);
+  }
+  SUBCASE("Records are read and written through proxies"){
+    auto task = tasks[7];
+    CHECK(task.Index() == 7);
+    CHECK(task.Get<2>() == 7);
+    task.Get<0>() = State::Blocked;
+    CHECK(tasks.Column<0>()[7] == State::Blocked);
+    auto [state, runtime, id] = tasks[9];
+    CHECK(state == State::Running);
+    CHECK(id == 9);
+    runtime = 5;
+    CHECK(tasks.Column<1>()[9] == 5);
+    const Tasks& view = tasks;
+    Tasks::ConstReference record = view[9];
+    CHECK(record.Get<1>() == 5);
+    std::uint32_t expected = 0;
+    for(auto [s, r, i] : view){
+      REQUIRE(i == expected);
+      expected++;
+    }
+    CHECK(expected == 1000);
+  }
+  SUBCASE("Erase keeps order, EraseUnordered fills from the back"){
+    REQUIRE(tasks.Erase(0));
+    CHECK(tasks[0].Get<2>() == 1);
+    CHECK(tasks.Size() == 999);
+    REQUIRE(tasks.EraseUnordered(0));
+    CHECK(tasks[0].Get<2>() == 999);
+    CHECK(tasks[0].Get<1>() == 9990);
+    CHECK(tasks.Back().Get<2>() == 998);
+    CHECK(tasks.Erase(998).Error() == Aii::Error::OutOfRange);
+    CHECK(tasks.EraseUnordered(998).Error() == Aii::Error::OutOfRange);
+    REQUIRE(tasks.EraseUnordered(997));
+    CHECK(tasks.Back().Get<2>() == 997);
+    REQUIRE(tasks.PopBack());
+    CHECK(tasks.Size() == 996);
+  }
+  SUBCASE("Storage can be reserved, shrunk, moved and swapped"){
+    REQUIRE(tasks.Reserve(5000));
+    CHECK(tasks.Capacity() == 5000);
+    CHECK(tasks.Column<2>()[999] == 999);
+    REQUIRE(tasks.ShrinkToFit());
+    CHECK(tasks.Capacity() == 1000);
+    // a record of the vector itself may be appended while it grows
+    auto [state, runtime, id] = tasks[500];
+    REQUIRE(tasks.PushBack(state, runtime, id));
+    CHECK(tasks.Back().Get<1>() == 5000);
+    Tasks other{std::move(tasks)};
+    CHECK(tasks.Empty());
+    CHECK(other.Size() == 1001);
+    tasks.Swap(other);
+    CHECK(tasks.Column<2>()[1000] == 500);
+    other = std::move(tasks);
+    CHECK(other.Size() == 1001);
+    other.Clear();
+    REQUIRE(other.ShrinkToFit());
+    CHECK(other.Capacity() == 0);
+  }
+}
+
+TEST_CASE("SoaVector<Fields...> field lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::SoaVector<int, Tracked> vec;
+    for(int i = 0; i < 100; i++){
+      REQUIRE(vec.EmplaceBack(i, i));
+    }
+    CHECK(Tracked::live == 100);
+    REQUIRE(vec.Erase(10));
+    REQUIRE(vec.EraseUnordered(10));
+    REQUIRE(vec.PopBack());
+    CHECK(Tracked::live == 97);
+    CHECK(vec[10].Get<1>().val == 99);
+    CHECK(vec[11].Get<1>().val == 12);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+TEST_CASE("BasicSoaVector<A, Fields...> allocates through A"){
+  allocations = 0;
+  {
+    Aii::BasicSoaVector<CountingAllocator<char>, int, std::uint64_t> vec;
+    CHECK(allocations == 0);
+    for(int i = 0; i < 100; i++){
+      REQUIRE(vec.EmplaceBack(i, std::uint64_t(i) * 2));
+    }
+    // 16 records at first, doubled three times to 128
+    CHECK(allocations == 4);
+    REQUIRE(vec.ShrinkToFit());
+    CHECK(allocations == 5);
+    CHECK(vec.Column<1>()[99] == 198);
+  }
+}
@@ -0,0 +1,131 @@
+#include "doctest.h"
+
+// Tests for Aii::SpinLock, Aii::TicketLock, Aii::McsLock and
+// Aii::QueuedSpinLock
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/atomic.hpp"
+#include "aii/spinlock.hpp"
+
+namespace{
+
+constexpr int Rounds = 20000;
+
+unsigned ThreadCount(){
+  // the fair locks hand the lock to the next waiter whether it is running
+  // or not, so with more threads than cpus nearly every acquisition waits
+  // out a scheduler time slice
+  unsigned cpus = std::thread::hardware_concurrency();
+  return cpus < 1 ? 1 : cpus > 4 ? 4 : cpus;
+}
+
+template<typename L>
+void CheckSingleThread(){
+  L lock;
+  CHECK(!lock.IsLocked());
+  if constexpr(requires{ lock.Lock();}){
+    lock.Lock();
+    CHECK(lock.IsLocked());
+    CHECK(!lock.TryLock());
+    lock.Unlock();
+    CHECK(lock.TryLock());
+    lock.Unlock();
+  }
+  else{
+    typename L::Node first;
+    typename L::Node second;
+    lock.Lock(first);
+    CHECK(lock.IsLocked());
+    CHECK(!lock.TryLock(second));
+    lock.Unlock(first);
+    CHECK(lock.TryLock(second));
+    lock.Unlock(second);
+  }
+  CHECK(!lock.IsLocked());
+}
+
+template<typename L>
+std::uint64_t RunContended(L& lock){
+  // every thread increments a plain counter under the lock, which only
+  // adds up when the lock excludes
+  std::uint64_t counter = 0;
+  Aii::Atomic<bool> start{false};
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < ThreadCount(); t++){
+    threads.emplace_back([&lock, &counter, &start]{
+      while(!start.Load(Aii::MemoryOrder::Acquire)){
+        Aii::CpuRelax();
+      }
+      for(int round = 0; round < Rounds; round++){
+        if constexpr(requires{ lock.Lock();}){
+          Aii::LockGuard guard{lock};
+          counter++;
+        }
+        else{
+          Aii::McsLockGuard guard{lock};
+          counter++;
+        }
+      }
+    });
+  }
+  start.Store(true, Aii::MemoryOrder::Release);
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  return counter;
+}
+
+} // namespace
+
+TEST_CASE("Spin locks from one thread"){
+  CheckSingleThread<Aii::SpinLock>();
+  CheckSingleThread<Aii::TicketLock<>>();
+  CheckSingleThread<Aii::McsLock<>>();
+  CheckSingleThread<Aii::QueuedSpinLock<>>();
+  // the stats are free when off
+  CHECK(sizeof(Aii::TicketLock<>) == 8);
+  CHECK(sizeof(Aii::QueuedSpinLock<>) == 8);
+}
+
+TEST_CASE("Spin locks exclude"){
+  Aii::SpinLock spinLock;
+  CHECK(RunContended(spinLock) == ThreadCount() * Rounds);
+  Aii::TicketLock<> ticketLock;
+  CHECK(RunContended(ticketLock) == ThreadCount() * Rounds);
+  Aii::McsLock<> mcsLock;
+  CHECK(RunContended(mcsLock) == ThreadCount() * Rounds);
+  Aii::QueuedSpinLock<> queuedLock;
+  CHECK(RunContended(queuedLock) == ThreadCount() * Rounds);
+  CHECK(!queuedLock.IsLocked());
+}
+
+TEST_CASE("Spin lock stats"){
+  Aii::QueuedSpinLock<true> lock;
+  for(int i = 0; i < 3; i++){
+    Aii::LockGuard guard{lock};
+  }
+  CHECK(lock.TryLock());
+  lock.Unlock();
+  CHECK(lock.Stats().acquisitions == 4);
+  CHECK(lock.Stats().contended == 0);
+  CHECK(lock.Stats().spins == 0);
+  lock.ResetStats();
+  CHECK(lock.Stats().acquisitions == 0);
+
+  Aii::TicketLock<true> ticketLock;
+  CHECK(RunContended(ticketLock) == ThreadCount() * Rounds);
+  CHECK(ticketLock.Stats().acquisitions == ThreadCount() * Rounds);
+  CHECK(ticketLock.Stats().contended <= ticketLock.Stats().acquisitions);
+  Aii::McsLock<true> mcsLock;
+  CHECK(RunContended(mcsLock) == ThreadCount() * Rounds);
+  CHECK(mcsLock.Stats().acquisitions == ThreadCount() * Rounds);
+  Aii::QueuedSpinLock<true> queuedLock;
+  CHECK(RunContended(queuedLock) == ThreadCount() * Rounds);
+  CHECK(queuedLock.Stats().acquisitions == ThreadCount() * Rounds);
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+  CHECK(queuedLock.Stats().maxHoldCycles > 0);
+#endif
+}
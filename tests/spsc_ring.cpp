@@ -0,0 +1,121 @@
+#include "doctest.h"
+
+// Tests for Aii::SpscRing<T, N>
+
+#include <cstdint>
+#include <thread>
+
+#include "aii/spsc_ring.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+using Fixtures::Tracked;
+
+TEST_CASE("SpscRing<T, N> from one thread"){
+  Aii::SpscRing<std::uint64_t, 8> ring;
+  REQUIRE(ring.Empty());
+  CHECK(ring.Capacity() == 8);
+  CHECK(ring.Pop().Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("Elements come out in order and the ring wraps"){
+    std::uint64_t next = 0;
+    std::uint64_t expected = 0;
+    for(int round = 0; round < 100; round++){
+      while(ring.Push(next)){
+        next++;
+      }
+      REQUIRE(ring.Size() == 8);
+      for(int i = 0; i < 5; i++){
+        auto val = ring.Pop();
+        REQUIRE(val);
+        REQUIRE(*val == expected);
+        expected++;
+      }
+    }
+    CHECK(ring.Size() == 3);
+  }
+  SUBCASE("Batches are cut to the room available"){
+    std::uint64_t src[12];
+    for(std::uint64_t i = 0; i < 12; i++){
+      src[i] = i;
+    }
+    CHECK(ring.PushN(src, 5) == 5);
+    CHECK(ring.PushN(src + 5, 7) == 3);
+    CHECK(ring.PushN(src, 1) == 0);
+    std::uint64_t dest[12] = {};
+    CHECK(ring.PopN(dest, 6) == 6);
+    CHECK(ring.PushN(src + 8, 4) == 4);
+    CHECK(ring.PopN(dest + 6, 12) == 6);
+    CHECK(ring.PopN(dest, 1) == 0);
+    for(std::uint64_t i = 0; i < 12; i++){
+      REQUIRE(dest[i] == i);
+    }
+  }
+}
+
+TEST_CASE("SpscRing<T, N> element lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::SpscRing<Tracked, 4> ring;
+    for(int i = 0; i < 4; i++){
+      REQUIRE(ring.Emplace(i));
+    }
+    CHECK(ring.Emplace(4).Error() == Aii::Error::OutOfRange);
+    CHECK(Tracked::live == 4);
+    {
+      auto val = ring.Pop();
+      REQUIRE(val);
+      CHECK(val->val == 0);
+    }
+    Tracked dest[2];
+    CHECK(ring.PopN(dest, 2) == 2);
+    CHECK(dest[1].val == 2);
+    CHECK(Tracked::live == 3);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+TEST_CASE("SpscRing<T, N> between two threads"){
+  constexpr std::uint64_t Count = 200000;
+  Aii::SpscRing<std::uint64_t, 64> ring;
+  std::thread producer{[&ring]{
+    std::uint64_t batch[7];
+    std::uint64_t next = 0;
+    while(next < Count){
+      if(next % 2){
+        if(!ring.Push(next)){
+          std::this_thread::yield();
+          continue;
+        }
+        next++;
+        continue;
+      }
+      std::size_t count = 0;
+      for(; count < 7 && next + count < Count; count++){
+        batch[count] = next + count;
+      }
+      std::size_t pushed = ring.PushN(batch, count);
+      if(!pushed){
+        std::this_thread::yield();
+      }
+      next += pushed;
+    }
+  }};
+  std::uint64_t expected = 0;
+  bool ordered = true;
+  std::uint64_t batch[5];
+  while(expected < Count){
+    std::size_t popped = ring.PopN(batch, 5);
+    if(!popped){
+      std::this_thread::yield();
+    }
+    for(std::size_t i = 0; i < popped; i++){
+      ordered &= batch[i] == expected;
+      expected++;
+    }
+  }
+  producer.join();
+  CHECK(ordered);
+  CHECK(ring.Empty());
+}
@@ -0,0 +1,111 @@
+#include "doctest.h"
+
+// Tests for Aii::StableVector<T>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/stable_vector.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+using Fixtures::Tracked;
+
+TEST_CASE("StableVector<T>"){
+  Aii::StableVector<std::uint64_t> vec{1 << 20};
+  REQUIRE(vec.Empty());
+  CHECK(vec.MaxSize() == 1 << 20);
+  CHECK(vec.Capacity() == 0);
+  CHECK(vec.Data() == nullptr);
+
+  SUBCASE("Growing never moves an element"){
+    REQUIRE(vec.PushBack(0));
+    std::uint64_t* first = vec.Data();
+    std::uint64_t* middle = nullptr;
+    for(std::uint64_t i = 1; i < 500000; i++){
+      REQUIRE(vec.PushBack(i));
+      if(i == 1000){
+        middle = &vec.Back();
+      }
+    }
+    CHECK(vec.Data() == first);
+    CHECK(&vec[1000] == middle);
+    CHECK(*middle == 1000);
+    std::uint64_t expected = 0;
+    for(std::uint64_t val : vec){
+      REQUIRE(val == expected);
+      expected++;
+    }
+    CHECK(vec.Capacity() >= vec.Size());
+  }
+  SUBCASE("Memory is committed in growing steps and given back on shrink"){
+    REQUIRE(vec.PushBack(1));
+    CHECK(vec.Capacity() * sizeof(std::uint64_t) == 1 << 16);
+    REQUIRE(vec.Resize(100000));
+    std::size_t committed = vec.Capacity();
+    CHECK(committed >= 100000);
+    REQUIRE(vec.Resize(10));
+    vec.ShrinkToFit();
+    CHECK(vec.Capacity() < committed);
+    CHECK(vec.Capacity() >= 10);
+    CHECK(vec[9] == 0);
+    CHECK(vec[0] == 1);
+    // decommitted pages come back zeroed when grown into again
+    REQUIRE(vec.Resize(50000));
+    CHECK(vec[49999] == 0);
+    vec.Clear();
+    vec.ShrinkToFit();
+    CHECK(vec.Data() == nullptr);
+    REQUIRE(vec.PushBack(2));
+    CHECK(vec.Front() == 2);
+  }
+  SUBCASE("The reservation bounds the size"){
+    Aii::StableVector<std::uint64_t> small{100};
+    REQUIRE(small.Resize(100));
+    CHECK(small.PushBack(1).Error() == Aii::Error::OutOfRange);
+    CHECK(small.Resize(101).Error() == Aii::Error::OutOfRange);
+    CHECK(small.Reserve(101).Error() == Aii::Error::OutOfRange);
+    REQUIRE(small.PopBack());
+    REQUIRE(small.PushBack(1));
+    CHECK(small.Size() == 100);
+  }
+  SUBCASE("A reservation larger than the address space is rejected"){
+    Aii::StableVector<std::uint64_t> huge{~std::size_t{0} / 4};
+    CHECK(huge.PushBack(1).Error() == Aii::Error::InvalidArgument);
+    CHECK(huge.Reserve(1).Error() == Aii::Error::InvalidArgument);
+    CHECK(huge.Resize(1).Error() == Aii::Error::InvalidArgument);
+    CHECK(huge.Data() == nullptr);
+    CHECK(huge.Empty());
+  }
+  SUBCASE("Move and swap hand over the reservation"){
+    for(std::uint64_t i = 0; i < 10; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    std::uint64_t* data = vec.Data();
+    Aii::StableVector<std::uint64_t> other{std::move(vec)};
+    CHECK(vec.Empty());
+    CHECK(other.Data() == data);
+    vec.Swap(other);
+    CHECK(vec.Data() == data);
+    other = std::move(vec);
+    CHECK(other[9] == 9);
+  }
+}
+
+TEST_CASE("StableVector<T> element lifetimes"){
+  Tracked::live = 0;
+  {
+    Aii::StableVector<Tracked> vec;
+    for(int i = 0; i < 1000; i++){
+      REQUIRE(vec.EmplaceBack(i));
+    }
+    CHECK(Tracked::live == 1000);
+    REQUIRE(vec.Resize(10));
+    CHECK(Tracked::live == 10);
+    REQUIRE(vec.PopBack());
+    CHECK(Tracked::live == 9);
+    CHECK(vec.Back().val == 8);
+  }
+  CHECK(Tracked::live == 0);
+}
@@ -0,0 +1,137 @@
+#include "doctest.h"
+
+// Tests for Aii::StaticVector<T, N>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "aii/static_vector.hpp"
+#include "aii/error.hpp"
+
+namespace{
+
+// the first Count primes, worked out at compile time
+template<std::size_t Count>
+constexpr Aii::StaticVector<std::uint32_t, Count> Primes(){
+  Aii::StaticVector<std::uint32_t, Count> primes;
+  for(std::uint32_t candidate = 2; !primes.Full(); candidate++){
+    bool prime = true;
+    for(std::uint32_t p : primes){
+      if(candidate % p == 0){
+        prime = false;
+        break;
+      }
+    }
+    if(prime){
+      (void)primes.PushBack(candidate);
+    }
+  }
+  return primes;
+}
+
+constexpr auto SmallPrimes = Primes<10>();
+static_assert(SmallPrimes.Size() == 10);
+static_assert(SmallPrimes[9] == 29);
+static_assert(std::is_trivially_copyable_v<Aii::StaticVector<int, 4>>);
+
+// a type with a constexpr destructor which checks every object it counts
+// is destroyed exactly once
+struct Counted{
+  int* live;
+  int val;
+
+  constexpr Counted(int* l, int v) noexcept: live{l}, val{v}{ (*live)++;}
+  constexpr Counted(const Counted& src) noexcept: live{src.live}, val{src.val}{ (*live)++;}
+  constexpr Counted(Counted&& src) noexcept: live{src.live}, val{src.val}{ (*live)++;}
+  constexpr Counted& operator=(const Counted& src) noexcept{ val = src.val; return *this;}
+  constexpr ~Counted() noexcept{ (*live)--;}
+};
+
+constexpr bool Edits(){
+  // insertion, erasure and copies in constant evaluation, where any use of
+  // an element outside its lifetime is a compile error
+  int live = 0;
+  {
+    Aii::StaticVector<Counted, 8> vec;
+    for(int i = 0; i < 6; i++){
+      if(!vec.EmplaceBack(&live, i)){
+        return false;
+      }
+    }
+    if(!vec.Insert(2, Counted{&live, 100}) || !vec.Erase(0) || !vec.PopBack()){
+      return false;
+    }
+    Aii::StaticVector<Counted, 8> copy{vec};
+    if(copy.Size() != 5 || copy[1].val != 100 || copy[4].val != 4 || live != 10){
+      return false;
+    }
+    copy = std::move(vec);
+    if(!copy.PopBack() || !copy.PopBack() || !copy.PopBack() || copy.Back().val != 100 || live != 7){
+      return false;
+    }
+  }
+  return live == 0;
+}
+
+static_assert(Edits());
+
+} // namespace
+
+TEST_CASE("StaticVector<T, N>"){
+  Aii::StaticVector<std::uint64_t, 8> vec;
+  REQUIRE(vec.Empty());
+  CHECK(vec.Capacity() == 8);
+
+  SUBCASE("A full vector rejects new elements and is left as it was"){
+    for(std::uint64_t i = 0; i < 8; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    CHECK(vec.Full());
+    CHECK(vec.PushBack(8).Error() == Aii::Error::OutOfRange);
+    CHECK(vec.Insert(0, 8).Error() == Aii::Error::OutOfRange);
+    CHECK(vec.Resize(9).Error() == Aii::Error::OutOfRange);
+    REQUIRE(vec.Size() == 8);
+    for(std::uint64_t i = 0; i < 8; i++){
+      REQUIRE(vec[i] == i);
+    }
+  }
+  SUBCASE("Insert and erase shift the elements after them"){
+    for(std::uint64_t i = 0; i < 5; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    REQUIRE(**vec.Insert(0, 100) == 100);
+    REQUIRE(**vec.Insert(3, 103) == 103);
+    REQUIRE(vec.Insert(vec.Size(), vec[0]));
+    CHECK(vec.Insert(9, 0).Error() == Aii::Error::OutOfRange);
+    std::uint64_t expected[] = {100, 0, 1, 103, 2, 3, 4, 100};
+    REQUIRE(vec.Size() == 8);
+    for(std::size_t i = 0; i < 8; i++){
+      REQUIRE(vec[i] == expected[i]);
+    }
+    REQUIRE(vec.Erase(3));
+    REQUIRE(vec.Erase(0));
+    CHECK(vec.Erase(6).Error() == Aii::Error::OutOfRange);
+    REQUIRE(vec.PopBack());
+    for(std::uint64_t i = 0; i < 5; i++){
+      REQUIRE(vec[i] == i);
+    }
+    vec.Clear();
+    CHECK(vec.PopBack().Error() == Aii::Error::OutOfRange);
+  }
+  SUBCASE("Copies compare equal"){
+    REQUIRE(vec.Resize(3));
+    vec[1] = 5;
+    Aii::StaticVector<std::uint64_t, 8> copy = vec;
+    CHECK(copy == vec);
+    copy[2] = 1;
+    CHECK(!(copy == vec));
+  }
+  SUBCASE("Tables built at compile time are usable at runtime"){
+    std::uint64_t sum = 0;
+    for(std::uint32_t p : SmallPrimes){
+      sum += p;
+    }
+    CHECK(sum == 129);
+  }
+}
@@ -1,9 +1,12 @@
-#include "doctest.h"
-
 #include <iostream>
 #include <cassert>
+#include <cstddef>
 #include <utility>
 
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 // Implementation of the stubs for testing purposes
 
 namespace Aii::Details{
@@ -18,9 +21,46 @@ namespace Aii::Details{
   }
 
   template<typename T, typename ...Args>
-  T* Allocate(Args ...args){
+  T* Allocate(Args&& ...args){
     // perfect forward the argument to the allocation function
-    return new T{std::forward<T>(args)...};
+    return new T{std::forward<Args>(args)...};
+  }
+
+  template<typename T>
+  T* AllocateArray(std::size_t n){
+    return new T[n]{};
+  }
+
+  template<typename T>
+  void DeleteArray(T* t, std::size_t){
+    delete[] t;
+  }
+
+  inline std::size_t PageSize(){
+    return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  }
+
+  inline void* ReserveVirtual(std::size_t bytes){
+    void* address = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+  }
+
+  inline bool Commit(void* address, std::size_t bytes){
+    return mprotect(address, bytes, PROT_READ | PROT_WRITE) == 0;
+  }
+
+  inline void Decommit(void* address, std::size_t bytes){
+    madvise(address, bytes, MADV_DONTNEED);
+    mprotect(address, bytes, PROT_NONE);
+  }
+
+  inline void ReleaseVirtual(void* address, std::size_t bytes){
+    munmap(address, bytes);
+  }
+
+  inline std::size_t CurrentCpu(){
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : static_cast<std::size_t>(cpu);
   }
 
 } // namespace Aii::Details
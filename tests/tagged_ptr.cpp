@@ -0,0 +1,76 @@
+#include "doctest.h"
+
+// Tests for Aii::TaggedPtr<T, Bits>
+
+#include <cstdint>
+
+#include "aii/tagged_ptr.hpp"
+
+struct alignas(8) Aligned8{
+  int num;
+};
+
+TEST_CASE("TaggedPtr<T, Bits> constructors tests"){
+  SUBCASE("Default constructor should be null with an empty tag"){
+    Aii::TaggedPtr<Aligned8, 3> tptr{};
+    CHECK(!tptr);
+    CHECK(tptr.Ptr() == nullptr);
+    CHECK(tptr.Tag() == 0);
+  }
+  SUBCASE("Constructor with a pointer and tag should store both"){
+    Aligned8 obj{100};
+    Aii::TaggedPtr<Aligned8, 3> tptr{&obj, 5};
+    CHECK(tptr);
+    CHECK(tptr.Ptr() == &obj);
+    CHECK(tptr.Tag() == 5);
+    CHECK(tptr->num == 100);
+    CHECK((*tptr).num == 100);
+  }
+  SUBCASE("Tags wider than Bits are truncated"){
+    Aligned8 obj{100};
+    Aii::TaggedPtr<Aligned8, 2> tptr{&obj, 0xff};
+    CHECK(tptr.Ptr() == &obj);
+    CHECK(tptr.Tag() == 3);
+  }
+}
+
+TEST_CASE("TaggedPtr<T, Bits> setters keep the other half intact"){
+  Aligned8 obj1{1};
+  Aligned8 obj2{2};
+  Aii::TaggedPtr<Aligned8, 3> tptr{&obj1, 6};
+
+  SUBCASE("SetPtr() preserves the tag"){
+    tptr.SetPtr(&obj2);
+    CHECK(tptr.Ptr() == &obj2);
+    CHECK(tptr.Tag() == 6);
+  }
+  SUBCASE("SetTag() preserves the pointer"){
+    tptr.SetTag(1);
+    CHECK(tptr.Ptr() == &obj1);
+    CHECK(tptr.Tag() == 1);
+  }
+  SUBCASE("SetBit() and Bit() address single flags"){
+    tptr.SetBit(0, true);
+    tptr.SetBit(2, false);
+    CHECK(tptr.Bit(0));
+    CHECK(tptr.Bit(1));
+    CHECK(!tptr.Bit(2));
+    CHECK(tptr.Tag() == 3);
+    CHECK(tptr.Ptr() == &obj1);
+  }
+  SUBCASE("A null pointer can still carry a tag"){
+    tptr.SetPtr(nullptr);
+    CHECK(!tptr);
+    CHECK(tptr.Tag() == 6);
+  }
+}
+
+TEST_CASE("TaggedPtr<T, Bits> raw round trip and comparison"){
+  Aligned8 obj{1};
+  Aii::TaggedPtr<Aligned8, 3> tptr1{&obj, 2};
+  auto tptr2 = Aii::TaggedPtr<Aligned8, 3>::FromRaw(tptr1.Raw());
+  CHECK(tptr1 == tptr2);
+  tptr2.SetTag(3);
+  CHECK(tptr1 != tptr2);
+  CHECK(sizeof(tptr1) == sizeof(Aligned8*));
+}
@@ -0,0 +1,179 @@
+#include "doctest.h"
+
+// Tests for Aii::Vector<T, A>
+
+#include <cstdint>
+#include <utility>
+
+#include "aii/vector.hpp"
+#include "aii/error.hpp"
+
+#include "fixtures.hpp"
+
+namespace{
+
+using Fixtures::Tracked;
+
+// owns a heap object, so it is not trivially copyable but may be
+// relocated by copying its bytes
+struct Owner{
+  static inline int moves = 0;
+
+  int* val;
+
+  explicit Owner(int v) noexcept: val{new int{v}}{}
+  Owner(Owner&& src) noexcept: val{src.val}{ src.val = nullptr; moves++;}
+  Owner& operator=(Owner&& src) noexcept{ std::swap(val, src.val); return *this;}
+  ~Owner() noexcept{ delete val;}
+};
+
+} // namespace
+
+template<>
+inline constexpr bool Aii::IsTriviallyRelocatable<Owner> = true;
+
+static_assert(Aii::IsTriviallyRelocatable<int>);
+static_assert(!Aii::IsTriviallyRelocatable<Tracked>);
+
+TEST_CASE("Vector<T, A> growth and access"){
+  Aii::Vector<std::uint64_t> vec;
+  REQUIRE(vec.Empty());
+  CHECK(vec.Capacity() == 0);
+  CHECK(vec.begin() == vec.end());
+
+  SUBCASE("Appends keep their order and capacity doubles"){
+    std::size_t reallocations = 0;
+    std::size_t capacity = 0;
+    for(std::uint64_t i = 0; i < 10000; i++){
+      REQUIRE(vec.PushBack(i * 3));
+      if(vec.Capacity() != capacity){
+        CHECK(vec.Capacity() >= capacity * 2);
+        capacity = vec.Capacity();
+        reallocations++;
+      }
+    }
+    CHECK(reallocations < 16);
+    CHECK(vec.Size() == 10000);
+    CHECK(vec.Front() == 0);
+    CHECK(vec.Back() == 9999 * 3);
+    std::uint64_t expected = 0;
+    for(std::uint64_t val : vec){
+      REQUIRE(val == expected);
+      expected += 3;
+    }
+  }
+  SUBCASE("Reserve, Resize and ShrinkToFit"){
+    REQUIRE(vec.Reserve(100));
+    CHECK(vec.Capacity() == 100);
+    std::uint64_t* data = vec.Data();
+    for(std::uint64_t i = 0; i < 100; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    CHECK(vec.Data() == data);
+    REQUIRE(vec.Reserve(10));
+    CHECK(vec.Capacity() == 100);
+    REQUIRE(vec.Resize(20));
+    CHECK(vec.Size() == 20);
+    CHECK(vec.Back() == 19);
+    REQUIRE(vec.ShrinkToFit());
+    CHECK(vec.Capacity() == 20);
+    CHECK(vec[19] == 19);
+    REQUIRE(vec.Resize(25));
+    CHECK(vec[20] == 0);
+    CHECK(vec[24] == 0);
+    vec.Clear();
+    REQUIRE(vec.ShrinkToFit());
+    CHECK(vec.Capacity() == 0);
+    CHECK(vec.Data() == nullptr);
+  }
+  SUBCASE("Insert and erase shift the elements after them"){
+    for(std::uint64_t i = 0; i < 10; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    REQUIRE(vec.ShrinkToFit());
+    // full, so the first insert reallocates and the second shifts in place
+    REQUIRE(**vec.Insert(0, 100) == 100);
+    REQUIRE(**vec.Insert(5, 105) == 105);
+    CHECK(vec.Insert(13, 0).Error() == Aii::Error::OutOfRange);
+    std::uint64_t expected[] = {100, 0, 1, 2, 3, 105, 4, 5, 6, 7, 8, 9};
+    REQUIRE(vec.Size() == 12);
+    for(std::size_t i = 0; i < 12; i++){
+      REQUIRE(vec[i] == expected[i]);
+    }
+    REQUIRE(vec.Erase(5));
+    REQUIRE(vec.Erase(0));
+    CHECK(vec.Erase(10).Error() == Aii::Error::OutOfRange);
+    for(std::uint64_t i = 0; i < 10; i++){
+      REQUIRE(vec[i] == i);
+    }
+    REQUIRE(vec.PopBack());
+    CHECK(vec.Back() == 8);
+  }
+  SUBCASE("Appending an element of the vector itself"){
+    REQUIRE(vec.PushBack(7));
+    REQUIRE(vec.ShrinkToFit());
+    REQUIRE(vec.PushBack(vec[0]));
+    REQUIRE(vec.Insert(0, vec[1]));
+    CHECK(vec[0] == 7);
+    CHECK(vec[1] == 7);
+    CHECK(vec[2] == 7);
+  }
+  SUBCASE("Move and swap"){
+    for(std::uint64_t i = 0; i < 10; i++){
+      REQUIRE(vec.PushBack(i));
+    }
+    Aii::Vector<std::uint64_t> other{std::move(vec)};
+    CHECK(vec.Empty());
+    CHECK(other.Size() == 10);
+    vec = std::move(other);
+    CHECK(vec.Size() == 10);
+    vec.Swap(other);
+    CHECK(vec.Empty());
+    CHECK(other[9] == 9);
+  }
+}
+
+TEST_CASE("Vector<T, A> element lifetimes"){
+  SUBCASE("Elements which are not trivially relocatable are moved one by one"){
+    Tracked::live = 0;
+    {
+      Aii::Vector<Tracked> vec;
+      for(int i = 0; i < 100; i++){
+        REQUIRE(vec.EmplaceBack(i));
+        REQUIRE(Tracked::live == i + 1);
+      }
+      REQUIRE(vec.Insert(50, Tracked{-1}));
+      REQUIRE(vec.Erase(10));
+      REQUIRE(vec.PopBack());
+      CHECK(Tracked::live == 99);
+      for(const Tracked& t : vec){
+        REQUIRE(t.Intact());
+      }
+      CHECK(vec[10].val == 11);
+      CHECK(vec[49].val == -1);
+      REQUIRE(vec.Resize(10));
+      CHECK(Tracked::live == 10);
+      REQUIRE(vec.ShrinkToFit());
+      for(const Tracked& t : vec){
+        REQUIRE(t.Intact());
+      }
+    }
+    CHECK(Tracked::live == 0);
+  }
+  SUBCASE("Trivially relocatable elements are copied as bytes when growing"){
+    Owner::moves = 0;
+    Aii::Vector<Owner> vec;
+    for(int i = 0; i < 1000; i++){
+      REQUIRE(vec.EmplaceBack(i));
+    }
+    REQUIRE(vec.Insert(0, Owner{-1}));
+    REQUIRE(vec.Erase(500));
+    REQUIRE(vec.ShrinkToFit());
+    // only the moves out of the temporaries, none for relocation
+    CHECK(Owner::moves == 2);
+    CHECK(*vec[0].val == -1);
+    CHECK(*vec[1].val == 0);
+    CHECK(*vec[500].val == 500);
+    CHECK(*vec.Back().val == 999);
+  }
+}
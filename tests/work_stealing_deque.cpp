@@ -0,0 +1,102 @@
+#include "doctest.h"
+
+// Tests for Aii::WorkStealingDeque<T, A>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "aii/work_stealing_deque.hpp"
+#include "aii/atomic.hpp"
+#include "aii/error.hpp"
+
+TEST_CASE("WorkStealingDeque<T, A> from one thread"){
+  Aii::WorkStealingDeque<std::uint64_t> deque;
+  REQUIRE(deque.Empty());
+  CHECK(deque.Capacity() == 0);
+  CHECK(deque.Pop().Error() == Aii::Error::OutOfRange);
+  CHECK(deque.Steal().Error() == Aii::Error::OutOfRange);
+
+  SUBCASE("The owner pops LIFO and thieves steal FIFO"){
+    for(std::uint64_t i = 0; i < 10; i++){
+      REQUIRE(deque.Push(i));
+    }
+    CHECK(*deque.Pop() == 9);
+    CHECK(*deque.Steal() == 0);
+    CHECK(*deque.Pop() == 8);
+    CHECK(*deque.Steal() == 1);
+    CHECK(deque.Size() == 6);
+    for(std::uint64_t i = 7; i >= 2; i--){
+      REQUIRE(*deque.Pop() == i);
+    }
+    CHECK(deque.Pop().Error() == Aii::Error::OutOfRange);
+    CHECK(deque.Steal().Error() == Aii::Error::OutOfRange);
+    REQUIRE(deque.Push(5));
+    CHECK(*deque.Steal() == 5);
+  }
+  SUBCASE("Growing keeps the elements and the window moves around the ring"){
+    std::uint64_t stolen = 0;
+    for(std::uint64_t i = 0; i < 1000; i++){
+      REQUIRE(deque.Push(i));
+      if(i % 3 == 0){
+        REQUIRE(*deque.Steal() == stolen);
+        stolen++;
+      }
+    }
+    CHECK(deque.Capacity() >= deque.Size());
+    deque.Reclaim();
+    while(auto val = deque.Steal()){
+      REQUIRE(*val == stolen);
+      stolen++;
+    }
+    CHECK(stolen == 1000);
+  }
+}
+
+TEST_CASE("WorkStealingDeque<T, A> with thieves"){
+  constexpr std::uint64_t Count = 100000;
+  constexpr unsigned Thieves = 3;
+  Aii::WorkStealingDeque<std::uint64_t> deque;
+  // every element is taken exactly once
+  std::vector<Aii::Atomic<std::uint8_t>> taken(Count);
+  Aii::Atomic<bool> done{false};
+  std::vector<std::thread> thieves;
+  for(unsigned t = 0; t < Thieves; t++){
+    thieves.emplace_back([&]{
+      while(!done.Load(Aii::MemoryOrder::Acquire)){
+        if(auto val = deque.Steal()){
+          taken[*val].FetchAdd(1, Aii::MemoryOrder::Relaxed);
+        }
+        else{
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(std::uint64_t i = 0; i < Count; i++){
+    REQUIRE(deque.Push(i));
+    if(i % 4 == 3){
+      // pop two, so the deque both grows and drains to the last element
+      for(int j = 0; j < 2; j++){
+        if(auto val = deque.Pop()){
+          taken[*val].FetchAdd(1, Aii::MemoryOrder::Relaxed);
+        }
+      }
+    }
+    if(i % 10000 == 0){
+      deque.Reclaim();
+    }
+  }
+  while(auto val = deque.Pop()){
+    taken[*val].FetchAdd(1, Aii::MemoryOrder::Relaxed);
+  }
+  done.Store(true, Aii::MemoryOrder::Release);
+  for(std::thread& thief : thieves){
+    thief.join();
+  }
+  std::uint64_t once = 0;
+  for(const Aii::Atomic<std::uint8_t>& count : taken){
+    once += count.Load() == 1;
+  }
+  CHECK(once == Count);
+}